@@ -0,0 +1,370 @@
+#ifndef _BENCH_MESH_H_
+#define _BENCH_MESH_H_
+
+/*
+ * Npatch - Nagata Patch Library
+ *
+ * Copyright (c) 2015-2016 Advanced Institute for Computational Science, RIKEN.
+ * All rights reserved.
+ *
+ */
+
+////////////////////////////////////////////////////////////////////////////
+///
+/// ベンチマーク用 合成メッシュ生成
+///   三角形単位（頂点座標、頂点法線ベクトル）の配列を生成する
+///     sphere    : 単位球（正八面体の分割、解析的な法線）
+///     torus     : トーラス R=1.0 r=0.3（解析的な法線）
+///     cylinder  : 円柱 R=1.0 高さ2.0 の側面（解析的な法線）
+///     ellipsoid : 楕円体 a=1.0 b=0.7 c=0.4（正八面体の分割、解析的な法線）
+///     plane     : ノイズ付き平面（法線もランダムに傾ける）
+///     sliver    : 細長い三角形（アスペクト比 50-200、法線が平行となる縮退ケースを含む）
+///
+////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdint.h>
+#ifdef _OPENMP
+#include <omp.h>
+#else
+#include <sys/time.h>
+#endif
+
+#include "Npt.h"
+
+#ifndef PAI
+#define PAI 3.14159265358979323846
+#endif
+
+// 解析曲面の形状
+#define BENCH_TORUS_R        1.0
+#define BENCH_TORUS_r        0.3
+#define BENCH_CYLINDER_R     1.0
+#define BENCH_CYLINDER_H     2.0
+#define BENCH_ELLIPSOID_A    1.0
+#define BENCH_ELLIPSOID_B    0.7
+#define BENCH_ELLIPSOID_C    0.4
+
+///
+/// ベンチマーク用メッシュ（三角形単位の配列）
+///
+typedef struct {
+    int        num;          ///< 三角形数
+    NPT_REAL (*tri)[3][3];   ///< 三角形の頂点座標
+    NPT_REAL (*norm)[3][3];  ///< 三角形の頂点法線ベクトル
+} BENCH_MESH;
+
+
+/// 経過時間 (sec)
+static inline double
+bench_time( void )
+{
+#ifdef _OPENMP
+    return omp_get_wtime();
+#else
+    struct timeval tv;
+    gettimeofday( &tv, NULL );
+    return (double)tv.tv_sec + 1.0e-6*(double)tv.tv_usec;
+#endif
+}
+
+
+/// 再現性のある乱数 [0,1)  (xorshift64)
+static inline double
+bench_rand( uint64_t* state )
+{
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *state = x;
+    return (double)( x >> 11 ) * ( 1.0/9007199254740992.0 );
+}
+
+
+/// 領域確保
+static inline int
+bench_mesh_alloc( int num, BENCH_MESH* mesh )
+{
+    mesh->num  = num;
+    mesh->tri  = (NPT_REAL(*)[3][3])malloc( (size_t)(num > 0 ? num : 1)*sizeof(NPT_REAL[3][3]) );
+    mesh->norm = (NPT_REAL(*)[3][3])malloc( (size_t)(num > 0 ? num : 1)*sizeof(NPT_REAL[3][3]) );
+    if( mesh->tri == NULL || mesh->norm == NULL ) {
+        printf( "#### ERROR bench_mesh_alloc: memory num=%d\n", num );
+        return 1;
+    }
+    return 0;
+}
+
+
+/// 領域解放
+static inline void
+bench_mesh_free( BENCH_MESH* mesh )
+{
+    free( mesh->tri );
+    free( mesh->norm );
+    mesh->tri  = NULL;
+    mesh->norm = NULL;
+    mesh->num  = 0;
+}
+
+
+/// パラメトリック曲面  (u,v) in [0,1]x[0,1] -> 座標、法線
+typedef void (*BENCH_SURF_FUNC)( double u, double v, const double* prm, double pos[3], double norm[3] );
+
+
+/// トーラス  prm[0]:R  prm[1]:r
+static inline void
+bench_surf_torus( double u, double v, const double* prm, double pos[3], double norm[3] )
+{
+    double ph = 2.0*PAI*u;
+    double th = 2.0*PAI*v;
+    norm[0] = cos(th)*cos(ph);
+    norm[1] = cos(th)*sin(ph);
+    norm[2] = sin(th);
+    pos[0] = ( prm[0] + prm[1]*cos(th) )*cos(ph);
+    pos[1] = ( prm[0] + prm[1]*cos(th) )*sin(ph);
+    pos[2] = prm[1]*sin(th);
+}
+
+
+/// 円柱の側面  prm[0]:R  prm[1]:高さ
+static inline void
+bench_surf_cylinder( double u, double v, const double* prm, double pos[3], double norm[3] )
+{
+    double ph = 2.0*PAI*u;
+    norm[0] = cos(ph);
+    norm[1] = sin(ph);
+    norm[2] = 0.0;
+    pos[0] = prm[0]*cos(ph);
+    pos[1] = prm[0]*sin(ph);
+    pos[2] = prm[1]*( v - 0.5 );
+}
+
+
+/// パラメトリック曲面の分割  nu x nv の格子を三角形２個ずつに分割する
+static inline int
+bench_mesh_param( BENCH_SURF_FUNC func, const double* prm, int nu, int nv, BENCH_MESH* mesh )
+{
+    int i, j, k, l;
+
+    if( bench_mesh_alloc( 2*nu*nv, mesh ) != 0 ) return 1;
+
+#pragma omp parallel for private(i,k,l)
+    for( j=0; j<nv; j++ ) {
+        for( i=0; i<nu; i++ ) {
+            double pos[4][3], norm[4][3];
+            static const int quad[2][3] = { {0,1,2}, {0,2,3} };
+            func( (double)(i  )/nu, (double)(j  )/nv, prm, pos[0], norm[0] );
+            func( (double)(i+1)/nu, (double)(j  )/nv, prm, pos[1], norm[1] );
+            func( (double)(i+1)/nu, (double)(j+1)/nv, prm, pos[2], norm[2] );
+            func( (double)(i  )/nu, (double)(j+1)/nv, prm, pos[3], norm[3] );
+            for( k=0; k<2; k++ ) {
+                int it = 2*(j*nu + i) + k;
+                for( l=0; l<3; l++ ) {
+                    int ip = quad[k][l];
+                    mesh->tri [it][l][0] = pos [ip][0];
+                    mesh->tri [it][l][1] = pos [ip][1];
+                    mesh->tri [it][l][2] = pos [ip][2];
+                    mesh->norm[it][l][0] = norm[ip][0];
+                    mesh->norm[it][l][1] = norm[ip][1];
+                    mesh->norm[it][l][2] = norm[ip][2];
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+
+/// 楕円体  正八面体の各面を m x m に分割し単位球面に投影した後、軸方向に拡大する（8*m*m 三角形）
+///    UV分割と異なり極付近に細長い三角形が生じない
+///    abc[0-2] : x,y,z方向の半径（1,1,1 で単位球）
+static inline int
+bench_mesh_ellipsoid( int m, const double abc[3], BENCH_MESH* mesh )
+{
+    static const double oct[8][3][3] = {
+        { { 1, 0, 0}, { 0, 1, 0}, { 0, 0, 1} }, { { 0, 1, 0}, {-1, 0, 0}, { 0, 0, 1} },
+        { {-1, 0, 0}, { 0,-1, 0}, { 0, 0, 1} }, { { 0,-1, 0}, { 1, 0, 0}, { 0, 0, 1} },
+        { { 0, 1, 0}, { 1, 0, 0}, { 0, 0,-1} }, { {-1, 0, 0}, { 0, 1, 0}, { 0, 0,-1} },
+        { { 0,-1, 0}, {-1, 0, 0}, { 0, 0,-1} }, { { 1, 0, 0}, { 0,-1, 0}, { 0, 0,-1} } };
+    int f;
+
+    if( bench_mesh_alloc( 8*m*m, mesh ) != 0 ) return 1;
+
+#pragma omp parallel for
+    for( f=0; f<8; f++ ) {
+        int i, j, k, l, it = f*m*m;
+        for( j=0; j<m; j++ ) {
+            // 行jの三角形  上向き m-j 個、下向き m-j-1 個
+            for( i=0; i<2*(m-j)-1; i++ ) {
+                int bc[3][2];
+                if( i % 2 == 0 ) {
+                    bc[0][0] = i/2;   bc[0][1] = j;
+                    bc[1][0] = i/2+1; bc[1][1] = j;
+                    bc[2][0] = i/2;   bc[2][1] = j+1;
+                } else {
+                    bc[0][0] = i/2+1; bc[0][1] = j;
+                    bc[1][0] = i/2+1; bc[1][1] = j+1;
+                    bc[2][0] = i/2;   bc[2][1] = j+1;
+                }
+                for( l=0; l<3; l++ ) {
+                    double a = (double)bc[l][0]/m, b = (double)bc[l][1]/m;
+                    double p[3], n[3], len;
+                    for( k=0; k<3; k++ ) {
+                        p[k] = (1.0-a-b)*oct[f][0][k] + a*oct[f][1][k] + b*oct[f][2][k];
+                    }
+                    len = sqrt( p[0]*p[0] + p[1]*p[1] + p[2]*p[2] );
+                    for( k=0; k<3; k++ ) {
+                        p[k] = abc[k]*p[k]/len;
+                        n[k] = p[k]/( abc[k]*abc[k] );
+                    }
+                    len = sqrt( n[0]*n[0] + n[1]*n[1] + n[2]*n[2] );
+                    for( k=0; k<3; k++ ) {
+                        mesh->tri [it][l][k] = p[k];
+                        mesh->norm[it][l][k] = n[k]/len;
+                    }
+                }
+                it++;
+            }
+        }
+    }
+    return 0;
+}
+
+
+/// ノイズ付き平面  [0,1]x[0,1]、z方向に格子幅の5%のノイズ、法線を最大約6度傾ける
+static inline int
+bench_mesh_plane( int m, BENCH_MESH* mesh )
+{
+    int      i, j, k, l;
+    double   h = 1.0/m;
+    uint64_t seed = 0x9e3779b97f4a7c15ULL;
+    double*  z  = (double*)malloc( (size_t)(m+1)*(m+1)*sizeof(double) );
+    double (*nv)[3] = (double(*)[3])malloc( (size_t)(m+1)*(m+1)*sizeof(double[3]) );
+
+    if( z == NULL || nv == NULL || bench_mesh_alloc( 2*m*m, mesh ) != 0 ) {
+        free( z );
+        free( nv );
+        return 1;
+    }
+    for( i=0; i<(m+1)*(m+1); i++ ) {
+        double tx = 0.2*( bench_rand(&seed) - 0.5 );
+        double ty = 0.2*( bench_rand(&seed) - 0.5 );
+        double len = sqrt( tx*tx + ty*ty + 1.0 );
+        z[i] = 0.05*h*( bench_rand(&seed) - 0.5 );
+        nv[i][0] = tx/len;
+        nv[i][1] = ty/len;
+        nv[i][2] = 1.0/len;
+    }
+
+#pragma omp parallel for private(i,k,l)
+    for( j=0; j<m; j++ ) {
+        for( i=0; i<m; i++ ) {
+            static const int quad[2][3] = { {0,1,2}, {0,2,3} };
+            int id[4];
+            id[0] = j*(m+1) + i;
+            id[1] = j*(m+1) + i+1;
+            id[2] = (j+1)*(m+1) + i+1;
+            id[3] = (j+1)*(m+1) + i;
+            for( k=0; k<2; k++ ) {
+                int it = 2*(j*m + i) + k;
+                for( l=0; l<3; l++ ) {
+                    int iv = id[ quad[k][l] ];
+                    mesh->tri [it][l][0] = h*( iv%(m+1) );
+                    mesh->tri [it][l][1] = h*( iv/(m+1) );
+                    mesh->tri [it][l][2] = z[iv];
+                    mesh->norm[it][l][0] = nv[iv][0];
+                    mesh->norm[it][l][1] = nv[iv][1];
+                    mesh->norm[it][l][2] = nv[iv][2];
+                }
+            }
+        }
+    }
+    free( z );
+    free( nv );
+    return 0;
+}
+
+
+/// 細長い三角形  長さ1.0、高さ0.005-0.02
+///    1/4 は３頂点の法線が面の法線と一致（平行判定による縮退処理）
+///    残りは法線を最大約17度傾ける
+static inline int
+bench_mesh_sliver( int num, BENCH_MESH* mesh )
+{
+    int      i, l;
+    uint64_t seed = 0x2545f4914f6cdd1dULL;
+
+    if( bench_mesh_alloc( num, mesh ) != 0 ) return 1;
+
+    for( i=0; i<num; i++ ) {
+        double ox = 2.0*( i % 1000 );
+        double oy = 0.1*( i / 1000 );
+        double hh = 0.005 + 0.015*bench_rand(&seed);
+        double ax = 0.2 + 0.6*bench_rand(&seed);
+        mesh->tri[i][0][0] = ox;      mesh->tri[i][0][1] = oy;      mesh->tri[i][0][2] = 0.0;
+        mesh->tri[i][1][0] = ox+1.0;  mesh->tri[i][1][1] = oy;      mesh->tri[i][1][2] = 0.0;
+        mesh->tri[i][2][0] = ox+ax;   mesh->tri[i][2][1] = oy+hh;   mesh->tri[i][2][2] = 0.0;
+        for( l=0; l<3; l++ ) {
+            double tx = 0.0, ty = 0.0;
+            if( i % 4 != 0 ) {
+                tx = 0.6*( bench_rand(&seed) - 0.5 );
+                ty = 0.6*( bench_rand(&seed) - 0.5 );
+            }
+            double len = sqrt( tx*tx + ty*ty + 1.0 );
+            mesh->norm[i][l][0] = tx/len;
+            mesh->norm[i][l][1] = ty/len;
+            mesh->norm[i][l][2] = 1.0/len;
+        }
+    }
+    return 0;
+}
+
+
+/// 合成メッシュ生成
+///
+/// @param [in]    type         メッシュ種類 "sphere" "torus" "cylinder" "ellipsoid" "plane" "sliver"
+/// @param [in]    num          目標三角形数（格子分割のため近い値となる）
+/// @param [out]   mesh         メッシュ
+/// @return =0 正常  !=0 異常
+static inline int
+bench_mesh_crt( const char* type, int num, BENCH_MESH* mesh )
+{
+    memset( mesh, 0, sizeof(BENCH_MESH) );
+
+    if( strcmp( type, "sphere" ) == 0 ) {
+        static const double abc[3] = { 1.0, 1.0, 1.0 };
+        int m = (int)sqrt( num/8.0 );
+        if( m < 1 ) m = 1;
+        return bench_mesh_ellipsoid( m, abc, mesh );
+    } else if( strcmp( type, "ellipsoid" ) == 0 ) {
+        static const double abc[3] = { BENCH_ELLIPSOID_A, BENCH_ELLIPSOID_B, BENCH_ELLIPSOID_C };
+        int m = (int)sqrt( num/8.0 );
+        if( m < 1 ) m = 1;
+        return bench_mesh_ellipsoid( m, abc, mesh );
+    } else if( strcmp( type, "torus" ) == 0 ) {
+        static const double prm[2] = { BENCH_TORUS_R, BENCH_TORUS_r };
+        int nv = (int)sqrt( num/6.0 );
+        if( nv < 3 ) nv = 3;
+        return bench_mesh_param( bench_surf_torus, prm, 3*nv, nv, mesh );
+    } else if( strcmp( type, "cylinder" ) == 0 ) {
+        static const double prm[2] = { BENCH_CYLINDER_R, BENCH_CYLINDER_H };
+        int nv = (int)sqrt( num/(2.0*PAI) );
+        if( nv < 1 ) nv = 1;
+        return bench_mesh_param( bench_surf_cylinder, prm, (int)(PAI*nv), nv, mesh );
+    } else if( strcmp( type, "plane" ) == 0 ) {
+        int m = (int)sqrt( num/2.0 );
+        if( m < 1 ) m = 1;
+        return bench_mesh_plane( m, mesh );
+    } else if( strcmp( type, "sliver" ) == 0 ) {
+        return bench_mesh_sliver( num, mesh );
+    }
+    printf( "#### ERROR bench_mesh_crt: unknown mesh type=%s\n", type );
+    return 1;
+}
+
+#endif // _BENCH_MESH_H_
@@ -0,0 +1,413 @@
+/*
+ * Npatch - Nagata Patch Library
+ *
+ * Copyright (c) 2015-2016 Advanced Institute for Computational Science, RIKEN.
+ * All rights reserved.
+ *
+ */
+
+////////////////////////////////////////////////////////////////////////////
+///
+/// 長田パッチ 精度と処理速度の評価
+///
+///   解析曲面（sphere, cylinder, torus, ellipsoid）を複数の解像度で分割し、
+///   厳密な頂点法線で長田パッチを生成して、npt_correct_pnt による
+///   曲面補間点の位置誤差と法線誤差、および処理時間を出力する。
+///
+///   位置誤差 : 補間点から解析曲面までの距離
+///              （楕円体は陰関数の１次近似 |g|/|grad g|）
+///   法線誤差 : パッチの法線（ベジェ曲面の接ベクトルの外積）と
+///              補間点での解析曲面の法線のなす角 (degree)
+///   参考として平坦な三角形（補正なし）の位置誤差も出力する。
+///   -D_NPT_STAT_ でビルドした場合、制御点p11が中点で代替された辺の割合も出力する。
+///
+///   精度（単精度/倍精度）と許容誤差 NPT_ALW_V はコンパイル時に決まるため、
+///   組み合わせごとに別の実行ファイルとする（Benchmark/CMakeLists.txt 参照）。
+///
+///   使用法
+///       npt_accuracy [-s size,size,...] [-m mesh,mesh,...] [-r repeat] [-t target] [-o file.json]
+///
+////////////////////////////////////////////////////////////////////////////
+
+#include "bench_mesh.h"
+#include "Npt_Stat.h"
+
+#define BENCH_MAX_LIST  16
+
+/// 誤差評価点の数（三角形あたり）
+#define ACC_NUM_SAMPLE  12
+
+/// 計測結果
+typedef struct {
+    char    mesh[16];
+    int     num_tri;
+    double  h;              ///< 平均辺長
+    double  pos_max;        ///< 位置誤差 最大
+    double  pos_rms;        ///< 位置誤差 RMS
+    double  flat_max;       ///< 平坦な三角形の位置誤差 最大
+    double  norm_max;       ///< 法線誤差 最大 (degree)
+    double  norm_rms;       ///< 法線誤差 RMS (degree)
+    double  t_crt;          ///< npt_param_crt 処理時間 (sec)
+    double  t_eval;         ///< npt_correct_pnt 処理時間 (sec)
+    double  fallback;       ///< 制御点p11が中点で代替された割合（統計なしの場合 -1）
+    int     err;            ///< npt_param_crt 異常終了数
+} ACC_RESULT;
+
+
+//------------------------------------------------------------------
+//  プロトタイプ宣言
+//------------------------------------------------------------------
+static double acc_distance( const char* mesh, const double pos[3], double norm[3] );
+static void   acc_patch_normal( NPT_REAL eta, NPT_REAL xi, NPT_REAL tri[3][3], NPT_REAL cp[7][3], double norm[3] );
+static int    acc_split( char* str, char* list[], int max );
+static void   acc_usage( const char* prog );
+static void   acc_json( const char* file_name, ACC_RESULT* res, int num_res );
+
+
+// #################################################################
+//    メイン
+// #################################################################
+
+int
+main( int argc, char** argv )
+{
+    static char  size_def[] = "500,2000,8000,32000,128000";
+    static char  mesh_def[] = "sphere,cylinder,torus,ellipsoid";
+    char*        size_str = size_def;
+    char*        mesh_str = mesh_def;
+    const char*  json     = NULL;
+    int          repeat   = 3;
+    double       target   = -1.0;
+    char*        size_list[BENCH_MAX_LIST];
+    char*        mesh_list[BENCH_MAX_LIST];
+    int          num_size, num_mesh;
+    ACC_RESULT   res[BENCH_MAX_LIST*BENCH_MAX_LIST];
+    int          num_res = 0;
+    int          i, im, is, ir, k;
+
+    // 誤差評価点  重心座標 (a,b,c)/4 の格子点のうち頂点を除く12点
+    NPT_REAL     s_eta[ACC_NUM_SAMPLE], s_xi[ACC_NUM_SAMPLE];
+    k = 0;
+    for( i=0; i<=4; i++ ) {
+        int j;
+        for( j=0; j<=i; j++ ) {
+            if( (i == 0) || (i == 4 && (j == 0 || j == 4)) ) continue;
+            s_eta[k] = (NPT_REAL)( i/4.0 );
+            s_xi [k] = (NPT_REAL)( j/4.0 );
+            k++;
+        }
+    }
+
+    for( i=1; i<argc; i++ ) {
+        if( strcmp( argv[i], "-s" ) == 0 && i+1 < argc ) {
+            size_str = argv[++i];
+        } else if( strcmp( argv[i], "-m" ) == 0 && i+1 < argc ) {
+            mesh_str = argv[++i];
+        } else if( strcmp( argv[i], "-r" ) == 0 && i+1 < argc ) {
+            repeat = atoi( argv[++i] );
+            if( repeat < 1 ) repeat = 1;
+        } else if( strcmp( argv[i], "-t" ) == 0 && i+1 < argc ) {
+            target = atof( argv[++i] );
+        } else if( strcmp( argv[i], "-o" ) == 0 && i+1 < argc ) {
+            json = argv[++i];
+        } else {
+            acc_usage( argv[0] );
+            return 1;
+        }
+    }
+    num_size = acc_split( size_str, size_list, BENCH_MAX_LIST );
+    num_mesh = acc_split( mesh_str, mesh_list, BENCH_MAX_LIST );
+
+    printf( "#### Npatch accuracy  version=%s  real=%s  NPT_ALW_V=%g  threads=%d\n",
+            NPT_VERSION_NO, sizeof(NPT_REAL) == 8 ? "double" : "float", (double)NPT_ALW_V,
+#ifdef _OPENMP
+            omp_get_max_threads()
+#else
+            1
+#endif
+          );
+    printf( "%-9s %8s %9s %10s %10s %10s %9s %9s %9s %9s %9s%s\n",
+            "mesh", "num_tri", "h", "pos_max", "pos_rms", "flat_max",
+            "nrm_max", "nrm_rms", "crt_ns", "eval_ns", "fallback", target > 0.0 ? "  target" : "" );
+
+    for( im=0; im<num_mesh; im++ ) {
+        for( is=0; is<num_size; is++ ) {
+            BENCH_MESH  mesh;
+            ACC_RESULT* r = &res[num_res];
+            int         num;
+            uint64_t    seed = 0x853c49e6748fea9bULL;
+            double      h_sum = 0.0, pos_max = 0.0, pos_sum = 0.0, flat_max = 0.0;
+            double      norm_max = 0.0, norm_sum = 0.0;
+
+            if( bench_mesh_crt( mesh_list[im], atoi( size_list[is] ), &mesh ) != 0 ) {
+                bench_mesh_free( &mesh );
+                continue;
+            }
+            num = mesh.num;
+
+            NPT_REAL (*npatch)[7][3] = (NPT_REAL(*)[7][3])malloc( (size_t)num*sizeof(NPT_REAL[7][3]) );
+            NPT_REAL (*pos_o )[3]    = (NPT_REAL(*)[3]   )malloc( (size_t)num*sizeof(NPT_REAL[3]) );
+            NPT_REAL*  eta           = (NPT_REAL*)malloc( (size_t)num*sizeof(NPT_REAL) );
+            NPT_REAL*  xi            = (NPT_REAL*)malloc( (size_t)num*sizeof(NPT_REAL) );
+            if( npatch == NULL || pos_o == NULL || eta == NULL || xi == NULL ) {
+                printf( "#### ERROR memory mesh=%s num_tri=%d\n", mesh_list[im], num );
+                return 1;
+            }
+            for( i=0; i<num; i++ ) {
+                eta[i] = bench_rand(&seed);
+                xi [i] = eta[i]*bench_rand(&seed);
+            }
+
+            //-------------------
+            //  処理時間
+            //-------------------
+            r->t_crt = r->t_eval = 1.0e30;
+            for( ir=0; ir<=repeat; ir++ ) {
+                double t0 = bench_time();
+                r->err = npt_param_crt_n( num, mesh.tri, mesh.norm, npatch );
+                double t1 = bench_time();
+                npt_correct_pnt_n( num, eta, xi, mesh.tri, npatch, pos_o );
+                double t2 = bench_time();
+                if( ir > 0 && t1 - t0 < r->t_crt  ) r->t_crt  = t1 - t0;
+                if( ir > 0 && t2 - t1 < r->t_eval ) r->t_eval = t2 - t1;
+            }
+
+            //-------------------
+            //  中点代替の割合（処理時間の計測とは別に実行する）
+            //-------------------
+            r->fallback = -1.0;
+            if( npt_stat_available() ) {
+                NPT_STAT stat;
+                int      flag = npt_stat_is_enabled();
+                npt_stat_reset();
+                npt_stat_enable( 1 );
+                npt_param_crt_n( num, mesh.tri, mesh.norm, npatch );
+                npt_stat_enable( flag );
+                npt_stat_get( &stat );
+                if( stat.count[NPT_STAT_P11] > 0 ) {
+                    r->fallback = (double)( stat.count[NPT_STAT_P11_PARALLEL]
+                                          + stat.count[NPT_STAT_P11_PERPENDICULAR]
+                                          + stat.count[NPT_STAT_P11_NO_LINE] )
+                                / (double)stat.count[NPT_STAT_P11];
+                }
+            }
+
+            //-------------------
+            //  誤差
+            //-------------------
+#pragma omp parallel for private(k) reduction(+:h_sum,pos_sum,norm_sum) reduction(max:pos_max,flat_max,norm_max)
+            for( i=0; i<num; i++ ) {
+                NPT_REAL* p1 = mesh.tri[i][0];
+                NPT_REAL* p2 = mesh.tri[i][1];
+                NPT_REAL* p3 = mesh.tri[i][2];
+                NPT_REAL* cp[7];
+                for( k=0; k<7; k++ ) cp[k] = npatch[i][k];
+
+                h_sum += ( CalcLineSize( p1, p2 ) + CalcLineSize( p2, p3 ) + CalcLineSize( p3, p1 ) ) / 3.0;
+
+                for( k=0; k<ACC_NUM_SAMPLE; k++ ) {
+                    NPT_REAL pos[3];
+                    double   dpos[3], flat[3], n_exact[3], n_patch[3], d, ang;
+                    double   u = s_eta[k] - s_xi[k], v = s_xi[k], w = 1.0 - s_eta[k];
+                    int      l;
+
+                    npt_correct_pnt( s_eta[k], s_xi[k], p1, p2, p3,
+                                     cp[0], cp[1], cp[2], cp[3], cp[4], cp[5], cp[6], pos );
+                    for( l=0; l<3; l++ ) {
+                        dpos[l] = pos[l];
+                        flat[l] = w*p1[l] + u*p2[l] + v*p3[l];
+                    }
+
+                    d = fabs( acc_distance( mesh_list[im], dpos, n_exact ) );
+                    if( d > pos_max ) pos_max = d;
+                    pos_sum += d*d;
+
+                    d = fabs( acc_distance( mesh_list[im], flat, NULL ) );
+                    if( d > flat_max ) flat_max = d;
+
+                    acc_patch_normal( s_eta[k], s_xi[k], mesh.tri[i], npatch[i], n_patch );
+                    d = fabs( n_exact[0]*n_patch[0] + n_exact[1]*n_patch[1] + n_exact[2]*n_patch[2] );
+                    ang = acos( d > 1.0 ? 1.0 : d ) * 180.0/PAI;
+                    if( ang > norm_max ) norm_max = ang;
+                    norm_sum += ang*ang;
+                }
+            }
+
+            strncpy( r->mesh, mesh_list[im], sizeof(r->mesh)-1 );
+            r->mesh[sizeof(r->mesh)-1] = '\0';
+            r->num_tri  = num;
+            r->h        = h_sum/num;
+            r->pos_max  = pos_max;
+            r->pos_rms  = sqrt( pos_sum/( (double)num*ACC_NUM_SAMPLE ) );
+            r->flat_max = flat_max;
+            r->norm_max = norm_max;
+            r->norm_rms = sqrt( norm_sum/( (double)num*ACC_NUM_SAMPLE ) );
+            num_res++;
+
+            printf( "%-9s %8d %9.3e %10.3e %10.3e %10.3e %9.4f %9.4f %9.2f %9.2f %9.4f",
+                    r->mesh, num, r->h, r->pos_max, r->pos_rms, r->flat_max,
+                    r->norm_max, r->norm_rms, 1.0e9*r->t_crt/num, 1.0e9*r->t_eval/num, r->fallback );
+            if( target > 0.0 ) printf( "  %s", r->pos_max <= target ? "ok" : "ng" );
+            if( r->err != 0 ) printf( "  (error patches=%d)", r->err );
+            printf( "\n" );
+
+            free( npatch );
+            free( pos_o );
+            free( eta );
+            free( xi );
+            bench_mesh_free( &mesh );
+        }
+    }
+
+    if( json != NULL ) acc_json( json, res, num_res );
+
+    return 0;
+}
+
+
+// #################################################################
+//    非公開（プライベート）関数
+// #################################################################
+
+/// 解析曲面までの距離（符号付き）と法線ベクトル
+///
+/// @param [in]    mesh         曲面種類
+/// @param [in]    pos          点座標
+/// @param [out]   norm         pos に最も近い曲面上の点の法線ベクトル（NULL可）
+/// @return 距離
+static double
+acc_distance( const char* mesh, const double pos[3], double norm[3] )
+{
+    double n[3], d, len;
+    double x = pos[0], y = pos[1], z = pos[2];
+
+    if( strcmp( mesh, "sphere" ) == 0 ) {
+        len = sqrt( x*x + y*y + z*z );
+        d = len - 1.0;
+        n[0] = x; n[1] = y; n[2] = z;
+    } else if( strcmp( mesh, "cylinder" ) == 0 ) {
+        len = sqrt( x*x + y*y );
+        d = len - BENCH_CYLINDER_R;
+        n[0] = x; n[1] = y; n[2] = 0.0;
+    } else if( strcmp( mesh, "torus" ) == 0 ) {
+        double rho = sqrt( x*x + y*y );
+        double dr  = rho - BENCH_TORUS_R;
+        d = sqrt( dr*dr + z*z ) - BENCH_TORUS_r;
+        n[0] = dr*x/rho; n[1] = dr*y/rho; n[2] = z;
+    } else {
+        // 楕円体  g = sqrt(x^2/a^2 + y^2/b^2 + z^2/c^2) - 1 の１次近似
+        double a2 = BENCH_ELLIPSOID_A*BENCH_ELLIPSOID_A;
+        double b2 = BENCH_ELLIPSOID_B*BENCH_ELLIPSOID_B;
+        double c2 = BENCH_ELLIPSOID_C*BENCH_ELLIPSOID_C;
+        double s  = sqrt( x*x/a2 + y*y/b2 + z*z/c2 );
+        n[0] = x/(a2*s); n[1] = y/(b2*s); n[2] = z/(c2*s);
+        d = ( s - 1.0 ) / sqrt( n[0]*n[0] + n[1]*n[1] + n[2]*n[2] );
+    }
+
+    if( norm != NULL ) {
+        len = sqrt( n[0]*n[0] + n[1]*n[1] + n[2]*n[2] );
+        norm[0] = n[0]/len;
+        norm[1] = n[1]/len;
+        norm[2] = n[2]/len;
+    }
+    return d;
+}
+
+
+/// 長田パッチの法線ベクトル（単位ベクトル）
+///    x(u,v,w) の偏微分から dx/deta = x_u - x_w, dx/dxi = x_v - x_u を求め外積をとる
+static void
+acc_patch_normal( NPT_REAL eta, NPT_REAL xi, NPT_REAL tri[3][3], NPT_REAL cp[7][3], double norm[3] )
+{
+    double u = eta - xi, v = xi, w = 1.0 - eta;
+    double de[3], dx[3], len;
+    int    l;
+
+    for( l=0; l<3; l++ ) {
+        double xu = 3.0*u*u*tri[1][l] + 3.0*w*w*cp[0][l] + 6.0*u*w*cp[1][l]
+                  + 6.0*u*v*cp[2][l]  + 3.0*v*v*cp[3][l] + 6.0*v*w*cp[6][l];
+        double xv = 3.0*v*v*tri[2][l] + 3.0*u*u*cp[2][l] + 6.0*u*v*cp[3][l]
+                  + 6.0*v*w*cp[4][l]  + 3.0*w*w*cp[5][l] + 6.0*u*w*cp[6][l];
+        double xw = 3.0*w*w*tri[0][l] + 6.0*u*w*cp[0][l] + 3.0*u*u*cp[1][l]
+                  + 3.0*v*v*cp[4][l]  + 6.0*v*w*cp[5][l] + 6.0*u*v*cp[6][l];
+        de[l] = xu - xw;
+        dx[l] = xv - xu;
+    }
+    norm[0] = de[1]*dx[2] - de[2]*dx[1];
+    norm[1] = de[2]*dx[0] - de[0]*dx[2];
+    norm[2] = de[0]*dx[1] - de[1]*dx[0];
+    len = sqrt( norm[0]*norm[0] + norm[1]*norm[1] + norm[2]*norm[2] );
+    if( len > 0.0 ) {
+        norm[0] /= len;
+        norm[1] /= len;
+        norm[2] /= len;
+    }
+}
+
+
+/// カンマ区切り文字列の分割（文字列を書き換える）
+static int
+acc_split( char* str, char* list[], int max )
+{
+    int   num = 0;
+    char* p   = strtok( str, "," );
+
+    while( p != NULL && num < max ) {
+        list[num++] = p;
+        p = strtok( NULL, "," );
+    }
+    return num;
+}
+
+
+/// 使用法の出力
+static void
+acc_usage( const char* prog )
+{
+    printf( "usage: %s [-s size,size,...] [-m mesh,mesh,...] [-r repeat] [-t target] [-o file.json]\n", prog );
+    printf( "    -s  target number of triangles (default 500,2000,8000,32000,128000)\n" );
+    printf( "    -m  surface sphere,cylinder,torus,ellipsoid (default all)\n" );
+    printf( "    -r  number of timed repeats, minimum is reported (default 3)\n" );
+    printf( "    -t  position error target, marks each row ok/ng\n" );
+    printf( "    -o  output results in JSON format\n" );
+}
+
+
+/// 計測結果の JSON 出力
+static void
+acc_json( const char* file_name, ACC_RESULT* res, int num_res )
+{
+    FILE* fp = fopen( file_name, "w" );
+    int   i;
+
+    if( fp == NULL ) {
+        printf( "#### ERROR open file=%s\n", file_name );
+        return;
+    }
+    fprintf( fp, "{\n" );
+    fprintf( fp, "  \"library\": \"Npatch\",\n" );
+    fprintf( fp, "  \"version\": \"%s\",\n", NPT_VERSION_NO );
+    fprintf( fp, "  \"real\": \"%s\",\n", sizeof(NPT_REAL) == 8 ? "double" : "float" );
+    fprintf( fp, "  \"npt_alw_v\": %g,\n", (double)NPT_ALW_V );
+#ifdef _OPENMP
+    fprintf( fp, "  \"threads\": %d,\n", omp_get_max_threads() );
+#else
+    fprintf( fp, "  \"threads\": 1,\n" );
+#endif
+    fprintf( fp, "  \"results\": [\n" );
+    for( i=0; i<num_res; i++ ) {
+        ACC_RESULT* r = &res[i];
+        fprintf( fp, "    {\"mesh\": \"%s\", \"num_tri\": %d, \"h\": %.6e, "
+                     "\"pos_err_max\": %.6e, \"pos_err_rms\": %.6e, \"flat_err_max\": %.6e, "
+                     "\"normal_err_max_deg\": %.6e, \"normal_err_rms_deg\": %.6e, "
+                     "\"param_crt_ns_per_patch\": %.3f, \"correct_pnt_ns_per_patch\": %.3f, "
+                     "\"p11_fallback_ratio\": %.6f, \"errors\": %d}%s\n",
+                 r->mesh, r->num_tri, r->h, r->pos_max, r->pos_rms, r->flat_max,
+                 r->norm_max, r->norm_rms, 1.0e9*r->t_crt/r->num_tri, 1.0e9*r->t_eval/r->num_tri,
+                 r->fallback, r->err,
+                 i < num_res-1 ? "," : "" );
+    }
+    fprintf( fp, "  ]\n" );
+    fprintf( fp, "}\n" );
+    fclose( fp );
+}
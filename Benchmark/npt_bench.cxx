@@ -0,0 +1,389 @@
+/*
+ * Npatch - Nagata Patch Library
+ *
+ * Copyright (c) 2015-2016 Advanced Institute for Computational Science, RIKEN.
+ * All rights reserved.
+ *
+ */
+
+////////////////////////////////////////////////////////////////////////////
+///
+/// 長田パッチ 公開関数のマイクロベンチマーク
+///
+///   合成メッシュ（sphere, torus, plane, sliver）を複数の大きさで生成し、
+///   以下の関数の１パッチあたりの処理時間 (ns/patch) を計測する。
+///       npt_param_crt          (npt_param_crt_n)
+///       npt_cvt_pos_to_eta_xi  (npt_cvt_pos_to_eta_xi_n)
+///       npt_correct_pnt        (npt_correct_pnt_n)
+///       npt_correct_pnt2       (npt_correct_pnt2_n)
+///       npt_move_vertex        (npt_move_vertex_n)
+///       npt_subdiv             (npt_subdiv_n、１パッチを４分割)
+///       npt_qpatch_encode      (npt_qpatch_encode_n、制御点の量子化)
+///       npt_correct_pnt_q      (npt_correct_pnt_q_n、量子化パラメータでの補正)
+///   各計測は repeat 回実行し最小値を採用する。
+///   単精度/倍精度は -D_REAL_IS_DOUBLE_ の有無で別の実行ファイルとする。
+///   -D_NPT_STAT_ でビルドし環境変数 NPT_STAT=1 (または 2) を指定すると、最後に統計値を出力する。
+///
+///   使用法
+///       npt_bench [-s size,size,...] [-m mesh,mesh,...] [-r repeat] [-o file.json]
+///
+////////////////////////////////////////////////////////////////////////////
+
+#include "bench_mesh.h"
+#include "Npt_Stat.h"
+#include "Npt_Quant.h"
+
+#define BENCH_MAX_LIST  16
+#define BENCH_NUM_KERNEL 8
+
+/// 計測結果
+typedef struct {
+    char    mesh[16];
+    int     num_tri;
+    char    kernel[32];
+    double  time;        ///< 最小処理時間 (sec)
+    int     err;         ///< 異常終了数（npt_param_crt のみ）
+} BENCH_RESULT;
+
+
+//------------------------------------------------------------------
+//  プロトタイプ宣言
+//------------------------------------------------------------------
+static int  bench_split( char* str, char* list[], int max );
+static void bench_usage( const char* prog );
+static void bench_json( const char* file_name, BENCH_RESULT* res, int num_res );
+static double bench_subdiv_diff( int num, NPT_REAL* eta, NPT_REAL* xi, NPT_REAL tri[][3][3], NPT_REAL npatch[][7][3],
+                                 NPT_REAL tri_s[][3][3], NPT_REAL npatch_s[][7][3] );
+static double bench_quant_diff( int num, NPT_REAL* eta, NPT_REAL* xi, NPT_REAL tri[][3][3], NPT_REAL npatch[][7][3],
+                                const NPT_QPATCH* qpatch, NPT_REAL pos_q[][3], double* over, double* err_r );
+
+
+// #################################################################
+//    メイン
+// #################################################################
+
+int
+main( int argc, char** argv )
+{
+    static char  size_def[] = "10000,100000,1000000";
+    static char  mesh_def[] = "sphere,torus,plane,sliver";
+    char*        size_str = size_def;
+    char*        mesh_str = mesh_def;
+    const char*  json     = NULL;
+    int          repeat   = 5;
+    char*        size_list[BENCH_MAX_LIST];
+    char*        mesh_list[BENCH_MAX_LIST];
+    int          num_size, num_mesh;
+    BENCH_RESULT res[BENCH_MAX_LIST*BENCH_MAX_LIST*BENCH_NUM_KERNEL];
+    int          num_res = 0;
+    int          i, im, is, ir, k;
+
+    for( i=1; i<argc; i++ ) {
+        if( strcmp( argv[i], "-s" ) == 0 && i+1 < argc ) {
+            size_str = argv[++i];
+        } else if( strcmp( argv[i], "-m" ) == 0 && i+1 < argc ) {
+            mesh_str = argv[++i];
+        } else if( strcmp( argv[i], "-r" ) == 0 && i+1 < argc ) {
+            repeat = atoi( argv[++i] );
+            if( repeat < 1 ) repeat = 1;
+        } else if( strcmp( argv[i], "-o" ) == 0 && i+1 < argc ) {
+            json = argv[++i];
+        } else {
+            bench_usage( argv[0] );
+            return 1;
+        }
+    }
+    num_size = bench_split( size_str, size_list, BENCH_MAX_LIST );
+    num_mesh = bench_split( mesh_str, mesh_list, BENCH_MAX_LIST );
+
+    printf( "#### Npatch benchmark  version=%s  real=%s  simd=%s  threads=%d  repeat=%d\n",
+            NPT_VERSION_NO, sizeof(NPT_REAL) == 8 ? "double" : "float",
+            npt_simd_name( npt_simd_get() ),
+#ifdef _OPENMP
+            omp_get_max_threads(),
+#else
+            1,
+#endif
+            repeat );
+    printf( "%-8s %10s %-24s %12s %12s\n", "mesh", "num_tri", "kernel", "ns/patch", "time(s)" );
+
+    for( im=0; im<num_mesh; im++ ) {
+        for( is=0; is<num_size; is++ ) {
+            BENCH_MESH mesh;
+            int        num;
+            uint64_t   seed = 0x853c49e6748fea9bULL;
+
+            if( bench_mesh_crt( mesh_list[im], atoi( size_list[is] ), &mesh ) != 0 ) {
+                bench_mesh_free( &mesh );
+                continue;
+            }
+            num = mesh.num;
+
+            NPT_REAL (*npatch  )[7][3] = (NPT_REAL(*)[7][3])malloc( (size_t)num*sizeof(NPT_REAL[7][3]) );
+            NPT_REAL (*npatch_n)[7][3] = (NPT_REAL(*)[7][3])malloc( (size_t)num*sizeof(NPT_REAL[7][3]) );
+            NPT_REAL (*tri_n   )[3][3] = (NPT_REAL(*)[3][3])malloc( (size_t)num*sizeof(NPT_REAL[3][3]) );
+            NPT_REAL (*pos     )[3]    = (NPT_REAL(*)[3]   )malloc( (size_t)num*sizeof(NPT_REAL[3]) );
+            NPT_REAL (*pos_o   )[3]    = (NPT_REAL(*)[3]   )malloc( (size_t)num*sizeof(NPT_REAL[3]) );
+            NPT_REAL*  eta             = (NPT_REAL*)malloc( (size_t)num*sizeof(NPT_REAL) );
+            NPT_REAL*  xi              = (NPT_REAL*)malloc( (size_t)num*sizeof(NPT_REAL) );
+            NPT_REAL (*tri_s   )[3][3] = (NPT_REAL(*)[3][3])malloc( (size_t)4*num*sizeof(NPT_REAL[3][3]) );
+            NPT_REAL (*npatch_s)[7][3] = (NPT_REAL(*)[7][3])malloc( (size_t)4*num*sizeof(NPT_REAL[7][3]) );
+            NPT_QPATCH* qpatch         = (NPT_QPATCH*)malloc( (size_t)num*sizeof(NPT_QPATCH) );
+            int*       tri_id          = (int*)malloc( (size_t)num*sizeof(int) );
+            if( npatch == NULL || npatch_n == NULL || tri_n == NULL || pos == NULL ||
+                pos_o == NULL || eta == NULL || xi == NULL || tri_s == NULL || npatch_s == NULL ||
+                qpatch == NULL || tri_id == NULL ) {
+                printf( "#### ERROR memory mesh=%s num_tri=%d\n", mesh_list[im], num );
+                return 1;
+            }
+
+            // 入力データ
+            //    pos   : 三角形上の点（重心座標をランダムに与える）
+            //    eta,xi: 0<=xi<=eta<=1 のランダムな値
+            //    tri_n : 回転(z軸周り0.1rad)と平行移動した三角形
+            for( i=0; i<num; i++ ) {
+                double a = bench_rand(&seed), b = bench_rand(&seed);
+                double c = 0.1, s = sin(c);
+                c = cos(c);
+                if( a + b > 1.0 ) { a = 1.0 - a; b = 1.0 - b; }
+                for( k=0; k<3; k++ ) {
+                    pos[i][k] = (1.0-a-b)*mesh.tri[i][0][k] + a*mesh.tri[i][1][k] + b*mesh.tri[i][2][k];
+                }
+                tri_id[i] = i;
+                eta[i] = bench_rand(&seed);
+                xi [i] = eta[i]*bench_rand(&seed);
+                for( k=0; k<3; k++ ) {
+                    tri_n[i][k][0] = c*mesh.tri[i][k][0] - s*mesh.tri[i][k][1] + 0.5;
+                    tri_n[i][k][1] = s*mesh.tri[i][k][0] + c*mesh.tri[i][k][1] - 0.25;
+                    tri_n[i][k][2] = mesh.tri[i][k][2] + 0.125;
+                }
+            }
+
+            // 計測
+            for( k=0; k<BENCH_NUM_KERNEL; k++ ) {
+                BENCH_RESULT* r = &res[num_res++];
+                double        t_min = 1.0e30;
+                int           err = 0;
+                NPT_REAL      qerr = 0.0;
+                static const char* kernel[BENCH_NUM_KERNEL] = {
+                    "npt_param_crt", "npt_cvt_pos_to_eta_xi", "npt_correct_pnt",
+                    "npt_correct_pnt2", "npt_move_vertex", "npt_subdiv",
+                    "npt_qpatch_encode", "npt_correct_pnt_q" };
+
+                // 1回目はウォームアップ
+                for( ir=0; ir<=repeat; ir++ ) {
+                    double t0 = bench_time();
+                    switch( k ) {
+                    case 0:
+                        err = npt_param_crt_n( num, mesh.tri, mesh.norm, npatch );
+                        break;
+                    case 1:
+                        npt_cvt_pos_to_eta_xi_n( num, pos, mesh.tri, eta, xi );
+                        break;
+                    case 2:
+                        npt_correct_pnt_n( num, eta, xi, mesh.tri, npatch, pos_o );
+                        break;
+                    case 3:
+                        npt_correct_pnt2_n( num, pos, mesh.tri, npatch, pos_o );
+                        break;
+                    case 4:
+                        npt_move_vertex_n( num, mesh.tri, npatch, tri_n, npatch_n );
+                        break;
+                    case 5:
+                        npt_subdiv_n( num, mesh.tri, npatch, tri_s, npatch_s );
+                        break;
+                    case 6:
+                        qerr = npt_qpatch_encode_n( num, mesh.tri, npatch, qpatch );
+                        break;
+                    case 7:
+                        npt_correct_pnt_q_n( num, tri_id, eta, xi, mesh.tri, qpatch, pos_o );
+                        break;
+                    }
+                    double t = bench_time() - t0;
+                    if( ir > 0 && t < t_min ) t_min = t;
+                }
+
+                strncpy( r->mesh,   mesh_list[im], sizeof(r->mesh)-1 );
+                r->mesh[sizeof(r->mesh)-1] = '\0';
+                strncpy( r->kernel, kernel[k],     sizeof(r->kernel)-1 );
+                r->kernel[sizeof(r->kernel)-1] = '\0';
+                r->num_tri = num;
+                r->time    = t_min;
+                r->err     = err;
+                printf( "%-8s %10d %-24s %12.2f %12.6f", r->mesh, num, r->kernel, 1.0e9*t_min/num, t_min );
+                if( k == 0 && err != 0 ) printf( "  (error patches=%d)", err );
+                if( k == 5 ) printf( "  (max diff from parent=%.2e)",
+                                     bench_subdiv_diff( num, eta, xi, mesh.tri, npatch, tri_s, npatch_s ) );
+                if( k == 6 ) printf( "  (error bound=%.2e)", qerr );
+                if( k == 7 ) {
+                    double over, err_r;
+                    double dmax = bench_quant_diff( num, eta, xi, mesh.tri, npatch, qpatch, pos_o, &over, &err_r );
+                    printf( "  (max error=%.2e, max over bound=%.2e, npt_correct_pnt max error=%.2e)",
+                            dmax, over, err_r );
+                }
+                printf( "\n" );
+            }
+
+            free( npatch );
+            free( npatch_n );
+            free( tri_n );
+            free( pos );
+            free( pos_o );
+            free( eta );
+            free( xi );
+            free( tri_s );
+            free( npatch_s );
+            free( qpatch );
+            free( tri_id );
+            bench_mesh_free( &mesh );
+        }
+    }
+
+    if( json != NULL ) bench_json( json, res, num_res );
+
+    if( npt_stat_is_enabled() ) npt_stat_print( stdout );
+
+    return 0;
+}
+
+
+// #################################################################
+//    非公開（プライベート）関数
+// #################################################################
+
+/// カンマ区切り文字列の分割（文字列を書き換える）
+static int
+bench_split( char* str, char* list[], int max )
+{
+    int   num = 0;
+    char* p   = strtok( str, "," );
+
+    while( p != NULL && num < max ) {
+        list[num++] = p;
+        p = strtok( NULL, "," );
+    }
+    return num;
+}
+
+
+/// 使用法の出力
+static void
+bench_usage( const char* prog )
+{
+    printf( "usage: %s [-s size,size,...] [-m mesh,mesh,...] [-r repeat] [-o file.json]\n", prog );
+    printf( "    -s  target number of triangles (default 10000,100000,1000000)\n" );
+    printf( "    -m  mesh type sphere,torus,plane,sliver (default all)\n" );
+    printf( "    -r  number of timed repeats, minimum is reported (default 5)\n" );
+    printf( "    -o  output results in JSON format\n" );
+}
+
+
+/// 計測結果の JSON 出力
+static void
+bench_json( const char* file_name, BENCH_RESULT* res, int num_res )
+{
+    FILE* fp = fopen( file_name, "w" );
+    int   i;
+
+    if( fp == NULL ) {
+        printf( "#### ERROR open file=%s\n", file_name );
+        return;
+    }
+    fprintf( fp, "{\n" );
+    fprintf( fp, "  \"library\": \"Npatch\",\n" );
+    fprintf( fp, "  \"version\": \"%s\",\n", NPT_VERSION_NO );
+    fprintf( fp, "  \"real\": \"%s\",\n", sizeof(NPT_REAL) == 8 ? "double" : "float" );
+    fprintf( fp, "  \"simd\": \"%s\",\n", npt_simd_name( npt_simd_get() ) );
+#ifdef _OPENMP
+    fprintf( fp, "  \"threads\": %d,\n", omp_get_max_threads() );
+#else
+    fprintf( fp, "  \"threads\": 1,\n" );
+#endif
+    fprintf( fp, "  \"results\": [\n" );
+    for( i=0; i<num_res; i++ ) {
+        fprintf( fp, "    {\"mesh\": \"%s\", \"num_tri\": %d, \"kernel\": \"%s\", "
+                     "\"ns_per_patch\": %.3f, \"time_s\": %.9f, \"errors\": %d}%s\n",
+                 res[i].mesh, res[i].num_tri, res[i].kernel,
+                 1.0e9*res[i].time/res[i].num_tri, res[i].time, res[i].err,
+                 i < num_res-1 ? "," : "" );
+    }
+    fprintf( fp, "  ]\n" );
+    fprintf( fp, "}\n" );
+    fclose( fp );
+}
+
+
+/// １-４分割の確認
+///    子パッチ上の点 (eta[i],xi[i]) と対応する親パッチ上の点の距離の最大値を返す
+static double
+bench_subdiv_diff( int num, NPT_REAL* eta, NPT_REAL* xi, NPT_REAL tri[][3][3], NPT_REAL npatch[][7][3],
+                   NPT_REAL tri_s[][3][3], NPT_REAL npatch_s[][7][3] )
+{
+    double dmax = 0.0;
+    int    i, c;
+
+    for( i=0; i<num; i++ ) {
+        for( c=0; c<4; c++ ) {
+            NPT_REAL e = eta[i], x = xi[i], ep, xp;
+            NPT_REAL p[3], q[3];
+            NPT_REAL (*t)[3]  = tri_s[4*i+c];
+            NPT_REAL (*cp)[3] = npatch_s[4*i+c];
+            switch( c ) {
+            case 0:  ep = 0.5*e;           xp = 0.5*x;       break;
+            case 1:  ep = 0.5*(1.0+e);     xp = 0.5*x;       break;
+            case 2:  ep = 0.5*(1.0+e);     xp = 0.5*(1.0+x); break;
+            default: ep = 0.5*(1.0+e-x);   xp = 0.5*e;       break;
+            }
+            npt_correct_pnt( e, x, t[0], t[1], t[2],
+                             cp[0], cp[1], cp[2], cp[3], cp[4], cp[5], cp[6], p );
+            npt_correct_pnt( ep, xp, tri[i][0], tri[i][1], tri[i][2],
+                             npatch[i][0], npatch[i][1], npatch[i][2], npatch[i][3],
+                             npatch[i][4], npatch[i][5], npatch[i][6], q );
+            double d = CalcLineSize( p, q );
+            if( d > dmax ) dmax = d;
+        }
+    }
+    return dmax;
+}
+
+
+/// 量子化パラメータでの補正点の誤差（量子化前のパラメータから倍精度で求めた点との距離）の最大値
+///    パッチごとの誤差の上限 sqrt(3)*scale/(2*NPT_QUANT_MAX) を超えた距離の最大値（丸め誤差）を over に、
+///    比較のため npt_correct_pnt の補正点の誤差の最大値を err_r に返す
+static double
+bench_quant_diff( int num, NPT_REAL* eta, NPT_REAL* xi, NPT_REAL tri[][3][3], NPT_REAL npatch[][7][3],
+                  const NPT_QPATCH* qpatch, NPT_REAL pos_q[][3], double* over, double* err_r )
+{
+    double dmax = 0.0;
+    int    i, j, k;
+
+    *over  = 0.0;
+    *err_r = 0.0;
+    for( i=0; i<num; i++ ) {
+        NPT_REAL pos_r[3];
+        npt_correct_pnt( eta[i], xi[i], tri[i][0], tri[i][1], tri[i][2],
+                         npatch[i][0], npatch[i][1], npatch[i][2], npatch[i][3],
+                         npatch[i][4], npatch[i][5], npatch[i][6], pos_r );
+
+        // npt_correct_pnt() と同じ式を倍精度で計算
+        double u = (double)eta[i] - (double)xi[i];
+        double v = (double)xi[i];
+        double w = 1.0 - (double)eta[i];
+        double b[7] = { 3.0*u*w*w, 3.0*u*u*w, 3.0*u*u*v, 3.0*u*v*v, 3.0*v*v*w, 3.0*v*w*w, 6.0*u*v*w };
+        double d = 0.0, dr = 0.0;
+        for( j=0; j<3; j++ ) {
+            double x = tri[i][0][j]*w*w*w + tri[i][1][j]*u*u*u + tri[i][2][j]*v*v*v;
+            for( k=0; k<7; k++ ) x += b[k]*npatch[i][k][j];
+            d  += ( pos_q[i][j] - x )*( pos_q[i][j] - x );
+            dr += ( pos_r[j]    - x )*( pos_r[j]    - x );
+        }
+        d  = sqrt( d );
+        dr = sqrt( dr );
+
+        double bound = 0.5*sqrt(3.0)*qpatch[i].scale/NPT_QUANT_MAX;
+        if( d > dmax ) dmax = d;
+        if( d - bound > *over ) *over = d - bound;
+        if( dr > *err_r ) *err_r = dr;
+    }
+    return dmax;
+}
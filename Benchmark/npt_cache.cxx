@@ -0,0 +1,275 @@
+/*
+ * Npatch - Nagata Patch Library
+ *
+ * Copyright (c) 2015-2016 Advanced Institute for Computational Science, RIKEN.
+ * All rights reserved.
+ *
+ */
+
+////////////////////////////////////////////////////////////////////////////
+///
+/// 長田パッチ パラメータの遅延生成キャッシュ（NPT_CACHE）の計測
+///
+///   頂点共有のトーラス（3nv x nv 格子）のうち w x w 格子の領域の三角形上の点
+///   （三角形あたり p 点、三角形の順はランダム）を補正する場合について、
+///       param_all : 全三角形の npt_mesh_param_get + npt_correct_pnt
+///       epatch    : npt_epatch_crt + npt_epatch_correct_pnt_n
+///       cache     : npt_cache_crt + npt_cache_correct_pnt_n（初回、未生成のパッチを生成）
+///       cache2    : npt_cache_correct_pnt_n（２回目、全て生成済み）
+///   の時間（繰り返しの最小値）とパラメータのメモリ量を出力する。
+///   cache の出力が param_all とビット単位で一致すること、生成されたパッチ数が
+///   領域の三角形数と一致することを確認する。
+///   さらに全スレッドが同じ三角形の集合を異なる順に同時に参照し、結果が一致することを確認する。
+///
+///   使用法
+///       npt_cache [-n nv] [-w window] [-p points] [-r repeat]
+///
+////////////////////////////////////////////////////////////////////////////
+
+#include "bench_mesh.h"
+#include "Npt_Cache.h"
+
+//------------------------------------------------------------------
+//  プロトタイプ宣言
+//------------------------------------------------------------------
+static long cache_compare( int num, NPT_REAL (*a)[3], NPT_REAL (*b)[3] );
+static long cache_concurrent( NPT_MESH* mesh, int num, const int* tri_id, NPT_REAL* eta, NPT_REAL* xi,
+                              NPT_REAL (*ref)[3] );
+
+
+// #################################################################
+//    メイン
+// #################################################################
+
+int
+main( int argc, char** argv )
+{
+    int        nv = 512, nu, w = 64, np = 4, repeat = 3;
+    int        i, j, k, r;
+    uint64_t   seed = 88172645463325252ULL;
+    static const double prm[2] = { BENCH_TORUS_R, BENCH_TORUS_r };
+
+    for( i=1; i<argc; i++ ) {
+        if( strcmp( argv[i], "-n" ) == 0 && i+1 < argc ) nv     = atoi( argv[++i] );
+        if( strcmp( argv[i], "-w" ) == 0 && i+1 < argc ) w      = atoi( argv[++i] );
+        if( strcmp( argv[i], "-p" ) == 0 && i+1 < argc ) np     = atoi( argv[++i] );
+        if( strcmp( argv[i], "-r" ) == 0 && i+1 < argc ) repeat = atoi( argv[++i] );
+    }
+    nu = 3*nv;
+    if( w > nv ) w = nv;
+    if( np < 1 ) np = 1;
+
+    //-------------------
+    //  頂点共有のトーラス
+    //-------------------
+    int num_vtx = nu*nv;
+    int num_tri = 2*nu*nv;
+    NPT_MESH mesh;
+    mesh.num_vtx  = num_vtx;
+    mesh.num_tri  = num_tri;
+    mesh.vtx      = (NPT_REAL(*)[3])malloc( (size_t)num_vtx*sizeof(NPT_REAL[3]) );
+    mesh.vtx_norm = (NPT_REAL(*)[3])malloc( (size_t)num_vtx*sizeof(NPT_REAL[3]) );
+    mesh.tri      = (int(*)[3])malloc( (size_t)num_tri*sizeof(int[3]) );
+    if( mesh.vtx == NULL || mesh.vtx_norm == NULL || mesh.tri == NULL ) {
+        printf( "#### ERROR npt_cache: memory\n" );
+        return 1;
+    }
+    for( j=0; j<nv; j++ ) {
+        for( i=0; i<nu; i++ ) {
+            double pos[3], norm[3];
+            bench_surf_torus( (double)i/nu, (double)j/nv, prm, pos, norm );
+            for( k=0; k<3; k++ ) {
+                mesh.vtx     [j*nu + i][k] = pos[k];
+                mesh.vtx_norm[j*nu + i][k] = norm[k];
+            }
+        }
+    }
+    for( j=0; j<nv; j++ ) {
+        for( i=0; i<nu; i++ ) {
+            int v00 = j*nu + i,                 v10 = j*nu + (i+1)%nu;
+            int v11 = ((j+1)%nv)*nu + (i+1)%nu, v01 = ((j+1)%nv)*nu + i;
+            int it  = 2*(j*nu + i);
+            mesh.tri[it  ][0] = v00; mesh.tri[it  ][1] = v10; mesh.tri[it  ][2] = v11;
+            mesh.tri[it+1][0] = v00; mesh.tri[it+1][1] = v11; mesh.tri[it+1][2] = v01;
+        }
+    }
+
+    //-------------------
+    //  問い合わせ点（w x w 格子の領域、三角形の順はランダム）
+    //-------------------
+    int   num_win = 2*w*w;
+    int   num_pnt = num_win*np;
+    int*  win     = (int*)malloc( (size_t)num_win*sizeof(int) );
+    int*  tri_id  = (int*)malloc( (size_t)num_pnt*sizeof(int) );
+    NPT_REAL*  eta  = (NPT_REAL*)malloc( (size_t)num_pnt*sizeof(NPT_REAL) );
+    NPT_REAL*  xi   = (NPT_REAL*)malloc( (size_t)num_pnt*sizeof(NPT_REAL) );
+    NPT_REAL (*pos_all)[3] = (NPT_REAL(*)[3])malloc( (size_t)num_pnt*sizeof(NPT_REAL[3]) );
+    NPT_REAL (*pos_ep )[3] = (NPT_REAL(*)[3])malloc( (size_t)num_pnt*sizeof(NPT_REAL[3]) );
+    NPT_REAL (*pos_c  )[3] = (NPT_REAL(*)[3])malloc( (size_t)num_pnt*sizeof(NPT_REAL[3]) );
+    NPT_REAL (*npatch )[7][3] = (NPT_REAL(*)[7][3])malloc( (size_t)num_tri*sizeof(NPT_REAL[7][3]) );
+    if( win == NULL || tri_id == NULL || eta == NULL || xi == NULL ||
+        pos_all == NULL || pos_ep == NULL || pos_c == NULL || npatch == NULL ) {
+        printf( "#### ERROR npt_cache: memory\n" );
+        return 1;
+    }
+    for( j=0; j<w; j++ ) {
+        for( i=0; i<w; i++ ) {
+            win[ 2*(j*w + i)     ] = 2*(j*nu + i);
+            win[ 2*(j*w + i) + 1 ] = 2*(j*nu + i) + 1;
+        }
+    }
+    for( i=num_win-1; i>0; i-- ) {
+        int t = (int)( bench_rand( &seed )*(i+1) );
+        int wk = win[i]; win[i] = win[t]; win[t] = wk;
+    }
+    for( i=0; i<num_pnt; i++ ) {
+        double e = bench_rand( &seed );
+        double x = bench_rand( &seed )*e;
+        tri_id[i] = win[ i/np ];
+        eta[i]    = e;
+        xi[i]     = x;
+    }
+
+    //-------------------
+    //  計測
+    //-------------------
+    double t_all = 1.0e30, t_ep = 1.0e30, t_c = 1.0e30, t_c2 = 1.0e30;
+    int    num_gen = 0;
+    size_t bytes_ep = 0, bytes_c = 0;
+
+    for( r=0; r<repeat; r++ ) {
+        double t0 = bench_time();
+#pragma omp parallel for schedule(static)
+        for( i=0; i<num_tri; i++ ) {
+            npt_mesh_param_get( &mesh, i, npatch[i] );
+        }
+#pragma omp parallel for schedule(static)
+        for( i=0; i<num_pnt; i++ ) {
+            int id = tri_id[i];
+            npt_correct_pnt( eta[i], xi[i],
+                    mesh.vtx[ mesh.tri[id][0] ], mesh.vtx[ mesh.tri[id][1] ], mesh.vtx[ mesh.tri[id][2] ],
+                    npatch[id][0], npatch[id][1], npatch[id][2], npatch[id][3],
+                    npatch[id][4], npatch[id][5], npatch[id][6],
+                    pos_all[i] );
+        }
+        double t1 = bench_time();
+
+        NPT_EPATCH epatch;
+        if( npt_epatch_crt( &mesh, &epatch ) != 0 ) {
+            printf( "#### ERROR npt_epatch_crt: memory\n" );
+            return 1;
+        }
+        npt_epatch_correct_pnt_n( &mesh, &epatch, num_pnt, tri_id, eta, xi, pos_ep );
+        double t2 = bench_time();
+        bytes_ep = (size_t)epatch.num_edge*( sizeof(int[2]) + sizeof(NPT_REAL[2][3]) )
+                 + (size_t)num_tri*sizeof(int[3]);
+        npt_epatch_free( &epatch );
+
+        double t3 = bench_time();
+        NPT_CACHE cache;
+        if( npt_cache_crt( &mesh, &cache ) != 0 ||
+            npt_cache_correct_pnt_n( &cache, num_pnt, tri_id, eta, xi, pos_c ) != 0 ) {
+            printf( "#### ERROR npt_cache: memory\n" );
+            return 1;
+        }
+        double t4 = bench_time();
+        npt_cache_correct_pnt_n( &cache, num_pnt, tri_id, eta, xi, pos_c );
+        double t5 = bench_time();
+        num_gen = npt_cache_num( &cache, &bytes_c );
+        bytes_c += (size_t)num_tri*sizeof(int);
+        npt_cache_free( &cache );
+
+        if( t1 - t0 < t_all ) t_all = t1 - t0;
+        if( t2 - t1 < t_ep  ) t_ep  = t2 - t1;
+        if( t4 - t3 < t_c   ) t_c   = t4 - t3;
+        if( t5 - t4 < t_c2  ) t_c2  = t5 - t4;
+    }
+
+    long ndiff = cache_compare( num_pnt, pos_c, pos_all );
+    long ndiff_ep = cache_compare( num_pnt, pos_ep, pos_all );
+    long nconc = cache_concurrent( &mesh, num_pnt, tri_id, eta, xi, pos_all );
+
+    printf( "#### Npatch cache  real=%s  num_tri=%d  window=%dx%d (%d tri, %.2f%%)  points=%d  threads=%d\n",
+            sizeof(NPT_REAL) == 8 ? "double" : "float", num_tri, w, w, num_win,
+            100.0*num_win/num_tri, num_pnt,
+#ifdef _OPENMP
+            omp_get_max_threads()
+#else
+            1
+#endif
+        );
+    printf( "  %-10s %12s %12s\n", "method", "time[s]", "memory[MB]" );
+    printf( "  %-10s %12.6f %12.2f\n", "param_all", t_all, (double)num_tri*sizeof(NPT_REAL[7][3])/1.0e6 );
+    printf( "  %-10s %12.6f %12.2f\n", "epatch",    t_ep,  (double)bytes_ep/1.0e6 );
+    printf( "  %-10s %12.6f %12.2f\n", "cache",     t_c,   (double)bytes_c/1.0e6 );
+    printf( "  %-10s %12.6f %12s\n",   "cache2",    t_c2,  "-" );
+    printf( "  generated patches     : %d (window %d) %s\n", num_gen, num_win, num_gen == num_win ? "OK" : "NG" );
+    printf( "  diff from param_all   : cache %ld  epatch %ld  (points, bitwise) %s\n",
+            ndiff, ndiff_ep, ndiff == 0 ? "OK" : "NG" );
+    printf( "  concurrent access     : %ld mismatches %s\n", nconc, nconc == 0 ? "OK" : "NG" );
+
+    free( mesh.vtx ); free( mesh.vtx_norm ); free( mesh.tri );
+    free( win ); free( tri_id ); free( eta ); free( xi );
+    free( pos_all ); free( pos_ep ); free( pos_c ); free( npatch );
+    return ( ndiff == 0 && nconc == 0 && num_gen == num_win ) ? 0 : 1;
+}
+
+
+// #################################################################
+//    非公開（プライベート）関数
+// #################################################################
+
+/// 出力点の比較（ビット単位で異なる点の数）
+static long
+cache_compare( int num, NPT_REAL (*a)[3], NPT_REAL (*b)[3] )
+{
+    long n = 0;
+    int  i;
+    for( i=0; i<num; i++ ) {
+        if( memcmp( a[i], b[i], sizeof(NPT_REAL[3]) ) != 0 ) n++;
+    }
+    return n;
+}
+
+
+/// 同時参照の確認
+///    全スレッドが同じ点の集合を異なる開始位置から巡回して npt_cache_get で参照し、
+///    参照解と異なる点の数を返す
+static long
+cache_concurrent( NPT_MESH* mesh, int num, const int* tri_id, NPT_REAL* eta, NPT_REAL* xi,
+                  NPT_REAL (*ref)[3] )
+{
+    NPT_CACHE cache;
+    long      nerr = 0;
+
+    if( npt_cache_crt( mesh, &cache ) != 0 ) return -1;
+
+#pragma omp parallel reduction(+:nerr)
+    {
+        int ith = 0, nth = 1, m;
+#ifdef _OPENMP
+        ith = omp_get_thread_num();
+        nth = omp_get_num_threads();
+#endif
+        int start = (int)( (long long)num*ith/nth );
+        for( m=0; m<num; m++ ) {
+            int i  = ( start + m ) % num;
+            int id = tri_id[i];
+            const NPT_REAL* cp = npt_cache_get( &cache, id );
+            NPT_REAL        pos[3];
+            if( cp == NULL ) {
+                nerr++;
+                continue;
+            }
+            npt_correct_pnt( eta[i], xi[i],
+                    mesh->vtx[ mesh->tri[id][0] ], mesh->vtx[ mesh->tri[id][1] ], mesh->vtx[ mesh->tri[id][2] ],
+                    (NPT_REAL*)cp, (NPT_REAL*)cp+3, (NPT_REAL*)cp+6, (NPT_REAL*)cp+9,
+                    (NPT_REAL*)cp+12, (NPT_REAL*)cp+15, (NPT_REAL*)cp+18,
+                    pos );
+            if( memcmp( pos, ref[i], sizeof(pos) ) != 0 ) nerr++;
+        }
+    }
+
+    npt_cache_free( &cache );
+    return nerr;
+}
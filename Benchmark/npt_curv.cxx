@@ -0,0 +1,276 @@
+/*
+ * Npatch - Nagata Patch Library
+ *
+ * Copyright (c) 2015-2016 Advanced Institute for Computational Science, RIKEN.
+ * All rights reserved.
+ *
+ */
+
+////////////////////////////////////////////////////////////////////////////
+///
+/// 長田パッチ 曲率の評価（npt_curv_eval_n, npt_curv_vtx_mesh）の計測
+///
+///   球、楕円体、トーラスのメッシュの各三角形上のランダムな点（三角形あたり p 点）の
+///   ガウス曲率、平均曲率を npt_curv_eval_n で求め、評価点の解析曲面上の値との誤差と
+///   時間を出力する。トーラスでは主方向（子午線方向）の誤差も出力する。
+///   さらに頂点共有のトーラスの頂点の曲率（npt_curv_vtx_mesh）の誤差を、
+///   平面三角形の角度欠損によるガウス曲率の誤差と比較する。
+///   誤差は解析解の絶対値の最大値に対する比とする。
+///
+///   使用法
+///       npt_curv [-n num] [-p points]
+///
+////////////////////////////////////////////////////////////////////////////
+
+#include "bench_mesh.h"
+#include "Npt_Curv.h"
+
+//------------------------------------------------------------------
+//  プロトタイプ宣言
+//------------------------------------------------------------------
+static void curv_exact( const char* type, const NPT_REAL pos[3], double* kg, double* km, double mer[3] );
+static int  curv_samples( const char* type, int num, int np );
+static int  curv_vertex( int nv );
+
+
+// #################################################################
+//    メイン
+// #################################################################
+
+int
+main( int argc, char** argv )
+{
+    static const char* type[3] = { "sphere", "ellipsoid", "torus" };
+    int  num = 2000, np = 16;
+    int  i, ng = 0;
+
+    for( i=1; i<argc; i++ ) {
+        if( strcmp( argv[i], "-n" ) == 0 && i+1 < argc ) num = atoi( argv[++i] );
+        if( strcmp( argv[i], "-p" ) == 0 && i+1 < argc ) np  = atoi( argv[++i] );
+    }
+    if( np < 1 ) np = 1;
+
+    printf( "#### Npatch curv  real=%s  threads=%d\n",
+            sizeof(NPT_REAL) == 8 ? "double" : "float",
+#ifdef _OPENMP
+            omp_get_max_threads()
+#else
+            1
+#endif
+        );
+
+    printf( "\n## samples (npt_curv_eval_n, %d points per triangle)\n", np );
+    printf( "  %-10s %8s %10s %10s %10s %10s %10s %10s\n",
+            "mesh", "num_tri", "K_rms", "K_max", "H_rms", "H_max", "dir[deg]", "ns/point" );
+    for( i=0; i<3; i++ ) {
+        ng += curv_samples( type[i], num, np );
+    }
+
+    ng += curv_vertex( (int)sqrt( num/6.0 ) );
+    return ng;
+}
+
+
+// #################################################################
+//    非公開（プライベート）関数
+// #################################################################
+
+/// 解析曲面の曲率（外向き法線、点 pos に最も近い曲面上の点の近似）
+///    mer : トーラスの子午線方向（主曲率 -1/r の方向）、それ以外は 0
+static void
+curv_exact( const char* type, const NPT_REAL pos[3], double* kg, double* km, double mer[3] )
+{
+    mer[0] = mer[1] = mer[2] = 0.0;
+
+    if( strcmp( type, "torus" ) == 0 ) {
+        double R = BENCH_TORUS_R, r = BENCH_TORUS_r;
+        double ph = atan2( (double)pos[1], (double)pos[0] );
+        double rh = sqrt( (double)pos[0]*pos[0] + (double)pos[1]*pos[1] ) - R;
+        double th = atan2( (double)pos[2], rh );
+        double ct = cos( th );
+        *kg = ct/( r*( R + r*ct ) );
+        *km = -( R + 2.0*r*ct )/( 2.0*r*( R + r*ct ) );
+        mer[0] = -sin( th )*cos( ph );
+        mer[1] = -sin( th )*sin( ph );
+        mer[2] =  ct;
+    }
+    else {
+        double a = 1.0, b = 1.0, c = 1.0;
+        if( strcmp( type, "ellipsoid" ) == 0 ) {
+            a = BENCH_ELLIPSOID_A; b = BENCH_ELLIPSOID_B; c = BENCH_ELLIPSOID_C;
+        }
+        // 中心からの射影で曲面上の点とする
+        double s = sqrt( pos[0]*pos[0]/(a*a) + pos[1]*pos[1]/(b*b) + pos[2]*pos[2]/(c*c) );
+        double x = pos[0]/s, y = pos[1]/s, z = pos[2]/s;
+        double h = sqrt( x*x/(a*a*a*a) + y*y/(b*b*b*b) + z*z/(c*c*c*c) );
+        double abc2 = a*a*b*b*c*c;
+        *kg = 1.0/( abc2*h*h*h*h );
+        *km = ( x*x + y*y + z*z - a*a - b*b - c*c )/( 2.0*abc2*h*h*h );
+    }
+}
+
+
+/// 三角形上のランダムな点の曲率の誤差
+static int
+curv_samples( const char* type, int num, int np )
+{
+    BENCH_MESH mesh;
+    uint64_t   seed = 88172645463325252ULL;
+    int        i, p, nbad = 0;
+    double     ekg2 = 0.0, ekm2 = 0.0, ekg = 0.0, ekm = 0.0, edir = 0.0;
+    double     kg_max = 0.0, km_max = 0.0, time = 0.0;
+
+    if( bench_mesh_crt( type, num, &mesh ) != 0 ) return 1;
+    NPT_REAL (*npatch)[7][3] = (NPT_REAL(*)[7][3])malloc( (size_t)mesh.num*sizeof(NPT_REAL[7][3]) );
+    NPT_REAL*  eta  = (NPT_REAL*)malloc( (size_t)mesh.num*sizeof(NPT_REAL) );
+    NPT_REAL*  xi   = (NPT_REAL*)malloc( (size_t)mesh.num*sizeof(NPT_REAL) );
+    NPT_CURV*  curv = (NPT_CURV*)malloc( (size_t)mesh.num*sizeof(NPT_CURV) );
+    double   (*ex)[2] = (double(*)[2])malloc( (size_t)mesh.num*np*sizeof(double[2]) );
+    if( npatch == NULL || eta == NULL || xi == NULL || curv == NULL || ex == NULL ) {
+        printf( "#### ERROR npt_curv: memory\n" );
+        return 1;
+    }
+    npt_param_crt_n( mesh.num, mesh.tri, mesh.norm, npatch );
+
+    for( p=0; p<np; p++ ) {
+        for( i=0; i<mesh.num; i++ ) {
+            double r1 = bench_rand( &seed ), r2 = bench_rand( &seed );
+            if( r2 > r1 ) { double t = r1; r1 = r2; r2 = t; }
+            eta[i] = r1;
+            xi[i]  = r2;
+        }
+        double t0 = bench_time();
+        nbad += npt_curv_eval_n( mesh.num, eta, xi, mesh.tri, npatch, curv );
+        time += bench_time() - t0;
+
+        for( i=0; i<mesh.num; i++ ) {
+            double kg, km, mer[3];
+            curv_exact( type, curv[i].pos, &kg, &km, mer );
+            if( fabs( kg ) > kg_max ) kg_max = fabs( kg );
+            if( fabs( km ) > km_max ) km_max = fabs( km );
+
+            double dk = curv[i].k_gauss - kg, dm = curv[i].k_mean - km;
+            ekg2 += dk*dk;
+            ekm2 += dm*dm;
+            ex[p*mesh.num + i][0] = fabs( dk );
+            ex[p*mesh.num + i][1] = fabs( dm );
+
+            // 子午線方向と主方向 dir[1]（小さい方の主曲率）のなす角
+            if( mer[0] != 0.0 || mer[1] != 0.0 || mer[2] != 0.0 ) {
+                double c = fabs( mer[0]*curv[i].dir[1][0] + mer[1]*curv[i].dir[1][1] + mer[2]*curv[i].dir[1][2] );
+                double a = acos( c > 1.0 ? 1.0 : c )*180.0/PAI;
+                if( a > edir ) edir = a;
+            }
+        }
+    }
+    for( i=0; i<mesh.num*np; i++ ) {
+        if( ex[i][0] > ekg ) ekg = ex[i][0];
+        if( ex[i][1] > ekm ) ekm = ex[i][1];
+    }
+
+    char dir[16];
+    if( strcmp( type, "torus" ) == 0 ) sprintf( dir, "%10.3f", edir );
+    else                               sprintf( dir, "%10s", "-" );
+    printf( "  %-10s %8d %10.3e %10.3e %10.3e %10.3e %s %10.1f\n", type, mesh.num,
+            sqrt( ekg2/(mesh.num*np) )/kg_max, ekg/kg_max, sqrt( ekm2/(mesh.num*np) )/km_max, ekm/km_max,
+            dir, 1.0e9*time/((double)mesh.num*np) );
+
+    free( npatch ); free( eta ); free( xi ); free( curv ); free( ex );
+    bench_mesh_free( &mesh );
+    return nbad > 0 ? 1 : 0;
+}
+
+
+/// 頂点共有のトーラス（3nv x nv 格子）の頂点の曲率
+static int
+curv_vertex( int nv )
+{
+    static const double prm[2] = { BENCH_TORUS_R, BENCH_TORUS_r };
+    int      nu;
+    int      i, j, k;
+    NPT_MESH mesh;
+
+    if( nv < 3 ) nv = 3;
+    nu = 3*nv;
+    mesh.num_vtx  = nu*nv;
+    mesh.num_tri  = 2*nu*nv;
+    mesh.vtx      = (NPT_REAL(*)[3])malloc( (size_t)mesh.num_vtx*sizeof(NPT_REAL[3]) );
+    mesh.vtx_norm = (NPT_REAL(*)[3])malloc( (size_t)mesh.num_vtx*sizeof(NPT_REAL[3]) );
+    mesh.tri      = (int(*)[3])malloc( (size_t)mesh.num_tri*sizeof(int[3]) );
+    NPT_CURV* curv = (NPT_CURV*)malloc( (size_t)mesh.num_vtx*sizeof(NPT_CURV) );
+    double*   ang  = (double*)malloc( (size_t)mesh.num_vtx*sizeof(double) );
+    double*   area = (double*)malloc( (size_t)mesh.num_vtx*sizeof(double) );
+    if( mesh.vtx == NULL || mesh.vtx_norm == NULL || mesh.tri == NULL || curv == NULL || ang == NULL || area == NULL ) {
+        printf( "#### ERROR npt_curv: memory\n" );
+        return 1;
+    }
+    for( j=0; j<nv; j++ ) {
+        for( i=0; i<nu; i++ ) {
+            double pos[3], norm[3];
+            bench_surf_torus( (double)i/nu, (double)j/nv, prm, pos, norm );
+            for( k=0; k<3; k++ ) {
+                mesh.vtx     [j*nu + i][k] = pos[k];
+                mesh.vtx_norm[j*nu + i][k] = norm[k];
+            }
+        }
+    }
+    for( j=0; j<nv; j++ ) {
+        for( i=0; i<nu; i++ ) {
+            int v00 = j*nu + i,                 v10 = j*nu + (i+1)%nu;
+            int v11 = ((j+1)%nv)*nu + (i+1)%nu, v01 = ((j+1)%nv)*nu + i;
+            int it  = 2*(j*nu + i);
+            mesh.tri[it  ][0] = v00; mesh.tri[it  ][1] = v10; mesh.tri[it  ][2] = v11;
+            mesh.tri[it+1][0] = v00; mesh.tri[it+1][1] = v11; mesh.tri[it+1][2] = v01;
+        }
+    }
+
+    double t0 = bench_time();
+    int    ret = npt_curv_vtx_mesh( &mesh, curv );
+    double t1 = bench_time();
+
+    // 平面三角形の角度欠損によるガウス曲率  (2π - Σ角度)/(Σ面積/3)
+    for( i=0; i<mesh.num_vtx; i++ ) ang[i] = area[i] = 0.0;
+    for( i=0; i<mesh.num_tri; i++ ) {
+        for( j=0; j<3; j++ ) {
+            NPT_REAL* p0 = mesh.vtx[ mesh.tri[i][j] ];
+            NPT_REAL* p1 = mesh.vtx[ mesh.tri[i][(j+1)%3] ];
+            NPT_REAL* p2 = mesh.vtx[ mesh.tri[i][(j+2)%3] ];
+            double e1[3], e2[3], c[3];
+            for( k=0; k<3; k++ ) { e1[k] = p1[k] - p0[k]; e2[k] = p2[k] - p0[k]; }
+            c[0] = e1[1]*e2[2] - e1[2]*e2[1];
+            c[1] = e1[2]*e2[0] - e1[0]*e2[2];
+            c[2] = e1[0]*e2[1] - e1[1]*e2[0];
+            double s = sqrt( c[0]*c[0] + c[1]*c[1] + c[2]*c[2] );
+            double d = e1[0]*e2[0] + e1[1]*e2[1] + e1[2]*e2[2];
+            ang [ mesh.tri[i][j] ] += atan2( s, d );
+            area[ mesh.tri[i][j] ] += s/6.0;
+        }
+    }
+
+    double kg_max = 0.0, km_max = 0.0;
+    double ekg2 = 0.0, ekm2 = 0.0, ekg = 0.0, ekm = 0.0, efl2 = 0.0, efl = 0.0;
+    for( i=0; i<mesh.num_vtx; i++ ) {
+        double kg, km, mer[3];
+        curv_exact( "torus", mesh.vtx[i], &kg, &km, mer );
+        if( fabs( kg ) > kg_max ) kg_max = fabs( kg );
+        if( fabs( km ) > km_max ) km_max = fabs( km );
+        double dk = fabs( curv[i].k_gauss - kg ), dm = fabs( curv[i].k_mean - km );
+        double df = fabs( ( 2.0*PAI - ang[i] )/area[i] - kg );
+        ekg2 += dk*dk; ekm2 += dm*dm; efl2 += df*df;
+        if( dk > ekg ) ekg = dk;
+        if( dm > ekm ) ekm = dm;
+        if( df > efl ) efl = df;
+    }
+
+    printf( "\n## vertices (indexed torus, num_vtx=%d)\n", mesh.num_vtx );
+    printf( "  %-22s %10s %10s %10s %10s %10s\n", "method", "K_rms", "K_max", "H_rms", "H_max", "ns/vertex" );
+    printf( "  %-22s %10.3e %10.3e %10.3e %10.3e %10.1f\n", "npt_curv_vtx_mesh",
+            sqrt( ekg2/mesh.num_vtx )/kg_max, ekg/kg_max, sqrt( ekm2/mesh.num_vtx )/km_max, ekm/km_max,
+            1.0e9*( t1 - t0 )/mesh.num_vtx );
+    printf( "  %-22s %10.3e %10.3e %10s %10s %10s\n", "flat angle deficit",
+            sqrt( efl2/mesh.num_vtx )/kg_max, efl/kg_max, "-", "-", "-" );
+
+    free( mesh.vtx ); free( mesh.vtx_norm ); free( mesh.tri );
+    free( curv ); free( ang ); free( area );
+    return ret;
+}
@@ -0,0 +1,256 @@
+/*
+ * Npatch - Nagata Patch Library
+ *
+ * Copyright (c) 2015-2016 Advanced Institute for Computational Science, RIKEN.
+ * All rights reserved.
+ *
+ */
+
+////////////////////////////////////////////////////////////////////////////
+///
+/// 長田パッチ フレーム間のパラメータ更新（npt_param_update_n）の計測
+///
+///   メッシュを次の運動で f フレーム動かし、フレームごとに
+///       crt    : npt_param_crt_n による全パッチの再生成
+///       update : npt_param_update_n による更新（前フレームの制御点の再利用）
+///   の時間（フレームの平均）、更新の区分ごとのパッチ数（フレームの平均）、
+///   update と crt の制御点の差の最大値（三角形の最大辺長との比）を出力する。
+///       static : 静止
+///       drift  : 許容差の 0.3 倍（最大辺長との比）ずつの平行移動
+///       rigid  : 剛体運動（回転 0.01 rad、平行移動 0.01 / フレーム）
+///       bump   : 剛体運動 + 表面を移動する局所的な変形（半径 0.2、高さ 0.05）
+///
+///   使用法
+///       npt_frame [-m mesh] [-n num] [-f frames] [-t tol]
+///
+////////////////////////////////////////////////////////////////////////////
+
+#include "bench_mesh.h"
+
+// 局所的な変形（ガウス関数の形状）
+#define FRAME_BUMP_R      0.2
+#define FRAME_BUMP_H      0.05
+
+// 運動の種類
+enum { FRAME_STATIC = 0, FRAME_DRIFT, FRAME_RIGID, FRAME_BUMP, FRAME_NUM_MOTION };
+
+static const char* frame_motion_str[FRAME_NUM_MOTION] = { "static", "drift", "rigid", "bump" };
+
+//------------------------------------------------------------------
+//  プロトタイプ宣言
+//------------------------------------------------------------------
+static void   frame_pose( int motion, int f, double drift, const BENCH_MESH* base, BENCH_MESH* cur );
+static double frame_diff( int num, NPT_REAL (*tri)[3][3], NPT_REAL (*a)[7][3], NPT_REAL (*b)[7][3] );
+
+
+// #################################################################
+//    メイン
+// #################################################################
+
+int
+main( int argc, char** argv )
+{
+    const char* type = "sphere";
+    int         num = 100000, nf = 20;
+    double      tol = 1.0e-3;
+    int         i, f, m;
+    BENCH_MESH  base, cur;
+
+    for( i=1; i<argc; i++ ) {
+        if( strcmp( argv[i], "-m" ) == 0 && i+1 < argc ) type = argv[++i];
+        if( strcmp( argv[i], "-n" ) == 0 && i+1 < argc ) num  = atoi( argv[++i] );
+        if( strcmp( argv[i], "-f" ) == 0 && i+1 < argc ) nf   = atoi( argv[++i] );
+        if( strcmp( argv[i], "-t" ) == 0 && i+1 < argc ) tol  = atof( argv[++i] );
+    }
+    if( nf < 1 ) nf = 1;
+
+    if( bench_mesh_crt( type, num, &base ) != 0 ) return 1;
+    num = base.num;
+
+    NPT_REAL (*tri_ref) [3][3] = (NPT_REAL (*)[3][3])malloc( sizeof(NPT_REAL[3][3])*num );
+    NPT_REAL (*norm_ref)[3][3] = (NPT_REAL (*)[3][3])malloc( sizeof(NPT_REAL[3][3])*num );
+    NPT_REAL (*cp_crt)  [7][3] = (NPT_REAL (*)[7][3])malloc( sizeof(NPT_REAL[7][3])*num );
+    NPT_REAL (*cp_upd)  [7][3] = (NPT_REAL (*)[7][3])malloc( sizeof(NPT_REAL[7][3])*num );
+    if( tri_ref == NULL || norm_ref == NULL || cp_crt == NULL || cp_upd == NULL ||
+        bench_mesh_alloc( num, &cur ) != 0 ) {
+        printf( "#### ERROR npt_frame: memory\n" );
+        return 1;
+    }
+
+    // 最大辺長（drift の移動量）
+    double lmax = 0.0;
+    for( i=0; i<num; i++ ) {
+        for( int j=0; j<3; j++ ) {
+            NPT_REAL d[3];
+            CalcVec( base.tri[i][j], base.tri[i][(j+1)%3], d );
+            double l = sqrt( (double)CalcInProduct( d, d ) );
+            if( l > lmax ) lmax = l;
+        }
+    }
+
+    int nthreads = 1;
+#ifdef _OPENMP
+    nthreads = omp_get_max_threads();
+#endif
+    printf( "#### Npatch frame update  real=%s  mesh=%s  num_tri=%d  frames=%d  tol=%g  threads=%d\n",
+            sizeof(NPT_REAL) == sizeof(double) ? "double" : "float",
+            type, num, nf, tol, nthreads );
+    printf( "  %-7s %10s %10s %8s %9s %9s %9s %11s\n",
+            "motion", "crt[ms]", "update[ms]", "speedup", "keep", "move", "crt", "max_diff/L" );
+
+    int nerr_all = 0;
+    for( m=0; m<FRAME_NUM_MOTION; m++ ) {
+        double t_crt = 0.0, t_upd = 0.0, dmax = 0.0;
+        double cnt[NPT_UPDATE_NUM] = { 0.0, 0.0, 0.0 };
+
+        // 初期フレーム
+        frame_pose( m, 0, tol*lmax, &base, &cur );
+        npt_param_crt_n( num, cur.tri, cur.norm, cp_upd );
+        memcpy( tri_ref,  cur.tri,  sizeof(NPT_REAL[3][3])*num );
+        memcpy( norm_ref, cur.norm, sizeof(NPT_REAL[3][3])*num );
+
+        for( f=1; f<=nf; f++ ) {
+            int    num_state[NPT_UPDATE_NUM];
+            double t0;
+
+            frame_pose( m, f, tol*lmax, &base, &cur );
+
+            t0 = bench_time();
+            npt_param_crt_n( num, cur.tri, cur.norm, cp_crt );
+            t_crt += bench_time() - t0;
+
+            t0 = bench_time();
+            nerr_all += npt_param_update_n( num, cur.tri, cur.norm, (NPT_REAL)tol,
+                                            tri_ref, norm_ref, cp_upd, num_state );
+            t_upd += bench_time() - t0;
+
+            for( i=0; i<NPT_UPDATE_NUM; i++ ) cnt[i] += num_state[i];
+            double d = frame_diff( num, cur.tri, cp_upd, cp_crt );
+            if( d > dmax ) dmax = d;
+        }
+
+        printf( "  %-7s %10.3f %10.3f %8.1f %9.0f %9.0f %9.0f %11.2e\n",
+                frame_motion_str[m], t_crt/nf*1.0e3, t_upd/nf*1.0e3, t_crt/t_upd,
+                cnt[NPT_UPDATE_KEEP]/nf, cnt[NPT_UPDATE_MOVE]/nf, cnt[NPT_UPDATE_CRT]/nf, dmax );
+    }
+    if( nerr_all != 0 ) {
+        printf( "  npt_param_update_n errors : %d\n", nerr_all );
+    }
+
+    free( tri_ref );
+    free( norm_ref );
+    free( cp_crt );
+    free( cp_upd );
+    bench_mesh_free( &cur );
+    bench_mesh_free( &base );
+
+    return 0;
+}
+
+
+// #################################################################
+//    非公開（プライベート）関数
+// #################################################################
+
+// フレーム f の頂点座標、法線ベクトル
+static void
+frame_pose(
+        int               motion,   // [in]  運動の種類
+        int               f,        // [in]  フレーム番号
+        double            drift,    // [in]  drift のフレームあたりの移動量
+        const BENCH_MESH* base,     // [in]  初期形状
+        BENCH_MESH*       cur       // [out] フレーム f の形状
+    )
+{
+    double rot[3][3], trans[3] = { 0.0, 0.0, 0.0 };
+    double cen[3] = { 0.0, 0.0, 0.0 };
+    int    i;
+
+    // 回転（軸 (1,2,3)、角度 0.01*f）、平行移動
+    double ax[3] = { 1.0/sqrt(14.0), 2.0/sqrt(14.0), 3.0/sqrt(14.0) };
+    double ang = ( motion == FRAME_RIGID || motion == FRAME_BUMP ) ? 0.01*f : 0.0;
+    double c = cos( ang ), s = sin( ang );
+    for( int j=0; j<3; j++ ) {
+        for( int k=0; k<3; k++ ) {
+            rot[j][k] = ax[j]*ax[k]*( 1.0 - c ) + ( j == k ? c : 0.0 );
+        }
+    }
+    rot[0][1] -= ax[2]*s;  rot[1][0] += ax[2]*s;
+    rot[1][2] -= ax[0]*s;  rot[2][1] += ax[0]*s;
+    rot[2][0] -= ax[1]*s;  rot[0][2] += ax[1]*s;
+    if( motion == FRAME_DRIFT ) {
+        trans[0] = 0.3*drift*f;
+    } else if( motion == FRAME_RIGID || motion == FRAME_BUMP ) {
+        trans[0] = trans[1] = trans[2] = 0.01*f/sqrt(3.0);
+    }
+
+    // 変形の中心（形状の表面付近を移動）
+    if( motion == FRAME_BUMP ) {
+        cen[0] = cos( 0.05*f );
+        cen[1] = sin( 0.05*f );
+    }
+
+#pragma omp parallel for schedule(static)
+    for( i=0; i<base->num; i++ ) {
+        for( int j=0; j<3; j++ ) {
+            double p[3], n[3], len;
+            for( int k=0; k<3; k++ ) {
+                p[k] = base->tri [i][j][k];
+                n[k] = base->norm[i][j][k];
+            }
+            if( motion == FRAME_BUMP ) {
+                // 法線方向の変位 h*g、法線は変位の勾配で傾ける
+                double d[3], r2 = 0.0;
+                for( int k=0; k<3; k++ ) { d[k] = p[k] - cen[k];  r2 += d[k]*d[k]; }
+                double g = FRAME_BUMP_H*exp( -r2/(FRAME_BUMP_R*FRAME_BUMP_R) );
+                for( int k=0; k<3; k++ ) {
+                    p[k] += g*n[k];
+                    n[k] += 2.0*g/(FRAME_BUMP_R*FRAME_BUMP_R)*d[k];
+                }
+                len = sqrt( n[0]*n[0] + n[1]*n[1] + n[2]*n[2] );
+                for( int k=0; k<3; k++ ) n[k] /= len;
+            }
+            for( int k=0; k<3; k++ ) {
+                cur->tri [i][j][k] = (NPT_REAL)( rot[k][0]*p[0] + rot[k][1]*p[1] + rot[k][2]*p[2] + trans[k] );
+                cur->norm[i][j][k] = (NPT_REAL)( rot[k][0]*n[0] + rot[k][1]*n[1] + rot[k][2]*n[2] );
+            }
+        }
+    }
+}
+
+
+// 制御点の差の最大値（三角形の最大辺長との比）
+static double
+frame_diff(
+        int       num,              // [in]  三角形数
+        NPT_REAL  (*tri)[3][3],     // [in]  三角形の頂点座標
+        NPT_REAL  (*a)[7][3],       // [in]  長田パッチパラメータ
+        NPT_REAL  (*b)[7][3]        // [in]  長田パッチパラメータ
+    )
+{
+    double dmax = 0.0;
+    int    i;
+
+    for( i=0; i<num; i++ ) {
+        double l2 = 0.0, d2 = 0.0;
+        for( int j=0; j<3; j++ ) {
+            double e = 0.0;
+            for( int k=0; k<3; k++ ) {
+                double t = (double)tri[i][(j+1)%3][k] - tri[i][j][k];
+                e += t*t;
+            }
+            if( e > l2 ) l2 = e;
+        }
+        for( int j=0; j<7; j++ ) {
+            double e = 0.0;
+            for( int k=0; k<3; k++ ) {
+                double t = (double)a[i][j][k] - b[i][j][k];
+                e += t*t;
+            }
+            if( e > d2 ) d2 = e;
+        }
+        if( l2 > 0.0 && sqrt( d2/l2 ) > dmax ) dmax = sqrt( d2/l2 );
+    }
+
+    return dmax;
+}
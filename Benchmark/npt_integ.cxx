@@ -0,0 +1,303 @@
+/*
+ * Npatch - Nagata Patch Library
+ *
+ * Copyright (c) 2015-2016 Advanced Institute for Computational Science, RIKEN.
+ * All rights reserved.
+ *
+ */
+
+////////////////////////////////////////////////////////////////////////////
+///
+/// 長田パッチ 曲面の積分（npt_integ_n, npt_integ_mesh）の計測
+///
+///   球、楕円体、トーラスのメッシュについて
+///       flat     : 平面三角形（制御点を辺の3等分点、重心とした平面パッチ）の積分（次数3、厳密）
+///       deg d    : 長田パッチの積分（求積公式の次数 d = 1-NPT_INTEG_MAX_DEGREE）
+///   の表面積、体積、重心、慣性テンソルの解析解との誤差と時間を出力する。
+///   （楕円体の表面積は解析解がないため出力しない）
+///   三角形が細かく隣接頂点の法線のなす角が小さい（NPT_ALW_V 未満）場合、パッチの辺は
+///   直線となり平面三角形と同じ結果となるため、既定の三角形数は少なめとする。
+///   さらに以下を確認する。
+///       スレッド数を変えた結果がビット単位で一致すること
+///       頂点共有のトーラスの npt_integ_mesh が npt_integ_n と（丸め誤差の範囲で）一致すること
+///
+///   使用法
+///       npt_integ [-n num] [-r repeat]
+///
+////////////////////////////////////////////////////////////////////////////
+
+#include "bench_mesh.h"
+#include "Npt_Integ.h"
+
+/// 解析解
+typedef struct {
+    double   area;           ///< 表面積（<0: 解析解なし）
+    double   volume;         ///< 体積
+    double   inertia[3];     ///< 慣性テンソルの対角成分（非対角成分は0、重心は原点）
+} INTEG_EXACT;
+
+//------------------------------------------------------------------
+//  プロトタイプ宣言
+//------------------------------------------------------------------
+static void   integ_exact( const char* type, INTEG_EXACT* ex );
+static void   integ_flat( int num, NPT_REAL (*tri)[3][3], NPT_REAL (*npatch)[7][3] );
+static void   integ_print( const char* label, const NPT_INTEG* r, const INTEG_EXACT* ex, double t );
+static double integ_time( int num, NPT_REAL (*tri)[3][3], NPT_REAL (*npatch)[7][3], int degree, int repeat,
+                          NPT_INTEG* res );
+static int    integ_threads( int num, NPT_REAL (*tri)[3][3], NPT_REAL (*npatch)[7][3] );
+static int    integ_mesh_check( int nv );
+
+
+// #################################################################
+//    メイン
+// #################################################################
+
+int
+main( int argc, char** argv )
+{
+    static const char* type[3] = { "sphere", "ellipsoid", "torus" };
+    int  num = 2000, repeat = 5;
+    int  i, d, ng = 0;
+
+    for( i=1; i<argc; i++ ) {
+        if( strcmp( argv[i], "-n" ) == 0 && i+1 < argc ) num    = atoi( argv[++i] );
+        if( strcmp( argv[i], "-r" ) == 0 && i+1 < argc ) repeat = atoi( argv[++i] );
+    }
+    if( repeat < 1 ) repeat = 1;
+
+    printf( "#### Npatch integ  real=%s  threads=%d  block=%d\n",
+            sizeof(NPT_REAL) == 8 ? "double" : "float",
+#ifdef _OPENMP
+            omp_get_max_threads(),
+#else
+            1,
+#endif
+            NPT_INTEG_BLOCK );
+
+    for( i=0; i<3; i++ ) {
+        BENCH_MESH  mesh;
+        INTEG_EXACT ex;
+        NPT_INTEG   res;
+
+        if( bench_mesh_crt( type[i], num, &mesh ) != 0 ) return 1;
+        NPT_REAL (*npatch)[7][3] = (NPT_REAL(*)[7][3])malloc( (size_t)mesh.num*sizeof(NPT_REAL[7][3]) );
+        NPT_REAL (*flat  )[7][3] = (NPT_REAL(*)[7][3])malloc( (size_t)mesh.num*sizeof(NPT_REAL[7][3]) );
+        if( npatch == NULL || flat == NULL ) {
+            printf( "#### ERROR npt_integ: memory\n" );
+            return 1;
+        }
+        npt_param_crt_n( mesh.num, mesh.tri, mesh.norm, npatch );
+        integ_flat( mesh.num, mesh.tri, flat );
+        integ_exact( type[i], &ex );
+
+        printf( "\n## %s  num_tri=%d\n", type[i], mesh.num );
+        printf( "  %-8s %12s %12s %12s %12s %12s\n",
+                "method", "area_err", "volume_err", "cen_err", "inertia_err", "time[ms]" );
+        double t = integ_time( mesh.num, mesh.tri, flat, 3, repeat, &res );
+        integ_print( "flat", &res, &ex, t );
+        for( d=1; d<=NPT_INTEG_MAX_DEGREE; d++ ) {
+            char label[16];
+            sprintf( label, "deg %d", d );
+            t = integ_time( mesh.num, mesh.tri, npatch, d, repeat, &res );
+            integ_print( label, &res, &ex, t );
+        }
+        ng += integ_threads( mesh.num, mesh.tri, npatch );
+
+        free( npatch );
+        free( flat );
+        bench_mesh_free( &mesh );
+    }
+
+    ng += integ_mesh_check( 64 );
+    return ng;
+}
+
+
+// #################################################################
+//    非公開（プライベート）関数
+// #################################################################
+
+/// 解析解（重心は原点）
+static void
+integ_exact( const char* type, INTEG_EXACT* ex )
+{
+    if( strcmp( type, "torus" ) == 0 ) {
+        double R = BENCH_TORUS_R, r = BENCH_TORUS_r;
+        ex->area       = 4.0*PAI*PAI*R*r;
+        ex->volume     = 2.0*PAI*PAI*R*r*r;
+        ex->inertia[0] = ex->volume*( 0.5*R*R + 0.625*r*r );
+        ex->inertia[1] = ex->inertia[0];
+        ex->inertia[2] = ex->volume*( R*R + 0.75*r*r );
+    }
+    else {
+        double a = 1.0, b = 1.0, c = 1.0;
+        if( strcmp( type, "ellipsoid" ) == 0 ) {
+            a = BENCH_ELLIPSOID_A; b = BENCH_ELLIPSOID_B; c = BENCH_ELLIPSOID_C;
+        }
+        ex->area       = ( a == b && b == c ) ? 4.0*PAI*a*a : -1.0;
+        ex->volume     = 4.0/3.0*PAI*a*b*c;
+        ex->inertia[0] = ex->volume*( b*b + c*c )/5.0;
+        ex->inertia[1] = ex->volume*( a*a + c*c )/5.0;
+        ex->inertia[2] = ex->volume*( a*a + b*b )/5.0;
+    }
+}
+
+
+/// 平面パッチ（制御点を辺の3等分点、三角形の重心とする）
+static void
+integ_flat( int num, NPT_REAL (*tri)[3][3], NPT_REAL (*npatch)[7][3] )
+{
+    int i, k;
+
+    for( i=0; i<num; i++ ) {
+        for( k=0; k<3; k++ ) {
+            NPT_REAL p1 = tri[i][0][k], p2 = tri[i][1][k], p3 = tri[i][2][k];
+            npatch[i][0][k] = ( 2.0*p1 + p2 )/3.0;
+            npatch[i][1][k] = ( p1 + 2.0*p2 )/3.0;
+            npatch[i][2][k] = ( 2.0*p2 + p3 )/3.0;
+            npatch[i][3][k] = ( p2 + 2.0*p3 )/3.0;
+            npatch[i][4][k] = ( p1 + 2.0*p3 )/3.0;
+            npatch[i][5][k] = ( 2.0*p1 + p3 )/3.0;
+            npatch[i][6][k] = ( p1 + p2 + p3 )/3.0;
+        }
+    }
+}
+
+
+/// 誤差の出力
+///    area_err, volume_err : 相対誤差
+///    cen_err              : 重心の距離
+///    inertia_err          : 成分の誤差の最大値 / 対角成分の最大値
+static void
+integ_print( const char* label, const NPT_INTEG* r, const INTEG_EXACT* ex, double t )
+{
+    char   area_err[32];
+    double cen_err = sqrt( r->cen[0]*r->cen[0] + r->cen[1]*r->cen[1] + r->cen[2]*r->cen[2] );
+    double imax = 0.0, ierr = 0.0;
+    int    j, k;
+
+    for( j=0; j<3; j++ ) {
+        if( ex->inertia[j] > imax ) imax = ex->inertia[j];
+        for( k=0; k<3; k++ ) {
+            double e = fabs( r->inertia[j][k] - ( j == k ? ex->inertia[j] : 0.0 ) );
+            if( e > ierr ) ierr = e;
+        }
+    }
+    if( ex->area > 0.0 ) {
+        sprintf( area_err, "%12.3e", fabs( r->area - ex->area )/ex->area );
+    } else {
+        sprintf( area_err, "%12s", "-" );
+    }
+    printf( "  %-8s %s %12.3e %12.3e %12.3e %12.4f\n", label, area_err,
+            fabs( r->volume - ex->volume )/ex->volume, cen_err, ierr/imax, 1.0e3*t );
+}
+
+
+/// 積分の時間（繰り返しの最小値）
+static double
+integ_time( int num, NPT_REAL (*tri)[3][3], NPT_REAL (*npatch)[7][3], int degree, int repeat, NPT_INTEG* res )
+{
+    double tmin = 1.0e30;
+    int    r;
+
+    for( r=0; r<repeat; r++ ) {
+        double t0 = bench_time();
+        npt_integ_n( num, tri, npatch, degree, res );
+        double t1 = bench_time();
+        if( t1 - t0 < tmin ) tmin = t1 - t0;
+    }
+    return tmin;
+}
+
+
+/// スレッド数を変えた結果の比較（ビット単位）
+static int
+integ_threads( int num, NPT_REAL (*tri)[3][3], NPT_REAL (*npatch)[7][3] )
+{
+    NPT_INTEG ref, res;
+    int       same = 1;
+
+    npt_integ_n( num, tri, npatch, NPT_INTEG_MAX_DEGREE, &ref );
+#ifdef _OPENMP
+    static const int nth[4] = { 1, 2, 3, 8 };
+    int max_th = omp_get_max_threads();
+    int i;
+    for( i=0; i<4; i++ ) {
+        omp_set_num_threads( nth[i] );
+        npt_integ_n( num, tri, npatch, NPT_INTEG_MAX_DEGREE, &res );
+        if( memcmp( &ref, &res, sizeof(NPT_INTEG) ) != 0 ) same = 0;
+    }
+    omp_set_num_threads( max_th );
+#else
+    npt_integ_n( num, tri, npatch, NPT_INTEG_MAX_DEGREE, &res );
+    if( memcmp( &ref, &res, sizeof(NPT_INTEG) ) != 0 ) same = 0;
+#endif
+    printf( "  threads 1,2,3,8 : %s\n", same ? "bitwise identical" : "NG: results differ" );
+    return same ? 0 : 1;
+}
+
+
+/// 頂点共有のトーラス（3nv x nv 格子）の npt_integ_mesh と npt_integ_n の比較
+static int
+integ_mesh_check( int nv )
+{
+    static const double prm[2] = { BENCH_TORUS_R, BENCH_TORUS_r };
+    int        nu = 3*nv;
+    int        i, j, k;
+    NPT_MESH   mesh;
+    BENCH_MESH soup;
+    NPT_INTEG  rm, rn;
+
+    mesh.num_vtx  = nu*nv;
+    mesh.num_tri  = 2*nu*nv;
+    mesh.vtx      = (NPT_REAL(*)[3])malloc( (size_t)mesh.num_vtx*sizeof(NPT_REAL[3]) );
+    mesh.vtx_norm = (NPT_REAL(*)[3])malloc( (size_t)mesh.num_vtx*sizeof(NPT_REAL[3]) );
+    mesh.tri      = (int(*)[3])malloc( (size_t)mesh.num_tri*sizeof(int[3]) );
+    if( mesh.vtx == NULL || mesh.vtx_norm == NULL || mesh.tri == NULL ) {
+        printf( "#### ERROR npt_integ: memory\n" );
+        return 1;
+    }
+    for( j=0; j<nv; j++ ) {
+        for( i=0; i<nu; i++ ) {
+            double pos[3], norm[3];
+            bench_surf_torus( (double)i/nu, (double)j/nv, prm, pos, norm );
+            for( k=0; k<3; k++ ) {
+                mesh.vtx     [j*nu + i][k] = pos[k];
+                mesh.vtx_norm[j*nu + i][k] = norm[k];
+            }
+        }
+    }
+    for( j=0; j<nv; j++ ) {
+        for( i=0; i<nu; i++ ) {
+            int v00 = j*nu + i,                 v10 = j*nu + (i+1)%nu;
+            int v11 = ((j+1)%nv)*nu + (i+1)%nu, v01 = ((j+1)%nv)*nu + i;
+            int it  = 2*(j*nu + i);
+            mesh.tri[it  ][0] = v00; mesh.tri[it  ][1] = v10; mesh.tri[it  ][2] = v11;
+            mesh.tri[it+1][0] = v00; mesh.tri[it+1][1] = v11; mesh.tri[it+1][2] = v01;
+        }
+    }
+
+    // 同じ格子の三角形単位の配列（bench_mesh_param と同じ頂点の並び）
+    if( bench_mesh_param( bench_surf_torus, prm, nu, nv, &soup ) != 0 ) return 1;
+    NPT_REAL (*npatch)[7][3] = (NPT_REAL(*)[7][3])malloc( (size_t)soup.num*sizeof(NPT_REAL[7][3]) );
+    if( npatch == NULL ) {
+        printf( "#### ERROR npt_integ: memory\n" );
+        return 1;
+    }
+    npt_param_crt_n( soup.num, soup.tri, soup.norm, npatch );
+
+    double t0 = bench_time();
+    npt_integ_mesh( &mesh, NPT_INTEG_MAX_DEGREE, &rm );
+    double t1 = bench_time();
+    npt_integ_n( soup.num, soup.tri, npatch, NPT_INTEG_MAX_DEGREE, &rn );
+
+    double dv = fabs( rm.volume - rn.volume )/rn.volume;
+    double da = fabs( rm.area   - rn.area   )/rn.area;
+    printf( "\n## npt_integ_mesh  indexed torus num_tri=%d  time=%.4f[ms]\n", mesh.num_tri, 1.0e3*( t1 - t0 ) );
+    printf( "  diff from npt_integ_n : area %.3e  volume %.3e\n", da, dv );
+
+    free( npatch );
+    bench_mesh_free( &soup );
+    free( mesh.vtx ); free( mesh.vtx_norm ); free( mesh.tri );
+    return ( dv < 1.0e-4 && da < 1.0e-4 ) ? 0 : 1;
+}
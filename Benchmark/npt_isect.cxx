@@ -0,0 +1,465 @@
+/*
+ * Npatch - Nagata Patch Library
+ *
+ * Copyright (c) 2015-2016 Advanced Institute for Computational Science, RIKEN.
+ * All rights reserved.
+ *
+ */
+
+////////////////////////////////////////////////////////////////////////////
+///
+/// 長田パッチ 曲面の交差検出（npt_isect_mesh, npt_isect_self）の計測
+///
+///   ２つの頂点共有メッシュについて以下を計測する。
+///       cross  : 管が互いに交差する２つのトーラス（平面三角形でも交差する）
+///       touch  : 中心間距離が直径よりわずかに小さい２つの粗い球
+///                （平面三角形は交差せず、曲面のみ交差する）
+///       plane  : 同一の平面（z=0 の n x n 格子）どうし（npt_isect_mesh のみ）
+///                （同一平面上の三角形どうしの判定では交差を検出しないため、同一の三角形の組は
+///                  詳細判定が打ち切られ、交差する組（limit）として出力されることを確認する）
+///   方法
+///       brute   : 全ての三角形の組の平面三角形どうしの判定（従来の２重ループ、-b 指定時）
+///       flat    : npt_isect_mesh( depth=0 )（包含箱の階層 + 平面三角形どうしの判定）
+///       patch   : npt_isect_mesh( depth )
+///       self    : ２つのメッシュを結合したメッシュの npt_isect_self( depth )
+///   交差するパッチの組の数、粗い判定の候補数、詳細判定を打ち切った組の数、時間を出力し、
+///   self の組が patch の組と一致すること、patch の近似の交点が２つの曲面の近く
+///   （両方の解析曲面からの距離が三角形の辺長の 1/4^depth 程度以下）であることを確認する。
+///
+///   使用法
+///       npt_isect [-n div] [-d depth] [-b]
+///
+////////////////////////////////////////////////////////////////////////////
+
+#include "bench_mesh.h"
+#include "Npt_Isect.h"
+
+/// 解析曲面の種類
+enum { ISECT_TORUS = 0, ISECT_SPHERE, ISECT_PLANE };
+
+/// メッシュと解析曲面
+typedef struct {
+    NPT_MESH  mesh;
+    int       type;          ///< 解析曲面の種類
+    double    rot;           ///< x軸周りの回転角
+    double    cen[3];        ///< 中心
+} ISECT_BODY;
+
+//------------------------------------------------------------------
+//  プロトタイプ宣言
+//------------------------------------------------------------------
+static int    isect_torus( int nv, double rot, const double cen[3], ISECT_BODY* body );
+static int    isect_sphere( int nlat, int nlon, const double cen[3], ISECT_BODY* body );
+static int    isect_plane( int nv, ISECT_BODY* body );
+static void   isect_free( ISECT_BODY* body );
+static double isect_dist( const ISECT_BODY* body, const NPT_REAL pos[3] );
+static int    isect_run( const char* name, ISECT_BODY* a, ISECT_BODY* b, int depth, int brute, double h );
+static long   isect_brute( NPT_MESH* a, NPT_MESH* b );
+static int    isect_segTri( NPT_REAL p[3], NPT_REAL q[3], NPT_REAL t[3][3] );
+
+
+// #################################################################
+//    メイン
+// #################################################################
+
+int
+main( int argc, char** argv )
+{
+    int  n = 16, depth = 4, brute = 0;
+    int  i, ret = 0;
+
+    for( i=1; i<argc; i++ ) {
+        if( strcmp( argv[i], "-n" ) == 0 && i+1 < argc ) n     = atoi( argv[++i] );
+        if( strcmp( argv[i], "-d" ) == 0 && i+1 < argc ) depth = atoi( argv[++i] );
+        if( strcmp( argv[i], "-b" ) == 0 ) brute = 1;
+    }
+
+    printf( "#### Npatch isect  real=%s  depth=%d  threads=%d\n",
+            sizeof(NPT_REAL) == 8 ? "double" : "float", depth,
+#ifdef _OPENMP
+            omp_get_max_threads()
+#else
+            1
+#endif
+        );
+    printf( "  %-7s %-7s %10s %10s %10s %8s %12s %12s\n",
+            "case", "method", "num_tri", "cand", "pairs", "limit", "time[s]", "max_dist/h" );
+
+    // cross : xy面のトーラスと、x軸周りに90度回転し x方向に R/2 ずらしたトーラス
+    //    （後者の中心円は z=0 面を x=-R/2, 3R/2 で通り、前者の管と２か所で交差する）
+    {
+        ISECT_BODY a, b;
+        double c0[3] = { 0.0, 0.0, 0.0 }, c1[3] = { 0.5*BENCH_TORUS_R, 0.0, 0.0 };
+        if( isect_torus( n, 0.0, c0, &a ) != 0 || isect_torus( n, 0.5*PAI, c1, &b ) != 0 ) return 1;
+        ret |= isect_run( "cross", &a, &b, depth, brute, 2.0*PAI*BENCH_TORUS_r/n );
+        isect_free( &a );
+        isect_free( &b );
+    }
+
+    // touch : 単位球（緯度方向 nlat、経度方向 2nlat 分割）２つ、x軸方向に並べる
+    //    x軸方向は四角形（２三角形）の中央であり、平面三角形の原点からの距離は約 1-sag。
+    //    中心間距離を 2-sag/2 とすると、解析曲面は交差し、平面三角形は交差しない。
+    {
+        ISECT_BODY a, b;
+        int    nlat = ( n/2 )*2 + 1;
+        double sag  = 1.0 - cos( 0.5*PAI/nlat )*cos( PAI/(2*nlat) );
+        double c0[3] = { 0.0, 0.0, 0.0 }, c1[3] = { 2.0 - 0.5*sag, 0.0, 0.0 };
+        if( isect_sphere( nlat, 2*nlat, c0, &a ) != 0 || isect_sphere( nlat, 2*nlat, c1, &b ) != 0 ) return 1;
+        ret |= isect_run( "touch", &a, &b, depth, brute, PAI/nlat );
+        isect_free( &a );
+        isect_free( &b );
+    }
+
+    // plane : 同一の平面どうし（全ての子パッチの組の包含箱が重なり、同一平面上の三角形どうしの
+    //    判定では交差を検出しないため、詳細判定は NPT_ISECT_MAX_WORK で打ち切られ、交差するとみなされる）
+    {
+        ISECT_BODY a;
+        NPT_ISECT  res;
+        if( isect_plane( n, &a ) != 0 ) return 1;
+        double t0 = bench_time();
+        if( npt_isect_mesh( &a.mesh, &a.mesh, depth, &res ) != 0 ) {
+            printf( "#### ERROR npt_isect_mesh\n" );
+            return 1;
+        }
+        double t1 = bench_time();
+        long long nflag = 0;
+        int       nsame = 0;
+        for( i=0; i<res.num_pair; i++ ) {
+            nflag += res.pair[i].limit;
+            if( res.pair[i].tri[0] == res.pair[i].tri[1] ) nsame++;
+        }
+        int ok = ( nsame == a.mesh.num_tri && nflag == res.num_limit );
+        if( !ok ) ret = 1;
+        printf( "  %-7s %-7s %10d %10lld %10d %8lld %12.6f %12s  %s\n", "plane", "patch",
+                2*a.mesh.num_tri, res.num_cand, res.num_pair, res.num_limit, t1 - t0, "-",
+                ok ? "(all identical pairs reported)" : "(NG: identical pairs not reported)" );
+        npt_isect_free( &res );
+        isect_free( &a );
+    }
+
+    return ret;
+}
+
+
+// #################################################################
+//    非公開（プライベート）関数
+// #################################################################
+
+/// 頂点共有のトーラス（3nv x nv 格子）
+///    x軸周りに rot 回転し cen に移動する
+static int
+isect_torus( int nv, double rot, const double cen[3], ISECT_BODY* body )
+{
+    int    nu = 3*nv;
+    int    i, j;
+    static const double prm[2] = { BENCH_TORUS_R, BENCH_TORUS_r };
+    NPT_MESH* m = &body->mesh;
+
+    body->type = ISECT_TORUS;
+    body->rot  = rot;
+    memcpy( body->cen, cen, sizeof(body->cen) );
+    m->num_vtx  = nu*nv;
+    m->num_tri  = 2*nu*nv;
+    m->vtx      = (NPT_REAL(*)[3])malloc( (size_t)m->num_vtx*sizeof(NPT_REAL[3]) );
+    m->vtx_norm = (NPT_REAL(*)[3])malloc( (size_t)m->num_vtx*sizeof(NPT_REAL[3]) );
+    m->tri      = (int(*)[3])malloc( (size_t)m->num_tri*sizeof(int[3]) );
+    if( m->vtx == NULL || m->vtx_norm == NULL || m->tri == NULL ) {
+        printf( "#### ERROR npt_isect: memory\n" );
+        return 1;
+    }
+    double c = cos( rot ), s = sin( rot );
+    for( j=0; j<nv; j++ ) {
+        for( i=0; i<nu; i++ ) {
+            double pos[3], norm[3];
+            int    iv = j*nu + i;
+            bench_surf_torus( (double)i/nu, (double)j/nv, prm, pos, norm );
+            m->vtx[iv][0]      = pos[0] + cen[0];
+            m->vtx[iv][1]      = c*pos[1] - s*pos[2] + cen[1];
+            m->vtx[iv][2]      = s*pos[1] + c*pos[2] + cen[2];
+            m->vtx_norm[iv][0] = norm[0];
+            m->vtx_norm[iv][1] = c*norm[1] - s*norm[2];
+            m->vtx_norm[iv][2] = s*norm[1] + c*norm[2];
+        }
+    }
+    for( j=0; j<nv; j++ ) {
+        for( i=0; i<nu; i++ ) {
+            int v00 = j*nu + i,                 v10 = j*nu + (i+1)%nu;
+            int v11 = ((j+1)%nv)*nu + (i+1)%nu, v01 = ((j+1)%nv)*nu + i;
+            int it  = 2*(j*nu + i);
+            m->tri[it  ][0] = v00; m->tri[it  ][1] = v10; m->tri[it  ][2] = v11;
+            m->tri[it+1][0] = v00; m->tri[it+1][1] = v11; m->tri[it+1][2] = v01;
+        }
+    }
+    return 0;
+}
+
+
+/// 頂点共有の単位球（緯度 nlat x 経度 nlon、極は１頂点、経度は半格子ずらす）
+static int
+isect_sphere( int nlat, int nlon, const double cen[3], ISECT_BODY* body )
+{
+    int       i, j, k, it = 0;
+    NPT_MESH* m = &body->mesh;
+
+    body->type = ISECT_SPHERE;
+    body->rot  = 0.0;
+    memcpy( body->cen, cen, sizeof(body->cen) );
+    m->num_vtx  = (nlat-1)*nlon + 2;
+    m->num_tri  = 2*(nlat-1)*nlon;
+    m->vtx      = (NPT_REAL(*)[3])malloc( (size_t)m->num_vtx*sizeof(NPT_REAL[3]) );
+    m->vtx_norm = (NPT_REAL(*)[3])malloc( (size_t)m->num_vtx*sizeof(NPT_REAL[3]) );
+    m->tri      = (int(*)[3])malloc( (size_t)m->num_tri*sizeof(int[3]) );
+    if( m->vtx == NULL || m->vtx_norm == NULL || m->tri == NULL ) {
+        printf( "#### ERROR npt_isect: memory\n" );
+        return 1;
+    }
+
+    // 頂点  0: 北極  1+(j-1)*nlon+i: 緯線 j  num_vtx-1: 南極
+    for( j=0; j<=nlat; j++ ) {
+        double th = PAI*j/nlat;
+        int    n  = ( j == 0 || j == nlat ) ? 1 : nlon;
+        for( i=0; i<n; i++ ) {
+            double ph = 2.0*PAI*( i + 0.5 )/nlon;
+            double d[3];
+            int    iv = ( j == 0 ) ? 0 : ( j == nlat ) ? m->num_vtx-1 : 1 + (j-1)*nlon + i;
+            d[0] = sin( th )*cos( ph );
+            d[1] = sin( th )*sin( ph );
+            d[2] = cos( th );
+            for( k=0; k<3; k++ ) {
+                m->vtx[iv][k]      = cen[k] + d[k];
+                m->vtx_norm[iv][k] = d[k];
+            }
+        }
+    }
+    for( i=0; i<nlon; i++ ) {
+        int i1 = ( i + 1 )%nlon;
+        m->tri[it][0] = 0; m->tri[it][1] = 1 + i; m->tri[it][2] = 1 + i1; it++;
+        for( j=1; j<nlat-1; j++ ) {
+            int v00 = 1 + (j-1)*nlon + i, v01 = 1 + (j-1)*nlon + i1;
+            int v10 = 1 +  j   *nlon + i, v11 = 1 +  j   *nlon + i1;
+            m->tri[it][0] = v00; m->tri[it][1] = v10; m->tri[it][2] = v11; it++;
+            m->tri[it][0] = v00; m->tri[it][1] = v11; m->tri[it][2] = v01; it++;
+        }
+        int vs = 1 + (nlat-2)*nlon;
+        m->tri[it][0] = vs + i; m->tri[it][1] = m->num_vtx-1; m->tri[it][2] = vs + i1; it++;
+    }
+    return 0;
+}
+
+
+/// 頂点共有の平面（z=0 の [0,1]^2、nv x nv 格子の四角形を２三角形に分割）
+static int
+isect_plane( int nv, ISECT_BODY* body )
+{
+    int    i, j;
+    NPT_MESH* m = &body->mesh;
+
+    body->type = ISECT_PLANE;
+    body->rot  = 0.0;
+    body->cen[0] = body->cen[1] = body->cen[2] = 0.0;
+    m->num_vtx  = (nv+1)*(nv+1);
+    m->num_tri  = 2*nv*nv;
+    m->vtx      = (NPT_REAL(*)[3])malloc( (size_t)m->num_vtx*sizeof(NPT_REAL[3]) );
+    m->vtx_norm = (NPT_REAL(*)[3])malloc( (size_t)m->num_vtx*sizeof(NPT_REAL[3]) );
+    m->tri      = (int(*)[3])malloc( (size_t)m->num_tri*sizeof(int[3]) );
+    if( m->vtx == NULL || m->vtx_norm == NULL || m->tri == NULL ) {
+        printf( "#### ERROR npt_isect: memory\n" );
+        return 1;
+    }
+    for( j=0; j<=nv; j++ ) {
+        for( i=0; i<=nv; i++ ) {
+            int iv = j*(nv+1) + i;
+            m->vtx[iv][0]      = (NPT_REAL)i/nv;
+            m->vtx[iv][1]      = (NPT_REAL)j/nv;
+            m->vtx[iv][2]      = 0.0;
+            m->vtx_norm[iv][0] = 0.0;
+            m->vtx_norm[iv][1] = 0.0;
+            m->vtx_norm[iv][2] = 1.0;
+        }
+    }
+    for( j=0; j<nv; j++ ) {
+        for( i=0; i<nv; i++ ) {
+            int v00 = j*(nv+1) + i,       v10 = v00 + 1;
+            int v01 = v00 + (nv+1),       v11 = v01 + 1;
+            int it  = 2*(j*nv + i);
+            m->tri[it  ][0] = v00; m->tri[it  ][1] = v10; m->tri[it  ][2] = v11;
+            m->tri[it+1][0] = v00; m->tri[it+1][1] = v11; m->tri[it+1][2] = v01;
+        }
+    }
+    return 0;
+}
+
+
+/// メッシュの解放
+static void
+isect_free( ISECT_BODY* body )
+{
+    free( body->mesh.vtx );
+    free( body->mesh.vtx_norm );
+    free( body->mesh.tri );
+}
+
+
+/// 解析曲面からの距離
+static double
+isect_dist( const ISECT_BODY* body, const NPT_REAL pos[3] )
+{
+    double p[3];
+    int    k;
+
+    for( k=0; k<3; k++ ) p[k] = pos[k] - body->cen[k];
+    if( body->type == ISECT_SPHERE ) {
+        return fabs( sqrt( p[0]*p[0] + p[1]*p[1] + p[2]*p[2] ) - 1.0 );
+    }
+    if( body->type == ISECT_PLANE ) {
+        return fabs( p[2] );
+    }
+    // x軸周りの逆回転
+    double c = cos( body->rot ), s = sin( body->rot );
+    double y =  c*p[1] + s*p[2];
+    double z = -s*p[1] + c*p[2];
+    double rxy = sqrt( p[0]*p[0] + y*y ) - BENCH_TORUS_R;
+    return fabs( sqrt( rxy*rxy + z*z ) - BENCH_TORUS_r );
+}
+
+
+/// １つの配置の計測
+static int
+isect_run( const char* name, ISECT_BODY* a, ISECT_BODY* b, int depth, int brute, double h )
+{
+    NPT_MESH* ma = &a->mesh;
+    NPT_MESH* mb = &b->mesh;
+    NPT_ISECT res_flat, res_patch, res_self;
+    int       i, k, ng = 0;
+
+    if( brute ) {
+        double t0 = bench_time();
+        long   np = isect_brute( ma, mb );
+        double t1 = bench_time();
+        printf( "  %-7s %-7s %10d %10lld %10ld %8s %12.6f %12s\n", name, "brute",
+                ma->num_tri + mb->num_tri, (long long)ma->num_tri*mb->num_tri, np, "-", t1 - t0, "-" );
+    }
+
+    double t0 = bench_time();
+    if( npt_isect_mesh( ma, mb, 0, &res_flat ) != 0 ) {
+        printf( "#### ERROR npt_isect_mesh\n" );
+        return 1;
+    }
+    double t1 = bench_time();
+    if( npt_isect_mesh( ma, mb, depth, &res_patch ) != 0 ) {
+        printf( "#### ERROR npt_isect_mesh\n" );
+        return 1;
+    }
+    double t2 = bench_time();
+
+    // 結合メッシュの自己交差
+    NPT_MESH mc;
+    mc.num_vtx  = ma->num_vtx + mb->num_vtx;
+    mc.num_tri  = ma->num_tri + mb->num_tri;
+    mc.vtx      = (NPT_REAL(*)[3])malloc( (size_t)mc.num_vtx*sizeof(NPT_REAL[3]) );
+    mc.vtx_norm = (NPT_REAL(*)[3])malloc( (size_t)mc.num_vtx*sizeof(NPT_REAL[3]) );
+    mc.tri      = (int(*)[3])malloc( (size_t)mc.num_tri*sizeof(int[3]) );
+    if( mc.vtx == NULL || mc.vtx_norm == NULL || mc.tri == NULL ) {
+        printf( "#### ERROR npt_isect: memory\n" );
+        return 1;
+    }
+    memcpy( mc.vtx,                 ma->vtx,      (size_t)ma->num_vtx*sizeof(NPT_REAL[3]) );
+    memcpy( mc.vtx + ma->num_vtx,   mb->vtx,      (size_t)mb->num_vtx*sizeof(NPT_REAL[3]) );
+    memcpy( mc.vtx_norm,               ma->vtx_norm, (size_t)ma->num_vtx*sizeof(NPT_REAL[3]) );
+    memcpy( mc.vtx_norm + ma->num_vtx, mb->vtx_norm, (size_t)mb->num_vtx*sizeof(NPT_REAL[3]) );
+    for( i=0; i<ma->num_tri; i++ ) {
+        for( k=0; k<3; k++ ) mc.tri[i][k] = ma->tri[i][k];
+    }
+    for( i=0; i<mb->num_tri; i++ ) {
+        for( k=0; k<3; k++ ) mc.tri[ma->num_tri + i][k] = mb->tri[i][k] + ma->num_vtx;
+    }
+    double t3 = bench_time();
+    if( npt_isect_self( &mc, depth, &res_self ) != 0 ) {
+        printf( "#### ERROR npt_isect_self\n" );
+        return 1;
+    }
+    double t4 = bench_time();
+
+    // 近似の交点の解析曲面からの距離
+    double dmax = 0.0;
+    for( i=0; i<res_patch.num_pair; i++ ) {
+        double da = isect_dist( a, res_patch.pair[i].pos );
+        double db = isect_dist( b, res_patch.pair[i].pos );
+        if( da > dmax ) dmax = da;
+        if( db > dmax ) dmax = db;
+    }
+    // self の組と patch の組の一致
+    int same = ( res_self.num_pair == res_patch.num_pair );
+    for( i=0; same && i<res_self.num_pair; i++ ) {
+        if( res_self.pair[i].tri[0] != res_patch.pair[i].tri[0] ||
+            res_self.pair[i].tri[1] != res_patch.pair[i].tri[1] + ma->num_tri ) same = 0;
+    }
+    if( !same ) ng++;
+
+    printf( "  %-7s %-7s %10d %10lld %10d %8lld %12.6f %12s\n", name, "flat",
+            mc.num_tri, res_flat.num_cand, res_flat.num_pair, res_flat.num_limit, t1 - t0, "-" );
+    printf( "  %-7s %-7s %10d %10lld %10d %8lld %12.6f %12.2e\n", name, "patch",
+            mc.num_tri, res_patch.num_cand, res_patch.num_pair, res_patch.num_limit, t2 - t1, dmax/h );
+    printf( "  %-7s %-7s %10d %10lld %10d %8lld %12.6f %12s  %s\n", name, "self",
+            mc.num_tri, res_self.num_cand, res_self.num_pair, res_self.num_limit, t4 - t3, "-",
+            same ? "(same pairs as patch)" : "(NG: differs from patch)" );
+
+    npt_isect_free( &res_flat );
+    npt_isect_free( &res_patch );
+    npt_isect_free( &res_self );
+    free( mc.vtx ); free( mc.vtx_norm ); free( mc.tri );
+    return ng;
+}
+
+
+/// 全ての三角形の組の判定（平面三角形、交差する組の数）
+static long
+isect_brute( NPT_MESH* a, NPT_MESH* b )
+{
+    long num = 0;
+    int  i;
+
+#pragma omp parallel for schedule(dynamic,16) reduction(+:num)
+    for( i=0; i<a->num_tri; i++ ) {
+        NPT_REAL ta[3][3], tb[3][3];
+        int      j, k, m;
+        for( k=0; k<3; k++ ) {
+            for( m=0; m<3; m++ ) ta[k][m] = a->vtx[ a->tri[i][k] ][m];
+        }
+        for( j=0; j<b->num_tri; j++ ) {
+            for( k=0; k<3; k++ ) {
+                for( m=0; m<3; m++ ) tb[k][m] = b->vtx[ b->tri[j][k] ][m];
+            }
+            int hit = 0;
+            for( k=0; k<3 && !hit; k++ ) {
+                hit = isect_segTri( ta[k], ta[(k+1)%3], tb ) || isect_segTri( tb[k], tb[(k+1)%3], ta );
+            }
+            if( hit ) num++;
+        }
+    }
+    return num;
+}
+
+
+/// 線分と三角形の交差判定（Moller-Trumbore）
+static int
+isect_segTri( NPT_REAL p[3], NPT_REAL q[3], NPT_REAL t[3][3] )
+{
+    NPT_REAL e1[3], e2[3], d[3], s[3], h[3], g[3];
+    NPT_REAL det, u, v, r;
+
+    CalcVec( t[0], t[1], e1 );
+    CalcVec( t[0], t[2], e2 );
+    CalcVec( p, q, d );
+    CalcOutProduct( d, e2, h );
+    det = CalcInProduct( e1, h );
+    if( det == 0.0 ) return 0;
+    CalcVec( t[0], p, s );
+    u = CalcInProduct( s, h )/det;
+    if( u < 0.0 || u > 1.0 ) return 0;
+    CalcOutProduct( s, e1, g );
+    v = CalcInProduct( d, g )/det;
+    if( v < 0.0 || u + v > 1.0 ) return 0;
+    r = CalcInProduct( e2, g )/det;
+    return ( r >= 0.0 && r <= 1.0 ) ? 1 : 0;
+}
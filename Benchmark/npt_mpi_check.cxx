@@ -0,0 +1,306 @@
+/*
+ * Npatch - Nagata Patch Library
+ *
+ * Copyright (c) 2015-2016 Advanced Institute for Computational Science, RIKEN.
+ * All rights reserved.
+ *
+ */
+
+////////////////////////////////////////////////////////////////////////////
+///
+/// 長田パッチ MPI領域分割メッシュ処理の確認と計測
+///
+///   トーラス（nu x nv 格子、頂点共有）を u 方向にランク数で分割し、
+///   npt_mpi_halo_crt, npt_mpi_vtx_norm, npt_mpi_param_crt を実行して
+///   以下を確認する。
+///     - 頂点法線が全体を逐次計算した値と一致すること（丸め誤差の範囲）
+///     - 他ランクと共有しない頂点の頂点法線が自ランクのメッシュの npt_vnorm_crt と
+///       ビット単位で一致すること（三角形の法線は同じ npt_mesh_tri_norm で求める）
+///     - 辺を共有する２つのパッチの辺の制御点がビット単位で一致すること
+///       （参考として三角形単位の npt_param_crt での不一致数も出力する）
+///   各処理の時間（全ランクの最大値）も出力する。
+///
+///   使用法
+///       mpirun -np 4 npt_mpi_check [-n nv]
+///
+////////////////////////////////////////////////////////////////////////////
+
+#include "bench_mesh.h"
+#include "Npt_Mpi.h"
+#include <vector>
+#include <algorithm>
+
+/// 辺の制御点（gid の小さい頂点側、大きい頂点側）
+struct check_edge {
+    long long  g0, g1;
+    NPT_REAL   cp[2][3];
+    bool operator<( const check_edge& o ) const {
+        return ( g0 < o.g0 ) || ( g0 == o.g0 && g1 < o.g1 );
+    }
+};
+
+//------------------------------------------------------------------
+//  プロトタイプ宣言
+//------------------------------------------------------------------
+static void check_edges( NPT_MESH* mesh, const long long* gid, NPT_REAL npatch[][7][3], std::vector<check_edge>& edge );
+static void check_compare( MPI_Comm comm, std::vector<check_edge>& edge, long long* num_pair, long long* num_diff );
+
+
+// #################################################################
+//    メイン
+// #################################################################
+
+int
+main( int argc, char** argv )
+{
+    int        nproc, rank;
+    int        nv = 64, nu;
+    int        i, j, k;
+    double     t[3], t_max[3];
+
+    MPI_Init( &argc, &argv );
+    MPI_Comm_size( MPI_COMM_WORLD, &nproc );
+    MPI_Comm_rank( MPI_COMM_WORLD, &rank );
+
+    for( i=1; i<argc; i++ ) {
+        if( strcmp( argv[i], "-n" ) == 0 && i+1 < argc ) nv = atoi( argv[++i] );
+    }
+    nu = 3*nv;
+    if( nu < nproc ) nu = nproc;
+
+    //-------------------
+    //  全体メッシュ（トーラス）  頂点 gid = j*nu + i
+    //-------------------
+    int num_gvtx = nu*nv;
+    int num_gtri = 2*nu*nv;
+    std::vector<NPT_REAL> gvtx( 3*num_gvtx ), gnorm( 3*num_gvtx, 0.0 );
+    std::vector<int>      gtri( 3*num_gtri );
+    static const double   prm[2] = { BENCH_TORUS_R, BENCH_TORUS_r };
+
+    for( j=0; j<nv; j++ ) {
+        for( i=0; i<nu; i++ ) {
+            double pos[3], norm[3];
+            bench_surf_torus( (double)i/nu, (double)j/nv, prm, pos, norm );
+            for( k=0; k<3; k++ ) gvtx[3*(j*nu+i)+k] = pos[k];
+        }
+    }
+    for( j=0; j<nv; j++ ) {
+        for( i=0; i<nu; i++ ) {
+            int v00 = j*nu + i,           v10 = j*nu + (i+1)%nu;
+            int v11 = ((j+1)%nv)*nu + (i+1)%nu, v01 = ((j+1)%nv)*nu + i;
+            int it  = 2*(j*nu + i);
+            gtri[3*it  ] = v00; gtri[3*it+1] = v10; gtri[3*it+2] = v11;
+            gtri[3*it+3] = v00; gtri[3*it+4] = v11; gtri[3*it+5] = v01;
+        }
+    }
+
+    //-------------------
+    //  自ランクのメッシュ  列 i の三角形はランク i*nproc/nu
+    //-------------------
+    std::vector<int>       g2l( num_gvtx, -1 );
+    std::vector<long long> gid;
+    std::vector<int>       ltri;
+    for( j=0; j<nv; j++ ) {
+        for( i=0; i<nu; i++ ) {
+            if( (long long)i*nproc/nu != rank ) continue;
+            for( k=0; k<6; k++ ) {
+                int gv = gtri[6*(j*nu + i) + k];
+                if( g2l[gv] < 0 ) {
+                    g2l[gv] = (int)gid.size();
+                    gid.push_back( gv );
+                }
+                ltri.push_back( g2l[gv] );
+            }
+        }
+    }
+    NPT_MESH mesh;
+    std::vector<NPT_REAL> lvtx( 3*gid.size() ), lnorm( 3*gid.size() );
+    for( i=0; i<(int)gid.size(); i++ ) {
+        for( k=0; k<3; k++ ) lvtx[3*i+k] = gvtx[3*gid[i]+k];
+    }
+    mesh.num_vtx  = (int)gid.size();
+    mesh.num_tri  = (int)ltri.size()/3;
+    mesh.vtx      = (NPT_REAL(*)[3])&lvtx[0];
+    mesh.vtx_norm = (NPT_REAL(*)[3])&lnorm[0];
+    mesh.tri      = (int(*)[3])&ltri[0];
+
+    //-------------------
+    //  共有頂点、頂点法線、長田パッチ
+    //-------------------
+    NPT_MPI_HALO halo;
+    std::vector<NPT_REAL> npatch( 21*mesh.num_tri );
+
+    // t[0]:halo_crt  t[1]:vtx_norm  t[2]:param_crt
+    MPI_Barrier( MPI_COMM_WORLD );
+    t[0] = MPI_Wtime();
+    if( npt_mpi_halo_crt( MPI_COMM_WORLD, &mesh, &gid[0], &halo ) != 0 ) MPI_Abort( MPI_COMM_WORLD, 1 );
+    t[0] = MPI_Wtime() - t[0];
+    t[1] = MPI_Wtime();
+    if( npt_mpi_vtx_norm( &halo, &mesh ) != 0 ) MPI_Abort( MPI_COMM_WORLD, 1 );
+    t[1] = MPI_Wtime() - t[1];
+    t[2] = MPI_Wtime();
+    npt_mpi_param_crt( &mesh, &gid[0], (NPT_REAL(*)[7][3])&npatch[0] );
+    t[2] = MPI_Wtime() - t[2];
+    MPI_Reduce( t, t_max, 3, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD );
+
+    //-------------------
+    //  頂点法線の確認（全体の逐次計算との比較）
+    //-------------------
+    for( i=0; i<num_gtri; i++ ) {
+        NPT_REAL n[3];
+        npt_mesh_tri_norm( &gvtx[3*gtri[3*i]], &gvtx[3*gtri[3*i+1]], &gvtx[3*gtri[3*i+2]], n );
+        for( j=0; j<3; j++ ) {
+            for( k=0; k<3; k++ ) gnorm[3*gtri[3*i+j]+k] += n[k];
+        }
+    }
+    double dn_max = 0.0, dn_gmax;
+    for( i=0; i<mesh.num_vtx; i++ ) {
+        NPT_REAL* gn = &gnorm[3*gid[i]];
+        CalcNormalize( gn );
+        for( k=0; k<3; k++ ) {
+            double d = fabs( (double)gn[k] - (double)mesh.vtx_norm[i][k] );
+            if( d > dn_max ) dn_max = d;
+        }
+    }
+    MPI_Reduce( &dn_max, &dn_gmax, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD );
+
+    // 共有しない頂点と自ランクのメッシュの npt_vnorm_crt の比較（ビット単位）
+    long long num_own = 0, num_own_diff = 0, num_own_sum, num_own_diff_sum;
+    {
+        NPT_MESH              mesh_s = mesh;
+        NPT_VNORM             vnorm;
+        std::vector<NPT_REAL> snorm( 3*gid.size() );
+        std::vector<char>     shared( gid.size(), 0 );
+        mesh_s.vtx_norm = (NPT_REAL(*)[3])&snorm[0];
+        if( npt_vnorm_crt( &mesh_s, &vnorm ) != 0 ) MPI_Abort( MPI_COMM_WORLD, 1 );
+        npt_vnorm_free( &vnorm );
+        if( halo.num_nbr > 0 ) {
+            for( i=0; i<halo.nbr_ptr[halo.num_nbr]; i++ ) shared[ halo.nbr_vtx[i] ] = 1;
+        }
+        for( i=0; i<mesh.num_vtx; i++ ) {
+            if( shared[i] ) continue;
+            num_own++;
+            if( memcmp( mesh.vtx_norm[i], mesh_s.vtx_norm[i], sizeof(NPT_REAL[3]) ) != 0 ) num_own_diff++;
+        }
+    }
+    MPI_Reduce( &num_own,      &num_own_sum,      1, MPI_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD );
+    MPI_Reduce( &num_own_diff, &num_own_diff_sum, 1, MPI_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD );
+
+    //-------------------
+    //  辺の制御点の一致確認
+    //-------------------
+    std::vector<check_edge> edge;
+    long long num_pair, num_diff, num_pair_ref, num_diff_ref;
+
+    check_edges( &mesh, &gid[0], (NPT_REAL(*)[7][3])&npatch[0], edge );
+    check_compare( MPI_COMM_WORLD, edge, &num_pair, &num_diff );
+
+    // 参考：三角形単位の npt_param_crt
+    for( i=0; i<mesh.num_tri; i++ ) {
+        NPT_REAL* cp = &npatch[21*i];
+        npt_param_crt( mesh.vtx[ltri[3*i]],   mesh.vtx_norm[ltri[3*i]],
+                       mesh.vtx[ltri[3*i+1]], mesh.vtx_norm[ltri[3*i+1]],
+                       mesh.vtx[ltri[3*i+2]], mesh.vtx_norm[ltri[3*i+2]],
+                       cp, cp+3, cp+6, cp+9, cp+12, cp+15, cp+18 );
+    }
+    check_edges( &mesh, &gid[0], (NPT_REAL(*)[7][3])&npatch[0], edge );
+    check_compare( MPI_COMM_WORLD, edge, &num_pair_ref, &num_diff_ref );
+
+    int num_shared = halo.num_shared, num_shared_sum;
+    MPI_Reduce( &num_shared, &num_shared_sum, 1, MPI_INT, MPI_SUM, 0, MPI_COMM_WORLD );
+
+    //-------------------
+    //  自ランク内の gid の重複（ランク0のみ、全ランクで異常となること）
+    //-------------------
+    NPT_MPI_HALO halo_dup;
+    std::vector<long long> gid_dup( gid );
+    if( rank == 0 && gid_dup.size() > 1 ) gid_dup[1] = gid_dup[0];
+    int dup_ng = ( npt_mpi_halo_crt( MPI_COMM_WORLD, &mesh, &gid_dup[0], &halo_dup ) == 0 ) ? 1 : 0, dup_ng_sum;
+    MPI_Reduce( &dup_ng, &dup_ng_sum, 1, MPI_INT, MPI_SUM, 0, MPI_COMM_WORLD );
+
+    if( rank == 0 ) {
+        printf( "#### Npatch MPI check  ranks=%d  real=%s  num_tri=%d  num_vtx=%d\n",
+                nproc, sizeof(NPT_REAL) == 8 ? "double" : "float", num_gtri, num_gvtx );
+        printf( "  shared vertices (sum over ranks)   : %d\n", num_shared_sum );
+        printf( "  vertex normal max diff vs serial   : %.3e\n", dn_gmax );
+        printf( "  vertex normal vs npt_vnorm_crt     : %lld own vertices, %lld mismatch\n",
+                num_own_sum, num_own_diff_sum );
+        printf( "  shared edges  npt_mpi_param_crt    : %lld pairs, %lld mismatch\n", num_pair, num_diff );
+        printf( "  shared edges  npt_param_crt (ref)  : %lld pairs, %lld mismatch\n", num_pair_ref, num_diff_ref );
+        printf( "  time (max over ranks)  halo_crt=%.6f  vtx_norm=%.6f  param_crt=%.6f sec\n",
+                t_max[0], t_max[1], t_max[2] );
+        printf( "  duplicate gid on rank 0            : %s\n",
+                dup_ng_sum == 0 ? "rejected on all ranks" : "NG (accepted)" );
+        printf( "%s\n", ( num_diff == 0 && num_own_diff_sum == 0 && dup_ng_sum == 0 ) ? "#### OK" : "#### NG" );
+    }
+
+    npt_mpi_halo_free( &halo );
+    MPI_Finalize();
+    return 0;
+}
+
+
+// #################################################################
+//    非公開（プライベート）関数
+// #################################################################
+
+/// 全パッチの辺の制御点を gid の向きに揃えて取り出す
+static void
+check_edges( NPT_MESH* mesh, const long long* gid, NPT_REAL npatch[][7][3], std::vector<check_edge>& edge )
+{
+    int i, j, k;
+
+    edge.clear();
+    for( i=0; i<mesh->num_tri; i++ ) {
+        for( j=0; j<3; j++ ) {
+            check_edge e;
+            long long  g0 = gid[ mesh->tri[i][j] ];
+            long long  g1 = gid[ mesh->tri[i][(j+1)%3] ];
+            int        flip = ( g0 > g1 ) ? 1 : 0;
+            e.g0 = flip ? g1 : g0;
+            e.g1 = flip ? g0 : g1;
+            for( k=0; k<3; k++ ) {
+                e.cp[flip  ][k] = npatch[i][2*j  ][k];
+                e.cp[1-flip][k] = npatch[i][2*j+1][k];
+            }
+            edge.push_back( e );
+        }
+    }
+}
+
+
+/// 辺の制御点をランク0に集めて比較する（確認用のため集約する）
+static void
+check_compare( MPI_Comm comm, std::vector<check_edge>& edge, long long* num_pair, long long* num_diff )
+{
+    int nproc, rank, k;
+    int n = (int)( edge.size()*sizeof(check_edge) );
+    std::vector<int> cnt, dsp;
+    std::vector<check_edge> all;
+
+    MPI_Comm_size( comm, &nproc );
+    MPI_Comm_rank( comm, &rank );
+    cnt.resize( nproc );
+    dsp.resize( nproc );
+    MPI_Gather( &n, 1, MPI_INT, &cnt[0], 1, MPI_INT, 0, comm );
+    if( rank == 0 ) {
+        int total = 0;
+        for( k=0; k<nproc; k++ ) {
+            dsp[k] = total;
+            total += cnt[k];
+        }
+        all.resize( total/sizeof(check_edge) );
+    }
+    MPI_Gatherv( &edge[0], n, MPI_BYTE, rank == 0 && !all.empty() ? (void*)&all[0] : NULL,
+                 &cnt[0], &dsp[0], MPI_BYTE, 0, comm );
+
+    *num_pair = *num_diff = 0;
+    if( rank != 0 ) return;
+
+    std::sort( all.begin(), all.end() );
+    for( size_t i=1; i<all.size(); i++ ) {
+        if( all[i].g0 != all[i-1].g0 || all[i].g1 != all[i-1].g1 ) continue;
+        (*num_pair)++;
+        if( memcmp( all[i].cp, all[i-1].cp, sizeof(all[i].cp) ) != 0 ) (*num_diff)++;
+    }
+}
@@ -0,0 +1,388 @@
+/*
+ * Npatch - Nagata Patch Library
+ *
+ * Copyright (c) 2015-2016 Advanced Institute for Computational Science, RIKEN.
+ * All rights reserved.
+ *
+ */
+
+////////////////////////////////////////////////////////////////////////////
+///
+/// 幾何演算系 パケット版（CalcGeo_Packet.h）の計測
+///
+///   乱数のベクトル（同一点、並行な線分、平行な平面の縮退を含む）について、
+///   CalcGeo.h の１ベクトル版とパケット版の
+///       結果（ベクトル、値、成否のマスク）のビット単位の一致
+///       時間（ベクトルあたり ns）、速度比
+///   を関数ごとに出力する。１ベクトル版で失敗した場合の出力はパケット版に合わせて 0 とする。
+///
+///   使用法
+///       npt_packet [-n num] [-r repeat]
+///
+////////////////////////////////////////////////////////////////////////////
+
+#include "bench_mesh.h"
+#include "CalcGeo_Packet.h"
+
+// 関数
+enum {
+    PK_IN_PRODUCT = 0,
+    PK_OUT_PRODUCT,
+    PK_NORMALIZE2,
+    PK_LINE_VEC,
+    PK_INTERSECTION_LINE,
+    PK_NEAR_POS_ON_LINE,
+    PK_CROSS_POINT_LINE,
+    PK_VEC_MIRROR,
+    PK_NUM_FUNC
+};
+
+static const char* pk_name[PK_NUM_FUNC] = {
+    "CalcInProduct", "CalcOutProduct", "CalcNormalize2", "CalcLineVec",
+    "CalcIntersectionLine", "CalcNearPosOnLine", "CalcCrossPointLine", "CalcVecMirror"
+};
+
+// 入力と出力（１ベクトル版は AoS、パケット版は SoA）
+typedef struct {
+    int             num;         // ベクトル数（GEO_PACK_W の倍数）
+    GEO_REAL      (*in[4])[3];   // 入力ベクトル
+    GEO_REAL*       ins[2];      // 入力スカラー
+    GEO_PACK_VEC*   pin[4];      // 入力パケット
+    GEO_REAL      (*o1)[3];      // 出力ベクトル１
+    GEO_REAL      (*o2)[3];      // 出力ベクトル２
+    GEO_REAL*       os;          // 出力スカラー
+    int*            ok;          // 成否
+    GEO_PACK_VEC*   p1;          // 出力パケット１
+    GEO_PACK_VEC*   p2;          // 出力パケット２
+    GEO_REAL*       ps;          // 出力スカラー（パケット版）
+    GEO_PACK_MASK*  pm;          // 成否のマスク
+} PK_DATA;
+
+//------------------------------------------------------------------
+//  プロトタイプ宣言
+//------------------------------------------------------------------
+static int    pk_alloc( int num, PK_DATA* d );
+static void   pk_free( PK_DATA* d );
+static void   pk_init( PK_DATA* d );
+static void   pk_scalar( int f, PK_DATA* d );
+static void   pk_packet( int f, PK_DATA* d );
+static int    pk_compare( int f, PK_DATA* d );
+
+
+// #################################################################
+//    メイン
+// #################################################################
+
+int
+main( int argc, char** argv )
+{
+    PK_DATA d;
+    int     num = 1 << 16, rep = 20;
+    int     f, i, ng = 0;
+
+    for( i=1; i<argc; i++ ) {
+        if( strcmp( argv[i], "-n" ) == 0 && i+1 < argc ) num = atoi( argv[++i] );
+        if( strcmp( argv[i], "-r" ) == 0 && i+1 < argc ) rep = atoi( argv[++i] );
+    }
+    num = ( num + GEO_PACK_W - 1 )/GEO_PACK_W*GEO_PACK_W;
+    if( num < GEO_PACK_W ) num = GEO_PACK_W;
+    if( rep < 1 ) rep = 1;
+
+    if( pk_alloc( num, &d ) != 0 ) {
+        printf( "#### ERROR npt_packet: memory\n" );
+        return 1;
+    }
+    pk_init( &d );
+
+    printf( "#### Npatch CalcGeo packet  real=%s  lanes=%d  num=%d  repeat=%d\n",
+            sizeof(GEO_REAL) == 8 ? "double" : "float", GEO_PACK_W, num, rep );
+    printf( "  %-22s %12s %12s %8s %8s  %s\n", "function", "scalar ns", "packet ns", "speedup", "fail", "result" );
+
+    for( f=0; f<PK_NUM_FUNC; f++ ) {
+        double ts = 1.0e30, tp = 1.0e30, t0;
+        int    r, nf = 0, bad;
+
+        for( r=0; r<rep; r++ ) {
+            t0 = bench_time();
+            pk_scalar( f, &d );
+            t0 = bench_time() - t0;
+            if( t0 < ts ) ts = t0;
+
+            t0 = bench_time();
+            pk_packet( f, &d );
+            t0 = bench_time() - t0;
+            if( t0 < tp ) tp = t0;
+        }
+        for( i=0; i<num; i++ ) nf += ( d.ok[i] == 0 );
+        bad = pk_compare( f, &d );
+        printf( "  %-22s %12.3f %12.3f %8.2f %8d  %s\n", pk_name[f], 1.0e9*ts/num, 1.0e9*tp/num,
+                ts/tp, nf, bad == 0 ? "same" : "DIFFERENT" );
+        if( bad != 0 ) {
+            printf( "#### ERROR npt_packet: %s differs in %d lanes\n", pk_name[f], bad );
+            ng++;
+        }
+    }
+
+    pk_free( &d );
+    return ng;
+}
+
+
+// #################################################################
+//    非公開（プライベート）関数
+// #################################################################
+
+/// 領域確保
+static int
+pk_alloc( int num, PK_DATA* d )
+{
+    int np = num/GEO_PACK_W;
+    int k;
+
+    memset( d, 0, sizeof(PK_DATA) );
+    d->num = num;
+    for( k=0; k<4; k++ ) {
+        d->in [k] = (GEO_REAL(*)[3])malloc( sizeof(GEO_REAL)*3*num );
+        d->pin[k] = (GEO_PACK_VEC*)malloc( sizeof(GEO_PACK_VEC)*np );
+        if( d->in[k] == NULL || d->pin[k] == NULL ) return 1;
+    }
+    for( k=0; k<2; k++ ) {
+        d->ins[k] = (GEO_REAL*)malloc( sizeof(GEO_REAL)*num );
+        if( d->ins[k] == NULL ) return 1;
+    }
+    d->o1 = (GEO_REAL(*)[3])malloc( sizeof(GEO_REAL)*3*num );
+    d->o2 = (GEO_REAL(*)[3])malloc( sizeof(GEO_REAL)*3*num );
+    d->os = (GEO_REAL*)malloc( sizeof(GEO_REAL)*num );
+    d->ok = (int*)malloc( sizeof(int)*num );
+    d->p1 = (GEO_PACK_VEC*)malloc( sizeof(GEO_PACK_VEC)*np );
+    d->p2 = (GEO_PACK_VEC*)malloc( sizeof(GEO_PACK_VEC)*np );
+    d->ps = (GEO_REAL*)malloc( sizeof(GEO_REAL)*num );
+    d->pm = (GEO_PACK_MASK*)malloc( sizeof(GEO_PACK_MASK)*np );
+    if( d->o1 == NULL || d->o2 == NULL || d->os == NULL || d->ok == NULL ||
+        d->p1 == NULL || d->p2 == NULL || d->ps == NULL || d->pm == NULL ) return 1;
+    return 0;
+}
+
+
+/// 領域解放
+static void
+pk_free( PK_DATA* d )
+{
+    int k;
+
+    for( k=0; k<4; k++ ) {
+        if( d->in [k] ) free( d->in [k] );
+        if( d->pin[k] ) free( d->pin[k] );
+    }
+    for( k=0; k<2; k++ ) {
+        if( d->ins[k] ) free( d->ins[k] );
+    }
+    if( d->o1 ) free( d->o1 );
+    if( d->o2 ) free( d->o2 );
+    if( d->os ) free( d->os );
+    if( d->ok ) free( d->ok );
+    if( d->p1 ) free( d->p1 );
+    if( d->p2 ) free( d->p2 );
+    if( d->ps ) free( d->ps );
+    if( d->pm ) free( d->pm );
+}
+
+
+/// 入力の作成
+///   in[0],in[1] : 線分１の始点、終点（平面１の法線）  in[2],in[3] : 線分２の始点、終点（平面２の法線）
+///   7 個おきに同一点、11 個おきに並行な線分（平行な平面）、13 個おきにほぼ同一点とする
+static void
+pk_init( PK_DATA* d )
+{
+    uint64_t seed = 0x243F6A8885A308D3ULL;
+    int      i, k, m;
+
+    for( i=0; i<d->num; i++ ) {
+        for( k=0; k<4; k++ ) {
+            for( m=0; m<3; m++ ) d->in[k][i][m] = (GEO_REAL)( 2.0*bench_rand( &seed ) - 1.0 );
+        }
+        for( k=0; k<2; k++ ) d->ins[k][i] = (GEO_REAL)( 2.0*bench_rand( &seed ) - 1.0 );
+
+        if( i % 7 == 3 ) {
+            for( m=0; m<3; m++ ) d->in[1][i][m] = d->in[0][i][m];
+        }
+        if( i % 11 == 5 ) {
+            for( m=0; m<3; m++ ) d->in[3][i][m] = d->in[2][i][m] + ( d->in[1][i][m] - d->in[0][i][m] );
+        }
+        if( i % 13 == 6 ) {
+            for( m=0; m<3; m++ ) d->in[3][i][m] = d->in[2][i][m] + (GEO_REAL)( 0.1*GEO_ALW_L );
+        }
+    }
+    for( k=0; k<4; k++ ) {
+        for( i=0; i<d->num; i+=GEO_PACK_W ) CalcPackLoad( GEO_PACK_W, &d->in[k][i], &d->pin[k][i/GEO_PACK_W] );
+    }
+}
+
+
+/// １ベクトル版（失敗した場合の出力は 0）
+static void
+pk_scalar( int f, PK_DATA* d )
+{
+    int i;
+
+    switch( f ) {
+    case PK_IN_PRODUCT:
+        for( i=0; i<d->num; i++ ) {
+            d->os[i] = CalcInProduct( d->in[0][i], d->in[1][i] );
+            d->ok[i] = 1;
+        }
+        break;
+    case PK_OUT_PRODUCT:
+        for( i=0; i<d->num; i++ ) {
+            CalcOutProduct( d->in[0][i], d->in[1][i], d->o1[i] );
+            d->ok[i] = 1;
+        }
+        break;
+    case PK_NORMALIZE2:
+        for( i=0; i<d->num; i++ ) {
+            GEO_REAL v[3];
+            CalcVec( d->in[0][i], d->in[1][i], v );
+            d->ok[i] = CalcNormalize2( v, d->o1[i] );
+        }
+        break;
+    case PK_LINE_VEC:
+        for( i=0; i<d->num; i++ ) {
+            d->ok[i] = CalcLineVec( d->in[0][i], d->in[1][i], d->o1[i], &d->os[i] );
+        }
+        break;
+    case PK_INTERSECTION_LINE:
+        for( i=0; i<d->num; i++ ) {
+            GEO_REAL n1[3], n2[3];
+            CalcNormalize2( d->in[1][i], n1 );
+            CalcNormalize2( d->in[i % 11 == 5 ? 1 : 3][i], n2 );
+            d->ok[i] = CalcIntersectionLine( n1, d->ins[0][i], n2, d->ins[1][i], d->o1[i], d->o2[i] );
+            if( !d->ok[i] ) {
+                memset( d->o1[i], 0, sizeof(GEO_REAL)*3 );
+                memset( d->o2[i], 0, sizeof(GEO_REAL)*3 );
+            }
+        }
+        break;
+    case PK_NEAR_POS_ON_LINE:
+        for( i=0; i<d->num; i++ ) {
+            CalcNearPosOnLine( d->in[2][i], d->in[0][i], d->in[1][i], d->o1[i] );
+            d->ok[i] = 1;
+        }
+        break;
+    case PK_CROSS_POINT_LINE:
+        for( i=0; i<d->num; i++ ) {
+            d->ok[i] = CalcCrossPointLine( d->in[0][i], d->in[1][i], d->in[2][i], d->in[3][i], d->o1[i], d->o2[i] );
+            if( !d->ok[i] ) {
+                memset( d->o1[i], 0, sizeof(GEO_REAL)*3 );
+                memset( d->o2[i], 0, sizeof(GEO_REAL)*3 );
+            }
+        }
+        break;
+    case PK_VEC_MIRROR:
+        for( i=0; i<d->num; i++ ) {
+            CalcVecMirror( d->in[0][i], d->in[1][i], d->o1[i] );
+            d->ok[i] = 1;
+        }
+        break;
+    }
+}
+
+
+/// パケット版
+static void
+pk_packet( int f, PK_DATA* d )
+{
+    int np = d->num/GEO_PACK_W;
+    int p;
+
+    switch( f ) {
+    case PK_IN_PRODUCT:
+        for( p=0; p<np; p++ ) {
+            CalcInProductP( &d->pin[0][p], &d->pin[1][p], &d->ps[p*GEO_PACK_W] );
+            d->pm[p] = GEO_PACK_ALL;
+        }
+        break;
+    case PK_OUT_PRODUCT:
+        for( p=0; p<np; p++ ) {
+            CalcOutProductP( &d->pin[0][p], &d->pin[1][p], &d->p1[p] );
+            d->pm[p] = GEO_PACK_ALL;
+        }
+        break;
+    case PK_NORMALIZE2:
+        for( p=0; p<np; p++ ) {
+            GEO_PACK_VEC v;
+            CalcVecP( &d->pin[0][p], &d->pin[1][p], &v );
+            d->pm[p] = CalcNormalize2P( &v, &d->p1[p] );
+        }
+        break;
+    case PK_LINE_VEC:
+        for( p=0; p<np; p++ ) {
+            d->pm[p] = CalcLineVecP( &d->pin[0][p], &d->pin[1][p], &d->p1[p], &d->ps[p*GEO_PACK_W] );
+        }
+        break;
+    case PK_INTERSECTION_LINE:
+        for( p=0; p<np; p++ ) {
+            GEO_PACK_VEC n1, n2, v2;
+            int          l;
+            for( l=0; l<GEO_PACK_W; l++ ) {
+                int  i   = p*GEO_PACK_W + l;
+                int  par = ( i % 11 == 5 );
+                v2.x[l] = par ? d->pin[1][p].x[l] : d->pin[3][p].x[l];
+                v2.y[l] = par ? d->pin[1][p].y[l] : d->pin[3][p].y[l];
+                v2.z[l] = par ? d->pin[1][p].z[l] : d->pin[3][p].z[l];
+            }
+            CalcNormalize2P( &d->pin[1][p], &n1 );
+            CalcNormalize2P( &v2, &n2 );
+            d->pm[p] = CalcIntersectionLineP( &n1, &d->ins[0][p*GEO_PACK_W], &n2, &d->ins[1][p*GEO_PACK_W],
+                                              &d->p1[p], &d->p2[p] );
+        }
+        break;
+    case PK_NEAR_POS_ON_LINE:
+        for( p=0; p<np; p++ ) {
+            CalcNearPosOnLineP( &d->pin[2][p], &d->pin[0][p], &d->pin[1][p], &d->p1[p] );
+            d->pm[p] = GEO_PACK_ALL;
+        }
+        break;
+    case PK_CROSS_POINT_LINE:
+        for( p=0; p<np; p++ ) {
+            d->pm[p] = CalcCrossPointLineP( &d->pin[0][p], &d->pin[1][p], &d->pin[2][p], &d->pin[3][p],
+                                            &d->p1[p], &d->p2[p] );
+        }
+        break;
+    case PK_VEC_MIRROR:
+        for( p=0; p<np; p++ ) {
+            CalcVecMirrorP( &d->pin[0][p], &d->pin[1][p], &d->p1[p] );
+            d->pm[p] = GEO_PACK_ALL;
+        }
+        break;
+    }
+}
+
+
+/// 結果の比較（一致しないレーン数）
+static int
+pk_compare( int f, PK_DATA* d )
+{
+    int use1 = ( f != PK_IN_PRODUCT );
+    int use2 = ( f == PK_INTERSECTION_LINE || f == PK_CROSS_POINT_LINE );
+    int uses = ( f == PK_IN_PRODUCT || f == PK_LINE_VEC );
+    int bad  = 0;
+    int i;
+
+    for( i=0; i<d->num; i++ ) {
+        int      p = i/GEO_PACK_W, l = i%GEO_PACK_W;
+        GEO_REAL v[3];
+        int      same = ( (int)( ( d->pm[p] >> l ) & 1u ) == ( d->ok[i] != 0 ) );
+
+        if( use1 ) {
+            v[0] = d->p1[p].x[l]; v[1] = d->p1[p].y[l]; v[2] = d->p1[p].z[l];
+            same = same && ( memcmp( v, d->o1[i], sizeof(v) ) == 0 );
+        }
+        if( use2 ) {
+            v[0] = d->p2[p].x[l]; v[1] = d->p2[p].y[l]; v[2] = d->p2[p].z[l];
+            same = same && ( memcmp( v, d->o2[i], sizeof(v) ) == 0 );
+        }
+        if( uses ) same = same && ( memcmp( &d->ps[i], &d->os[i], sizeof(GEO_REAL) ) == 0 );
+        if( !same ) bad++;
+    }
+    return bad;
+}
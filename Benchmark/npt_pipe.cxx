@@ -0,0 +1,240 @@
+/*
+ * Npatch - Nagata Patch Library
+ *
+ * Copyright (c) 2015-2016 Advanced Institute for Computational Science, RIKEN.
+ * All rights reserved.
+ *
+ */
+
+////////////////////////////////////////////////////////////////////////////
+///
+/// 長田パッチ パイプライン処理（npt_pipe_run）の計測
+///
+///   入力STL（-i 指定なしの場合はトーラスのバイナリSTLを作成、三角形の順はランダム）
+///   を細分割してバイナリSTLに出力し、キューの深さ（-d）ごとに
+///   段階ごとの処理時間、その合計、全体の経過時間を出力する。
+///   depth=1 は各段階を順に実行した場合（並行なし）に相当する。
+///   -k を指定すると出力が閉じた曲面（全ての辺を２つの三角形が共有）であるかを確認する。
+///   さらに level*(1/level) が 1 とならない最小の細分割数（単精度 41、倍精度 49）で
+///   小さいトーラスを細分割し、同様に確認する。
+///
+///   使用法
+///       npt_pipe [-i in.stl] [-n nv] [-l level] [-c chunk] [-d depth,depth,...] [-o out.stl] [-k]
+///
+////////////////////////////////////////////////////////////////////////////
+
+#include "bench_mesh.h"
+#include "Npt_Pipe.h"
+#include "Npt_Stl.h"
+#include <vector>
+#include <algorithm>
+
+/// 辺（両端の座標のビット列）
+struct pipe_edge {
+    float v[2][3];
+    bool operator<( const pipe_edge& o ) const { return memcmp( v, o.v, sizeof(v) ) < 0; }
+    bool operator==( const pipe_edge& o ) const { return memcmp( v, o.v, sizeof(v) ) == 0; }
+};
+
+//------------------------------------------------------------------
+//  プロトタイプ宣言
+//------------------------------------------------------------------
+static int  pipe_write_torus( const char* file_name, int nv );
+static long pipe_check_closed( const char* file_name );
+
+
+// #################################################################
+//    メイン
+// #################################################################
+
+int
+main( int argc, char** argv )
+{
+    const char* in_file  = NULL;
+    const char* out_file = "npt_pipe_out.stl";
+    const char* depth_list = "1,4";
+    int         nv = 256, i, check = 0;
+    NPT_PIPE_PARAM prm;
+    static const char* stage_name[NPT_PIPE_NUM_STAGE] = { "read", "weld", "normal", "param", "refine", "write" };
+
+    npt_pipe_param_init( &prm );
+    for( i=1; i<argc; i++ ) {
+        if( strcmp( argv[i], "-i" ) == 0 && i+1 < argc ) in_file    = argv[++i];
+        else if( strcmp( argv[i], "-n" ) == 0 && i+1 < argc ) nv    = atoi( argv[++i] );
+        else if( strcmp( argv[i], "-l" ) == 0 && i+1 < argc ) prm.level = atoi( argv[++i] );
+        else if( strcmp( argv[i], "-c" ) == 0 && i+1 < argc ) prm.chunk = atoi( argv[++i] );
+        else if( strcmp( argv[i], "-d" ) == 0 && i+1 < argc ) depth_list = argv[++i];
+        else if( strcmp( argv[i], "-o" ) == 0 && i+1 < argc ) out_file  = argv[++i];
+        else if( strcmp( argv[i], "-k" ) == 0 ) check = 1;
+    }
+
+    if( in_file == NULL ) {
+        in_file = "npt_pipe_in.stl";
+        if( pipe_write_torus( in_file, nv ) != 0 ) return 1;
+    }
+    prm.in_file  = in_file;
+    prm.out_file = out_file;
+
+    printf( "#### Npatch pipeline  real=%s  in=%s  level=%d  chunk=%d  threads=%d\n",
+            sizeof(NPT_REAL) == 8 ? "double" : "float", in_file, prm.level, prm.chunk,
+#ifdef _OPENMP
+            omp_get_max_threads()
+#else
+            1
+#endif
+        );
+
+    const char* p = depth_list;
+    while( *p ) {
+        NPT_PIPE_RESULT res;
+        double          sum = 0.0, tmax = 0.0;
+        int             k;
+
+        prm.depth = atoi( p );
+        int ret = npt_pipe_run( &prm, &res );
+        if( ret != NPT_PIPE_OK ) {
+            printf( "#### ERROR npt_pipe_run ret=%d\n", ret );
+            return 1;
+        }
+
+        printf( "  depth=%d  num_tri=%d  num_vtx=%d  drop=%d  num_out=%lld\n",
+                prm.depth, res.num_tri, res.num_vtx, res.num_drop, res.num_out );
+        for( k=0; k<NPT_PIPE_NUM_STAGE; k++ ) {
+            printf( "    %-8s %10.4f sec\n", stage_name[k], res.time[k] );
+            sum += res.time[k];
+            if( res.time[k] > tmax ) tmax = res.time[k];
+        }
+        printf( "    %-8s %10.4f sec\n", "sum", sum );
+        printf( "    %-8s %10.4f sec\n", "max", tmax );
+        printf( "    %-8s %10.4f sec\n", "total", res.time_total );
+
+        while( *p && *p != ',' ) p++;
+        if( *p == ',' ) p++;
+    }
+
+    if( check ) {
+        long n = pipe_check_closed( out_file );
+        printf( "  closed check : %ld open/non-manifold edges %s\n", n, n == 0 ? "OK" : "NG" );
+
+        // level*(1/level) が 1 とならない最小の細分割数（小さいトーラス）
+        int lv;
+        for( lv=2; lv<=NPT_PIPE_MAX_LEVEL; lv++ ) {
+            NPT_REAL dl = (NPT_REAL)1.0/lv;
+            if( (NPT_REAL)( lv*dl ) != (NPT_REAL)1.0 ) break;
+        }
+        if( lv <= NPT_PIPE_MAX_LEVEL ) {
+            NPT_PIPE_PARAM prm_l = prm;
+            prm_l.in_file = "npt_pipe_level.stl";
+            prm_l.level   = lv;
+            prm_l.depth   = 1;
+            if( pipe_write_torus( prm_l.in_file, 6 ) != 0 ) return 1;
+            int ret = npt_pipe_run( &prm_l, NULL );
+            if( ret != NPT_PIPE_OK ) {
+                printf( "#### ERROR npt_pipe_run ret=%d\n", ret );
+                return 1;
+            }
+            n = pipe_check_closed( out_file );
+            printf( "  closed check level=%d (level*(1/level)!=1, torus nv=6) : %ld open/non-manifold edges %s\n",
+                    lv, n, n == 0 ? "OK" : "NG" );
+        }
+    }
+    return 0;
+}
+
+
+// #################################################################
+//    非公開（プライベート）関数
+// #################################################################
+
+/// トーラスのバイナリSTL出力（3nv x nv 格子、三角形の順はランダム）
+static int
+pipe_write_torus( const char* file_name, int nv )
+{
+    int      nu = 3*nv;
+    int      num = 2*nu*nv;
+    int      i, j, k;
+    uint64_t seed = 88172645463325252ULL;
+    static const double prm[2] = { BENCH_TORUS_R, BENCH_TORUS_r };
+    std::vector<float> rec( (size_t)12*num );
+    std::vector<int>   order( num );
+
+    for( j=0; j<nv; j++ ) {
+        for( i=0; i<nu; i++ ) {
+            double pos[4][3], norm[3];
+            static const int quad[2][3] = { {0,1,2}, {0,2,3} };
+            // 周期境界の座標が一致するよう格子番号を折り返す
+            bench_surf_torus( (double)(  i      )/nu, (double)(  j      )/nv, prm, pos[0], norm );
+            bench_surf_torus( (double)( (i+1)%nu)/nu, (double)(  j      )/nv, prm, pos[1], norm );
+            bench_surf_torus( (double)( (i+1)%nu)/nu, (double)( (j+1)%nv)/nv, prm, pos[2], norm );
+            bench_surf_torus( (double)(  i      )/nu, (double)( (j+1)%nv)/nv, prm, pos[3], norm );
+            for( int m=0; m<2; m++ ) {
+                float* r = &rec[ (size_t)12*( 2*(j*nu + i) + m ) ];
+                r[0] = r[1] = r[2] = 0.0f;
+                for( k=0; k<9; k++ ) r[3+k] = (float)pos[ quad[m][k/3] ][k%3];
+            }
+        }
+    }
+    for( i=0; i<num; i++ ) order[i] = i;
+    for( i=num-1; i>0; i-- ) {
+        int r = (int)( bench_rand( &seed )*(i+1) );
+        std::swap( order[i], order[r] );
+    }
+
+    FILE* fp = fopen( file_name, "wb" );
+    if( fp == NULL ) {
+        printf( "#### ERROR pipe_write_torus: file open error %s\n", file_name );
+        return 1;
+    }
+    char     header[80];
+    uint32_t n = num;
+    uint16_t attr = 0;
+    memset( header, 0, sizeof(header) );
+    snprintf( header, sizeof(header), "npt_pipe torus nv=%d", nv );
+    fwrite( header, 1, 80, fp );
+    fwrite( &n, sizeof(n), 1, fp );
+    for( i=0; i<num; i++ ) {
+        fwrite( &rec[ (size_t)12*order[i] ], sizeof(float), 12, fp );
+        fwrite( &attr, sizeof(attr), 1, fp );
+    }
+    fclose( fp );
+    return 0;
+}
+
+
+/// 閉じた曲面の確認
+///    辺を両端の座標（ビット列）で識別し、２つの三角形に共有されていない辺の数を返す
+static long
+pipe_check_closed( const char* file_name )
+{
+    NPT_STL stl;
+    int     i, j, k;
+    long    num_open = 0;
+
+    if( npt_stl_read( file_name, &stl ) != NPT_STL_OK ) return -1;
+
+    std::vector<pipe_edge> edge( (size_t)3*stl.num_tri );
+    for( i=0; i<stl.num_tri; i++ ) {
+        for( j=0; j<3; j++ ) {
+            float a[3], b[3];
+            int   i0 = 3*i + j, i1 = 3*i + (j+1)%3;
+            a[0] = stl.x[i0]; a[1] = stl.y[i0]; a[2] = stl.z[i0];
+            b[0] = stl.x[i1]; b[1] = stl.y[i1]; b[2] = stl.z[i1];
+            pipe_edge& e = edge[ (size_t)3*i + j ];
+            bool swap = memcmp( a, b, sizeof(a) ) > 0;
+            for( k=0; k<3; k++ ) {
+                e.v[0][k] = swap ? b[k] : a[k];
+                e.v[1][k] = swap ? a[k] : b[k];
+            }
+        }
+    }
+    npt_stl_free( &stl );
+
+    std::sort( edge.begin(), edge.end() );
+    for( size_t s=0; s<edge.size(); ) {
+        size_t t = s;
+        while( t < edge.size() && edge[t] == edge[s] ) t++;
+        if( t - s != 2 ) num_open++;
+        s = t;
+    }
+    return num_open;
+}
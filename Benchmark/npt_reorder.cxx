@@ -0,0 +1,332 @@
+/*
+ * Npatch - Nagata Patch Library
+ *
+ * Copyright (c) 2015-2016 Advanced Institute for Computational Science, RIKEN.
+ * All rights reserved.
+ *
+ */
+
+////////////////////////////////////////////////////////////////////////////
+///
+/// 長田パッチ 空間充填曲線による並べ替えの効果の計測
+///
+///   頂点共有のトーラス（nu x nv 格子）の頂点、三角形をランダムに並べ替えた
+///   メッシュ（入力順がランダムな STL を想定）に対し、
+///       input   : そのまま
+///       morton  : npt_mesh_reorder( NPT_REORDER_MORTON )
+///       hilbert : npt_mesh_reorder( NPT_REORDER_HILBERT )
+///   の順で以下を計測する。
+///       reorder      : 並べ替え時間
+///       vtx_norm     : 頂点法線の計算（三角形の法線の頂点への加算）
+///       epatch_crt   : npt_epatch_crt
+///       correct_pnt  : npt_epatch_correct_pnt_n（三角形あたり3点、三角形番号順）
+///       span         : 三角形の頂点番号の最大と最小の差の平均（小さいほど局所的）
+///       step         : 連続する三角形の重心間距離の平均（辺長で正規化）
+///   さらにスレッド数 1,2,3,8 で並べ替え、頂点座標と三角形の頂点番号が
+///   出力の vtx_perm、tri_perm による逐次の付け替えと一致することを確認する。
+///
+///   使用法
+///       npt_reorder [-n nv] [-r repeat]
+///
+////////////////////////////////////////////////////////////////////////////
+
+#include "bench_mesh.h"
+#include "Npt_Mesh.h"
+
+/// 計測結果
+typedef struct {
+    double  t_reorder, t_norm, t_crt, t_pnt;
+    double  span, step;
+} REORDER_RESULT;
+
+//------------------------------------------------------------------
+//  プロトタイプ宣言
+//------------------------------------------------------------------
+static void reorder_vtx_norm( NPT_MESH* mesh );
+static int  reorder_measure( NPT_MESH* mesh, int repeat, double h, REORDER_RESULT* res );
+static long reorder_check( int num_vtx, int num_tri, NPT_REAL (*vtx0)[3], int (*tri0)[3], int curve, int nthread );
+
+
+// #################################################################
+//    メイン
+// #################################################################
+
+int
+main( int argc, char** argv )
+{
+    int        nv = 512, nu, repeat = 3;
+    int        i, j, k, c;
+    uint64_t   seed = 88172645463325252ULL;
+    static const double prm[2] = { BENCH_TORUS_R, BENCH_TORUS_r };
+    static const char*  name[3] = { "input", "morton", "hilbert" };
+
+    for( i=1; i<argc; i++ ) {
+        if( strcmp( argv[i], "-n" ) == 0 && i+1 < argc ) nv     = atoi( argv[++i] );
+        if( strcmp( argv[i], "-r" ) == 0 && i+1 < argc ) repeat = atoi( argv[++i] );
+    }
+    nu = 3*nv;
+
+    //-------------------
+    //  頂点共有のトーラス（頂点、三角形をランダムに並べ替える）
+    //-------------------
+    int num_vtx = nu*nv;
+    int num_tri = 2*nu*nv;
+    NPT_REAL (*vtx0)[3] = (NPT_REAL(*)[3])malloc( (size_t)num_vtx*sizeof(NPT_REAL[3]) );
+    NPT_REAL (*nrm0)[3] = (NPT_REAL(*)[3])malloc( (size_t)num_vtx*sizeof(NPT_REAL[3]) );
+    int      (*tri0)[3] = (int(*)[3])malloc( (size_t)num_tri*sizeof(int[3]) );
+    NPT_REAL (*vtx )[3] = (NPT_REAL(*)[3])malloc( (size_t)num_vtx*sizeof(NPT_REAL[3]) );
+    NPT_REAL (*nrm )[3] = (NPT_REAL(*)[3])malloc( (size_t)num_vtx*sizeof(NPT_REAL[3]) );
+    int      (*tri )[3] = (int(*)[3])malloc( (size_t)num_tri*sizeof(int[3]) );
+    int*       perm     = (int*)malloc( (size_t)num_tri*sizeof(int) );
+    if( vtx0 == NULL || nrm0 == NULL || tri0 == NULL || vtx == NULL || nrm == NULL || tri == NULL || perm == NULL ) {
+        printf( "#### ERROR npt_reorder: memory\n" );
+        return 1;
+    }
+
+    // 頂点のランダムな番号
+    for( i=0; i<num_vtx; i++ ) perm[i] = i;
+    for( i=num_vtx-1; i>0; i-- ) {
+        int r = (int)( bench_rand( &seed )*(i+1) );
+        int t = perm[i]; perm[i] = perm[r]; perm[r] = t;
+    }
+    for( j=0; j<nv; j++ ) {
+        for( i=0; i<nu; i++ ) {
+            double pos[3], norm[3];
+            int    iv = perm[ j*nu + i ];
+            bench_surf_torus( (double)i/nu, (double)j/nv, prm, pos, norm );
+            for( k=0; k<3; k++ ) {
+                vtx0[iv][k] = pos[k];
+                nrm0[iv][k] = norm[k];
+            }
+        }
+    }
+    for( j=0; j<nv; j++ ) {
+        for( i=0; i<nu; i++ ) {
+            int v00 = perm[ j*nu + i ],                 v10 = perm[ j*nu + (i+1)%nu ];
+            int v11 = perm[ ((j+1)%nv)*nu + (i+1)%nu ], v01 = perm[ ((j+1)%nv)*nu + i ];
+            int it  = 2*(j*nu + i);
+            tri0[it  ][0] = v00; tri0[it  ][1] = v10; tri0[it  ][2] = v11;
+            tri0[it+1][0] = v00; tri0[it+1][1] = v11; tri0[it+1][2] = v01;
+        }
+    }
+    // 三角形のランダムな順序
+    for( i=num_tri-1; i>0; i-- ) {
+        int r = (int)( bench_rand( &seed )*(i+1) );
+        for( k=0; k<3; k++ ) {
+            int t = tri0[i][k]; tri0[i][k] = tri0[r][k]; tri0[r][k] = t;
+        }
+    }
+
+    //-------------------
+    //  計測
+    //-------------------
+    double h = 2.0*PAI*BENCH_TORUS_r/nv;
+
+    printf( "#### Npatch reorder  real=%s  num_tri=%d  num_vtx=%d  threads=%d\n",
+            sizeof(NPT_REAL) == 8 ? "double" : "float", num_tri, num_vtx,
+#ifdef _OPENMP
+            omp_get_max_threads()
+#else
+            1
+#endif
+        );
+    printf( "  %-8s %12s %12s %12s %12s %12s %8s\n",
+            "order", "reorder[s]", "vtx_norm[s]", "epatch[s]", "correct[s]", "span", "step" );
+
+    for( c=0; c<3; c++ ) {
+        NPT_MESH       mesh;
+        REORDER_RESULT res;
+
+        memcpy( vtx, vtx0, (size_t)num_vtx*sizeof(NPT_REAL[3]) );
+        memcpy( nrm, nrm0, (size_t)num_vtx*sizeof(NPT_REAL[3]) );
+        memcpy( tri, tri0, (size_t)num_tri*sizeof(int[3]) );
+        mesh.num_vtx  = num_vtx;
+        mesh.num_tri  = num_tri;
+        mesh.vtx      = vtx;
+        mesh.vtx_norm = nrm;
+        mesh.tri      = tri;
+
+        res.t_reorder = 0.0;
+        if( c > 0 ) {
+            double t0 = bench_time();
+            if( npt_mesh_reorder( &mesh, c == 1 ? NPT_REORDER_MORTON : NPT_REORDER_HILBERT, NULL, NULL ) != 0 ) {
+                printf( "#### ERROR npt_mesh_reorder\n" );
+                return 1;
+            }
+            res.t_reorder = bench_time() - t0;
+        }
+        if( reorder_measure( &mesh, repeat, h, &res ) != 0 ) return 1;
+
+        printf( "  %-8s %12.6f %12.6f %12.6f %12.6f %12.1f %8.2f\n",
+                name[c], res.t_reorder, res.t_norm, res.t_crt, res.t_pnt, res.span, res.step );
+    }
+
+    //-------------------
+    //  スレッド数による差の確認
+    //-------------------
+    static const int nthread[4] = { 1, 2, 3, 8 };
+    long nerr = 0;
+    for( c=0; c<4; c++ ) {
+        long n0 = reorder_check( num_vtx, num_tri, vtx0, tri0, NPT_REORDER_MORTON,  nthread[c] );
+        long n1 = reorder_check( num_vtx, num_tri, vtx0, tri0, NPT_REORDER_HILBERT, nthread[c] );
+        if( n0 < 0 || n1 < 0 ) return 1;
+        nerr += n0 + n1;
+    }
+    printf( "  remap check (threads 1,2,3,8) : %ld mismatches %s\n", nerr, nerr == 0 ? "OK" : "NG" );
+
+    free( vtx0 ); free( nrm0 ); free( tri0 );
+    free( vtx );  free( nrm );  free( tri );
+    free( perm );
+    return 0;
+}
+
+
+// #################################################################
+//    非公開（プライベート）関数
+// #################################################################
+
+/// 頂点法線の計算（三角形の法線の面積重み付き和）
+static void
+reorder_vtx_norm( NPT_MESH* mesh )
+{
+    int i, j, k;
+
+    memset( mesh->vtx_norm, 0, (size_t)mesh->num_vtx*sizeof(NPT_REAL[3]) );
+    for( i=0; i<mesh->num_tri; i++ ) {
+        NPT_REAL v12[3], v13[3], n[3];
+        CalcVec( mesh->vtx[ mesh->tri[i][0] ], mesh->vtx[ mesh->tri[i][1] ], v12 );
+        CalcVec( mesh->vtx[ mesh->tri[i][0] ], mesh->vtx[ mesh->tri[i][2] ], v13 );
+        CalcOutProduct( v12, v13, n );
+        for( j=0; j<3; j++ ) {
+            for( k=0; k<3; k++ ) mesh->vtx_norm[ mesh->tri[i][j] ][k] += n[k];
+        }
+    }
+    for( i=0; i<mesh->num_vtx; i++ ) CalcNormalize( mesh->vtx_norm[i] );
+}
+
+
+/// 各処理の計測（繰り返しの最小値）
+static int
+reorder_measure( NPT_MESH* mesh, int repeat, double h, REORDER_RESULT* res )
+{
+    int        num_tri = mesh->num_tri;
+    int        num_pnt = 3*num_tri;
+    int        i, k, r;
+    NPT_EPATCH epatch;
+    static const NPT_REAL pe[3] = { 0.25, 0.5, 0.75 };
+    static const NPT_REAL px[3] = { 0.125, 0.25, 0.5 };
+
+    int*       tri_id = (int*)malloc( (size_t)num_pnt*sizeof(int) );
+    NPT_REAL*  eta    = (NPT_REAL*)malloc( (size_t)num_pnt*sizeof(NPT_REAL) );
+    NPT_REAL*  xi     = (NPT_REAL*)malloc( (size_t)num_pnt*sizeof(NPT_REAL) );
+    NPT_REAL (*pos)[3] = (NPT_REAL(*)[3])malloc( (size_t)num_pnt*sizeof(NPT_REAL[3]) );
+    if( tri_id == NULL || eta == NULL || xi == NULL || pos == NULL ) {
+        printf( "#### ERROR npt_reorder: memory\n" );
+        return 1;
+    }
+    for( i=0; i<num_pnt; i++ ) {
+        tri_id[i] = i/3;
+        eta[i]    = pe[i%3];
+        xi[i]     = px[i%3];
+    }
+
+    res->t_norm = res->t_crt = res->t_pnt = 1.0e30;
+    for( r=0; r<repeat; r++ ) {
+        double t0 = bench_time();
+        reorder_vtx_norm( mesh );
+        double t1 = bench_time();
+        if( npt_epatch_crt( mesh, &epatch ) != 0 ) {
+            printf( "#### ERROR npt_epatch_crt: memory\n" );
+            return 1;
+        }
+        double t2 = bench_time();
+        npt_epatch_correct_pnt_n( mesh, &epatch, num_pnt, tri_id, eta, xi, pos );
+        double t3 = bench_time();
+        npt_epatch_free( &epatch );
+
+        if( t1 - t0 < res->t_norm ) res->t_norm = t1 - t0;
+        if( t2 - t1 < res->t_crt  ) res->t_crt  = t2 - t1;
+        if( t3 - t2 < res->t_pnt  ) res->t_pnt  = t3 - t2;
+    }
+
+    // 局所性の指標
+    double span = 0.0, step = 0.0;
+    NPT_REAL g0[3] = { 0.0, 0.0, 0.0 };
+    for( i=0; i<num_tri; i++ ) {
+        int* t = mesh->tri[i];
+        int  vmin = t[0], vmax = t[0];
+        NPT_REAL g[3];
+        for( k=1; k<3; k++ ) {
+            if( t[k] < vmin ) vmin = t[k];
+            if( t[k] > vmax ) vmax = t[k];
+        }
+        span += vmax - vmin;
+        for( k=0; k<3; k++ ) g[k] = ( mesh->vtx[t[0]][k] + mesh->vtx[t[1]][k] + mesh->vtx[t[2]][k] )/3.0;
+        if( i > 0 ) step += CalcLineSize( g0, g );
+        for( k=0; k<3; k++ ) g0[k] = g[k];
+    }
+    res->span = span/num_tri;
+    res->step = ( num_tri > 1 ) ? step/(num_tri-1)/h : 0.0;
+
+    free( tri_id );
+    free( eta );
+    free( xi );
+    free( pos );
+    return 0;
+}
+
+
+/// 並べ替え結果と逐次の付け替えの比較
+///    スレッド数 nthread で並べ替え、頂点座標、三角形の頂点番号が
+///    vtx_perm、tri_perm による付け替えと異なる要素数を返す（<0 はエラー）
+static long
+reorder_check( int num_vtx, int num_tri, NPT_REAL (*vtx0)[3], int (*tri0)[3], int curve, int nthread )
+{
+    NPT_MESH mesh;
+    long     nerr = 0;
+    int      i, k;
+
+    mesh.num_vtx  = num_vtx;
+    mesh.num_tri  = num_tri;
+    mesh.vtx      = (NPT_REAL(*)[3])malloc( (size_t)num_vtx*sizeof(NPT_REAL[3]) );
+    mesh.vtx_norm = NULL;
+    mesh.tri      = (int(*)[3])malloc( (size_t)num_tri*sizeof(int[3]) );
+    int* vtx_perm = (int*)malloc( (size_t)num_vtx*sizeof(int) );
+    int* tri_perm = (int*)malloc( (size_t)num_tri*sizeof(int) );
+    int* inv      = (int*)malloc( (size_t)num_vtx*sizeof(int) );
+    if( mesh.vtx == NULL || mesh.tri == NULL || vtx_perm == NULL || tri_perm == NULL || inv == NULL ) {
+        printf( "#### ERROR npt_reorder: memory\n" );
+        free( mesh.vtx ); free( mesh.tri ); free( vtx_perm ); free( tri_perm ); free( inv );
+        return -1;
+    }
+    memcpy( mesh.vtx, vtx0, (size_t)num_vtx*sizeof(NPT_REAL[3]) );
+    memcpy( mesh.tri, tri0, (size_t)num_tri*sizeof(int[3]) );
+
+#ifdef _OPENMP
+    int nthread_org = omp_get_max_threads();
+    omp_set_num_threads( nthread );
+#else
+    (void)nthread;
+#endif
+    int ret = npt_mesh_reorder( &mesh, curve, vtx_perm, tri_perm );
+#ifdef _OPENMP
+    omp_set_num_threads( nthread_org );
+#endif
+    if( ret != 0 ) {
+        printf( "#### ERROR npt_mesh_reorder\n" );
+        nerr = -1;
+    } else {
+        for( i=0; i<num_vtx; i++ ) inv[ vtx_perm[i] ] = i;
+        for( i=0; i<num_vtx; i++ ) {
+            if( memcmp( mesh.vtx[i], vtx0[ vtx_perm[i] ], sizeof(NPT_REAL[3]) ) != 0 ) nerr++;
+        }
+        for( i=0; i<num_tri; i++ ) {
+            for( k=0; k<3; k++ ) {
+                if( mesh.tri[i][k] != inv[ tri0[ tri_perm[i] ][k] ] ) nerr++;
+            }
+        }
+    }
+
+    free( mesh.vtx ); free( mesh.tri ); free( vtx_perm ); free( tri_perm ); free( inv );
+    return nerr;
+}
@@ -0,0 +1,313 @@
+/*
+ * Npatch - Nagata Patch Library
+ *
+ * Copyright (c) 2015-2016 Advanced Institute for Computational Science, RIKEN.
+ * All rights reserved.
+ *
+ */
+
+////////////////////////////////////////////////////////////////////////////
+///
+/// 長田パッチ 曲面上の点の一様配置（npt_sample_mesh）の計測
+///
+///   頂点共有のトーラスのメッシュについて
+///       sample   : npt_sample_mesh による点（最小距離 spacing）
+///       centroid : 三角形ごとに１点（パッチの重心パラメータ）、比較用
+///   の点数、最近接点の距離（最小、平均、最大）、トーラスの内側と外側の面積あたりの
+///   点数の比（一様な場合は1）と時間を出力する。
+///   さらに以下を確認する。
+///       全ての点の組の距離が spacing 以上であること
+///       スレッド数を変えた結果がビット単位で一致すること
+///
+///   使用法
+///       npt_sample [-n num] [-s spacing] [-r repeat]
+///
+////////////////////////////////////////////////////////////////////////////
+
+#include "bench_mesh.h"
+#include "Npt_Mesh.h"
+#include "Npt_Sample.h"
+#include "Npt_Integ.h"
+#include "Npt_Curv.h"
+#include <algorithm>
+
+/// 点の格子のセル（最近接点の探索用）
+typedef struct {
+    uint64_t   key;          ///< セル番号
+    long long  idx;          ///< 点番号
+} SAMPLE_CELL;
+
+/// セル番号の比較
+struct sample_cell_less {
+    bool operator()( const SAMPLE_CELL& a, const SAMPLE_CELL& b ) const {
+        if( a.key != b.key ) return a.key < b.key;
+        return a.idx < b.idx;
+    }
+};
+
+/// 点の分布の統計
+typedef struct {
+    double     nn_min;       ///< 最近接点の距離の最小値
+    double     nn_mean;      ///< 最近接点の距離の平均値
+    double     nn_max;       ///< 最近接点の距離の最大値（探索範囲内）
+    long long  far;          ///< 探索範囲内に最近接点がない点の数
+    double     ratio;        ///< 内側と外側の面積あたりの点数の比
+} SAMPLE_STAT;
+
+//------------------------------------------------------------------
+//  プロトタイプ宣言
+//------------------------------------------------------------------
+static int  sample_torus( int nv, NPT_MESH* mesh );
+static int  sample_stat( long long num, NPT_REAL (*pos)[3], double area, SAMPLE_STAT* st );
+static void sample_print( long long num, const SAMPLE_STAT* st, double spacing, double area, double t );
+static int  sample_threads( NPT_MESH* mesh, NPT_REAL spacing, const NPT_SAMPLE* ref );
+
+
+// #################################################################
+//    メイン
+// #################################################################
+
+int
+main( int argc, char** argv )
+{
+    int       num = 2000, repeat = 3;
+    double    spacing = 0.02;
+    int       i, k, ng = 0;
+    NPT_MESH  mesh;
+    NPT_INTEG integ;
+
+    for( i=1; i<argc; i++ ) {
+        if( strcmp( argv[i], "-n" ) == 0 && i+1 < argc ) num     = atoi( argv[++i] );
+        if( strcmp( argv[i], "-s" ) == 0 && i+1 < argc ) spacing = atof( argv[++i] );
+        if( strcmp( argv[i], "-r" ) == 0 && i+1 < argc ) repeat  = atoi( argv[++i] );
+    }
+    if( repeat < 1 ) repeat = 1;
+
+    printf( "#### Npatch sample  real=%s  threads=%d  density=%.1f\n",
+            sizeof(NPT_REAL) == 8 ? "double" : "float",
+#ifdef _OPENMP
+            omp_get_max_threads(),
+#else
+            1,
+#endif
+            NPT_SAMPLE_DENSITY );
+
+    if( sample_torus( (int)sqrt( num/6.0 ), &mesh ) != 0 ) return 1;
+    if( npt_integ_mesh( &mesh, 8, &integ ) != 0 ) return 1;
+    printf( "\n## indexed torus  num_tri=%d  area=%.6f (exact %.6f)  spacing=%g\n",
+            mesh.num_tri, integ.area, 4.0*PAI*PAI*BENCH_TORUS_R*BENCH_TORUS_r, spacing );
+    printf( "  %-9s %10s %10s %8s %8s %8s %8s %10s %10s %12s\n", "method", "num", "num_cand", "n*s^2/A",
+            "nn_min", "nn_mean", "nn_max", "in/out", "time[ms]", "points/s" );
+
+    // npt_sample_mesh
+    NPT_SAMPLE  smp;
+    SAMPLE_STAT st;
+    double      t = 1.0e30;
+    for( k=0; k<repeat; k++ ) {
+        double t0 = bench_time();
+        if( npt_sample_mesh( &mesh, (NPT_REAL)spacing, 1234u, &smp ) != 0 ) {
+            printf( "#### ERROR npt_sample_mesh\n" );
+            return 1;
+        }
+        double t1 = bench_time();
+        if( t1 - t0 < t ) t = t1 - t0;
+        if( k+1 < repeat ) npt_sample_free( &smp );
+    }
+    if( sample_stat( smp.num, smp.pos, integ.area, &st ) != 0 ) return 1;
+    printf( "  %-9s %10lld %10lld ", "sample", smp.num, smp.num_cand );
+    sample_print( smp.num, &st, spacing, integ.area, t );
+    if( st.nn_min < spacing*(1.0 - 1.0e-5) ) {
+        printf( "#### ERROR npt_sample_mesh: nearest distance %e < spacing %e\n", st.nn_min, spacing );
+        ng++;
+    }
+
+    // 三角形ごとに１点
+    {
+        NPT_REAL (*pos)[3] = (NPT_REAL(*)[3])malloc( (size_t)mesh.num_tri*sizeof(NPT_REAL[3]) );
+        SAMPLE_STAT sc;
+        if( pos == NULL ) return 1;
+        for( i=0; i<mesh.num_tri; i++ ) {
+            NPT_REAL tri[3][3], cp[7][3], d_eta[3], d_xi[3];
+            int      l, m;
+            for( l=0; l<3; l++ ) {
+                for( m=0; m<3; m++ ) tri[l][m] = mesh.vtx[ mesh.tri[i][l] ][m];
+            }
+            npt_mesh_param_get( &mesh, i, cp );
+            npt_curv_tangent( (NPT_REAL)(2.0/3.0), (NPT_REAL)(1.0/3.0), tri, cp, pos[i], d_eta, d_xi );
+        }
+        if( sample_stat( mesh.num_tri, pos, integ.area, &sc ) != 0 ) return 1;
+        printf( "  %-9s %10d %10s ", "centroid", mesh.num_tri, "-" );
+        sample_print( mesh.num_tri, &sc, spacing, integ.area, 0.0 );
+        free( pos );
+    }
+    if( st.far > 0 ) printf( "  (%lld samples without a neighbour in the search range)\n", st.far );
+
+    ng += sample_threads( &mesh, (NPT_REAL)spacing, &smp );
+
+    npt_sample_free( &smp );
+    free( mesh.vtx ); free( mesh.vtx_norm ); free( mesh.tri );
+    return ng;
+}
+
+
+// #################################################################
+//    非公開（プライベート）関数
+// #################################################################
+
+/// 頂点共有のトーラスのメッシュ（nu=3*nv, 2*nu*nv 三角形）
+static int
+sample_torus( int nv, NPT_MESH* mesh )
+{
+    static const double prm[2] = { BENCH_TORUS_R, BENCH_TORUS_r };
+    int nu;
+    int i, j, k;
+
+    if( nv < 3 ) nv = 3;
+    nu = 3*nv;
+    mesh->num_vtx  = nu*nv;
+    mesh->num_tri  = 2*nu*nv;
+    mesh->vtx      = (NPT_REAL(*)[3])malloc( (size_t)mesh->num_vtx*sizeof(NPT_REAL[3]) );
+    mesh->vtx_norm = (NPT_REAL(*)[3])malloc( (size_t)mesh->num_vtx*sizeof(NPT_REAL[3]) );
+    mesh->tri      = (int(*)[3])malloc( (size_t)mesh->num_tri*sizeof(int[3]) );
+    if( mesh->vtx == NULL || mesh->vtx_norm == NULL || mesh->tri == NULL ) {
+        printf( "#### ERROR npt_sample: memory\n" );
+        return 1;
+    }
+    for( j=0; j<nv; j++ ) {
+        for( i=0; i<nu; i++ ) {
+            double pos[3], norm[3];
+            bench_surf_torus( (double)i/nu, (double)j/nv, prm, pos, norm );
+            for( k=0; k<3; k++ ) {
+                mesh->vtx     [j*nu + i][k] = pos[k];
+                mesh->vtx_norm[j*nu + i][k] = norm[k];
+            }
+        }
+    }
+    for( j=0; j<nv; j++ ) {
+        for( i=0; i<nu; i++ ) {
+            int v00 = j*nu + i,                 v10 = j*nu + (i+1)%nu;
+            int v11 = ((j+1)%nv)*nu + (i+1)%nu, v01 = ((j+1)%nv)*nu + i;
+            int it  = 2*(j*nu + i);
+            mesh->tri[it  ][0] = v00; mesh->tri[it  ][1] = v10; mesh->tri[it  ][2] = v11;
+            mesh->tri[it+1][0] = v00; mesh->tri[it+1][1] = v11; mesh->tri[it+1][2] = v01;
+        }
+    }
+    return 0;
+}
+
+
+/// 点の分布の統計
+///    最近接点は一辺 h = 2.5*sqrt(面積/点数) の格子の近傍27セルから探索する
+///    内側、外側はトーラスの中心軸からの距離 R 未満、以上（面積 2πr(πR∓2r)）とする
+static int
+sample_stat( long long num, NPT_REAL (*pos)[3], double area, SAMPLE_STAT* st )
+{
+    double       R = BENCH_TORUS_R, r = BENCH_TORUS_r;
+    double       h = 2.5*sqrt( area/(double)num );
+    double       bmin[3];
+    long long    i, n_in = 0;
+    int          k;
+    SAMPLE_CELL* cell = (SAMPLE_CELL*)malloc( (size_t)num*sizeof(SAMPLE_CELL) );
+    double*      nn   = (double*)malloc( (size_t)num*sizeof(double) );
+
+    if( cell == NULL || nn == NULL ) {
+        printf( "#### ERROR npt_sample: memory\n" );
+        return 1;
+    }
+    for( k=0; k<3; k++ ) bmin[k] = pos[0][k];
+    for( i=1; i<num; i++ ) {
+        for( k=0; k<3; k++ ) if( pos[i][k] < bmin[k] ) bmin[k] = pos[i][k];
+    }
+    for( i=0; i<num; i++ ) {
+        uint64_t key = 0;
+        for( k=0; k<3; k++ ) key |= (uint64_t)( (pos[i][k] - bmin[k])/h ) << (21*k);
+        cell[i].key = key;
+        cell[i].idx = i;
+        if( sqrt( (double)pos[i][0]*pos[i][0] + (double)pos[i][1]*pos[i][1] ) < R ) n_in++;
+    }
+    std::sort( cell, cell + num, sample_cell_less() );
+
+#pragma omp parallel for schedule(dynamic,256)
+    for( i=0; i<num; i++ ) {
+        long long ic[3];
+        double    d2min = 1.0e300;
+        int       dx, dy, dz, l;
+        for( l=0; l<3; l++ ) ic[l] = (long long)( (pos[i][l] - bmin[l])/h );
+        for( dz=-1; dz<=1; dz++ ) for( dy=-1; dy<=1; dy++ ) for( dx=-1; dx<=1; dx++ ) {
+            long long jc[3] = { ic[0]+dx, ic[1]+dy, ic[2]+dz };
+            if( jc[0] < 0 || jc[1] < 0 || jc[2] < 0 ) continue;
+            SAMPLE_CELL key;
+            key.key = (uint64_t)jc[0] | (uint64_t)jc[1] << 21 | (uint64_t)jc[2] << 42;
+            key.idx = -1;
+            SAMPLE_CELL* p = std::lower_bound( cell, cell + num, key, sample_cell_less() );
+            for( ; p < cell + num && p->key == key.key; p++ ) {
+                double d[3];
+                if( p->idx == i ) continue;
+                for( l=0; l<3; l++ ) d[l] = (double)pos[p->idx][l] - pos[i][l];
+                double d2 = d[0]*d[0] + d[1]*d[1] + d[2]*d[2];
+                if( d2 < d2min ) d2min = d2;
+            }
+        }
+        nn[i] = ( d2min < h*h ) ? sqrt( d2min ) : -1.0;
+    }
+
+    st->nn_min = 1.0e300; st->nn_max = 0.0; st->nn_mean = 0.0; st->far = 0;
+    for( i=0; i<num; i++ ) {
+        if( nn[i] < 0.0 ) { st->far++; continue; }
+        if( nn[i] < st->nn_min ) st->nn_min = nn[i];
+        if( nn[i] > st->nn_max ) st->nn_max = nn[i];
+        st->nn_mean += nn[i];
+    }
+    if( num > st->far ) st->nn_mean /= (double)( num - st->far );
+    st->ratio = ( (double)n_in/( PAI*R - 2.0*r ) )/( (double)( num - n_in )/( PAI*R + 2.0*r ) );
+
+    free( cell );
+    free( nn );
+    return 0;
+}
+
+
+/// 統計の出力（距離は spacing に対する比）
+static void
+sample_print( long long num, const SAMPLE_STAT* st, double spacing, double area, double t )
+{
+    printf( "%8.3f %8.3f %8.3f %8.3f %10.3f ",
+            (double)num*spacing*spacing/area, st->nn_min/spacing, st->nn_mean/spacing, st->nn_max/spacing,
+            st->ratio );
+    if( t > 0.0 ) printf( "%10.2f %12.3e\n", 1.0e3*t, (double)num/t );
+    else          printf( "%10s %12s\n", "-", "-" );
+}
+
+
+/// スレッド数を変えた結果の一致の確認
+static int
+sample_threads( NPT_MESH* mesh, NPT_REAL spacing, const NPT_SAMPLE* ref )
+{
+#ifdef _OPENMP
+    static const int nth[4] = { 1, 2, 3, 8 };
+    int  max_th = omp_get_max_threads();
+    int  i, ng = 0;
+
+    printf( "\n## threads (bitwise identical results)\n" );
+    for( i=0; i<4; i++ ) {
+        NPT_SAMPLE s;
+        int        same;
+        omp_set_num_threads( nth[i] );
+        if( npt_sample_mesh( mesh, spacing, 1234u, &s ) != 0 ) return 1;
+        same = ( s.num == ref->num && s.num_cand == ref->num_cand &&
+                 memcmp( s.tri,  ref->tri,  (size_t)s.num*sizeof(int) ) == 0 &&
+                 memcmp( s.eta,  ref->eta,  (size_t)s.num*sizeof(NPT_REAL) ) == 0 &&
+                 memcmp( s.xi,   ref->xi,   (size_t)s.num*sizeof(NPT_REAL) ) == 0 &&
+                 memcmp( s.pos,  ref->pos,  (size_t)s.num*sizeof(NPT_REAL[3]) ) == 0 &&
+                 memcmp( s.norm, ref->norm, (size_t)s.num*sizeof(NPT_REAL[3]) ) == 0 );
+        printf( "  threads=%d  num=%lld  %s\n", nth[i], s.num, same ? "same" : "DIFFERENT" );
+        if( !same ) ng++;
+        npt_sample_free( &s );
+    }
+    omp_set_num_threads( max_th );
+    return ng;
+#else
+    (void)mesh; (void)spacing; (void)ref;
+    return 0;
+#endif
+}
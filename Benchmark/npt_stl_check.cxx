@@ -0,0 +1,268 @@
+/*
+ * Npatch - Nagata Patch Library
+ *
+ * Copyright (c) 2015-2016 Advanced Institute for Computational Science, RIKEN.
+ * All rights reserved.
+ *
+ */
+
+////////////////////////////////////////////////////////////////////////////
+///
+/// STLファイル読み込み（npt_stl_read）の確認
+///
+///   バイナリ/アスキーSTLを書き出して読み込み、リターンコード、三角形数、
+///   座標と面の法線ベクトル（書き出した値とビット単位で一致）を確認する。
+///   座標は NPT_REAL で正確に表せる値（1/8 の倍数）とする。
+///     bin        : バイナリ
+///     bin_tail   : 末尾に余分なデータがあるバイナリ
+///     bin_short  : 三角形数に対してレコードが足りないバイナリ（不正）
+///     ascii      : アスキー（ファイルサイズが大きい場合はスレッドで分割して読む）
+///     ascii_crlf : アスキー（改行 CR+LF、インデント無し、"endfacet" 無し）
+///     vtx2       : 中央の三角形の "vertex" が２つ（不正）
+///     vtx4       : 中央の三角形の "vertex" が４つ（不正）
+///     junk       : 中央の三角形の座標の直後に余分な文字（"1.0abc"、不正）
+///     empty      : 空のファイル（不正）
+///     no_facet   : 三角形の無いアスキー（不正）
+///
+///   使用法
+///       npt_stl_check [-n num]
+///
+////////////////////////////////////////////////////////////////////////////
+
+#include "bench_mesh.h"
+#include "Npt_Stl.h"
+
+// アスキーSTLの書き出し方
+enum { STL_ASCII = 0, STL_ASCII_CRLF, STL_ASCII_VTX2, STL_ASCII_VTX4, STL_ASCII_JUNK };
+
+#define STL_CHECK_FILE  "npt_stl_check.stl"
+
+//------------------------------------------------------------------
+//  プロトタイプ宣言
+//------------------------------------------------------------------
+static double stl_val( int i, int k );
+static int    stl_write_bin( const char* file_name, int num, int num_rec, int num_tail );
+static int    stl_write_ascii( const char* file_name, int num, int mode );
+static int    stl_write_text( const char* file_name, const char* text );
+static int    stl_compare( const NPT_STL* stl, int num );
+static int    stl_case( const char* name, int ret_ok, int num );
+
+
+// #################################################################
+//    メイン
+// #################################################################
+
+int
+main( int argc, char** argv )
+{
+    int num = 100000;
+    int i, nerr = 0;
+
+    for( i=1; i<argc; i++ ) {
+        if( strcmp( argv[i], "-n" ) == 0 && i+1 < argc ) num = atoi( argv[++i] );
+    }
+    if( num < 3 ) num = 3;
+
+    int nthreads = 1;
+#ifdef _OPENMP
+    nthreads = omp_get_max_threads();
+#endif
+    printf( "#### Npatch STL read check  real=%s  num_tri=%d  threads=%d\n",
+            sizeof(NPT_REAL) == sizeof(double) ? "double" : "float", num, nthreads );
+    printf( "  %-11s %8s %8s %10s %8s %6s\n", "case", "expect", "ret", "num_tri", "values", "check" );
+
+    // バイナリ
+    if( stl_write_bin( STL_CHECK_FILE, num, num, 0 ) != 0 ) return 1;
+    nerr += stl_case( "bin", 1, num );
+    if( stl_write_bin( STL_CHECK_FILE, num, num, 37 ) != 0 ) return 1;
+    nerr += stl_case( "bin_tail", 1, num );
+    if( stl_write_bin( STL_CHECK_FILE, num, num-1, 0 ) != 0 ) return 1;
+    nerr += stl_case( "bin_short", 0, num );
+
+    // アスキー
+    if( stl_write_ascii( STL_CHECK_FILE, num, STL_ASCII ) != 0 ) return 1;
+    nerr += stl_case( "ascii", 1, num );
+    if( stl_write_ascii( STL_CHECK_FILE, num, STL_ASCII_CRLF ) != 0 ) return 1;
+    nerr += stl_case( "ascii_crlf", 1, num );
+    if( stl_write_ascii( STL_CHECK_FILE, num, STL_ASCII_VTX2 ) != 0 ) return 1;
+    nerr += stl_case( "vtx2", 0, num );
+    if( stl_write_ascii( STL_CHECK_FILE, num, STL_ASCII_VTX4 ) != 0 ) return 1;
+    nerr += stl_case( "vtx4", 0, num );
+    if( stl_write_ascii( STL_CHECK_FILE, num, STL_ASCII_JUNK ) != 0 ) return 1;
+    nerr += stl_case( "junk", 0, num );
+
+    // 三角形の無いファイル
+    if( stl_write_text( STL_CHECK_FILE, "" ) != 0 ) return 1;
+    nerr += stl_case( "empty", 0, 0 );
+    if( stl_write_text( STL_CHECK_FILE, "solid empty\nendsolid empty\n" ) != 0 ) return 1;
+    nerr += stl_case( "no_facet", 0, 0 );
+
+    remove( STL_CHECK_FILE );
+
+    printf( "%s\n", nerr == 0 ? "#### OK" : "#### NG" );
+    return ( nerr == 0 ) ? 0 : 1;
+}
+
+
+// #################################################################
+//    非公開（プライベート）関数
+// #################################################################
+
+// 三角形iの値（k=0-8 頂点座標、k=9-11 面の法線ベクトル、1/8 の倍数）
+static double
+stl_val(
+        int  i,                   // [in]  三角形番号
+        int  k                    // [in]  成分
+    )
+{
+    return ( (int)( ( (long long)i*12 + k*7 ) % 16001 ) - 8000 )*0.125;
+}
+
+
+// バイナリSTLの書き出し
+static int
+stl_write_bin(
+        const char*  file_name,   // [in]  ファイル名
+        int          num,         // [in]  ヘッダの三角形数
+        int          num_rec,     // [in]  書き出すレコード数
+        int          num_tail     // [in]  末尾に追加するバイト数
+    )
+{
+    FILE* fp = fopen( file_name, "wb" );
+    if( fp == NULL ) {
+        printf( "#### ERROR npt_stl_check: file open error file_name=%s\n", file_name );
+        return 1;
+    }
+
+    char     header[80];
+    uint32_t n = (uint32_t)num;
+    memset( header, 0, sizeof(header) );
+    strcpy( header, "solid npt_stl_check" );
+    fwrite( header, 1, sizeof(header), fp );
+    fwrite( &n, sizeof(uint32_t), 1, fp );
+    for( int i=0; i<num_rec; i++ ) {
+        float    rec[12];
+        uint16_t attr = 0;
+        rec[0] = (float)stl_val( i, 9 );
+        rec[1] = (float)stl_val( i, 10 );
+        rec[2] = (float)stl_val( i, 11 );
+        for( int k=0; k<9; k++ ) rec[3+k] = (float)stl_val( i, k );
+        fwrite( rec, sizeof(float), 12, fp );
+        fwrite( &attr, sizeof(uint16_t), 1, fp );
+    }
+    for( int i=0; i<num_tail; i++ ) fputc( 0, fp );
+    fclose( fp );
+    return 0;
+}
+
+
+// アスキーSTLの書き出し
+static int
+stl_write_ascii(
+        const char*  file_name,   // [in]  ファイル名
+        int          num,         // [in]  三角形数
+        int          mode         // [in]  書き出し方 STL_ASCII-STL_ASCII_JUNK
+    )
+{
+    FILE* fp = fopen( file_name, "wb" );
+    if( fp == NULL ) {
+        printf( "#### ERROR npt_stl_check: file open error file_name=%s\n", file_name );
+        return 1;
+    }
+
+    const char* nl  = ( mode == STL_ASCII_CRLF ) ? "\r\n" : "\n";
+    const char* ind = ( mode == STL_ASCII_CRLF ) ? "" : "  ";
+    int         bad = num/2;
+
+    fprintf( fp, "solid npt_stl_check%s", nl );
+    for( int i=0; i<num; i++ ) {
+        int nvtx = 3;
+        if( i == bad && mode == STL_ASCII_VTX2 ) nvtx = 2;
+        if( i == bad && mode == STL_ASCII_VTX4 ) nvtx = 4;
+
+        fprintf( fp, "%sfacet normal %.3f %.3f %.3f%s", ind,
+                 stl_val( i, 9 ), stl_val( i, 10 ), stl_val( i, 11 ), nl );
+        fprintf( fp, "%s%souter loop%s", ind, ind, nl );
+        for( int j=0; j<nvtx; j++ ) {
+            int jj = j % 3;
+            fprintf( fp, "%s%s%svertex %.3f %.3f %.3f%s%s", ind, ind, ind,
+                     stl_val( i, 3*jj ), stl_val( i, 3*jj+1 ), stl_val( i, 3*jj+2 ),
+                     ( i == bad && j == 1 && mode == STL_ASCII_JUNK ) ? "abc" : "", nl );
+        }
+        fprintf( fp, "%s%sendloop%s", ind, ind, nl );
+        if( mode != STL_ASCII_CRLF ) fprintf( fp, "%sendfacet%s", ind, nl );
+    }
+    fprintf( fp, "endsolid npt_stl_check%s", nl );
+    fclose( fp );
+    return 0;
+}
+
+
+// テキストの書き出し
+static int
+stl_write_text(
+        const char*  file_name,   // [in]  ファイル名
+        const char*  text         // [in]  内容
+    )
+{
+    FILE* fp = fopen( file_name, "wb" );
+    if( fp == NULL ) {
+        printf( "#### ERROR npt_stl_check: file open error file_name=%s\n", file_name );
+        return 1;
+    }
+    fputs( text, fp );
+    fclose( fp );
+    return 0;
+}
+
+
+// 読み込んだ値と書き出した値が一致しない三角形数
+static int
+stl_compare(
+        const NPT_STL*  stl,      // [in]  STLデータ
+        int             num       // [in]  三角形数
+    )
+{
+    int i, ndiff = 0;
+
+#pragma omp parallel for schedule(static) reduction(+:ndiff)
+    for( i=0; i<num; i++ ) {
+        int diff = 0;
+        for( int j=0; j<3; j++ ) {
+            if( stl->x[3*i+j] != (NPT_REAL)stl_val( i, 3*j   ) ) diff = 1;
+            if( stl->y[3*i+j] != (NPT_REAL)stl_val( i, 3*j+1 ) ) diff = 1;
+            if( stl->z[3*i+j] != (NPT_REAL)stl_val( i, 3*j+2 ) ) diff = 1;
+        }
+        if( stl->nx[i] != (NPT_REAL)stl_val( i, 9  ) ) diff = 1;
+        if( stl->ny[i] != (NPT_REAL)stl_val( i, 10 ) ) diff = 1;
+        if( stl->nz[i] != (NPT_REAL)stl_val( i, 11 ) ) diff = 1;
+        ndiff += diff;
+    }
+    return ndiff;
+}
+
+
+// １ケースの読み込みと確認（NGの場合に1を返す）
+static int
+stl_case(
+        const char*  name,        // [in]  ケース名
+        int          ret_ok,      // [in]  =1 NPT_STL_OK となること  =0 NPT_STL_ERR_FORMAT となること
+        int          num          // [in]  三角形数
+    )
+{
+    NPT_STL stl;
+    int     ret, ng, ndiff = 0;
+
+    ret = npt_stl_read( STL_CHECK_FILE, &stl );
+    if( ret_ok ) {
+        if( ret == NPT_STL_OK && stl.num_tri == num ) ndiff = stl_compare( &stl, num );
+        ng = ( ret != NPT_STL_OK || stl.num_tri != num || ndiff != 0 );
+    } else {
+        ng = ( ret != NPT_STL_ERR_FORMAT || stl.num_tri != 0 );
+    }
+
+    printf( "  %-11s %8s %8d %10d %8d %6s\n", name, ret_ok ? "ok" : "format",
+            ret, stl.num_tri, ndiff, ng ? "NG" : "ok" );
+    npt_stl_free( &stl );
+    return ng;
+}
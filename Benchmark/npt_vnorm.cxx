@@ -0,0 +1,261 @@
+/*
+ * Npatch - Nagata Patch Library
+ *
+ * Copyright (c) 2015-2016 Advanced Institute for Computational Science, RIKEN.
+ * All rights reserved.
+ *
+ */
+
+////////////////////////////////////////////////////////////////////////////
+///
+/// 長田パッチ 頂点法線ベクトルの差分更新（NPT_VNORM）の計測
+///
+///   頂点共有のトーラス（3nv x nv 格子）の w x w 格子の頂点を局所的に変形する
+///   （位置を変えて s 回）場合について、変形ごとに
+///       full : 全三角形の法線の頂点への加算と単位ベクトル化 + 全三角形の npt_mesh_param_get
+///       incr : npt_vnorm_update + upd_tri の三角形の npt_mesh_param_get
+///   の時間（変形ごとの平均）を出力する。
+///   incr の頂点法線ベクトルと長田パッチパラメータが full とビット単位で一致すること
+///   （upd_tri 以外のパッチが変化しないこと）を確認する。
+///
+///   使用法
+///       npt_vnorm [-n nv] [-w window] [-s steps]
+///
+////////////////////////////////////////////////////////////////////////////
+
+#include "bench_mesh.h"
+#include "Npt_Mesh.h"
+
+// 変形の高さ（トーラスの管の半径との比）
+#define VNORM_BUMP_H   0.1
+
+//------------------------------------------------------------------
+//  プロトタイプ宣言
+//------------------------------------------------------------------
+static int  vnorm_torus( int nv, NPT_MESH* mesh );
+static void vnorm_full( NPT_MESH* mesh, NPT_REAL (*norm)[3] );
+static long vnorm_compare( int num, const NPT_REAL* a, const NPT_REAL* b );
+
+
+// #################################################################
+//    メイン
+// #################################################################
+
+int
+main( int argc, char** argv )
+{
+    int        nv = 512, nu, w = 16, ns = 10;
+    int        i, j, k, s;
+    uint64_t   seed = 88172645463325252ULL;
+    NPT_MESH   mesh;
+    NPT_VNORM  vnorm;
+
+    for( i=1; i<argc; i++ ) {
+        if( strcmp( argv[i], "-n" ) == 0 && i+1 < argc ) nv = atoi( argv[++i] );
+        if( strcmp( argv[i], "-w" ) == 0 && i+1 < argc ) w  = atoi( argv[++i] );
+        if( strcmp( argv[i], "-s" ) == 0 && i+1 < argc ) ns = atoi( argv[++i] );
+    }
+    if( nv < 3 ) nv = 3;
+    nu = 3*nv;
+    if( w > nv ) w = nv;
+    if( w < 1 ) w = 1;
+    if( ns < 1 ) ns = 1;
+
+    if( vnorm_torus( nv, &mesh ) != 0 ) return 1;
+
+    int num_vtx = mesh.num_vtx;
+    int num_tri = mesh.num_tri;
+    NPT_REAL (*vtx0)   [3] = (NPT_REAL(*)[3])malloc( (size_t)num_vtx*sizeof(NPT_REAL[3]) );
+    NPT_REAL (*norm_f) [3] = (NPT_REAL(*)[3])malloc( (size_t)num_vtx*sizeof(NPT_REAL[3]) );
+    NPT_REAL (*cp_f)[7][3] = (NPT_REAL(*)[7][3])malloc( (size_t)num_tri*sizeof(NPT_REAL[7][3]) );
+    NPT_REAL (*cp_i)[7][3] = (NPT_REAL(*)[7][3])malloc( (size_t)num_tri*sizeof(NPT_REAL[7][3]) );
+    int*       mov         = (int*)malloc( (size_t)w*w*sizeof(int) );
+    if( vtx0 == NULL || norm_f == NULL || cp_f == NULL || cp_i == NULL || mov == NULL ) {
+        printf( "#### ERROR npt_vnorm: memory\n" );
+        return 1;
+    }
+    memcpy( vtx0, mesh.vtx, (size_t)num_vtx*sizeof(NPT_REAL[3]) );
+
+    // 初期状態
+    double t0 = bench_time();
+    if( npt_vnorm_crt( &mesh, &vnorm ) != 0 ) {
+        printf( "#### ERROR npt_vnorm_crt: memory\n" );
+        return 1;
+    }
+    double t_crt = bench_time() - t0;
+#pragma omp parallel for schedule(static)
+    for( i=0; i<num_tri; i++ ) {
+        npt_mesh_param_get( &mesh, i, cp_i[i] );
+    }
+    vnorm_full( &mesh, norm_f );
+    long ndiff_crt = vnorm_compare( 3*num_vtx, mesh.vtx_norm[0], norm_f[0] );
+
+    double t_nf = 0.0, t_pf = 0.0, t_ni = 0.0, t_pi = 0.0;
+    long   ndiff_norm = 0, ndiff_cp = 0;
+    double n_upd_vtx = 0.0, n_upd_tri = 0.0;
+    for( s=0; s<ns; s++ ) {
+        // w x w 格子の頂点を管の中心から離れる向きに変位
+        int i0 = (int)( bench_rand( &seed )*nu );
+        int j0 = (int)( bench_rand( &seed )*nv );
+        int nm = 0;
+        for( j=0; j<w; j++ ) {
+            for( i=0; i<w; i++ ) {
+                int    iv = ( (j0+j)%nv )*nu + (i0+i)%nu;
+                double a  = sin( PAI*(i+0.5)/w )*sin( PAI*(j+0.5)/w )*VNORM_BUMP_H*BENCH_TORUS_r;
+                double u  = 2.0*PAI*( (i0+i)%nu )/nu;
+                double v  = 2.0*PAI*( (j0+j)%nv )/nv;
+                mesh.vtx[iv][0] += (NPT_REAL)( a*cos(v)*cos(u) );
+                mesh.vtx[iv][1] += (NPT_REAL)( a*cos(v)*sin(u) );
+                mesh.vtx[iv][2] += (NPT_REAL)( a*sin(v) );
+                mov[nm++] = iv;
+            }
+        }
+
+        // full
+        t0 = bench_time();
+        vnorm_full( &mesh, norm_f );
+        t_nf += bench_time() - t0;
+        NPT_REAL (*norm_i)[3] = mesh.vtx_norm;
+        mesh.vtx_norm = norm_f;
+        t0 = bench_time();
+#pragma omp parallel for schedule(static)
+        for( i=0; i<num_tri; i++ ) {
+            npt_mesh_param_get( &mesh, i, cp_f[i] );
+        }
+        t_pf += bench_time() - t0;
+        mesh.vtx_norm = norm_i;
+
+        // incr
+        t0 = bench_time();
+        npt_vnorm_update( &mesh, &vnorm, nm, mov );
+        t_ni += bench_time() - t0;
+        t0 = bench_time();
+#pragma omp parallel for schedule(static)
+        for( k=0; k<vnorm.num_upd_tri; k++ ) {
+            npt_mesh_param_get( &mesh, vnorm.upd_tri[k], cp_i[ vnorm.upd_tri[k] ] );
+        }
+        t_pi += bench_time() - t0;
+        n_upd_vtx += vnorm.num_upd_vtx;
+        n_upd_tri += vnorm.num_upd_tri;
+
+        ndiff_norm += vnorm_compare( 3*num_vtx, mesh.vtx_norm[0], norm_f[0] );
+        ndiff_cp   += vnorm_compare( 21*num_tri, cp_i[0][0], cp_f[0][0] );
+
+        // 元に戻す
+        memcpy( mesh.vtx, vtx0, (size_t)num_vtx*sizeof(NPT_REAL[3]) );
+        npt_vnorm_update( &mesh, &vnorm, nm, mov );
+        for( k=0; k<vnorm.num_upd_tri; k++ ) {
+            npt_mesh_param_get( &mesh, vnorm.upd_tri[k], cp_i[ vnorm.upd_tri[k] ] );
+        }
+    }
+
+    int nthreads = 1;
+#ifdef _OPENMP
+    nthreads = omp_get_max_threads();
+#endif
+    printf( "#### Npatch vertex normal update  real=%s  num_vtx=%d  num_tri=%d  window=%dx%d  steps=%d  threads=%d\n",
+            sizeof(NPT_REAL) == sizeof(double) ? "double" : "float",
+            num_vtx, num_tri, w, w, ns, nthreads );
+    printf( "  npt_vnorm_crt         : %.6f s  (diff from full %ld) %s\n",
+            t_crt, ndiff_crt, ndiff_crt == 0 ? "OK" : "NG" );
+    printf( "  moved / updated       : %d vertices, %.0f normals, %.0f patches per step\n",
+            w*w, n_upd_vtx/ns, n_upd_tri/ns );
+    printf( "  %-6s %12s %12s %12s\n", "method", "normal[ms]", "param[ms]", "total[ms]" );
+    printf( "  %-6s %12.4f %12.4f %12.4f\n", "full", t_nf/ns*1.0e3, t_pf/ns*1.0e3, (t_nf+t_pf)/ns*1.0e3 );
+    printf( "  %-6s %12.4f %12.4f %12.4f  (x%.0f)\n", "incr", t_ni/ns*1.0e3, t_pi/ns*1.0e3, (t_ni+t_pi)/ns*1.0e3,
+            (t_nf+t_pf)/(t_ni+t_pi) );
+    printf( "  diff from full        : normal %ld  param %ld  (bitwise) %s\n",
+            ndiff_norm, ndiff_cp, ( ndiff_norm == 0 && ndiff_cp == 0 ) ? "OK" : "NG" );
+
+    npt_vnorm_free( &vnorm );
+    free( vtx0 );
+    free( norm_f );
+    free( cp_f );
+    free( cp_i );
+    free( mov );
+    free( mesh.vtx );
+    free( mesh.vtx_norm );
+    free( mesh.tri );
+
+    return 0;
+}
+
+
+// #################################################################
+//    非公開（プライベート）関数
+// #################################################################
+
+// 頂点共有のトーラス（3nv x nv 格子、頂点法線ベクトルは未設定）
+static int
+vnorm_torus( int nv, NPT_MESH* mesh )
+{
+    static const double prm[2] = { BENCH_TORUS_R, BENCH_TORUS_r };
+    int nu = 3*nv;
+    int i, j, k;
+
+    mesh->num_vtx  = nu*nv;
+    mesh->num_tri  = 2*nu*nv;
+    mesh->vtx      = (NPT_REAL(*)[3])malloc( (size_t)mesh->num_vtx*sizeof(NPT_REAL[3]) );
+    mesh->vtx_norm = (NPT_REAL(*)[3])malloc( (size_t)mesh->num_vtx*sizeof(NPT_REAL[3]) );
+    mesh->tri      = (int(*)[3])malloc( (size_t)mesh->num_tri*sizeof(int[3]) );
+    if( mesh->vtx == NULL || mesh->vtx_norm == NULL || mesh->tri == NULL ) {
+        printf( "#### ERROR npt_vnorm: memory\n" );
+        return 1;
+    }
+    for( j=0; j<nv; j++ ) {
+        for( i=0; i<nu; i++ ) {
+            double pos[3], norm[3];
+            bench_surf_torus( (double)i/nu, (double)j/nv, prm, pos, norm );
+            for( k=0; k<3; k++ ) mesh->vtx[j*nu + i][k] = pos[k];
+        }
+    }
+    for( j=0; j<nv; j++ ) {
+        for( i=0; i<nu; i++ ) {
+            int v00 = j*nu + i,                 v10 = j*nu + (i+1)%nu;
+            int v11 = ((j+1)%nv)*nu + (i+1)%nu, v01 = ((j+1)%nv)*nu + i;
+            int it  = 2*(j*nu + i);
+            mesh->tri[it  ][0] = v00; mesh->tri[it  ][1] = v10; mesh->tri[it  ][2] = v11;
+            mesh->tri[it+1][0] = v00; mesh->tri[it+1][1] = v11; mesh->tri[it+1][2] = v01;
+        }
+    }
+    return 0;
+}
+
+
+// 全頂点の法線ベクトル（三角形の順に各頂点へ加算、逐次）
+static void
+vnorm_full( NPT_MESH* mesh, NPT_REAL (*norm)[3] )
+{
+    int i, k;
+
+    memset( norm, 0, (size_t)mesh->num_vtx*sizeof(NPT_REAL[3]) );
+    for( i=0; i<mesh->num_tri; i++ ) {
+        NPT_REAL vec12[3], vec13[3], n[3];
+        int*     tri = mesh->tri[i];
+        CalcVec( mesh->vtx[tri[0]], mesh->vtx[tri[1]], vec12 );
+        CalcVec( mesh->vtx[tri[0]], mesh->vtx[tri[2]], vec13 );
+        CalcOutProduct( vec12, vec13, n );
+        for( k=0; k<3; k++ ) {
+            norm[tri[k]][0] += n[0];
+            norm[tri[k]][1] += n[1];
+            norm[tri[k]][2] += n[2];
+        }
+    }
+    for( i=0; i<mesh->num_vtx; i++ ) {
+        CalcNormalize( norm[i] );
+    }
+}
+
+
+// ビット単位で異なる要素数
+static long
+vnorm_compare( int num, const NPT_REAL* a, const NPT_REAL* b )
+{
+    long n = 0;
+    int  i;
+
+    for( i=0; i<num; i++ ) {
+        if( memcmp( &a[i], &b[i], sizeof(NPT_REAL) ) != 0 ) n++;
+    }
+    return n;
+}
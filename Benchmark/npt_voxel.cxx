@@ -0,0 +1,402 @@
+/*
+ * Npatch - Nagata Patch Library
+ *
+ * Copyright (c) 2015-2016 Advanced Institute for Computational Science, RIKEN.
+ * All rights reserved.
+ *
+ */
+
+////////////////////////////////////////////////////////////////////////////
+///
+/// 長田パッチ 閉曲面のボクセル化（npt_voxel_mesh）の計測
+///
+///   頂点共有の球（緯度経度分割）、トーラスのメッシュについて、g^3 程度の格子で
+///       内部セル数による体積の誤差
+///       解析曲面の内外判定と異なるセルの数、曲面からの最大距離（セルの大きさとの比）
+///       （参考：平面三角形の重心と解析曲面の最大距離）
+///       交点の数が奇数の行の有無（戻り値 2）
+///       時間、セル/秒
+///   を出力する。格子の原点は対称面（メッシュの頂点、辺を通る行）を含む位置とする。
+///   さらにスレッド数を変えた結果がビット単位で一致することを確認する。
+///
+///   切断セル（npt_voxel_cut）について
+///       切断セル数、固体の体積の誤差（切断セルの体積率と内部セルの和）
+///       z=0 に最も近い格子面の固体の面積の誤差（z の面の開口率と内部セルの和）
+///       切断セルの体積率と解析曲面の体積率（セル内の点の数え上げ）の差の平均、最大
+///       時間、スレッド数によらない結果の一致
+///   を出力する。
+///
+///   使用法
+///       npt_voxel [-n num] [-g cells] [-d depth] [-s nsub]
+///
+////////////////////////////////////////////////////////////////////////////
+
+#include "bench_mesh.h"
+#include "Npt_Mesh.h"
+#include "Npt_Voxel.h"
+
+//------------------------------------------------------------------
+//  プロトタイプ宣言
+//------------------------------------------------------------------
+static int    voxel_sphere( int nlat, NPT_MESH* mesh );
+static int    voxel_torus( int nv, NPT_MESH* mesh );
+static double voxel_dist( const char* type, double x, double y, double z );
+static double voxel_sag( const char* type, NPT_MESH* mesh );
+static int    voxel_run( const char* type, NPT_MESH* mesh, int g, int depth, int nsub );
+static int    voxel_cut( const char* type, NPT_MESH* mesh, const NPT_VOXEL_GRID* grid, int depth, int nsub,
+                         const unsigned int* flag, double vol_ex );
+
+
+// #################################################################
+//    メイン
+// #################################################################
+
+int
+main( int argc, char** argv )
+{
+    int num = 2000, g = 256, depth = 2, nsub = 4;
+    int i, ng = 0;
+
+    for( i=1; i<argc; i++ ) {
+        if( strcmp( argv[i], "-n" ) == 0 && i+1 < argc ) num   = atoi( argv[++i] );
+        if( strcmp( argv[i], "-g" ) == 0 && i+1 < argc ) g     = atoi( argv[++i] );
+        if( strcmp( argv[i], "-d" ) == 0 && i+1 < argc ) depth = atoi( argv[++i] );
+        if( strcmp( argv[i], "-s" ) == 0 && i+1 < argc ) nsub  = atoi( argv[++i] );
+    }
+    if( g < 8 ) g = 8;
+
+    printf( "#### Npatch voxel  real=%s  threads=%d  depth=%d  tile=%d  nsub=%d\n",
+            sizeof(NPT_REAL) == 8 ? "double" : "float",
+#ifdef _OPENMP
+            omp_get_max_threads(),
+#else
+            1,
+#endif
+            depth, NPT_VOXEL_TILE, nsub );
+
+    for( i=0; i<2; i++ ) {
+        const char* type = ( i == 0 ) ? "sphere" : "torus";
+        NPT_MESH    mesh;
+        int         ret;
+
+        ret = ( i == 0 ) ? voxel_sphere( (int)sqrt( num/4.0 ), &mesh ) : voxel_torus( (int)sqrt( num/6.0 ), &mesh );
+        if( ret != 0 ) return 1;
+        ng += voxel_run( type, &mesh, g, depth, nsub );
+        free( mesh.vtx ); free( mesh.vtx_norm ); free( mesh.tri );
+    }
+    return ng;
+}
+
+
+// #################################################################
+//    非公開（プライベート）関数
+// #################################################################
+
+/// 頂点共有の単位球（緯度 nlat 分割、経度 2*nlat 分割、極は１頂点）
+static int
+voxel_sphere( int nlat, NPT_MESH* mesh )
+{
+    int nlon, nr;
+    int i, j, k, it = 0;
+
+    if( nlat < 3 ) nlat = 3;
+    nlon = 2*nlat;
+    nr   = nlat - 1;
+    mesh->num_vtx  = nr*nlon + 2;
+    mesh->num_tri  = 2*nlon*nr;
+    mesh->vtx      = (NPT_REAL(*)[3])malloc( (size_t)mesh->num_vtx*sizeof(NPT_REAL[3]) );
+    mesh->vtx_norm = (NPT_REAL(*)[3])malloc( (size_t)mesh->num_vtx*sizeof(NPT_REAL[3]) );
+    mesh->tri      = (int(*)[3])malloc( (size_t)mesh->num_tri*sizeof(int[3]) );
+    if( mesh->vtx == NULL || mesh->vtx_norm == NULL || mesh->tri == NULL ) {
+        printf( "#### ERROR npt_voxel: memory\n" );
+        return 1;
+    }
+    for( j=0; j<nr; j++ ) {
+        double th = PAI*(j + 1)/nlat;
+        for( i=0; i<nlon; i++ ) {
+            double ph = 2.0*PAI*i/nlon;
+            double p[3] = { sin( th )*cos( ph ), sin( th )*sin( ph ), cos( th ) };
+            for( k=0; k<3; k++ ) mesh->vtx[j*nlon + i][k] = mesh->vtx_norm[j*nlon + i][k] = p[k];
+        }
+    }
+    for( k=0; k<3; k++ ) {
+        mesh->vtx[nr*nlon  ][k] = mesh->vtx_norm[nr*nlon  ][k] = ( k == 2 ) ?  1.0 : 0.0;
+        mesh->vtx[nr*nlon+1][k] = mesh->vtx_norm[nr*nlon+1][k] = ( k == 2 ) ? -1.0 : 0.0;
+    }
+    for( i=0; i<nlon; i++ ) {
+        int i1 = (i+1)%nlon;
+        mesh->tri[it][0] = nr*nlon; mesh->tri[it][1] = i; mesh->tri[it][2] = i1; it++;
+        mesh->tri[it][0] = nr*nlon+1; mesh->tri[it][1] = (nr-1)*nlon + i1; mesh->tri[it][2] = (nr-1)*nlon + i; it++;
+        for( j=0; j+1<nr; j++ ) {
+            int v00 = j*nlon + i, v01 = j*nlon + i1, v10 = (j+1)*nlon + i, v11 = (j+1)*nlon + i1;
+            mesh->tri[it][0] = v00; mesh->tri[it][1] = v10; mesh->tri[it][2] = v11; it++;
+            mesh->tri[it][0] = v00; mesh->tri[it][1] = v11; mesh->tri[it][2] = v01; it++;
+        }
+    }
+    return 0;
+}
+
+
+/// 頂点共有のトーラスのメッシュ（nu=3*nv, 2*nu*nv 三角形）
+static int
+voxel_torus( int nv, NPT_MESH* mesh )
+{
+    static const double prm[2] = { BENCH_TORUS_R, BENCH_TORUS_r };
+    int nu;
+    int i, j, k;
+
+    if( nv < 3 ) nv = 3;
+    nu = 3*nv;
+    mesh->num_vtx  = nu*nv;
+    mesh->num_tri  = 2*nu*nv;
+    mesh->vtx      = (NPT_REAL(*)[3])malloc( (size_t)mesh->num_vtx*sizeof(NPT_REAL[3]) );
+    mesh->vtx_norm = (NPT_REAL(*)[3])malloc( (size_t)mesh->num_vtx*sizeof(NPT_REAL[3]) );
+    mesh->tri      = (int(*)[3])malloc( (size_t)mesh->num_tri*sizeof(int[3]) );
+    if( mesh->vtx == NULL || mesh->vtx_norm == NULL || mesh->tri == NULL ) {
+        printf( "#### ERROR npt_voxel: memory\n" );
+        return 1;
+    }
+    for( j=0; j<nv; j++ ) {
+        for( i=0; i<nu; i++ ) {
+            double pos[3], norm[3];
+            bench_surf_torus( (double)i/nu, (double)j/nv, prm, pos, norm );
+            for( k=0; k<3; k++ ) {
+                mesh->vtx     [j*nu + i][k] = pos[k];
+                mesh->vtx_norm[j*nu + i][k] = norm[k];
+            }
+        }
+    }
+    for( j=0; j<nv; j++ ) {
+        for( i=0; i<nu; i++ ) {
+            int v00 = j*nu + i,                 v10 = j*nu + (i+1)%nu;
+            int v11 = ((j+1)%nv)*nu + (i+1)%nu, v01 = ((j+1)%nv)*nu + i;
+            int it  = 2*(j*nu + i);
+            mesh->tri[it  ][0] = v00; mesh->tri[it  ][1] = v10; mesh->tri[it  ][2] = v11;
+            mesh->tri[it+1][0] = v00; mesh->tri[it+1][1] = v11; mesh->tri[it+1][2] = v01;
+        }
+    }
+    return 0;
+}
+
+
+/// 解析曲面の符号付き距離（内部で負）
+static double
+voxel_dist( const char* type, double x, double y, double z )
+{
+    if( strcmp( type, "torus" ) == 0 ) {
+        double q = sqrt( x*x + y*y ) - BENCH_TORUS_R;
+        return sqrt( q*q + z*z ) - BENCH_TORUS_r;
+    }
+    return sqrt( x*x + y*y + z*z ) - 1.0;
+}
+
+
+/// 平面三角形の重心と解析曲面の最大距離
+static double
+voxel_sag( const char* type, NPT_MESH* mesh )
+{
+    double sag = 0.0;
+    int    i, k;
+
+    for( i=0; i<mesh->num_tri; i++ ) {
+        double c[3] = { 0.0, 0.0, 0.0 };
+        for( k=0; k<3; k++ ) {
+            c[0] += mesh->vtx[ mesh->tri[i][k] ][0]/3.0;
+            c[1] += mesh->vtx[ mesh->tri[i][k] ][1]/3.0;
+            c[2] += mesh->vtx[ mesh->tri[i][k] ][2]/3.0;
+        }
+        double d = fabs( voxel_dist( type, c[0], c[1], c[2] ) );
+        if( d > sag ) sag = d;
+    }
+    return sag;
+}
+
+
+/// ボクセル化と結果の確認
+static int
+voxel_run( const char* type, NPT_MESH* mesh, int g, int depth, int nsub )
+{
+    NPT_VOXEL_GRID grid;
+    double         ext[3], vol_ex, t0, t1, dmax = 0.0;
+    long long      solid = 0, mis = 0;
+    int            i, j, k, ret, ng = 0;
+
+    if( strcmp( type, "torus" ) == 0 ) {
+        double a = BENCH_TORUS_R + BENCH_TORUS_r;
+        ext[0] = ext[1] = a; ext[2] = BENCH_TORUS_r;
+        vol_ex = 2.0*PAI*PAI*BENCH_TORUS_R*BENCH_TORUS_r*BENCH_TORUS_r;
+    }
+    else {
+        ext[0] = ext[1] = ext[2] = 1.0;
+        vol_ex = 4.0/3.0*PAI;
+    }
+    // 原点対称の格子（g は偶数、z=0 等の対称面を行が通る）
+    double pitch = 2.0*ext[0]*1.1/( g & ~1 );
+    for( k=0; k<3; k++ ) {
+        int n = 2*(int)ceil( ext[k]*1.1/pitch );
+        grid.size [k] = n;
+        grid.pitch[k] = pitch;
+        grid.org  [k] = -0.5*n*pitch + 0.5*pitch;   // セル中心が 0 を通るよう半セルずらす
+    }
+    int       nw    = NPT_VOXEL_ROW_WORDS( grid.size[0] );
+    size_t    nword = (size_t)grid.size[2]*grid.size[1]*nw;
+    unsigned int* flag = (unsigned int*)malloc( nword*sizeof(unsigned int) );
+    if( flag == NULL ) {
+        printf( "#### ERROR npt_voxel: memory\n" );
+        return 1;
+    }
+
+    t0  = bench_time();
+    ret = npt_voxel_mesh( mesh, &grid, depth, flag );
+    t1  = bench_time();
+
+    for( k=0; k<grid.size[2]; k++ ) {
+        double z = grid.org[2] + (k + 0.5)*pitch;
+        for( j=0; j<grid.size[1]; j++ ) {
+            double y = grid.org[1] + (j + 0.5)*pitch;
+            for( i=0; i<grid.size[0]; i++ ) {
+                double x  = grid.org[0] + (i + 0.5)*pitch;
+                int    in = (int)NPT_VOXEL_GET( flag, &grid, i, j, k );
+                double d  = voxel_dist( type, x, y, z );
+                solid += in;
+                if( in != ( d < 0.0 ) ) {
+                    mis++;
+                    if( fabs( d ) > dmax ) dmax = fabs( d );
+                }
+            }
+        }
+    }
+
+    long long ncell = (long long)grid.size[0]*grid.size[1]*grid.size[2];
+    printf( "\n## %s  num_tri=%d  grid=%dx%dx%d (%.3e cells, %.1f MB)\n", type, mesh->num_tri,
+            grid.size[0], grid.size[1], grid.size[2], (double)ncell, nword*sizeof(unsigned int)/1.0e6 );
+    printf( "  ret=%d  volume_err=%.3e  mismatch=%lld (%.2e)  mismatch_dist/h=%.3f  (flat sag/h=%.3f)\n",
+            ret, solid*pitch*pitch*pitch/vol_ex - 1.0, mis, (double)mis/ncell, dmax/pitch,
+            voxel_sag( type, mesh )/pitch );
+    printf( "  time=%.1f ms  %.3e cells/s\n", 1.0e3*( t1 - t0 ), ncell/( t1 - t0 ) );
+    if( ret != 0 ) {
+        printf( "#### ERROR npt_voxel_mesh: ret=%d\n", ret );
+        ng++;
+    }
+
+#ifdef _OPENMP
+    {
+        static const int nth[4] = { 1, 2, 3, 8 };
+        int  max_th = omp_get_max_threads();
+        unsigned int* f2 = (unsigned int*)malloc( nword*sizeof(unsigned int) );
+        if( f2 == NULL ) {
+            free( flag );
+            return ng + 1;
+        }
+        printf( "  threads" );
+        for( i=0; i<4; i++ ) {
+            omp_set_num_threads( nth[i] );
+            npt_voxel_mesh( mesh, &grid, depth, f2 );
+            int same = ( memcmp( f2, flag, nword*sizeof(unsigned int) ) == 0 );
+            printf( "  %d:%s", nth[i], same ? "same" : "DIFFERENT" );
+            if( !same ) ng++;
+        }
+        printf( "\n" );
+        omp_set_num_threads( max_th );
+        free( f2 );
+    }
+#endif
+
+    ng += voxel_cut( type, mesh, &grid, depth, nsub, flag, vol_ex );
+    free( flag );
+    return ng;
+}
+
+
+/// 切断セルの確認
+static int
+voxel_cut( const char* type, NPT_MESH* mesh, const NPT_VOXEL_GRID* grid, int depth, int nsub,
+           const unsigned int* flag, double vol_ex )
+{
+    NPT_VOXEL_CUT cut;
+    double        h = grid->pitch[0], t0, t1;
+    double        vol = 0.0, area = 0.0, area_ex, zf, err_sum = 0.0, err_max = 0.0;
+    int           nw = NPT_VOXEL_ROW_WORDS( grid->size[0] );
+    size_t        nword = (size_t)grid->size[2]*grid->size[1]*nw;
+    int           kf, i, j, k, ret, ng = 0;
+    long long     l;
+
+    unsigned int* band = (unsigned int*)calloc( nword, sizeof(unsigned int) );
+    if( band == NULL ) {
+        printf( "#### ERROR npt_voxel: memory\n" );
+        return 1;
+    }
+
+    t0  = bench_time();
+    ret = npt_voxel_cut( mesh, grid, depth, nsub, &cut );
+    t1  = bench_time();
+
+    // z=0 に最も近い格子面（セル k の下側の面）
+    kf = (int)floor( -grid->org[2]/h + 0.5 );
+    zf = grid->org[2] + kf*h;
+    if( strcmp( type, "torus" ) == 0 ) area_ex = 4.0*PAI*BENCH_TORUS_R*sqrt( BENCH_TORUS_r*BENCH_TORUS_r - zf*zf );
+    else                               area_ex = PAI*( 1.0 - zf*zf );
+
+    // 切断セルの体積率と面の開口率（セル内の 8^3, 面の 8^2 点の数え上げと比較）
+    for( l=0; l<cut.num; l++ ) {
+        int    ci = cut.idx[l][0], cj = cut.idx[l][1], ck = cut.idx[l][2];
+        double x0 = grid->org[0] + ci*h, y0 = grid->org[1] + cj*h, z0 = grid->org[2] + ck*h;
+        int    nin = 0, a, b, c;
+
+        band[ ((size_t)ck*grid->size[1] + cj)*nw + ci/32 ] |= 1u << (ci%32);
+        vol += ( 1.0 - cut.vol[l] )*h*h*h;
+        if( ck == kf ) area += ( 1.0 - cut.area[l][2] )*h*h;
+        for( c=0; c<8; c++ ) for( b=0; b<8; b++ ) for( a=0; a<8; a++ ) {
+            if( voxel_dist( type, x0 + (a + 0.5)*h/8, y0 + (b + 0.5)*h/8, z0 + (c + 0.5)*h/8 ) >= 0.0 ) nin++;
+        }
+        double e = fabs( cut.vol[l] - nin/512.0 );
+        err_sum += e;
+        if( e > err_max ) err_max = e;
+    }
+    for( k=0; k<grid->size[2]; k++ ) {
+        for( j=0; j<grid->size[1]; j++ ) {
+            for( i=0; i<grid->size[0]; i++ ) {
+                if( NPT_VOXEL_GET( band, grid, i, j, k ) ) continue;
+                if( !NPT_VOXEL_GET( flag, grid, i, j, k ) ) continue;
+                vol += h*h*h;
+                if( k == kf ) area += h*h;
+            }
+        }
+    }
+
+    printf( "  cut: ret=%d  cells=%lld  volume_err=%.3e  area_err(z=%.3f)=%.3e  "
+            "vol_frac_err mean=%.3e max=%.3e (8^3 count)\n",
+            ret, cut.num, vol/vol_ex - 1.0, zf, area/area_ex - 1.0,
+            cut.num > 0 ? err_sum/cut.num : 0.0, err_max );
+    printf( "  cut: time=%.1f ms  %.3e cut cells/s\n", 1.0e3*( t1 - t0 ), cut.num/( t1 - t0 ) );
+    if( ret != 0 ) {
+        printf( "#### ERROR npt_voxel_cut: ret=%d\n", ret );
+        ng++;
+    }
+
+#ifdef _OPENMP
+    {
+        static const int nth[4] = { 1, 2, 3, 8 };
+        int  max_th = omp_get_max_threads();
+        printf( "  cut: threads" );
+        for( i=0; i<4; i++ ) {
+            NPT_VOXEL_CUT c2;
+            omp_set_num_threads( nth[i] );
+            npt_voxel_cut( mesh, grid, depth, nsub, &c2 );
+            int same = ( c2.num == cut.num ) && ( cut.num == 0 ||
+                       ( memcmp( c2.idx,  cut.idx,  sizeof(int)*3*cut.num )      == 0 &&
+                         memcmp( c2.vol,  cut.vol,  sizeof(NPT_REAL)*cut.num )   == 0 &&
+                         memcmp( c2.area, cut.area, sizeof(NPT_REAL)*3*cut.num ) == 0 ) );
+            printf( "  %d:%s", nth[i], same ? "same" : "DIFFERENT" );
+            if( !same ) ng++;
+            npt_voxel_cut_free( &c2 );
+        }
+        printf( "\n" );
+        omp_set_num_threads( max_th );
+    }
+#endif
+
+    npt_voxel_cut_free( &cut );
+    free( band );
+    return ng;
+}
@@ -0,0 +1,335 @@
+/*
+ * Npatch - Nagata Patch Library
+ *
+ * Copyright (c) 2015-2016 Advanced Institute for Computational Science, RIKEN.
+ * All rights reserved.
+ *
+ */
+
+////////////////////////////////////////////////////////////////////////////
+///
+/// 長田パッチ 一般化巻き数による点の内外判定（npt_wind_*）の計測
+///
+///   頂点共有の球（緯度経度分割）、トーラスのメッシュについて、包含箱内の乱数の点で
+///       作成時間
+///       解析曲面の内外判定と異なる点の数、曲面からの最大距離（平面三角形の重心と
+///       解析曲面の最大距離との比）
+///       展開を使わない評価（beta=1e30、先頭の点のみ）との一般化巻き数の最大差
+///       時間、点/秒
+///       三角形の一部を除いた（穴のある）曲面での内外判定の結果
+///   を出力する。さらにスレッド数を変えた結果がビット単位で一致することを確認する。
+///
+///   使用法
+///       npt_wind [-n num] [-p points] [-b beta] [-h holes]
+///
+////////////////////////////////////////////////////////////////////////////
+
+#include "bench_mesh.h"
+#include "Npt_Mesh.h"
+#include "Npt_Wind.h"
+
+// 展開を使わない評価の点数
+#define WIND_NUM_REF   200
+
+//------------------------------------------------------------------
+//  プロトタイプ宣言
+//------------------------------------------------------------------
+static int    wind_sphere( int nlat, NPT_MESH* mesh );
+static int    wind_torus( int nv, NPT_MESH* mesh );
+static double wind_dist( const char* type, double x, double y, double z );
+static double wind_sag( const char* type, NPT_MESH* mesh );
+static int    wind_run( const char* type, NPT_MESH* mesh, int npnt, double beta, int hole );
+static void   wind_check( const char* label, const char* type, int npnt, NPT_REAL (*pos)[3],
+                          const unsigned char* inside, double sag, long long* mis, double* dmax );
+
+
+// #################################################################
+//    メイン
+// #################################################################
+
+int
+main( int argc, char** argv )
+{
+    int    num = 8000, npnt = 100000, hole = 100;
+    double beta = 2.0;
+    int    i, ng = 0;
+
+    for( i=1; i<argc; i++ ) {
+        if( strcmp( argv[i], "-n" ) == 0 && i+1 < argc ) num  = atoi( argv[++i] );
+        if( strcmp( argv[i], "-p" ) == 0 && i+1 < argc ) npnt = atoi( argv[++i] );
+        if( strcmp( argv[i], "-b" ) == 0 && i+1 < argc ) beta = atof( argv[++i] );
+        if( strcmp( argv[i], "-h" ) == 0 && i+1 < argc ) hole = atoi( argv[++i] );
+    }
+    if( npnt < WIND_NUM_REF ) npnt = WIND_NUM_REF;
+
+    printf( "#### Npatch wind  real=%s  threads=%d  beta=%g  max_depth=%d\n",
+            sizeof(NPT_REAL) == 8 ? "double" : "float",
+#ifdef _OPENMP
+            omp_get_max_threads(),
+#else
+            1,
+#endif
+            beta, NPT_WIND_MAX_DEPTH );
+
+    for( i=0; i<2; i++ ) {
+        const char* type = ( i == 0 ) ? "sphere" : "torus";
+        NPT_MESH    mesh;
+        int         ret;
+
+        ret = ( i == 0 ) ? wind_sphere( (int)sqrt( num/4.0 ), &mesh ) : wind_torus( (int)sqrt( num/6.0 ), &mesh );
+        if( ret != 0 ) return 1;
+        ng += wind_run( type, &mesh, npnt, beta, hole );
+        free( mesh.vtx ); free( mesh.vtx_norm ); free( mesh.tri );
+    }
+    return ng;
+}
+
+
+// #################################################################
+//    非公開（プライベート）関数
+// #################################################################
+
+/// 頂点共有の単位球（緯度 nlat 分割、経度 2*nlat 分割、極は１頂点）
+static int
+wind_sphere( int nlat, NPT_MESH* mesh )
+{
+    int nlon, nr;
+    int i, j, k, it = 0;
+
+    if( nlat < 3 ) nlat = 3;
+    nlon = 2*nlat;
+    nr   = nlat - 1;
+    mesh->num_vtx  = nr*nlon + 2;
+    mesh->num_tri  = 2*nlon*nr;
+    mesh->vtx      = (NPT_REAL(*)[3])malloc( (size_t)mesh->num_vtx*sizeof(NPT_REAL[3]) );
+    mesh->vtx_norm = (NPT_REAL(*)[3])malloc( (size_t)mesh->num_vtx*sizeof(NPT_REAL[3]) );
+    mesh->tri      = (int(*)[3])malloc( (size_t)mesh->num_tri*sizeof(int[3]) );
+    if( mesh->vtx == NULL || mesh->vtx_norm == NULL || mesh->tri == NULL ) {
+        printf( "#### ERROR npt_wind: memory\n" );
+        return 1;
+    }
+    for( j=0; j<nr; j++ ) {
+        double th = PAI*(j + 1)/nlat;
+        for( i=0; i<nlon; i++ ) {
+            double ph = 2.0*PAI*i/nlon;
+            double p[3] = { sin( th )*cos( ph ), sin( th )*sin( ph ), cos( th ) };
+            for( k=0; k<3; k++ ) mesh->vtx[j*nlon + i][k] = mesh->vtx_norm[j*nlon + i][k] = p[k];
+        }
+    }
+    for( k=0; k<3; k++ ) {
+        mesh->vtx[nr*nlon  ][k] = mesh->vtx_norm[nr*nlon  ][k] = ( k == 2 ) ?  1.0 : 0.0;
+        mesh->vtx[nr*nlon+1][k] = mesh->vtx_norm[nr*nlon+1][k] = ( k == 2 ) ? -1.0 : 0.0;
+    }
+    for( i=0; i<nlon; i++ ) {
+        int i1 = (i+1)%nlon;
+        mesh->tri[it][0] = nr*nlon; mesh->tri[it][1] = i; mesh->tri[it][2] = i1; it++;
+        mesh->tri[it][0] = nr*nlon+1; mesh->tri[it][1] = (nr-1)*nlon + i1; mesh->tri[it][2] = (nr-1)*nlon + i; it++;
+        for( j=0; j+1<nr; j++ ) {
+            int v00 = j*nlon + i, v01 = j*nlon + i1, v10 = (j+1)*nlon + i, v11 = (j+1)*nlon + i1;
+            mesh->tri[it][0] = v00; mesh->tri[it][1] = v10; mesh->tri[it][2] = v11; it++;
+            mesh->tri[it][0] = v00; mesh->tri[it][1] = v11; mesh->tri[it][2] = v01; it++;
+        }
+    }
+    return 0;
+}
+
+
+/// 頂点共有のトーラスのメッシュ（nu=3*nv, 2*nu*nv 三角形）
+static int
+wind_torus( int nv, NPT_MESH* mesh )
+{
+    static const double prm[2] = { BENCH_TORUS_R, BENCH_TORUS_r };
+    int nu;
+    int i, j, k;
+
+    if( nv < 3 ) nv = 3;
+    nu = 3*nv;
+    mesh->num_vtx  = nu*nv;
+    mesh->num_tri  = 2*nu*nv;
+    mesh->vtx      = (NPT_REAL(*)[3])malloc( (size_t)mesh->num_vtx*sizeof(NPT_REAL[3]) );
+    mesh->vtx_norm = (NPT_REAL(*)[3])malloc( (size_t)mesh->num_vtx*sizeof(NPT_REAL[3]) );
+    mesh->tri      = (int(*)[3])malloc( (size_t)mesh->num_tri*sizeof(int[3]) );
+    if( mesh->vtx == NULL || mesh->vtx_norm == NULL || mesh->tri == NULL ) {
+        printf( "#### ERROR npt_wind: memory\n" );
+        return 1;
+    }
+    for( j=0; j<nv; j++ ) {
+        for( i=0; i<nu; i++ ) {
+            double pos[3], norm[3];
+            bench_surf_torus( (double)i/nu, (double)j/nv, prm, pos, norm );
+            for( k=0; k<3; k++ ) {
+                mesh->vtx     [j*nu + i][k] = pos[k];
+                mesh->vtx_norm[j*nu + i][k] = norm[k];
+            }
+        }
+    }
+    for( j=0; j<nv; j++ ) {
+        for( i=0; i<nu; i++ ) {
+            int v00 = j*nu + i,                 v10 = j*nu + (i+1)%nu;
+            int v11 = ((j+1)%nv)*nu + (i+1)%nu, v01 = ((j+1)%nv)*nu + i;
+            int it  = 2*(j*nu + i);
+            mesh->tri[it  ][0] = v00; mesh->tri[it  ][1] = v10; mesh->tri[it  ][2] = v11;
+            mesh->tri[it+1][0] = v00; mesh->tri[it+1][1] = v11; mesh->tri[it+1][2] = v01;
+        }
+    }
+    return 0;
+}
+
+
+/// 解析曲面の符号付き距離（内部で負）
+static double
+wind_dist( const char* type, double x, double y, double z )
+{
+    if( strcmp( type, "torus" ) == 0 ) {
+        double q = sqrt( x*x + y*y ) - BENCH_TORUS_R;
+        return sqrt( q*q + z*z ) - BENCH_TORUS_r;
+    }
+    return sqrt( x*x + y*y + z*z ) - 1.0;
+}
+
+
+/// 平面三角形の重心と解析曲面の最大距離
+static double
+wind_sag( const char* type, NPT_MESH* mesh )
+{
+    double sag = 0.0;
+    int    i, k;
+
+    for( i=0; i<mesh->num_tri; i++ ) {
+        double c[3] = { 0.0, 0.0, 0.0 };
+        for( k=0; k<3; k++ ) {
+            c[0] += mesh->vtx[ mesh->tri[i][k] ][0]/3.0;
+            c[1] += mesh->vtx[ mesh->tri[i][k] ][1]/3.0;
+            c[2] += mesh->vtx[ mesh->tri[i][k] ][2]/3.0;
+        }
+        double d = fabs( wind_dist( type, c[0], c[1], c[2] ) );
+        if( d > sag ) sag = d;
+    }
+    return sag;
+}
+
+
+/// 内外判定の結果と解析曲面の比較
+static void
+wind_check( const char* label, const char* type, int npnt, NPT_REAL (*pos)[3],
+            const unsigned char* inside, double sag, long long* mis, double* dmax )
+{
+    int i;
+
+    *mis  = 0;
+    *dmax = 0.0;
+    for( i=0; i<npnt; i++ ) {
+        double d = wind_dist( type, pos[i][0], pos[i][1], pos[i][2] );
+        if( inside[i] != ( d < 0.0 ) ) {
+            (*mis)++;
+            if( fabs( d ) > *dmax ) *dmax = fabs( d );
+        }
+    }
+    printf( "  %-6s mismatch=%lld (%.2e)  mismatch_dist/sag=%.3f\n",
+            label, *mis, (double)*mis/npnt, *dmax/sag );
+}
+
+
+/// 内外判定と結果の確認
+static int
+wind_run( const char* type, NPT_MESH* mesh, int npnt, double beta, int hole )
+{
+    NPT_WIND       wind;
+    double         ext[3], sag, t0, t1, t2, t3, dmax, wmax = 0.0;
+    long long      mis;
+    uint64_t       seed = 12345;
+    int            i, k, ret, ng = 0;
+
+    if( strcmp( type, "torus" ) == 0 ) {
+        ext[0] = ext[1] = BENCH_TORUS_R + BENCH_TORUS_r; ext[2] = BENCH_TORUS_r;
+    }
+    else {
+        ext[0] = ext[1] = ext[2] = 1.0;
+    }
+    NPT_REAL (*pos)[3]    = (NPT_REAL(*)[3])malloc( (size_t)npnt*sizeof(NPT_REAL[3]) );
+    NPT_REAL* wn          = (NPT_REAL*)malloc( (size_t)npnt*sizeof(NPT_REAL) );
+    NPT_REAL* wn_ref      = (NPT_REAL*)malloc( WIND_NUM_REF*sizeof(NPT_REAL) );
+    unsigned char* inside = (unsigned char*)malloc( (size_t)npnt );
+    unsigned char* in2    = (unsigned char*)malloc( (size_t)npnt );
+    if( pos == NULL || wn == NULL || wn_ref == NULL || inside == NULL || in2 == NULL ) {
+        printf( "#### ERROR npt_wind: memory\n" );
+        return 1;
+    }
+    for( i=0; i<npnt; i++ ) {
+        for( k=0; k<3; k++ ) pos[i][k] = ext[k]*1.2*( 2.0*bench_rand( &seed ) - 1.0 );
+    }
+    sag = wind_sag( type, mesh );
+
+    t0  = bench_time();
+    ret = npt_wind_crt( mesh, &wind );
+    t1  = bench_time();
+    if( ret != 0 ) {
+        printf( "#### ERROR npt_wind_crt: ret=%d\n", ret );
+        return 1;
+    }
+    npt_wind_inside_n( &wind, npnt, pos, beta, inside );
+    t2  = bench_time();
+    npt_wind_eval_n( &wind, WIND_NUM_REF, pos, 1.0e30, wn_ref );
+    t3  = bench_time();
+    npt_wind_eval_n( &wind, WIND_NUM_REF, pos, beta, wn );
+    for( i=0; i<WIND_NUM_REF; i++ ) {
+        if( fabs( wn[i] - wn_ref[i] ) > wmax ) wmax = fabs( wn[i] - wn_ref[i] );
+    }
+
+    printf( "\n## %s  num_tri=%d  points=%d  bvh nodes=%d  flat sag=%.3e\n", type, mesh->num_tri, npnt,
+            wind.bvh.num_node, sag );
+    printf( "  crt    time=%.1f ms\n", 1.0e3*( t1 - t0 ) );
+    wind_check( "closed", type, npnt, pos, inside, sag, &mis, &dmax );
+    printf( "  eval   time=%.1f ms  %.3e points/s  (no expansion: %.3e points/s, max |w-w_exact|=%.3e)\n",
+            1.0e3*( t2 - t1 ), npnt/( t2 - t1 ), WIND_NUM_REF/( t3 - t2 ), wmax );
+    if( dmax > sag ) ng++;
+
+#ifdef _OPENMP
+    {
+        static const int nth[4] = { 1, 2, 3, 8 };
+        int  max_th = omp_get_max_threads();
+        printf( "  threads" );
+        for( i=0; i<4; i++ ) {
+            omp_set_num_threads( nth[i] );
+            npt_wind_inside_n( &wind, npnt, pos, beta, in2 );
+            int same = ( memcmp( in2, inside, npnt ) == 0 );
+            printf( "  %d:%s", nth[i], same ? "same" : "DIFFERENT" );
+            if( !same ) ng++;
+        }
+        printf( "\n" );
+        omp_set_num_threads( max_th );
+    }
+#endif
+    npt_wind_free( &wind );
+
+    // 穴のある曲面（hole 個ごとに三角形を１つ除く）
+    if( hole > 0 ) {
+        NPT_MESH mh = *mesh;
+        int      nh = 0;
+
+        mh.tri = (int(*)[3])malloc( (size_t)mesh->num_tri*sizeof(int[3]) );
+        if( mh.tri == NULL ) {
+            printf( "#### ERROR npt_wind: memory\n" );
+            return ng + 1;
+        }
+        mh.num_tri = 0;
+        for( i=0; i<mesh->num_tri; i++ ) {
+            if( i%hole == hole/2 ) {
+                nh++;
+                continue;
+            }
+            for( k=0; k<3; k++ ) mh.tri[mh.num_tri][k] = mesh->tri[i][k];
+            mh.num_tri++;
+        }
+        if( npt_wind_crt( &mh, &wind ) == 0 ) {
+            npt_wind_inside_n( &wind, npnt, pos, beta, in2 );
+            printf( "  holes: %d triangles removed\n", nh );
+            wind_check( "holes", type, npnt, pos, in2, sag, &mis, &dmax );
+            npt_wind_free( &wind );
+        }
+        free( mh.tri );
+    }
+
+    free( pos ); free( wn ); free( wn_ref ); free( inside ); free( in2 );
+    return ng;
+}
@@ -0,0 +1,23 @@
+#!/bin/bash
+#
+# Npatch - Nagata Patch Library
+#
+# Copyright (c) 2015-2016 Advanced Institute for Computational Science, RIKEN.
+# All rights reserved.
+#
+#
+# Run all npt_accuracy_* programs (precision x NPT_ALW_V) with the same options
+# and write one JSON file per configuration.
+#
+#   usage: run_accuracy.sh <build_dir/Benchmark> <output_dir> [npt_accuracy options]
+#
+
+BIN_DIR=${1:-.}
+OUT_DIR=${2:-.}
+shift 2
+
+mkdir -p ${OUT_DIR}
+for prog in ${BIN_DIR}/npt_accuracy_*; do
+    name=`basename ${prog}`
+    ${prog} "$@" -o ${OUT_DIR}/${name}.json || exit 1
+done
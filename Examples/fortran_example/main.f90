@@ -17,6 +17,8 @@
 !///     ・長田パッチの生成
 !///     ・三角形の各辺の中点の長田パッチ上の曲面補間点を求める
 !///     ・三角形の頂点と上記の曲面補間点より、三角形数を４倍としたデータを生成する
+!///     ・複数パッチ版（fnpt_param_crt_n, fnpt_correct_pnt_n）の結果を上記と比較する
+!///       （tri(3,3,n), npatch(3,7,n) の配列をそのまま渡す）
 !///   - 当サンプルは頂点の法線ベクトルを求めるのに単純にループさせているが
 !///     三角形数が多い場合には処理時間がかかるようになるので注意
 !///
@@ -155,6 +157,13 @@ program main
     real(NPT_REAL_PN) :: p12(3), p23(3),p31(3)
     real(NPT_REAL_PN) :: tri_4      (3,3,4*NMAX)  ! 長田パッチ補間により４倍したポリゴン
     real(NPT_REAL_PN) :: plane_norm4(3,4*NMAX)    ! ４倍したポリゴンの法線ベクトル
+    real(NPT_REAL_PN) :: npatch_n  (3,7,NMAX)  ! 長田パッチパラメータ（複数パッチ版）
+    real(NPT_REAL_PN) :: eta_n(NMAX), xi_n(NMAX)  ! η、ξパラメータ（複数点版）
+    real(NPT_REAL_PN) :: pos_n(3,NMAX)         ! 曲面補間点（複数点版）
+    real(NPT_REAL_PN) :: pos_1(3)              ! 曲面補間点（１点版）
+    real(NPT_REAL_PN) :: eta_m(3), xi_m(3)     ! 各辺の中点のη、ξパラメータ
+    real(NPT_REAL_PN) :: err_max
+    integer :: k
 
     character(64) :: file_name_stl_in   ='stl_in.stl'
     character(64) :: file_name_stl4_out ='stl4_out.stl'
@@ -294,7 +303,7 @@ program main
                   npatch(1,5,i), npatch(1,6,i), npatch(1,7,i),  &
                   iret &
                 )
-       if( iret .ne. 1 ) then
+       if( iret .ne. 0 ) then
            write(*,'("#### Error npt_param_crt() ret=",i3," i=",i9)') iret,i
            stop 1;
        endif
@@ -303,6 +312,55 @@ program main
     ! 確認のため長田パッチファイルに出力
     call output_npt_file( file_name_npt_out, num_tri, tri, npatch )
 
+    ! 複数パッチ版の長田パッチ変換（１パッチ版と一致すること）
+    call fnpt_param_crt_n( num_tri, tri, vtx_norm, npatch_n, iret )
+    if( iret .ne. 0 ) then
+        write(*,'("#### Error npt_param_crt_n() ret=",i9)') iret
+        stop 1;
+    endif
+    err_max = 0.0
+    do i=1, num_tri
+        do j=1, 7
+            do k=1, 3
+                err_max = max( err_max, abs( npatch_n(k,j,i)-npatch(k,j,i) ) )
+            enddo
+        enddo
+    enddo
+    write(*,'("---- npt_param_crt_n   max diff=",e12.4)') err_max
+    if( err_max > 1.0e-5*100.0 ) then
+        write(*,'("#### Error npt_param_crt_n() differs from npt_param_crt()")')
+        stop 1;
+    endif
+
+    ! 複数点版の曲面補間（各辺の中点、１点版と一致すること）
+    eta_m(1)=0.5; xi_m(1)=0.0
+    eta_m(2)=1.0; xi_m(2)=0.5
+    eta_m(3)=0.5; xi_m(3)=0.5
+    err_max = 0.0
+    do j=1, 3
+        do i=1, num_tri
+            eta_n(i)=eta_m(j); xi_n(i)=xi_m(j)
+        enddo
+        call fnpt_correct_pnt_n( num_tri, eta_n, xi_n, tri, npatch_n, pos_n )
+        do i=1, num_tri
+            call fnpt_correct_pnt( &
+                    eta_m(j), xi_m(j),  &
+                    tri(1,1,i), tri(1,2,i), tri(1,3,i),  &
+                    npatch(1,1,i), npatch(1,2,i), npatch(1,3,i), npatch(1,4,i), &
+                    npatch(1,5,i), npatch(1,6,i), npatch(1,7,i),  &
+                    pos_1 &
+                 )
+            do k=1, 3
+                err_max = max( err_max, abs( pos_n(k,i)-pos_1(k) ) )
+            enddo
+        enddo
+    enddo
+    write(*,'("---- npt_correct_pnt_n max diff=",e12.4)') err_max
+    if( err_max > 1.0e-5*100.0 ) then
+        write(*,'("#### Error npt_correct_pnt_n() differs from npt_correct_pnt()")')
+        stop 1;
+    endif
+
 #if 0
     ! eta,xi取得テスト
     !    三角形１の辺１の中点
@@ -665,28 +665,13 @@ Calc_3dTransAxisPntn(
         GEO_REAL pntno[][3]
     )
 {
-    GEO_REAL  change_mat[4][4];       /* 変換マトリクス   */
-    int     loop_cnt;               /* 座標変換カウンタ */
-    GEO_REAL  src_point[4];           /* 変換前座標       */
-    GEO_REAL  dsp_point[4];           /* 変換後座標       */
+    GEO_REAL  change_mat[4][3];       /* 変換マトリクス（アフィン） */
 
     /* ワールド --> ローカル変換マトリクス */
-    Calc_3dMat4TranAxis( orig, x_axis, y_axis, z_axis, change_mat );
+    Calc_3dMat43TranAxis( orig, x_axis, y_axis, z_axis, change_mat );
 
     /* 点列座標の変換 */
-    for ( loop_cnt = 0; loop_cnt < n; loop_cnt++ ) {
-        src_point[0] = pntni[loop_cnt][0];
-        src_point[1] = pntni[loop_cnt][1];
-        src_point[2] = pntni[loop_cnt][2];
-        src_point[3] = 1.0;
-
-        Calc_3dMat4Multi14( src_point, change_mat, dsp_point );
-
-        /* 変換後の座標セーブ */
-        pntno[loop_cnt][0] = dsp_point[0];
-        pntno[loop_cnt][1] = dsp_point[1];
-        pntno[loop_cnt][2] = dsp_point[2];
-    }
+    Calc_3dMat43Pntn( change_mat, n, pntni, pntno );
 }
 
 
@@ -713,28 +698,13 @@ Calc_3dTransAxisPntnInv(
         GEO_REAL pntno[][3]
     )
 {
-    GEO_REAL  change_mat[4][4];       /* 変換マトリクス   */
-    int       loop_cnt;               /* 座標変換カウンタ */
-    GEO_REAL  src_point[4];           /* 変換前座標       */
-    GEO_REAL  dsp_point[4];           /* 変換後座標       */
+    GEO_REAL  change_mat[4][3];       /* 変換マトリクス（アフィン） */
 
     /* ローカル --> ワールド変換マトリクス */
-    Calc_3dMat4TranAxisInv( orig, x_axis, y_axis, z_axis, change_mat );
+    Calc_3dMat43TranAxisInv( orig, x_axis, y_axis, z_axis, change_mat );
 
     /* 点列座標の変換 */
-    for ( loop_cnt = 0; loop_cnt < n; loop_cnt++ ) {
-        src_point[0] = pntni[loop_cnt][0];
-        src_point[1] = pntni[loop_cnt][1];
-        src_point[2] = pntni[loop_cnt][2];
-        src_point[3] = 1.0;
-
-        Calc_3dMat4Multi14( src_point, change_mat, dsp_point );
-
-        /* 変換後の座標セーブ */
-        pntno[loop_cnt][0] = dsp_point[0];
-        pntno[loop_cnt][1] = dsp_point[1];
-        pntno[loop_cnt][2] = dsp_point[2];
-    }
+    Calc_3dMat43Pntn( change_mat, n, pntni, pntno );
 }
 
 #ifdef __cplusplus
@@ -321,6 +321,231 @@ Calc_3dMat4Rot2(
     matA[3][3] = 1.0;
 }
 
+
+////////////////////////////////////////////////////////////////////////////
+///
+/// アフィン変換マトリクス（４×３）
+///   ４×４変換マトリクス（行ベクトル系）の第４列 (0,0,0,1) を省いたもの。
+///   matA[0-2] が回転（３×３）、matA[3] が平行移動となり、点 p の変換は
+///       p' = p[0]*matA[0] + p[1]*matA[1] + p[2]*matA[2] + matA[3]
+///   とする。同次座標 w=1 の４×１への詰め替えと第４列の演算を省くため、
+///   点の変換は乗算 9、加算 9（４×４は乗算 16、加算 12）となる。
+///   演算順は４×４版（Calc_3dMat4Multi14 等）と同じため、結果はビット単位で一致する。
+///
+////////////////////////////////////////////////////////////////////////////
+
+///
+/// 点とアフィン変換マトリクスの積を求める
+///
+/// @param [in]   pnt    点座標
+/// @param [in]   matA   アフィン変換マトリクス（４×３）
+/// @param [out]  pnto   変換後の点座標（pnt と同一領域も可）
+/// @return 終了コード   なし
+///
+INLINE void
+Calc_3dMat43Multi13(
+            GEO_REAL pnt[3],      // [in]  点座標
+            GEO_REAL matA[4][3],  // [in]  アフィン変換マトリクス
+            GEO_REAL pnto[3]      // [out] 変換後の点座標
+        )
+{
+    int      l_cnt_b;   /* 演算カウンタ  matA   */
+    GEO_REAL x = pnt[0], y = pnt[1], z = pnt[2];
+
+    for ( l_cnt_b = 0; l_cnt_b < 3; l_cnt_b++ ) {
+        pnto[l_cnt_b] = ( x * matA[0][l_cnt_b] +
+                          y * matA[1][l_cnt_b] +
+                          z * matA[2][l_cnt_b] +
+                              matA[3][l_cnt_b] );
+    }
+}
+
+
+///
+/// 方向ベクトルとアフィン変換マトリクスの積を求める（回転のみ、平行移動なし）
+///
+/// @param [in]   vec    方向ベクトル
+/// @param [in]   matA   アフィン変換マトリクス（４×３）
+/// @param [out]  veco   変換後の方向ベクトル（vec と同一領域も可）
+/// @return 終了コード   なし
+///
+INLINE void
+Calc_3dMat43Vec13(
+            GEO_REAL vec[3],      // [in]  方向ベクトル
+            GEO_REAL matA[4][3],  // [in]  アフィン変換マトリクス
+            GEO_REAL veco[3]      // [out] 変換後の方向ベクトル
+        )
+{
+    int      l_cnt_b;   /* 演算カウンタ  matA   */
+    GEO_REAL x = vec[0], y = vec[1], z = vec[2];
+
+    for ( l_cnt_b = 0; l_cnt_b < 3; l_cnt_b++ ) {
+        veco[l_cnt_b] = ( x * matA[0][l_cnt_b] +
+                          y * matA[1][l_cnt_b] +
+                          z * matA[2][l_cnt_b] );
+    }
+}
+
+
+///
+/// アフィン変換マトリクスの積を求める（matA の変換の後に matB の変換を行うマトリクス）
+///
+/// @param [in]   matA   アフィン変換マトリクス Ａ
+/// @param [in]   matB   アフィン変換マトリクス Ｂ
+/// @param [out]  matC   アフィン変換マトリクス Ｃ (演算結果）
+/// @return 終了コード   なし
+///
+INLINE void
+Calc_3dMat43Multi43(
+        GEO_REAL matA[4][3],
+        GEO_REAL matB[4][3],
+        GEO_REAL matC[4][3]
+     )
+{
+    int l_cnt_a;        /* 演算カウンタ  matA   */
+    int l_cnt_b;        /* 演算カウンタ  matB   */
+
+    for ( l_cnt_a = 0; l_cnt_a < 3; l_cnt_a++ ) {
+        for ( l_cnt_b = 0; l_cnt_b < 3; l_cnt_b++ ) {
+            matC[l_cnt_a][l_cnt_b] = ( matA[l_cnt_a][0] * matB[0][l_cnt_b] +
+                                       matA[l_cnt_a][1] * matB[1][l_cnt_b] +
+                                       matA[l_cnt_a][2] * matB[2][l_cnt_b] );
+        }
+    }
+    Calc_3dMat43Multi13( matA[3], matB, matC[3] );
+}
+
+
+///
+/// 任意座標軸設定用アフィン変換マトリクスを求める
+///        （ワールド --> ローカル座標変換、Calc_3dMat4TranAxis() の４×３版)
+///
+/// @param [in]   orig      新座標軸の原点となる点
+/// @param [in]   x_axis    新座標系のX軸となるベクトル
+/// @param [in]   y_axis    新座標系のY軸となるベクトル
+/// @param [in]   z_axis    新座標系のZ軸となるベクトル
+/// @param [out]  matA      アフィン変換マトリクス（行ベクトル系）
+/// @return 終了コード   なし
+///
+INLINE void
+Calc_3dMat43TranAxis(
+        GEO_REAL orig[3],
+        GEO_REAL x_axis[3],
+        GEO_REAL y_axis[3],
+        GEO_REAL z_axis[3],
+        GEO_REAL matA[4][3]
+     )
+{
+    matA[0][0] = x_axis[0];
+    matA[1][0] = x_axis[1];
+    matA[2][0] = x_axis[2];
+    matA[3][0] = -( x_axis[0]*orig[0] + x_axis[1]*orig[1] + x_axis[2]*orig[2] );
+
+    matA[0][1] = y_axis[0];
+    matA[1][1] = y_axis[1];
+    matA[2][1] = y_axis[2];
+    matA[3][1] = -( y_axis[0]*orig[0] + y_axis[1]*orig[1] + y_axis[2]*orig[2] );
+
+    matA[0][2] = z_axis[0];
+    matA[1][2] = z_axis[1];
+    matA[2][2] = z_axis[2];
+    matA[3][2] = -( z_axis[0]*orig[0] + z_axis[1]*orig[1] + z_axis[2]*orig[2] );
+}
+
+
+///
+/// 任意座標軸設定用アフィン変換マトリクスを求める
+///        （ローカル --> ワールド座標変換、Calc_3dMat4TranAxisInv() の４×３版)
+///   回転部分は座標軸を行とするマトリクス、平行移動は原点となる
+///
+/// @param [in]   orig      任意座標軸の原点となる点（ワールド座標系で指定）
+/// @param [in]   x_axis    任意座標系のX軸となるベクトル（ワールド座標系で指定）
+/// @param [in]   y_axis    任意座標系のY軸となるベクトル（ワールド座標系で指定）
+/// @param [in]   z_axis    任意座標系のZ軸となるベクトル（ワールド座標系で指定）
+/// @param [out]  matA      アフィン変換マトリクス（行ベクトル系）
+/// @return 終了コード   なし
+///
+INLINE void
+Calc_3dMat43TranAxisInv(
+        GEO_REAL orig[3],
+        GEO_REAL x_axis[3],
+        GEO_REAL y_axis[3],
+        GEO_REAL z_axis[3],
+        GEO_REAL matA[4][3]
+     )
+{
+    int l_cnt;
+
+    for ( l_cnt = 0; l_cnt < 3; l_cnt++ ) {
+        matA[0][l_cnt] = x_axis[l_cnt];
+        matA[1][l_cnt] = y_axis[l_cnt];
+        matA[2][l_cnt] = z_axis[l_cnt];
+        matA[3][l_cnt] = orig  [l_cnt];
+    }
+}
+
+
+///
+/// 点列座標のアフィン変換（AoS）
+///
+/// @param [in]   matA      アフィン変換マトリクス
+/// @param [in]   n         点列座標数
+/// @param [in]   pnti      点列座標
+/// @param [out]  pnto      変換後の点列座標（pnti と同一領域も可）
+/// @return 終了コード   なし
+///
+INLINE void
+Calc_3dMat43Pntn(
+        GEO_REAL matA[4][3],
+        int      n,
+        GEO_REAL pnti[][3],
+        GEO_REAL pnto[][3]
+     )
+{
+    int loop_cnt;
+
+    for ( loop_cnt = 0; loop_cnt < n; loop_cnt++ ) {
+        Calc_3dMat43Multi13( pnti[loop_cnt], matA, pnto[loop_cnt] );
+    }
+}
+
+
+///
+/// 点列座標のアフィン変換（SoA）
+///   座標成分ごとの配列のため、ループはベクトル化される
+///
+/// @param [in]   matA      アフィン変換マトリクス
+/// @param [in]   n         点列座標数
+/// @param [in]   xi,yi,zi  点列座標（x,y,z 成分） [n]
+/// @param [out]  xo,yo,zo  変換後の点列座標（x,y,z 成分） [n]（入力と同一領域も可）
+/// @return 終了コード   なし
+///
+INLINE void
+Calc_3dMat43PntnSoA(
+        GEO_REAL        matA[4][3],
+        int             n,
+        const GEO_REAL* xi,
+        const GEO_REAL* yi,
+        const GEO_REAL* zi,
+        GEO_REAL*       xo,
+        GEO_REAL*       yo,
+        GEO_REAL*       zo
+     )
+{
+    int      loop_cnt;
+    GEO_REAL m00 = matA[0][0], m01 = matA[0][1], m02 = matA[0][2];
+    GEO_REAL m10 = matA[1][0], m11 = matA[1][1], m12 = matA[1][2];
+    GEO_REAL m20 = matA[2][0], m21 = matA[2][1], m22 = matA[2][2];
+    GEO_REAL m30 = matA[3][0], m31 = matA[3][1], m32 = matA[3][2];
+
+    for ( loop_cnt = 0; loop_cnt < n; loop_cnt++ ) {
+        GEO_REAL x = xi[loop_cnt], y = yi[loop_cnt], z = zi[loop_cnt];
+        xo[loop_cnt] = x*m00 + y*m10 + z*m20 + m30;
+        yo[loop_cnt] = x*m01 + y*m11 + z*m21 + m31;
+        zo[loop_cnt] = x*m02 + y*m12 + z*m22 + m32;
+    }
+}
+
 #ifdef __cplusplus
 } // extern "C" or extern
 #else
@@ -0,0 +1,535 @@
+#ifndef _CALC_GEO_PACKET_H_
+#define _CALC_GEO_PACKET_H_
+
+/*
+ * Npatch - Nagata Patch Library
+ *
+ * Copyright (c) 2015-2016 Advanced Institute for Computational Science, RIKEN.
+ * All rights reserved.
+ *
+ */
+
+////////////////////////////////////////////////////////////////////////////
+///
+/// 幾何演算系 パケット版
+///
+///   GEO_PACK_W 個のベクトルを成分ごとの配列（SoA）にまとめたパケット単位に、
+///   CalcGeo.h の関数と同じ演算を行う。レーンごとの演算順序は１ベクトル版と同じとし、
+///   結果はレーンごとに１ベクトル版とビット単位で一致する（FMA の縮約 -ffp-contract が
+///   同じとなる場合。異なる場合は丸め誤差の範囲で異なる）。
+///   レーンのループは分岐のない選択のみとし、コンパイラの自動ベクトル化を前提とする。
+///   許容誤差（double の定数）との比較は、同じ判定となる GEO_REAL の閾値に置き換えて
+///   レーンの型を揃える。sqrt、除算を含むループのベクトル化には -fno-math-errno
+///   -fno-trapping-math が必要（GCC。指定しない場合も結果は同じ）。x86 の SSE2 のみでは
+///   一部のループ（CalcIntersectionLineP、倍精度の sqrt を含むループ）はベクトル化されない
+///   （AVX2 以降で全てのループをベクトル化する）。
+///
+///   １ベクトル版の bool の戻り値は、レーンごとのビット（bit l がレーン l）の
+///   マスク GEO_PACK_MASK とする。失敗したレーンの出力は 0 とする
+///   （１ベクトル版は出力を変更しない場合がある）。
+///
+/** パケットのレーン数の指定
+ * - デフォルトでは、GEO_PACK_W=8
+ * - コンパイル時オプション-DGEO_PACK_W=4, 16 で変更する
+ */
+////////////////////////////////////////////////////////////////////////////
+
+#include "CalcGeo.h"
+
+#ifndef GEO_PACK_W
+#define GEO_PACK_W  8
+#endif
+
+#if GEO_PACK_W != 4 && GEO_PACK_W != 8 && GEO_PACK_W != 16
+#error "GEO_PACK_W must be 4, 8 or 16"
+#endif
+
+/// 全てのレーンのマスク
+#define GEO_PACK_ALL   ( (GEO_PACK_MASK)( (1u << GEO_PACK_W) - 1u ) )
+
+#ifdef __cplusplus
+extern "C" {  // for C++
+#else
+#endif
+
+///
+/// レーンのマスク（bit l がレーン l）
+///
+typedef unsigned int GEO_PACK_MASK;
+
+///
+/// ベクトルのパケット（SoA）
+///
+typedef struct {
+    GEO_REAL    x[GEO_PACK_W];   ///< x 成分
+    GEO_REAL    y[GEO_PACK_W];   ///< y 成分
+    GEO_REAL    z[GEO_PACK_W];   ///< z 成分
+} GEO_PACK_VEC;
+
+
+//====================================================================
+
+///
+/// レーンの成否からマスクを作成する
+/// @param [in]   ok      レーンの成否（0:失敗）
+/// @return マスク
+///
+INLINE GEO_PACK_MASK
+CalcPackMask(
+       const int   ok[GEO_PACK_W]   // [in]  レーンの成否
+     )
+{
+    GEO_PACK_MASK mask = 0;
+    int           l;
+
+    for( l=0; l<GEO_PACK_W; l++ ) mask |= (GEO_PACK_MASK)( ok[l] != 0 ) << l;
+    return mask;
+}
+
+
+///
+/// 許容誤差の閾値（a > alw と (double)a > alw が同じ判定となる GEO_REAL の値）
+/// @param [in]   alw     許容誤差
+/// @return 閾値（alw 以下の最大の GEO_REAL の値）
+///
+INLINE GEO_REAL
+CalcPackAlwGT(
+       double    alw      // [in]  許容誤差
+     )
+{
+    GEO_REAL t = (GEO_REAL)alw;
+#ifndef _REAL_IS_DOUBLE_
+    if( (double)t > alw ) t = nextafterf( t, 0.0f );
+#endif
+    return t;
+}
+
+
+///
+/// 許容誤差の閾値（a < alw と (double)a < alw が同じ判定となる GEO_REAL の値）
+/// @param [in]   alw     許容誤差
+/// @return 閾値（alw 以上の最小の GEO_REAL の値）
+///
+INLINE GEO_REAL
+CalcPackAlwLT(
+       double    alw      // [in]  許容誤差
+     )
+{
+    GEO_REAL t = (GEO_REAL)alw;
+#ifndef _REAL_IS_DOUBLE_
+    if( (double)t < alw ) t = nextafterf( t, 1.0f );
+#endif
+    return t;
+}
+
+
+///
+/// ベクトル列をパケットに詰める
+///           n < GEO_PACK_W の場合、残りのレーンは 0 とする
+/// @param [in]   n       ベクトル数（0～GEO_PACK_W）
+/// @param [in]   vec     ベクトル列
+/// @param [out]  pk      パケット
+/// @return 有効なレーンのマスク
+///
+INLINE GEO_PACK_MASK
+CalcPackLoad(
+       int             n,          // [in]  ベクトル数
+       GEO_REAL        vec[][3],   // [in]  ベクトル列
+       GEO_PACK_VEC*   pk          // [out] パケット
+     )
+{
+    int l;
+
+    for( l=0; l<GEO_PACK_W; l++ ) {
+        pk->x[l] = ( l < n ) ? vec[l][0] : (GEO_REAL)0.0;
+        pk->y[l] = ( l < n ) ? vec[l][1] : (GEO_REAL)0.0;
+        pk->z[l] = ( l < n ) ? vec[l][2] : (GEO_REAL)0.0;
+    }
+    return ( n >= GEO_PACK_W ) ? GEO_PACK_ALL : (GEO_PACK_MASK)( (1u << n) - 1u );
+}
+
+
+///
+/// パケットをベクトル列に取り出す
+/// @param [in]   pk      パケット
+/// @param [in]   n       ベクトル数（0～GEO_PACK_W）
+/// @param [out]  vec     ベクトル列
+/// @return なし
+///
+INLINE void
+CalcPackStore(
+       const GEO_PACK_VEC*  pk,         // [in]  パケット
+       int                  n,          // [in]  ベクトル数
+       GEO_REAL             vec[][3]    // [out] ベクトル列
+     )
+{
+    int l;
+
+    for( l=0; l<n && l<GEO_PACK_W; l++ ) {
+        vec[l][0] = pk->x[l];
+        vec[l][1] = pk->y[l];
+        vec[l][2] = pk->z[l];
+    }
+}
+
+
+///
+/// 線分のベクトル作成（パケット版 CalcVec）
+/// @param [in]   pp      始点
+/// @param [in]   lp      終点
+/// @param [out]  vec     ベクトル  （単位ベクトルではない）
+/// @return なし
+///
+INLINE void
+CalcVecP(
+       const GEO_PACK_VEC*  pp,      // [in]  始点
+       const GEO_PACK_VEC*  lp,      // [in]  終点
+       GEO_PACK_VEC*        vec      // [out] ベクトル
+     )
+{
+    int l;
+
+    for( l=0; l<GEO_PACK_W; l++ ) {
+        vec->x[l] = lp->x[l] - pp->x[l];
+        vec->y[l] = lp->y[l] - pp->y[l];
+        vec->z[l] = lp->z[l] - pp->z[l];
+    }
+}
+
+
+///
+/// ベクトルのサイズ（パケット版 CalcVecSize）
+/// @param [in]   vec     ベクトル
+/// @param [out]  size    ベクトルのサイズ（長さ）
+/// @return なし
+///
+INLINE void
+CalcVecSizeP(
+       const GEO_PACK_VEC*  vec,              // [in]  ベクトル
+       GEO_REAL             size[GEO_PACK_W]  // [out] ベクトルのサイズ
+     )
+{
+    int l;
+
+    for( l=0; l<GEO_PACK_W; l++ ) {
+        size[l] = sqrt ( vec->x[l]*vec->x[l] + vec->y[l]*vec->y[l] + vec->z[l]*vec->z[l] );
+    }
+}
+
+
+///
+/// ベクトルの内積（パケット版 CalcInProduct）
+/// @param [in]   vec1     ベクトル１
+/// @param [in]   vec2     ベクトル２
+/// @param [out]  prod     内積値
+/// @return なし
+///
+INLINE void
+CalcInProductP(
+       const GEO_PACK_VEC*  vec1,              // [in]  ベクトル１
+       const GEO_PACK_VEC*  vec2,              // [in]  ベクトル２
+       GEO_REAL             prod[GEO_PACK_W]   // [out] 内積値
+   )
+{
+    int l;
+
+    for( l=0; l<GEO_PACK_W; l++ ) {
+        prod[l] = ( vec1->x[l]*vec2->x[l] + vec1->y[l]*vec2->y[l] + vec1->z[l]*vec2->z[l] );
+    }
+}
+
+
+///
+/// ベクトルの外積（パケット版 CalcOutProduct）
+/// @param [in]   vec1     ベクトル１
+/// @param [in]   vec2     ベクトル２
+/// @param [out]  vec_o    外積ベクトル（vec1, vec2 と別の領域）
+/// @return なし
+///
+INLINE void
+CalcOutProductP(
+       const GEO_PACK_VEC*  vec1,    // [in]  ベクトル１
+       const GEO_PACK_VEC*  vec2,    // [in]  ベクトル２
+       GEO_PACK_VEC*        vec_o    // [out] 外積ベクトル
+   )
+{
+    int l;
+
+    for( l=0; l<GEO_PACK_W; l++ ) {
+        vec_o->x[l] = vec1->y[l] * vec2->z[l] - vec1->z[l] * vec2->y[l];
+        vec_o->y[l] = vec1->z[l] * vec2->x[l] - vec1->x[l] * vec2->z[l];
+        vec_o->z[l] = vec1->x[l] * vec2->y[l] - vec1->y[l] * vec2->x[l];
+    }
+}
+
+
+///
+/// ベクトルを正規化する（パケット版 CalcNormalize2）
+/// @param [in]   vec      ベクトル  (長さ任意）
+/// @param [out]  vec_o    ベクトル  (長さ1、失敗したレーンは 0）
+/// @return 成功したレーンのマスク（失敗：同一点）
+///
+INLINE GEO_PACK_MASK
+CalcNormalize2P(
+       const GEO_PACK_VEC*  vec,      // [in]  ベクトル  (長さ任意）
+       GEO_PACK_VEC*        vec_o     // [out] ベクトル  (長さ1）
+     )
+{
+    GEO_REAL alw = CalcPackAlwGT( GEO_ALW_L );
+    int      ok[GEO_PACK_W];
+    int      l;
+
+    for( l=0; l<GEO_PACK_W; l++ ) {
+        GEO_REAL len = sqrt ( vec->x[l]*vec->x[l] + vec->y[l]*vec->y[l] + vec->z[l]*vec->z[l] );
+        int      c   = ( len > alw );
+        GEO_REAL div = c ? len : (GEO_REAL)1.0;
+        GEO_REAL qx  = vec->x[l] / div;
+        GEO_REAL qy  = vec->y[l] / div;
+        GEO_REAL qz  = vec->z[l] / div;
+        vec_o->x[l] = c ? qx : (GEO_REAL)0.0;
+        vec_o->y[l] = c ? qy : (GEO_REAL)0.0;
+        vec_o->z[l] = c ? qz : (GEO_REAL)0.0;
+        ok[l] = c;
+    }
+    return CalcPackMask( ok );
+}
+
+
+///
+/// 線分のベクトルと長さ取得（パケット版 CalcLineVec）
+/// @param [in]   pp       始点
+/// @param [in]   lp       終点
+/// @param [out]  vec      単位ベクトル（失敗したレーンは 0）
+/// @param [out]  length   長さ（失敗したレーンは 0）
+/// @return 成功したレーンのマスク（失敗：同一点）
+///
+INLINE GEO_PACK_MASK
+CalcLineVecP(
+       const GEO_PACK_VEC*  pp,                  // [in]  始点
+       const GEO_PACK_VEC*  lp,                  // [in]  終点
+       GEO_PACK_VEC*        vec,                 // [out] ベクトル
+       GEO_REAL             length[GEO_PACK_W]   // [out] 長さ
+     )
+{
+    GEO_REAL alw = CalcPackAlwGT( GEO_ALW_L );
+    int      ok[GEO_PACK_W];
+    int      l;
+
+    for( l=0; l<GEO_PACK_W; l++ ) {
+        GEO_REAL vx = lp->x[l] - pp->x[l];
+        GEO_REAL vy = lp->y[l] - pp->y[l];
+        GEO_REAL vz = lp->z[l] - pp->z[l];
+        GEO_REAL len = sqrt ( vx*vx + vy*vy + vz*vz );
+        int      c   = ( len > alw );
+        GEO_REAL div = c ? len : (GEO_REAL)1.0;
+        GEO_REAL qx  = vx / div;
+        GEO_REAL qy  = vy / div;
+        GEO_REAL qz  = vz / div;
+        vec->x[l]  = c ? qx : (GEO_REAL)0.0;
+        vec->y[l]  = c ? qy : (GEO_REAL)0.0;
+        vec->z[l]  = c ? qz : (GEO_REAL)0.0;
+        length[l]  = c ? len : (GEO_REAL)0.0;
+        ok[l] = c;
+    }
+    return CalcPackMask( ok );
+}
+
+
+///
+/// ２平面の交線（無限線分）取得（パケット版 CalcIntersectionLine）
+/// @param [in]  vec1        平面１の法線ベクトル(正規化済）
+/// @param [in]  d1          平面１の原点からの距離
+/// @param [in]  vec2        平面２の法線ベクトル(正規化済）
+/// @param [in]  d2          平面２の原点からの距離
+/// @param [out] pos         面の交線の通過点（原点からの最短距離、失敗したレーンは 0）
+/// @param [out] vec         面の交線のベクトル（失敗したレーンは 0）
+/// @return 成功したレーンのマスク（失敗：２平面が並行など）
+///
+INLINE GEO_PACK_MASK
+CalcIntersectionLineP(
+       const GEO_PACK_VEC*  vec1,              // [in]  平面1  法線ベクトル(単位ベクトル）
+       const GEO_REAL       d1[GEO_PACK_W],    // [in]
+       const GEO_PACK_VEC*  vec2,              // [in]  平面2  法線ベクトル(単位ベクトル）
+       const GEO_REAL       d2[GEO_PACK_W],    // [in]
+       GEO_PACK_VEC*        pos,               // [out] 面の交線の通過点
+       GEO_PACK_VEC*        vec                // [out] 面の交線のベクトル
+   )
+{
+    GEO_REAL alw = CalcPackAlwLT( GEO_ALW_V );
+    int      ok[GEO_PACK_W];
+    int      l;
+
+    for( l=0; l<GEO_PACK_W; l++ ) {
+        GEO_REAL a1 = vec1->x[l], b1 = vec1->y[l], c1 = vec1->z[l];
+        GEO_REAL a2 = vec2->x[l], b2 = vec2->y[l], c2 = vec2->z[l];
+        GEO_REAL a3, b3, c3, len, lenv, d3 = 0.0;
+        GEO_REAL b_c, a_c, a_b, size_det, d_c, d_b, a_d, detinv, px, py, pz;
+        int      c;
+
+        // 交線のベクトル
+        a3  = b1 * c2 - c1 * b2;
+        b3  = c1 * a2 - a1 * c2;
+        c3  = a1 * b2 - b1 * a2;
+        len = sqrt ( a3*a3 + b3*b3 + c3*c3 );
+        c    = !( len < alw );
+        lenv = c ? len : (GEO_REAL)1.0;
+        a3 /= lenv;
+        b3 /= lenv;
+        c3 /= lenv;
+
+        // 3平面の交点（原点を通る交線に垂直な面 d3=0 と平面１、２）
+        b_c = b2*c3 - b3*c2;
+        a_c = a2*c3 - a3*c2;
+        a_b = a2*b3 - a3*b2;
+
+        size_det = a1*b_c - b1*a_c + c1*a_b;
+        c = c & !( fabs( size_det ) < alw );
+
+        d_c = d3*c2 - d2[l]*c3;
+        d_b = d3*b2 - d2[l]*b3;
+        a_d = a3*d2[l] - a2*d3;
+        detinv = (GEO_REAL)1.0/( c ? size_det : (GEO_REAL)1.0 );
+
+        px = (b1*d_c + d1[l]*b_c - c1*d_b )*detinv;
+        py = (-d1[l]*a_c - a1*d_c - c1*a_d )*detinv;
+        pz = (b1*a_d + a1*d_b + d1[l]*a_b )*detinv;
+
+        pos->x[l] = c ? px : (GEO_REAL)0.0;
+        pos->y[l] = c ? py : (GEO_REAL)0.0;
+        pos->z[l] = c ? pz : (GEO_REAL)0.0;
+        vec->x[l] = c ? a3 : (GEO_REAL)0.0;
+        vec->y[l] = c ? b3 : (GEO_REAL)0.0;
+        vec->z[l] = c ? c3 : (GEO_REAL)0.0;
+        ok[l] = c;
+    }
+    return CalcPackMask( ok );
+}
+
+
+///
+/// 点から線分上に垂線を下した点を求める（パケット版 CalcNearPosOnLine）
+/// @param [in]   pnt       点座標
+/// @param [in]   pos       線分の通過点
+/// @param [in]   vec       線分の方向ベクトル（単位ベクトル）
+/// @param [out]  pos_x     点から線分に下した垂線との交点
+/// @return なし
+///
+INLINE void
+CalcNearPosOnLineP(
+       const GEO_PACK_VEC*  pnt,     // [in]  点座標
+       const GEO_PACK_VEC*  pos,     // [in]  線分の通過点
+       const GEO_PACK_VEC*  vec,     // [in]  線分の方向ベクトル（単位ベクトル）
+       GEO_PACK_VEC*        pos_x    // [out] 点から線分に下した垂線との交点
+   )
+{
+    int l;
+
+    for( l=0; l<GEO_PACK_W; l++ ) {
+        GEO_REAL wx = pnt->x[l] - pos->x[l];
+        GEO_REAL wy = pnt->y[l] - pos->y[l];
+        GEO_REAL wz = pnt->z[l] - pos->z[l];
+        GEO_REAL dist_wk = ( vec->x[l]*wx + vec->y[l]*wy + vec->z[l]*wz );
+
+        pos_x->x[l] = pos->x[l] + vec->x[l]*dist_wk;
+        pos_x->y[l] = pos->y[l] + vec->y[l]*dist_wk;
+        pos_x->z[l] = pos->z[l] + vec->z[l]*dist_wk;
+    }
+}
+
+
+///
+/// ２線分の最近点（パケット版 CalcCrossPointLine）
+/// @param [in]   pp1       線分１始点
+/// @param [in]   lp1       線分１終点
+/// @param [in]   pp2       線分２始点
+/// @param [in]   lp2       線分２終点
+/// @param [out]  pos_x1    線分１上の最近点（失敗したレーンは 0）
+/// @param [out]  pos_x2    線分２上の最近点（失敗したレーンは 0）
+/// @return 成功したレーンのマスク（失敗：同一点、２線分が並行）
+///
+INLINE GEO_PACK_MASK
+CalcCrossPointLineP(
+       const GEO_PACK_VEC*  pp1,       // [in]  線分１始点
+       const GEO_PACK_VEC*  lp1,       // [in]  線分１終点
+       const GEO_PACK_VEC*  pp2,       // [in]  線分２始点
+       const GEO_PACK_VEC*  lp2,       // [in]  線分２終点
+       GEO_PACK_VEC*        pos_x1,    // [out] 線分１上の最近点
+       GEO_PACK_VEC*        pos_x2     // [out] 線分２上の最近点
+      )
+{
+    GEO_REAL alw_l = CalcPackAlwGT( GEO_ALW_L );
+    GEO_REAL alw_v = CalcPackAlwLT( GEO_ALW_V );
+    int      ok[GEO_PACK_W];
+    int      l;
+
+    for( l=0; l<GEO_PACK_W; l++ ) {
+        GEO_REAL v1x = lp1->x[l] - pp1->x[l], v1y = lp1->y[l] - pp1->y[l], v1z = lp1->z[l] - pp1->z[l];
+        GEO_REAL v2x = lp2->x[l] - pp2->x[l], v2y = lp2->y[l] - pp2->y[l], v2z = lp2->z[l] - pp2->z[l];
+        GEO_REAL len1 = sqrt ( v1x*v1x + v1y*v1y + v1z*v1z );
+        GEO_REAL len2 = sqrt ( v2x*v2x + v2y*v2y + v2z*v2z );
+        int      c    = ( len1 > alw_l ) & ( len2 > alw_l );
+        GEO_REAL div1 = c ? len1 : (GEO_REAL)1.0;
+        GEO_REAL div2 = c ? len2 : (GEO_REAL)1.0;
+        GEO_REAL u1x = v1x / div1, u1y = v1y / div1, u1z = v1z / div1;
+        GEO_REAL u2x = v2x / div2, u2y = v2y / div2, u2z = v2z / div2;
+        GEO_REAL wk1 = ( u1x*u2x + u1y*u2y + u1z*u2z );
+        GEO_REAL wk2 = 1.0 - wk1*wk1;
+        GEO_REAL px  = pp2->x[l] - pp1->x[l];
+        GEO_REAL py  = pp2->y[l] - pp1->y[l];
+        GEO_REAL pz  = pp2->z[l] - pp1->z[l];
+        GEO_REAL p1  = ( px*u1x + py*u1y + pz*u1z );
+        GEO_REAL p2  = ( px*u2x + py*u2y + pz*u2z );
+        GEO_REAL div, d1, d2;
+
+        c   = c & !( wk2 < alw_v );
+        div = c ? wk2 : (GEO_REAL)1.0;
+        d1  = (     p1 - wk1*p2 ) / div;
+        d2  = ( wk1*p1 -     p2 ) / div;
+
+        pos_x1->x[l] = c ? pp1->x[l] + d1*u1x : (GEO_REAL)0.0;
+        pos_x1->y[l] = c ? pp1->y[l] + d1*u1y : (GEO_REAL)0.0;
+        pos_x1->z[l] = c ? pp1->z[l] + d1*u1z : (GEO_REAL)0.0;
+        pos_x2->x[l] = c ? pp2->x[l] + d2*u2x : (GEO_REAL)0.0;
+        pos_x2->y[l] = c ? pp2->y[l] + d2*u2y : (GEO_REAL)0.0;
+        pos_x2->z[l] = c ? pp2->z[l] + d2*u2z : (GEO_REAL)0.0;
+        ok[l] = c;
+    }
+    return CalcPackMask( ok );
+}
+
+
+///
+/// ベクトルのミラー（パケット版 CalcVecMirror）
+/// @param [in]   rot_vec   回転軸のベクトル
+/// @param [in]   veci      入力ベクトル
+/// @param [out]  veco      線対称にミラーしたベクトル
+/// @return なし
+///
+INLINE void
+CalcVecMirrorP(
+       const GEO_PACK_VEC*  rot_vec,   // [in]  回転軸のベクトル
+       const GEO_PACK_VEC*  veci,      // [in]  入力ベクトル
+       GEO_PACK_VEC*        veco       // [out] 線対称にミラーしたベクトル
+      )
+{
+    int l;
+
+    for( l=0; l<GEO_PACK_W; l++ ) {
+        GEO_REAL dist_wk = ( rot_vec->x[l]*veci->x[l] + rot_vec->y[l]*veci->y[l] + rot_vec->z[l]*veci->z[l] );
+        GEO_REAL px = rot_vec->x[l]*dist_wk;
+        GEO_REAL py = rot_vec->y[l]*dist_wk;
+        GEO_REAL pz = rot_vec->z[l]*dist_wk;
+
+        veco->x[l] = px + ( px - veci->x[l] );
+        veco->y[l] = py + ( py - veci->y[l] );
+        veco->z[l] = pz + ( pz - veci->z[l] );
+    }
+}
+
+#ifdef __cplusplus
+} // extern "C" or extern
+#else
+#endif
+
+
+#endif // _CALC_GEO_PACKET_H_
@@ -270,6 +270,170 @@ fnpt_move_vertex_ (
         NPT_REAL  cp_center_n [3]
     );
 
+////////////////////////////////////////////////////////////////////////////
+///
+/// 長田パッチ 複数パッチ一括処理 関数
+///   Fortranの配列 tri(3,3,n), tri_norm(3,3,n), npatch(3,7,n),
+///   pos(3,n), eta(n), xi(n) をそのまま受け取る。
+///   三角形単位の呼び出しに比べ、呼び出しのオーバーヘッドがなく、
+///   OpenMPが有効な場合はライブラリ内部でスレッド並列に処理する。
+///
+////////////////////////////////////////////////////////////////////////////
+
+///
+/// 長田パッチパラメータ生成（複数パッチ）
+///
+/// @param [in]    num          三角形数
+/// @param [in]    tri          三角形の頂点座標 tri(3,3,num)
+/// @param [in]    tri_norm     三角形の頂点法線ベクトル（単位ベクトル） tri_norm(3,3,num)
+/// @param [out]   npatch       長田パッチパラメータ npatch(3,7,num)
+/// @param [out]   ret          リターンコード   =0 正常  !=0 異常（異常となった三角形数）
+/// @return 戻り値なし
+///
+void
+fnpt_param_crt_n_ (
+        int*      num,
+        NPT_REAL  tri     [][3][3],
+        NPT_REAL  tri_norm[][3][3],
+        NPT_REAL  npatch  [][7][3],
+        int*      ret
+   );
+
+
+///
+/// 長田パッチパラメータ更新（複数パッチ、フレーム間の再利用）
+///    npt_param_update_n() を参照
+///
+/// @param [in]    num          三角形数
+/// @param [in]    tri          三角形の頂点座標 tri(3,3,num)
+/// @param [in]    tri_norm     三角形の頂点法線ベクトル（単位ベクトル） tri_norm(3,3,num)
+/// @param [in]    tol          許容差（頂点座標は三角形の最大辺長との比、法線ベクトルは差の長さ）
+/// @param [inout] tri_ref      基準の三角形の頂点座標 tri_ref(3,3,num)
+/// @param [inout] tri_norm_ref 基準の三角形の頂点法線ベクトル tri_norm_ref(3,3,num)
+/// @param [inout] npatch       長田パッチパラメータ npatch(3,7,num)
+/// @param [out]   num_state    区分（維持、剛体移動、再生成）ごとの三角形数 num_state(3)
+/// @param [out]   ret          リターンコード   =0 正常  !=0 異常（再生成で異常となった三角形数）
+/// @return 戻り値なし
+///
+void
+fnpt_param_update_n_ (
+        int*      num,
+        NPT_REAL  tri         [][3][3],
+        NPT_REAL  tri_norm    [][3][3],
+        NPT_REAL* tol,
+        NPT_REAL  tri_ref     [][3][3],
+        NPT_REAL  tri_norm_ref[][3][3],
+        NPT_REAL  npatch      [][7][3],
+        int*      num_state,
+        int*      ret
+   );
+
+
+///
+/// 長田パッチ η、ξパラメータ取得（複数点）
+///    点iは三角形iの平面上の点とする
+///
+/// @param [in]    num          点数（三角形数）
+/// @param [in]    pos          入力点座標 pos(3,num)
+/// @param [in]    tri          三角形の頂点座標 tri(3,3,num)
+/// @param [out]   eta          ηパラメータ eta(num)
+/// @param [out]   xi           ξパラメータ xi(num)
+/// @return なし
+///
+void
+fnpt_cvt_pos_to_eta_xi_n_ (
+        int*      num,
+        NPT_REAL  pos[][3],
+        NPT_REAL  tri[][3][3],
+        NPT_REAL* eta,
+        NPT_REAL* xi
+     );
+
+
+///
+/// 長田パッチ 近似曲面補正（複数点）
+///    点iは三角形iの (eta(i), xi(i)) とする
+///
+/// @param [in]    num          点数（三角形数）
+/// @param [in]    eta          ηパラメータ eta(num)
+/// @param [in]    xi           ξパラメータ xi(num)
+/// @param [in]    tri          三角形の頂点座標 tri(3,3,num)
+/// @param [in]    npatch       長田パッチパラメータ npatch(3,7,num)
+/// @param [out]   pos_o        出力点座標（曲面補正後の点） pos_o(3,num)
+/// @return なし
+///
+void
+fnpt_correct_pnt_n_ (
+        int*      num,
+        NPT_REAL* eta,
+        NPT_REAL* xi,
+        NPT_REAL  tri   [][3][3],
+        NPT_REAL  npatch[][7][3],
+        NPT_REAL  pos_o [][3]
+    );
+
+
+///
+/// 長田パッチ 近似曲面補正（複数点）
+///    点iは三角形iの平面上の点とする
+///
+/// @param [in]    num          点数（三角形数）
+/// @param [in]    pos          入力点座標 pos(3,num)
+/// @param [in]    tri          三角形の頂点座標 tri(3,3,num)
+/// @param [in]    npatch       長田パッチパラメータ npatch(3,7,num)
+/// @param [out]   pos_o        出力点座標（曲面補正後の点） pos_o(3,num)
+/// @return なし
+///
+void
+fnpt_correct_pnt2_n_ (
+        int*      num,
+        NPT_REAL  pos   [][3],
+        NPT_REAL  tri   [][3][3],
+        NPT_REAL  npatch[][7][3],
+        NPT_REAL  pos_o [][3]
+    );
+
+
+///
+/// 長田パッチ 頂点移動に伴う長田パッチパラメータ更新（複数パッチ）
+///
+/// @param [in]    num          三角形数
+/// @param [in]    tri          三角形の頂点座標 tri(3,3,num)
+/// @param [in]    npatch       長田パッチパラメータ npatch(3,7,num)
+/// @param [in]    tri_n        移動後 三角形の頂点座標 tri_n(3,3,num)
+/// @param [out]   npatch_n     移動後 長田パッチパラメータ npatch_n(3,7,num)
+/// @return なし
+///
+void
+fnpt_move_vertex_n_ (
+        int*      num,
+        NPT_REAL  tri     [][3][3],
+        NPT_REAL  npatch  [][7][3],
+        NPT_REAL  tri_n   [][3][3],
+        NPT_REAL  npatch_n[][7][3]
+    );
+
+
+///
+/// 長田パッチ １-４分割（複数パッチ）
+///
+/// @param [in]    num          三角形数
+/// @param [in]    tri          三角形の頂点座標 tri(3,3,num)
+/// @param [in]    npatch       長田パッチパラメータ npatch(3,7,num)
+/// @param [out]   tri_o        子パッチの頂点座標 tri_o(3,3,4*num)
+/// @param [out]   npatch_o     子パッチの長田パッチパラメータ npatch_o(3,7,4*num)
+/// @return なし
+///
+void
+fnpt_subdiv_n_ (
+        int*      num,
+        NPT_REAL  tri     [][3][3],
+        NPT_REAL  npatch  [][7][3],
+        NPT_REAL  tri_o   [][3][3],
+        NPT_REAL  npatch_o[][7][3]
+    );
+
+
 #ifdef __cplusplus
 } // extern "C" or extern
 #else
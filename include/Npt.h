@@ -106,6 +106,225 @@ npt_param_crt(
         NPT_REAL  cp_center [3]
    );
 
+////////////////////////////////////////////////////////////////////////////
+///
+/// 長田パッチ 複数パッチ一括処理 関数（インライン展開なし）
+///   配列は三角形iについて tri[i][0-2]（頂点1-3）、tri_norm[i][0-2]（頂点1-3の法線）、
+///   npatch[i][0-6]（cp_side1_1, cp_side1_2, cp_side2_1, cp_side2_2,
+///   cp_side3_1, cp_side3_2, cp_center）の順とする。
+///   OpenMPが有効な場合は三角形単位でスレッド並列に処理する。
+///
+////////////////////////////////////////////////////////////////////////////
+
+/// 長田パッチパラメータ生成（複数パッチ）
+///
+/// @param [in]    num          三角形数
+/// @param [in]    tri          三角形の頂点座標 [num]
+/// @param [in]    tri_norm     三角形の頂点法線ベクトル（単位ベクトル） [num]
+/// @param [out]   npatch       長田パッチパラメータ [num]
+/// @return リターンコード   =0 正常  !=0 異常（異常となった三角形数）
+int
+npt_param_crt_n(
+        int       num,
+        NPT_REAL  tri     [][3][3],
+        NPT_REAL  tri_norm[][3][3],
+        NPT_REAL  npatch  [][7][3]
+   );
+
+/// フレーム間の長田パッチパラメータ更新の区分
+#define NPT_UPDATE_KEEP   0   ///< 制御点をそのまま使用
+#define NPT_UPDATE_MOVE   1   ///< 制御点を剛体移動（npt_move_vertex_mat() の変換）
+#define NPT_UPDATE_CRT    2   ///< 制御点を再生成（npt_param_crt()）
+#define NPT_UPDATE_NUM    3
+
+/// 長田パッチパラメータ更新（複数パッチ、フレーム間の再利用）
+///    頂点座標、頂点法線ベクトルが少しずつ変化する場合に、前フレームの長田パッチパラメータを
+///    三角形ごとに次のいずれかで更新する。判定は制御点を求めた時点の三角形（基準）との差で行い、
+///    L を三角形の最大辺長として頂点座標の差 tol*L 以下、法線ベクトルの差 tol 以下を一致とする。
+///        NPT_UPDATE_KEEP : 基準と一致する                    → 制御点をそのまま使う
+///        NPT_UPDATE_MOVE : 基準を剛体移動したものと一致する  → 制御点を同じ変換で移動する
+///        NPT_UPDATE_CRT  : それ以外                          → npt_param_crt() で再生成する
+///    長田パッチパラメータは剛体移動に対して不変であるため、剛体運動する部分は再生成せずに済む。
+///    基準は MOVE、CRT の三角形のみ更新し（MOVE は基準を移動したもの）、KEEP の三角形は変えないため、
+///    フレームごとの変化が蓄積しても、制御点に対応する三角形と現在の三角形の差は常に許容差以下となる。
+///    tol=0 の場合、KEEP となるのは基準とビット単位で一致する三角形のみであり、
+///    結果は npt_param_crt_n() と一致する（MOVE の丸め誤差を除く）。
+///
+/// @param [in]    num          三角形数
+/// @param [in]    tri          三角形の頂点座標 [num]
+/// @param [in]    tri_norm     三角形の頂点法線ベクトル（単位ベクトル） [num]
+/// @param [in]    tol          許容差（頂点座標は三角形の最大辺長との比、法線ベクトルは差の長さ）
+///                             <0 の場合はすべて再生成する
+/// @param [inout] tri_ref      基準の三角形の頂点座標 [num]
+/// @param [inout] tri_norm_ref 基準の三角形の頂点法線ベクトル [num]
+/// @param [inout] npatch       長田パッチパラメータ（入力：基準に対するもの  出力：更新後） [num]
+/// @param [out]   num_state    区分ごとの三角形数 [NPT_UPDATE_NUM]（NULL 可）
+/// @return リターンコード   =0 正常  !=0 異常（再生成で異常となった三角形数）
+/// @attention
+///     初回は npt_param_crt_n() で生成し、tri, tri_norm を tri_ref, tri_norm_ref に複写しておくこと
+int
+npt_param_update_n(
+        int       num,
+        NPT_REAL  tri         [][3][3],
+        NPT_REAL  tri_norm    [][3][3],
+        NPT_REAL  tol,
+        NPT_REAL  tri_ref     [][3][3],
+        NPT_REAL  tri_norm_ref[][3][3],
+        NPT_REAL  npatch      [][7][3],
+        int*      num_state
+   );
+
+/// 長田パッチ η、ξパラメータ取得（複数点）
+///    点iは三角形iの平面上の点とする
+///
+/// @param [in]    num          点数（三角形数）
+/// @param [in]    pos          入力点座標 [num]
+/// @param [in]    tri          三角形の頂点座標 [num]
+/// @param [out]   eta          ηパラメータ [num]
+/// @param [out]   xi           ξパラメータ [num]
+/// @return なし
+void
+npt_cvt_pos_to_eta_xi_n(
+        int       num,
+        NPT_REAL  pos[][3],
+        NPT_REAL  tri[][3][3],
+        NPT_REAL* eta,
+        NPT_REAL* xi
+   );
+
+/// 長田パッチ 近似曲面補正（複数点）
+///    点iは三角形iの (eta[i], xi[i]) とする
+///
+/// @param [in]    num          点数（三角形数）
+/// @param [in]    eta          ηパラメータ [num]
+/// @param [in]    xi           ξパラメータ [num]
+/// @param [in]    tri          三角形の頂点座標 [num]
+/// @param [in]    npatch       長田パッチパラメータ [num]
+/// @param [out]   pos_o        出力点座標（曲面補正後の点） [num]
+/// @return なし
+void
+npt_correct_pnt_n(
+        int       num,
+        NPT_REAL* eta,
+        NPT_REAL* xi,
+        NPT_REAL  tri   [][3][3],
+        NPT_REAL  npatch[][7][3],
+        NPT_REAL  pos_o [][3]
+   );
+
+/// 長田パッチ 近似曲面補正（複数点）
+///    点iは三角形iの平面上の点とする
+///
+/// @param [in]    num          点数（三角形数）
+/// @param [in]    pos          入力点座標 [num]
+/// @param [in]    tri          三角形の頂点座標 [num]
+/// @param [in]    npatch       長田パッチパラメータ [num]
+/// @param [out]   pos_o        出力点座標（曲面補正後の点） [num]
+/// @return なし
+void
+npt_correct_pnt2_n(
+        int       num,
+        NPT_REAL  pos   [][3],
+        NPT_REAL  tri   [][3][3],
+        NPT_REAL  npatch[][7][3],
+        NPT_REAL  pos_o [][3]
+   );
+
+/// 長田パッチ 頂点移動に伴う長田パッチパラメータ更新（複数パッチ）
+///
+/// @param [in]    num          三角形数
+/// @param [in]    tri          三角形の頂点座標 [num]
+/// @param [in]    npatch       長田パッチパラメータ [num]
+/// @param [in]    tri_n        移動後 三角形の頂点座標 [num]
+/// @param [out]   npatch_n     移動後 長田パッチパラメータ [num]
+/// @return なし
+void
+npt_move_vertex_n(
+        int       num,
+        NPT_REAL  tri     [][3][3],
+        NPT_REAL  npatch  [][7][3],
+        NPT_REAL  tri_n   [][3][3],
+        NPT_REAL  npatch_n[][7][3]
+   );
+
+/// 長田パッチ １-４分割（複数パッチ）
+///    パッチを辺の中点で４つの子パッチに分割する。子パッチの制御点は３次三角形ベジェの
+///    de Casteljau 分割（中点の平均の繰り返し 40回/パッチ）で求めるため、子パッチは
+///    親パッチと同一の曲面を表し、分割を繰り返しても曲面は変化しない。
+///    三角形iの子パッチ 4i+c の頂点（親パッチの頂点 P1,P2,P3 と辺の中点 M12,M23,M31 の曲面上の点）と
+///    子パッチの (eta',xi') に対応する親パッチの (eta,xi)
+///        c=0 : P1,  M12, M31   (eta,xi) = ( eta'/2,            xi'/2     )
+///        c=1 : M12, P2,  M23   (eta,xi) = ( (1+eta')/2,        xi'/2     )
+///        c=2 : M31, M23, P3    (eta,xi) = ( (1+eta')/2,        (1+xi')/2 )
+///        c=3 : M12, M23, M31   (eta,xi) = ( (1+eta'-xi')/2,    eta'/2    )
+///    親パッチの辺上の子パッチの制御点はその辺の制御点の平均のみで求めるため、
+///    辺を共有する２つのパッチ（共有辺の制御点が一致するもの）を分割した場合、
+///    共有辺上の子パッチの頂点と制御点はビット単位で一致する。
+///
+/// @param [in]    num          三角形数
+/// @param [in]    tri          三角形の頂点座標 [num]
+/// @param [in]    npatch       長田パッチパラメータ [num]
+/// @param [out]   tri_o        子パッチの頂点座標 [4*num]
+/// @param [out]   npatch_o     子パッチの長田パッチパラメータ [4*num]
+/// @return なし
+/// @attention tri_o, npatch_o は tri, npatch と異なる領域とすること
+void
+npt_subdiv_n(
+        int       num,
+        NPT_REAL  tri     [][3][3],
+        NPT_REAL  npatch  [][7][3],
+        NPT_REAL  tri_o   [][3][3],
+        NPT_REAL  npatch_o[][7][3]
+   );
+
+/// 長田パッチ １-４分割
+///    npt_subdiv_n() の１パッチ分（子パッチの頂点、パラメータの対応は npt_subdiv_n() を参照）
+///
+/// @param [in]    tri          三角形の頂点座標（tri[0-2] 頂点1-3）
+/// @param [in]    npatch       長田パッチパラメータ（cp_side1_1-cp_center の順）
+/// @param [out]   tri_o        子パッチの頂点座標 [4]
+/// @param [out]   npatch_o     子パッチの長田パッチパラメータ [4]
+/// @return なし
+void
+npt_subdiv(
+        NPT_REAL  tri     [3][3],
+        NPT_REAL  npatch  [7][3],
+        NPT_REAL  tri_o   [4][3][3],
+        NPT_REAL  npatch_o[4][7][3]
+   );
+
+/// 複数パッチ一括処理の命令セット
+///    npt_cvt_pos_to_eta_xi_n(), npt_correct_pnt_n(), npt_correct_pnt2_n(),
+///    npt_move_vertex_n() は命令セット別の実装を持ち（GCC/Clang、x86 の場合）、
+///    初回の呼び出し時に実行中の CPU が対応する最上位の命令セットを選択する。
+///    環境変数 NPT_SIMD（generic, avx2, avx512 または 0-2）で上限を指定できる（試験用）。
+///    範囲外の数値は 0-2 に丸め、不正な文字列は警告を出力して汎用実装とする。
+///    FMA は使用しないため、いずれの命令セットでも結果はビット単位で一致する。
+#define NPT_SIMD_GENERIC  0   ///< 汎用（コンパイル時の命令セット）
+#define NPT_SIMD_AVX2     1   ///< AVX2
+#define NPT_SIMD_AVX512   2   ///< AVX-512F
+
+/// 複数パッチ一括処理の命令セット取得
+///
+/// @return 選択中の命令セット（NPT_SIMD_GENERIC, NPT_SIMD_AVX2, NPT_SIMD_AVX512）
+int
+npt_simd_get( void );
+
+/// 複数パッチ一括処理の命令セット指定
+///
+/// @param [in]    level        命令セット（NPT_SIMD_GENERIC, NPT_SIMD_AVX2, NPT_SIMD_AVX512）
+/// @return リターンコード   =0 正常  =1 CPU（またはコンパイラ）が未対応（選択は変更しない）
+/// @attention 一括処理の実行中に呼び出さないこと
+int
+npt_simd_set( int level );
+
+/// 命令セット名称
+///
+/// @param [in]    level        命令セット
+/// @return 名称（"generic", "avx2", "avx512"、範囲外の場合は "unknown"）
+const char*
+npt_simd_name( int level );
+
 
 ////////////////////////////////////////////////////////////////////////////
 ///
@@ -354,6 +573,70 @@ npt_correct_pnt2(
 
 
 
+///
+/// 長田パッチ 頂点移動の変換マトリクス
+///    移動前の三角形の局所座標系（p1 原点、x軸 p1->p2、z軸 三角形の法線）を
+///    移動後の三角形の局所座標系に重ねるアフィン変換（剛体運動）を求める。
+///    npt_move_vertex() は制御点をこのマトリクスで変換する
+///
+/// @param [in]    p1           長田パッチ 頂点１座標
+/// @param [in]    p2           長田パッチ 頂点２座標
+/// @param [in]    p3           長田パッチ 頂点３座標
+/// @param [in]    p1_n         長田パッチ 移動後 頂点１座標
+/// @param [in]    p2_n         長田パッチ 移動後 頂点２座標
+/// @param [in]    p3_n         長田パッチ 移動後 頂点３座標
+/// @param [out]   change_mat_all 変換マトリクス（アフィン ４×３）
+/// @return なし
+///
+INLINE void
+npt_move_vertex_mat(
+        NPT_REAL    p1[3],
+        NPT_REAL    p2[3],
+        NPT_REAL    p3[3],
+        NPT_REAL    p1_n[3],
+        NPT_REAL    p2_n[3],
+        NPT_REAL    p3_n[3],
+        NPT_REAL    change_mat_all[4][3]
+    )
+{
+    NPT_REAL len12, vec13[3];
+    NPT_REAL x_axis[3], y_axis[3], z_axis[3];
+    NPT_REAL x_axis_n[3], y_axis_n[3], z_axis_n[3];
+
+    // ローカル座標軸方向の決定
+    //  x_axis
+    CalcLineVec( p1, p2, x_axis, &len12 );
+    //  z_axis
+    CalcVec( p1, p3, vec13 );
+    CalcOutProduct( x_axis, vec13, z_axis );
+    CalcNormalize( z_axis );
+    //  y_axis
+    CalcOutProduct( z_axis, x_axis, y_axis );
+
+    // 移動後のワールド座標軸方向の決定
+    //  x_axis
+    CalcLineVec( p1_n, p2_n, x_axis_n, &len12 );
+    //  z_axis
+    CalcVec( p1_n, p3_n, vec13 );
+    CalcOutProduct( x_axis_n, vec13, z_axis_n );
+    CalcNormalize( z_axis_n );
+    //  y_axis
+    CalcOutProduct( z_axis_n, x_axis_n, y_axis_n );
+
+    NPT_REAL  change_mat[4][3];       // 変換マトリクス（アフィン）
+    NPT_REAL  change_mat_n[4][3];     // 変換マトリクス（アフィン）
+
+    // ワールド --> ローカル変換マトリクス
+    Calc_3dMat43TranAxis( p1, x_axis, y_axis, z_axis, change_mat );
+
+    // ローカル --> ワールド変換マトリクス
+    Calc_3dMat43TranAxisInv( p1_n, x_axis_n, y_axis_n, z_axis_n, change_mat_n );
+
+    // 最終変換マトリクス
+    Calc_3dMat43Multi43( change_mat, change_mat_n, change_mat_all );
+}
+
+
 ///
 /// 長田パッチ 頂点移動に伴う長田パッチパラメータ更新
 ///     長田パッチパラメータの実体は制御点である。
@@ -407,70 +690,31 @@ npt_move_vertex(
         NPT_REAL    cp_center_n [3]
     )
 {
-    NPT_REAL len12, vec13[3];
-    NPT_REAL x_axis[3], y_axis[3], z_axis[3];
-    NPT_REAL x_axis_n[3], y_axis_n[3], z_axis_n[3];
-    int      i;
-
-    // ローカル座標軸方向の決定
-    //  x_axis
-    CalcLineVec( p1, p2, x_axis, &len12 );
-    //  z_axis
-    CalcVec( p1, p3, vec13 );
-    CalcOutProduct( x_axis, vec13, z_axis );
-    CalcNormalize( z_axis );
-    //  y_axis
-    CalcOutProduct( z_axis, x_axis, y_axis );
-
-    // 移動後のワールド座標軸方向の決定
-    //  x_axis
-    CalcLineVec( p1_n, p2_n, x_axis_n, &len12 );
-    //  z_axis
-    CalcVec( p1_n, p3_n, vec13 );
-    CalcOutProduct( x_axis_n, vec13, z_axis_n );
-    CalcNormalize( z_axis_n );
-    //  y_axis
-    CalcOutProduct( z_axis_n, x_axis_n, y_axis_n );
+    NPT_REAL  change_mat_all[4][3];   // 最終変換マトリクス（アフィン）
 
-    NPT_REAL  change_mat[4][4];       // 変換マトリクス
-    NPT_REAL  change_mat_n[4][4];     // 変換マトリクス
-    NPT_REAL  change_mat_all[4][4];   // 最終変換マトリクス
+    // 変換マトリクス
+    npt_move_vertex_mat( p1, p2, p3, p1_n, p2_n, p3_n, change_mat_all );
 
-    // ワールド --> ローカル変換マトリクス
-    Calc_3dMat4TranAxis( p1, x_axis, y_axis, z_axis, change_mat );
-
-    // ローカル --> ワールド変換マトリクス
-    //Calc_3dMat4TranAxisInv( p1, x_axis_n, y_axis_n, z_axis_n, change_mat_n );
-    Calc_3dMat4TranAxisInv( p1_n, x_axis_n, y_axis_n, z_axis_n, change_mat_n );
+    NPT_REAL* cp_in [7] = { cp_side1_1,   cp_side1_2,   cp_side2_1,   cp_side2_2,
+                            cp_side3_1,   cp_side3_2,   cp_center    };
+    NPT_REAL* cp_out[7] = { cp_side1_1_n, cp_side1_2_n, cp_side2_1_n, cp_side2_2_n,
+                            cp_side3_1_n, cp_side3_2_n, cp_center_n  };
+    NPT_REAL  pnts_x[8], pnts_y[8], pnts_z[8];
+    int       i;
 
-    // 最終変換マトリクス
-    Calc_3dMat4Multi44( change_mat, change_mat_n, change_mat_all );
-    //Calc_3dMat4Multi44( change_mat_n, change_mat, change_mat_all );
-
-    NPT_REAL pnts_in[7][4], pnts_out[7][4];
-
-    // 配列に詰める
-    pnts_in[0][0]=cp_side1_1[0];  pnts_in[0][1]=cp_side1_1[1];  pnts_in[0][2]=cp_side1_1[2];  pnts_in[0][3]=1.0;
-    pnts_in[1][0]=cp_side1_2[0];  pnts_in[1][1]=cp_side1_2[1];  pnts_in[1][2]=cp_side1_2[2];  pnts_in[1][3]=1.0;
-    pnts_in[2][0]=cp_side2_1[0];  pnts_in[2][1]=cp_side2_1[1];  pnts_in[2][2]=cp_side2_1[2];  pnts_in[2][3]=1.0;
-    pnts_in[3][0]=cp_side2_2[0];  pnts_in[3][1]=cp_side2_2[1];  pnts_in[3][2]=cp_side2_2[2];  pnts_in[3][3]=1.0;
-    pnts_in[4][0]=cp_side3_1[0];  pnts_in[4][1]=cp_side3_1[1];  pnts_in[4][2]=cp_side3_1[2];  pnts_in[4][3]=1.0;
-    pnts_in[5][0]=cp_side3_2[0];  pnts_in[5][1]=cp_side3_2[1];  pnts_in[5][2]=cp_side3_2[2];  pnts_in[5][3]=1.0;
-    pnts_in[6][0]=cp_center[0];   pnts_in[6][1]=cp_center[1];   pnts_in[6][2]=cp_center[2];   pnts_in[6][3]=1.0;
-
-    // 座標変換
+    // 配列に詰める（成分別、ベクトル化のため８点目は 0）
     for ( i=0; i<7; i++ ) {
-        Calc_3dMat4Multi14( pnts_in[i], change_mat_all, pnts_out[i] );
+        pnts_x[i] = cp_in[i][0];  pnts_y[i] = cp_in[i][1];  pnts_z[i] = cp_in[i][2];
     }
+    pnts_x[7] = pnts_y[7] = pnts_z[7] = 0.0;
+
+    // 座標変換
+    Calc_3dMat43PntnSoA( change_mat_all, 8, pnts_x, pnts_y, pnts_z, pnts_x, pnts_y, pnts_z );
 
     // 配列から戻す
-    cp_side1_1_n[0]=pnts_out[0][0];  cp_side1_1_n[1]=pnts_out[0][1];  cp_side1_1_n[2]=pnts_out[0][2];
-    cp_side1_2_n[0]=pnts_out[1][0];  cp_side1_2_n[1]=pnts_out[1][1];  cp_side1_2_n[2]=pnts_out[1][2];
-    cp_side2_1_n[0]=pnts_out[2][0];  cp_side2_1_n[1]=pnts_out[2][1];  cp_side2_1_n[2]=pnts_out[2][2];
-    cp_side2_2_n[0]=pnts_out[3][0];  cp_side2_2_n[1]=pnts_out[3][1];  cp_side2_2_n[2]=pnts_out[3][2];
-    cp_side3_1_n[0]=pnts_out[4][0];  cp_side3_1_n[1]=pnts_out[4][1];  cp_side3_1_n[2]=pnts_out[4][2];
-    cp_side3_2_n[0]=pnts_out[5][0];  cp_side3_2_n[1]=pnts_out[5][1];  cp_side3_2_n[2]=pnts_out[5][2];
-    cp_center_n [0]=pnts_out[6][0];  cp_center_n [1]=pnts_out[6][1];  cp_center_n [2]=pnts_out[6][2];
+    for ( i=0; i<7; i++ ) {
+        cp_out[i][0] = pnts_x[i];  cp_out[i][1] = pnts_y[i];  cp_out[i][2] = pnts_z[i];
+    }
 }
 
 #ifdef __cplusplus
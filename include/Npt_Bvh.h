@@ -0,0 +1,115 @@
+#ifndef _NPT_BVH_H_
+#define _NPT_BVH_H_
+
+/*
+ * Npatch - Nagata Patch Library
+ *
+ * Copyright (c) 2015-2016 Advanced Institute for Computational Science, RIKEN.
+ * All rights reserved.
+ *
+ */
+
+////////////////////////////////////////////////////////////////////////////
+///
+/// 長田パッチ 包含箱の階層（BVH） 関数 (C++/C)
+///
+///   要素（パッチ等）の軸平行包含箱から二分木を作成する。
+///   節点の要素を中心座標の範囲が最大の軸で中央値により２分割し、
+///   要素数が NPT_BVH_LEAF 以下の節点を葉とする。
+///
+///   節点は深さ優先の順に格納し、節点0を根とする。
+///   節点iの要素は idx[ range[i][0] ] - idx[ range[i][0] + range[i][1] - 1 ] であり、
+///   内部節点の要素は２つの子節点の要素を合わせたものとなる（子節点の要素は連続する）。
+///
+////////////////////////////////////////////////////////////////////////////
+
+#include "Npt.h"
+
+#ifdef __cplusplus
+extern "C" {  // for C++
+#else
+#endif
+
+#define NPT_BVH_LEAF   4     ///< 葉の最大要素数
+
+///
+/// 包含箱の階層
+///
+typedef struct {
+    int        num_prim;     ///< 要素数
+    int        num_node;     ///< 節点数
+    NPT_REAL (*box)[2][3];   ///< 節点の包含箱（[0]最小 [1]最大） [num_node]
+    int      (*child)[2];    ///< 子節点番号 [num_node]（葉は -1）
+    int      (*range)[2];    ///< 節点の要素の範囲（idx の先頭位置、要素数） [num_node]
+    int*       idx;          ///< 要素番号 [num_prim]
+} NPT_BVH;
+
+
+///
+/// 包含箱の階層の作成
+///
+/// @param [in]    num          要素数
+/// @param [in]    box          要素の包含箱（[0]最小 [1]最大） [num]
+/// @param [out]   bvh          包含箱の階層
+/// @return リターンコード   =0 正常  !=0 異常（メモリ確保失敗）
+///
+int
+npt_bvh_crt(
+        int          num,
+        NPT_REAL     box[][2][3],
+        NPT_BVH*     bvh
+    );
+
+
+///
+/// 包含箱の階層の領域解放
+///
+/// @param [inout] bvh          包含箱の階層
+/// @return なし
+///
+void
+npt_bvh_free(
+        NPT_BVH*     bvh
+    );
+
+
+///
+/// 包含箱と重なる要素の検索
+///
+/// @param [in]    bvh          包含箱の階層
+/// @param [in]    box          検索する包含箱（[0]最小 [1]最大）
+/// @param [in]    elem_box     要素の包含箱 [num_prim]（npt_bvh_crt() に与えたもの）
+/// @param [in]    max          list の大きさ
+/// @param [out]   list         重なる要素の番号 [max]（max 個を超えた分は格納しない）
+/// @return 重なる要素数（max を超える場合も全数を返す）
+///
+int
+npt_bvh_query(
+        const NPT_BVH*  bvh,
+        NPT_REAL        box[2][3],
+        NPT_REAL        elem_box[][2][3],
+        int             max,
+        int*            list
+    );
+
+
+///
+/// 包含箱の重なり判定
+///
+/// @param [in]    a            包含箱（[0]最小 [1]最大）
+/// @param [in]    b            包含箱（[0]最小 [1]最大）
+/// @return 重なる（接する場合を含む）場合 1、それ以外は 0
+///
+int
+npt_bvh_overlap(
+        NPT_REAL     a[2][3],
+        NPT_REAL     b[2][3]
+    );
+
+#ifdef __cplusplus
+} // extern "C" or extern
+#else
+#endif
+
+
+#endif // _NPT_BVH_H_
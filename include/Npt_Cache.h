@@ -0,0 +1,161 @@
+#ifndef _NPT_CACHE_H_
+#define _NPT_CACHE_H_
+
+/*
+ * Npatch - Nagata Patch Library
+ *
+ * Copyright (c) 2015-2016 Advanced Institute for Computational Science, RIKEN.
+ * All rights reserved.
+ *
+ */
+
+////////////////////////////////////////////////////////////////////////////
+///
+/// 長田パッチ パラメータの遅延生成キャッシュ 関数 (C++/C)
+///
+///   三角形メッシュの長田パッチパラメータを、参照された三角形についてのみ
+///   初回参照時に生成（npt_mesh_param_get）して保持する。
+///   局所的な問い合わせ（一部の領域の点のみ補正する場合等）では、
+///   全三角形のパラメータを事前に生成する必要がない。
+///
+///   格納領域（スラブ）
+///       三角形番号 NPT_CACHE_SHARD_TRI 個単位で NPT_CACHE_NUM_SHARD 個のシャードに分け、
+///       シャードごとに生成順にパッチを詰めて格納する（NPT_CACHE_BLOCK パッチ単位で確保）。
+///       メモリ量は生成済みのパッチ数に比例する（7x3実数/パッチ + 三角形あたり int 1個）。
+///
+///   並行アクセス
+///       OpenMP を有効にしてビルドした場合（with_OMP=ON）、OpenMP のスレッドから
+///       同時に参照してよい。生成済みのパッチの参照はロックを取らない。
+///       未生成のパッチはシャード単位のロック（OpenMP ロック）を取って生成するため、
+///       異なるシャードの生成は並行して行われ、同じパッチが２回生成されることはない。
+///       生成済みのパッチの格納位置は変わらないため、取得したポインタは
+///       npt_cache_clear() / npt_cache_free() まで有効である。
+///       OpenMP を無効にしてビルドした場合はロック、メモリの同期（flush）を行わないため、
+///       １スレッドから参照すること。OpenMP 以外のスレッド（pthread、std::thread 等）から
+///       同時に参照する場合は、呼び出し側で排他すること。
+///
+///   メッシュの頂点座標、頂点法線を変更した場合は npt_cache_clear() を呼ぶこと。
+///
+////////////////////////////////////////////////////////////////////////////
+
+#include "Npt_Mesh.h"
+
+#ifdef __cplusplus
+extern "C" {  // for C++
+#else
+#endif
+
+#define NPT_CACHE_NUM_SHARD   64    ///< シャード数（2の冪）
+#define NPT_CACHE_SHARD_TRI   64    ///< シャードの割り当て単位（連続する三角形数、2の冪）
+#define NPT_CACHE_BLOCK       256   ///< スラブの確保単位（パッチ数）
+
+///
+/// 長田パッチパラメータの遅延生成キャッシュ
+///
+typedef struct {
+    NPT_MESH*      mesh;       ///< 三角形メッシュ（参照のみ）
+    volatile int*  slot;       ///< 三角形のシャード内の格納位置 [num_tri]  <0: 未生成
+    void*          shard;      ///< シャード [NPT_CACHE_NUM_SHARD]（内部使用）
+} NPT_CACHE;
+
+
+///
+/// キャッシュの作成
+///    パラメータは生成しない（三角形あたり int 1個とシャードの管理領域のみ確保）
+///
+/// @param [in]    mesh         三角形メッシュ（vtx_norm 設定済み、キャッシュの使用中は解放しないこと）
+/// @param [out]   cache        キャッシュ
+/// @return リターンコード   =0 正常  !=0 異常（メモリ確保失敗）
+///
+int
+npt_cache_crt(
+        NPT_MESH*    mesh,
+        NPT_CACHE*   cache
+    );
+
+
+///
+/// キャッシュの全パッチの無効化
+///    頂点座標、頂点法線の変更後に呼ぶ。確保済みのスラブは再利用する。
+///
+/// @param [inout] cache        キャッシュ
+/// @return なし
+/// @attention 他のスレッドが参照中でないこと。取得済みのポインタは無効となる。
+///
+void
+npt_cache_clear(
+        NPT_CACHE*   cache
+    );
+
+
+///
+/// キャッシュの領域解放
+///
+/// @param [inout] cache        キャッシュ
+/// @return なし
+///
+void
+npt_cache_free(
+        NPT_CACHE*   cache
+    );
+
+
+///
+/// 長田パッチパラメータの参照
+///    未生成の場合は生成して格納する（OpenMP 有効時は OpenMP の複数スレッドから同時に呼んでよい）
+///
+/// @param [inout] cache        キャッシュ
+/// @param [in]    itri         三角形番号
+/// @return 長田パッチパラメータ（制御点 cp_side1_1-cp_center の順 7x3実数）の先頭
+///         NULL: メモリ確保失敗
+///
+const NPT_REAL*
+npt_cache_get(
+        NPT_CACHE*   cache,
+        int          itri
+    );
+
+
+///
+/// 長田パッチ 近似曲面補正（キャッシュ 複数点）
+///    点iは三角形 tri_id[i] 上の (eta[i], xi[i]) とする
+///
+/// @param [inout] cache        キャッシュ
+/// @param [in]    num          点数
+/// @param [in]    tri_id       三角形番号 [num]
+/// @param [in]    eta          ηパラメータ [num]
+/// @param [in]    xi           ξパラメータ [num]
+/// @param [out]   pos_o        出力点座標 [num]
+/// @return リターンコード   =0 正常  !=0 異常（メモリ確保失敗）
+///
+int
+npt_cache_correct_pnt_n(
+        NPT_CACHE*   cache,
+        int          num,
+        const int*   tri_id,
+        NPT_REAL*    eta,
+        NPT_REAL*    xi,
+        NPT_REAL     pos_o[][3]
+    );
+
+
+///
+/// 生成済みのパッチ数、スラブのメモリ量
+///
+/// @param [in]    cache        キャッシュ
+/// @param [out]   bytes        スラブとして確保済みのメモリ量 (byte)（NULL 可）
+/// @return 生成済みのパッチ数
+///
+int
+npt_cache_num(
+        NPT_CACHE*   cache,
+        size_t*      bytes
+    );
+
+#ifdef __cplusplus
+} // extern "C" or extern
+#else
+#endif
+
+
+#endif // _NPT_CACHE_H_
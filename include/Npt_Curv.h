@@ -0,0 +1,152 @@
+#ifndef _NPT_CURV_H_
+#define _NPT_CURV_H_
+
+/*
+ * Npatch - Nagata Patch Library
+ *
+ * Copyright (c) 2015-2016 Advanced Institute for Computational Science, RIKEN.
+ * All rights reserved.
+ *
+ */
+
+////////////////////////////////////////////////////////////////////////////
+///
+/// 長田パッチ 曲率の評価 関数 (C++/C)
+///
+///   パッチ（３次三角形ベジェ）の制御点から、(eta,xi) における１次、２次微分を
+///   de Casteljau 法（ブロッサム）により解析的に求め、第一基本形式、第二基本形式、
+///   ガウス曲率、平均曲率、主曲率と主方向を求める。
+///       x_eta, x_xi             : １次微分
+///       x_eta_eta, x_eta_xi, x_xi_xi : ２次微分
+///       法線 n = x_eta × x_xi / |x_eta × x_xi|（三角形の頂点の並びの右回り）
+///       第一基本形式 E = x_eta.x_eta  F = x_eta.x_xi  G = x_xi.x_xi
+///       第二基本形式 L = x_eta_eta.n  M = x_eta_xi.n  N = x_xi_xi.n
+///       ガウス曲率 K = (LN-M^2)/(EG-F^2)   平均曲率 H = (EN-2FM+GL)/(2(EG-F^2))
+///   曲率は曲面が法線の向きに曲がる場合を正とする（外向き法線の球面では負、半径 r の球面で
+///   K = 1/r^2、H = -1/r）。
+///
+///   パッチの辺は隣接頂点の法線のなす角が小さい（NPT_ALW_V 未満）場合に直線となるため、
+///   細かいメッシュでは辺の近くの曲率は実際の曲面の曲率を表さない。
+///
+////////////////////////////////////////////////////////////////////////////
+
+#include "Npt_Mesh.h"
+
+#ifdef __cplusplus
+extern "C" {  // for C++
+#else
+#endif
+
+///
+/// 曲率の評価結果
+///
+typedef struct {
+    NPT_REAL   pos[3];       ///< 曲面上の点
+    NPT_REAL   norm[3];      ///< 単位法線ベクトル
+    NPT_REAL   ff1[3];       ///< 第一基本形式 E, F, G
+    NPT_REAL   ff2[3];       ///< 第二基本形式 L, M, N
+    NPT_REAL   k_gauss;      ///< ガウス曲率
+    NPT_REAL   k_mean;       ///< 平均曲率
+    NPT_REAL   k[2];         ///< 主曲率（k[0] >= k[1]）
+    NPT_REAL   dir[2][3];    ///< 主方向（単位ベクトル、dir[1] = norm × dir[0]）
+} NPT_CURV;
+
+
+///
+/// 曲率の評価
+///
+/// @param [in]    eta          ηパラメータ
+/// @param [in]    xi           ξパラメータ
+/// @param [in]    tri          三角形の頂点座標
+/// @param [in]    npatch       長田パッチパラメータ
+/// @param [out]   curv         曲率の評価結果
+/// @return リターンコード   =0 正常  !=0 異常（接ベクトルが平行、結果は pos 以外 0）
+///
+int
+npt_curv_eval(
+        NPT_REAL     eta,
+        NPT_REAL     xi,
+        NPT_REAL     tri   [3][3],
+        NPT_REAL     npatch[7][3],
+        NPT_CURV*    curv
+    );
+
+
+///
+/// 曲面上の点と接ベクトル（１次微分）
+///    単位法線ベクトルは d_eta × d_xi を正規化したもの、面積要素は |d_eta × d_xi| である
+///
+/// @param [in]    eta          ηパラメータ
+/// @param [in]    xi           ξパラメータ
+/// @param [in]    tri          三角形の頂点座標
+/// @param [in]    npatch       長田パッチパラメータ
+/// @param [out]   pos          曲面上の点
+/// @param [out]   d_eta        ηによる微分 x_eta
+/// @param [out]   d_xi         ξによる微分 x_xi
+/// @return なし
+///
+void
+npt_curv_tangent(
+        NPT_REAL     eta,
+        NPT_REAL     xi,
+        NPT_REAL     tri   [3][3],
+        NPT_REAL     npatch[7][3],
+        NPT_REAL     pos  [3],
+        NPT_REAL     d_eta[3],
+        NPT_REAL     d_xi [3]
+    );
+
+
+///
+/// 曲率の評価（複数点）
+///    点iは三角形iの (eta[i], xi[i]) とする
+///    OpenMPが有効な場合は点単位でスレッド並列に処理する。
+///
+/// @param [in]    num          点数（三角形数）
+/// @param [in]    eta          ηパラメータ [num]
+/// @param [in]    xi           ξパラメータ [num]
+/// @param [in]    tri          三角形の頂点座標 [num]
+/// @param [in]    npatch       長田パッチパラメータ [num]
+/// @param [out]   curv         曲率の評価結果 [num]
+/// @return リターンコード   =0 正常  !=0 異常（異常となった点数）
+///
+int
+npt_curv_eval_n(
+        int          num,
+        NPT_REAL*    eta,
+        NPT_REAL*    xi,
+        NPT_REAL     tri   [][3][3],
+        NPT_REAL     npatch[][7][3],
+        NPT_CURV*    curv
+    );
+
+
+///
+/// メッシュの頂点の曲率の評価
+///    頂点から出る各辺の法曲率（辺の両端の頂点法線の差 -(n_w - n_v)・d/|d|^2、d は辺ベクトル）に
+///    頂点法線の接平面での形状作用素を最小二乗で当てはめ、主曲率と主方向を求める。
+///    辺の曲線の両端は頂点法線に直交するため、この値は辺に沿った法曲率の平均に一致する。
+///    パッチの頂点での曲率（npt_curv_eval の角の値）は辺の曲線の端点の２次微分で決まり、
+///    解析曲面との誤差が大きい（トーラスで平面三角形の角度欠損の10倍以上）ため用いない。
+///    ガウス曲率の誤差は角度欠損と同程度（RMSでおよそ2倍）で、平均曲率と主方向も求まる。
+///    接平面での辺の方向が３つ未満の頂点（境界の角等）は曲率を 0 とする。
+///    結果の基本形式は主方向を基底とした値（E=G=1, F=0, L=k[0], M=0, N=k[1]）とする。
+///    平均は三角形番号順に行うため、結果はスレッド数によらない。
+///
+/// @param [in]    mesh         三角形メッシュ（vtx_norm 設定済み）
+/// @param [out]   curv         頂点の曲率の評価結果 [num_vtx]
+/// @return リターンコード   =0 正常  !=0 異常（メモリ確保失敗）
+///
+int
+npt_curv_vtx_mesh(
+        NPT_MESH*    mesh,
+        NPT_CURV*    curv
+    );
+
+#ifdef __cplusplus
+} // extern "C" or extern
+#else
+#endif
+
+
+#endif // _NPT_CURV_H_
@@ -0,0 +1,113 @@
+#ifndef _NPT_INTEG_H_
+#define _NPT_INTEG_H_
+
+/*
+ * Npatch - Nagata Patch Library
+ *
+ * Copyright (c) 2015-2016 Advanced Institute for Computational Science, RIKEN.
+ * All rights reserved.
+ *
+ */
+
+////////////////////////////////////////////////////////////////////////////
+///
+/// 長田パッチ 曲面の積分（表面積、体積、重心、慣性テンソル） 関数 (C++/C)
+///
+///   パッチの座標と (eta,xi) による微分から、Gauss-Dunavant 求積（三角形上の
+///   対称な求積公式、次数 1-NPT_INTEG_MAX_DEGREE）により曲面の積分を求める。
+///       表面積   : |x_eta × x_xi| の積分
+///       体積等   : 発散定理により曲面上の積分に変換する
+///                  （体積 x.n/3、１次モーメント x_i^2 n_i/2、２次モーメント x_i^3 n_i/3, x_i^2 x_j n_i/2）
+///   パッチの座標は (eta,xi) の３次式、x_eta × x_xi は４次式であるため、
+///   体積は次数7以上で丸め誤差を除き厳密となる。重心（10次）、慣性テンソル（13次）、
+///   表面積（非多項式）は次数とともに収束する近似値となる。
+///
+///   体積、重心、慣性テンソルは閉じた曲面（三角形の頂点の並びが外向き法線の右回り）を
+///   対象とする。重心、慣性テンソルは密度1とする。
+///
+///   三角形を NPT_INTEG_BLOCK 個ずつのブロックに分け、ブロック単位にスレッド並列で
+///   積分し、ブロックの部分和をブロック番号順に加算するため、結果はスレッド数によらず
+///   ビット単位で一致する。積分は倍精度で行う。
+///
+////////////////////////////////////////////////////////////////////////////
+
+#include "Npt_Mesh.h"
+
+#ifdef __cplusplus
+extern "C" {  // for C++
+#else
+#endif
+
+#define NPT_INTEG_MAX_DEGREE   8     ///< 求積公式の最大次数
+#define NPT_INTEG_BLOCK      256     ///< 部分和のブロックの三角形数
+
+///
+/// 曲面の積分の結果
+///
+typedef struct {
+    double   area;           ///< 表面積
+    double   volume;         ///< 囲む体積
+    double   cen[3];         ///< 重心（体積=0 の場合は積分の基準点）
+    double   inertia[3][3];  ///< 重心まわりの慣性テンソル（密度1）
+} NPT_INTEG;
+
+
+///
+/// 曲面の積分（複数パッチ）
+///
+/// @param [in]    num          三角形数
+/// @param [in]    tri          三角形の頂点座標 [num]
+/// @param [in]    npatch       長田パッチパラメータ [num]
+/// @param [in]    degree       求積公式の次数（1-NPT_INTEG_MAX_DEGREE）
+/// @param [out]   res          積分の結果
+/// @return リターンコード   =0 正常  !=0 異常（メモリ確保失敗、degree 不正）
+///
+int
+npt_integ_n(
+        int          num,
+        NPT_REAL     tri   [][3][3],
+        NPT_REAL     npatch[][7][3],
+        int          degree,
+        NPT_INTEG*   res
+    );
+
+
+///
+/// 曲面の積分（三角形メッシュ）
+///    長田パッチパラメータは npt_mesh_param_get() で三角形ごとに求める
+///
+/// @param [in]    mesh         三角形メッシュ（vtx_norm 設定済み）
+/// @param [in]    degree       求積公式の次数（1-NPT_INTEG_MAX_DEGREE）
+/// @param [out]   res          積分の結果
+/// @return リターンコード   =0 正常  !=0 異常（メモリ確保失敗、degree 不正）
+///
+int
+npt_integ_mesh(
+        NPT_MESH*    mesh,
+        int          degree,
+        NPT_INTEG*   res
+    );
+
+
+///
+/// パッチごとの表面積（三角形メッシュ）
+///
+/// @param [in]    mesh         三角形メッシュ（vtx_norm 設定済み）
+/// @param [in]    degree       求積公式の次数（1-NPT_INTEG_MAX_DEGREE）
+/// @param [out]   area         パッチの表面積 [num_tri]
+/// @return リターンコード   =0 正常  !=0 異常（degree 不正）
+///
+int
+npt_integ_area_mesh(
+        NPT_MESH*    mesh,
+        int          degree,
+        NPT_REAL*    area
+    );
+
+#ifdef __cplusplus
+} // extern "C" or extern
+#else
+#endif
+
+
+#endif // _NPT_INTEG_H_
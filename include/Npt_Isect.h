@@ -0,0 +1,117 @@
+#ifndef _NPT_ISECT_H_
+#define _NPT_ISECT_H_
+
+/*
+ * Npatch - Nagata Patch Library
+ *
+ * Copyright (c) 2015-2016 Advanced Institute for Computational Science, RIKEN.
+ * All rights reserved.
+ *
+ */
+
+////////////////////////////////////////////////////////////////////////////
+///
+/// 長田パッチ 曲面の交差検出 関数 (C++/C)
+///
+///   三角形メッシュの長田パッチ（npt_mesh_param_get）どうしの交差を検出する。
+///       粗い判定 : パッチの包含箱（頂点と制御点の包含箱、凸包性により曲面を含む）の
+///                  階層（NPT_BVH）により、包含箱が重なるパッチの組を求める。
+///       詳細判定 : ２つのパッチを npt_subdiv() で再帰的に４分割し、包含箱が重なる
+///                  子パッチの組のみを分割する。分割の深さ depth の子パッチは
+///                  頂点の三角形で近似し、三角形どうしの交差（辺と三角形の交点）を判定する。
+///   平面三角形では交差しないが曲面では交差する場合（曲率による交差）も検出する。
+///   パッチ単位に OpenMP でスレッド並列に処理する。
+///
+///   交差するパッチの組ごとに近似の交点（深さ depth の三角形どうしの交線の中点）を１点出力する。
+///   交点の誤差は深さ depth の子パッチと三角形の差（パッチの大きさの 1/4^depth 程度）である。
+///   同一平面上で重なる三角形、接するだけの曲面は三角形どうしの判定では検出されない場合がある。
+///   このような組では子パッチの包含箱がすべて重なり、判定する組の数が 16^depth まで増えるため、
+///   パッチの組あたりの子パッチの組の数を NPT_ISECT_MAX_WORK までとし、
+///   上限に達した組は交差するとみなし、limit=1 として出力し num_limit に数える
+///   （交点は上限に達したときの子パッチの包含箱の重なりの中心）。
+///
+////////////////////////////////////////////////////////////////////////////
+
+#include "Npt_Mesh.h"
+
+#ifdef __cplusplus
+extern "C" {  // for C++
+#else
+#endif
+
+#define NPT_ISECT_MAX_DEPTH   8     ///< 分割の深さの上限
+#define NPT_ISECT_MAX_WORK    4096  ///< パッチの組あたりの詳細判定の子パッチの組の数の上限
+
+///
+/// 交差するパッチの組
+///
+typedef struct {
+    int        tri[2];       ///< 三角形番号（自己交差: tri[0] < tri[1]、２メッシュ: tri[0] はメッシュa、tri[1] はメッシュb）
+    NPT_REAL   pos[3];       ///< 近似の交点
+    int        limit;        ///< =1 詳細判定が NPT_ISECT_MAX_WORK に達した組（交差するとみなす）
+} NPT_ISECT_PAIR;
+
+///
+/// 交差検出の結果
+///
+typedef struct {
+    int              num_pair;   ///< 交差するパッチの組の数
+    NPT_ISECT_PAIR*  pair;       ///< 交差するパッチの組 [num_pair]（tri[0], tri[1] の昇順）
+    long long        num_cand;   ///< 包含箱が重なるパッチの組の数（粗い判定の結果）
+    long long        num_limit;  ///< 詳細判定が NPT_ISECT_MAX_WORK に達したパッチの組の数（num_pair に含む）
+} NPT_ISECT;
+
+
+///
+/// 自己交差の検出
+///    頂点を共有するパッチの組は判定しない（共有辺、共有頂点で接するため）
+///
+/// @param [in]    mesh         三角形メッシュ（vtx_norm 設定済み）
+/// @param [in]    depth        分割の深さ（0-NPT_ISECT_MAX_DEPTH  =0: 平面三角形どうしの判定）
+/// @param [out]   res          交差検出の結果（npt_isect_free() で解放）
+/// @return リターンコード   =0 正常  !=0 異常（メモリ確保失敗、depth 不正）
+///
+int
+npt_isect_self(
+        NPT_MESH*    mesh,
+        int          depth,
+        NPT_ISECT*   res
+    );
+
+
+///
+/// ２つのメッシュの曲面の交差の検出
+///
+/// @param [in]    mesh_a       三角形メッシュa（vtx_norm 設定済み）
+/// @param [in]    mesh_b       三角形メッシュb（vtx_norm 設定済み）
+/// @param [in]    depth        分割の深さ（0-NPT_ISECT_MAX_DEPTH  =0: 平面三角形どうしの判定）
+/// @param [out]   res          交差検出の結果（npt_isect_free() で解放）
+/// @return リターンコード   =0 正常  !=0 異常（メモリ確保失敗、depth 不正）
+///
+int
+npt_isect_mesh(
+        NPT_MESH*    mesh_a,
+        NPT_MESH*    mesh_b,
+        int          depth,
+        NPT_ISECT*   res
+    );
+
+
+///
+/// 交差検出の結果の領域解放
+///
+/// @param [inout] res          交差検出の結果
+/// @return なし
+///
+void
+npt_isect_free(
+        NPT_ISECT*   res
+    );
+
+#ifdef __cplusplus
+} // extern "C" or extern
+#else
+#endif
+
+
+#endif // _NPT_ISECT_H_
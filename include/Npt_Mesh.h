@@ -0,0 +1,325 @@
+#ifndef _NPT_MESH_H_
+#define _NPT_MESH_H_
+
+/*
+ * Npatch - Nagata Patch Library
+ *
+ * Copyright (c) 2015-2016 Advanced Institute for Computational Science, RIKEN.
+ * All rights reserved.
+ *
+ */
+
+////////////////////////////////////////////////////////////////////////////
+///
+/// 長田パッチ メッシュ単位の処理 関数 (C++/C)
+///
+///   頂点を共有する三角形メッシュ（頂点座標、頂点法線ベクトル、
+///   三角形の頂点番号）を対象とする。
+///   配列の領域は呼び出し側で確保する。
+///
+////////////////////////////////////////////////////////////////////////////
+
+#include "Npt.h"
+
+#ifdef __cplusplus
+extern "C" {  // for C++
+#else
+#endif
+
+///
+/// 三角形メッシュ
+///    三角形iの頂点j(0-2)の座標は vtx[ tri[i][j] ]
+///    辺の向きは三角形の頂点の並び順 (j -> j+1) とする
+///
+typedef struct {
+    int        num_vtx;      ///< 頂点数
+    int        num_tri;      ///< 三角形数
+    NPT_REAL (*vtx)[3];      ///< 頂点座標 [num_vtx]
+    NPT_REAL (*vtx_norm)[3]; ///< 頂点法線ベクトル（単位ベクトル） [num_vtx]
+    int      (*tri)[3];      ///< 三角形の頂点番号 [num_tri]
+} NPT_MESH;
+
+
+///
+/// 三角形の長田パッチパラメータ生成（辺の向きを頂点番号で統一）
+///    辺の制御点は頂点番号の小さい頂点から大きい頂点の向きで計算するため、
+///    辺を共有する２つのパッチの制御点はビット単位で一致する（npt_epatch_get と同じ値）
+///
+/// @param [in]    mesh         三角形メッシュ
+/// @param [in]    itri         三角形番号
+/// @param [out]   cp           長田パッチパラメータ（制御点 cp_side1_1-cp_center の順）
+/// @return なし
+///
+void
+npt_mesh_param_get(
+        NPT_MESH*    mesh,
+        int          itri,
+        NPT_REAL     cp[7][3]
+    );
+
+
+///
+/// 三角形の法線（辺ベクトルの外積、大きさは面積の２倍）
+///    頂点法線ベクトルの面積重み付きの和に用いる。npt_vnorm_crt()、npt_mpi_vtx_norm()、
+///    npt_pipe の頂点の結合は本関数で三角形の法線を求め、同じ値を加算する
+///
+/// @param [in]    p1           頂点１座標
+/// @param [in]    p2           頂点２座標
+/// @param [in]    p3           頂点３座標
+/// @param [out]   norm         三角形の法線（(p2-p1)x(p3-p1)、単位ベクトル化しない）
+/// @return なし
+///
+void
+npt_mesh_tri_norm(
+        NPT_REAL     p1[3],
+        NPT_REAL     p2[3],
+        NPT_REAL     p3[3],
+        NPT_REAL     norm[3]
+    );
+
+
+////////////////////////////////////////////////////////////////////////////
+///
+/// 辺共有形式の長田パッチパラメータ
+///
+///   辺の制御点は隣接する２つの三角形で同一であるため辺単位に格納し、
+///   中央の制御点は辺の制御点と頂点から都度求める。
+///   三角形単位の格納（7x3実数/三角形）に比べ、メモリ量はおよそ半分となり、
+///   隣接パッチの共有辺は構造上必ず一致する。
+///
+///   辺eの制御点 edge_cp[e][0] は edge_vtx[e][0] 側、
+///   edge_cp[e][1] は edge_vtx[e][1] 側の制御点とする（edge_vtx[e][0] < edge_vtx[e][1]）。
+///   三角形iの辺j (頂点j -> 頂点j+1) は tri_edge[i][j] = 2*辺番号 + 向き
+///   （向き 0:edge_vtx[e][0]->edge_vtx[e][1]と同じ  1:逆向き）で表す。
+///
+////////////////////////////////////////////////////////////////////////////
+
+///
+/// 辺共有形式の長田パッチパラメータ
+///
+typedef struct {
+    int        num_edge;     ///< 辺数
+    int      (*edge_vtx)[2]; ///< 辺の頂点番号 [num_edge]
+    NPT_REAL (*edge_cp)[2][3]; ///< 辺の３次ベジェ制御点 [num_edge]
+    int      (*tri_edge)[3]; ///< 三角形の辺番号と向き [num_tri]
+} NPT_EPATCH;
+
+
+///
+/// 辺共有形式の長田パッチパラメータ生成
+///
+/// @param [in]    mesh         三角形メッシュ
+/// @param [out]   epatch       辺共有形式の長田パッチパラメータ（領域は内部で確保する）
+/// @return リターンコード   =0 正常  !=0 異常（メモリ確保失敗）
+/// @attention
+///     使用後は npt_epatch_free() で領域を解放すること
+///
+int
+npt_epatch_crt(
+        NPT_MESH*    mesh,
+        NPT_EPATCH*  epatch
+    );
+
+
+///
+/// 辺共有形式の長田パッチパラメータ 辺の制御点の再計算
+///    頂点座標、頂点法線ベクトルが変化した場合に使用する（辺の構成は変えない）
+///
+/// @param [in]    mesh         三角形メッシュ
+/// @param [inout] epatch       辺共有形式の長田パッチパラメータ
+/// @return なし
+///
+void
+npt_epatch_update(
+        NPT_MESH*    mesh,
+        NPT_EPATCH*  epatch
+    );
+
+
+///
+/// 辺共有形式の長田パッチパラメータ領域解放
+///
+/// @param [inout] epatch       辺共有形式の長田パッチパラメータ
+/// @return なし
+///
+void
+npt_epatch_free(
+        NPT_EPATCH*  epatch
+    );
+
+
+///
+/// 三角形の長田パッチパラメータ取得
+///    辺の制御点を三角形の向きに並べ、中央の制御点を求める
+///
+/// @param [in]    mesh         三角形メッシュ
+/// @param [in]    epatch       辺共有形式の長田パッチパラメータ
+/// @param [in]    itri         三角形番号
+/// @param [out]   cp           長田パッチパラメータ（制御点 cp_side1_1-cp_center の順）
+/// @return なし
+///
+void
+npt_epatch_get(
+        NPT_MESH*    mesh,
+        NPT_EPATCH*  epatch,
+        int          itri,
+        NPT_REAL     cp[7][3]
+    );
+
+
+///
+/// 長田パッチ 近似曲面補正（辺共有形式 複数点）
+///    点iは三角形 tri_id[i] 上の (eta[i], xi[i]) とする
+///
+/// @param [in]    mesh         三角形メッシュ
+/// @param [in]    epatch       辺共有形式の長田パッチパラメータ
+/// @param [in]    num          点数
+/// @param [in]    tri_id       三角形番号 [num]
+/// @param [in]    eta          ηパラメータ [num]
+/// @param [in]    xi           ξパラメータ [num]
+/// @param [out]   pos_o        出力点座標 [num]
+/// @return なし
+///
+void
+npt_epatch_correct_pnt_n(
+        NPT_MESH*    mesh,
+        NPT_EPATCH*  epatch,
+        int          num,
+        const int*   tri_id,
+        NPT_REAL*    eta,
+        NPT_REAL*    xi,
+        NPT_REAL     pos_o[][3]
+    );
+
+
+////////////////////////////////////////////////////////////////////////////
+///
+/// 頂点法線ベクトルの差分更新
+///
+///   頂点法線ベクトルは頂点の周囲の三角形の法線（辺ベクトルの外積、面積重み付き）の和を
+///   単位ベクトル化したものとする。頂点の周囲の三角形を三角形番号の昇順に保持し、
+///   各頂点の和をこの順に求める（頂点単位の集約のため、スレッド並列でも排他処理は不要）。
+///   三角形番号の順に各頂点へ加算する計算と加算順序が同じであり、結果はビット単位で一致する。
+///
+///   移動した頂点を指定した更新では、その頂点を含む三角形の法線と、それらの三角形の頂点
+///   （移動した頂点とその１リングの頂点）の法線ベクトルのみを再計算する。
+///   再計算の結果は全頂点の計算とビット単位で一致する。
+///   更新後の upd_tri は頂点法線ベクトルが変化した頂点を含む三角形（長田パッチパラメータの
+///   再生成が必要な三角形）であり、npt_mesh_param_get() 等で局所的に再生成できる。
+///
+////////////////////////////////////////////////////////////////////////////
+
+///
+/// 頂点法線ベクトルの差分更新用データ
+///
+typedef struct {
+    int        num_vtx;      ///< 頂点数
+    int        num_tri;      ///< 三角形数
+    int*       vtx_tri_ptr;  ///< 頂点iの周囲の三角形の位置 vtx_tri[ vtx_tri_ptr[i] - vtx_tri_ptr[i+1]-1 ] [num_vtx+1]
+    int*       vtx_tri;      ///< 頂点の周囲の三角形番号（頂点ごとに昇順） [3*num_tri]
+    NPT_REAL (*tri_norm)[3]; ///< 三角形の法線（辺ベクトルの外積） [num_tri]
+    int        num_upd_vtx;  ///< 直前の更新で法線ベクトルを再計算した頂点数
+    int*       upd_vtx;      ///< 直前の更新で法線ベクトルを再計算した頂点番号 [num_upd_vtx]
+    int        num_upd_tri;  ///< 直前の更新で頂点法線ベクトルが変化した頂点を含む三角形数
+    int*       upd_tri;      ///< 直前の更新で頂点法線ベクトルが変化した頂点を含む三角形番号 [num_upd_tri]
+    unsigned char* vtx_mark; ///< 作業領域 [num_vtx]
+    unsigned char* tri_mark; ///< 作業領域 [num_tri]
+    int*       mov_vtx;      ///< 作業領域（重複を除いた移動頂点） [num_vtx]
+} NPT_VNORM;
+
+
+///
+/// 頂点法線ベクトルの差分更新用データ生成
+///    頂点の周囲の三角形を求め、全三角形の法線と全頂点の法線ベクトル（mesh->vtx_norm）を計算する
+///
+/// @param [inout] mesh         三角形メッシュ（vtx_norm を設定する）
+/// @param [out]   vnorm        差分更新用データ（領域は内部で確保する）
+/// @return リターンコード   =0 正常  !=0 異常（メモリ確保失敗）
+/// @attention
+///     使用後は npt_vnorm_free() で領域を解放すること。
+///     三角形の頂点番号、頂点数、三角形数は変えないこと
+///
+int
+npt_vnorm_crt(
+        NPT_MESH*    mesh,
+        NPT_VNORM*   vnorm
+    );
+
+
+///
+/// 頂点法線ベクトルの差分更新
+///    移動した頂点（mesh->vtx を更新済み）を含む三角形の法線と、それらの三角形の頂点の
+///    法線ベクトル（mesh->vtx_norm）を再計算する。
+///    再計算した頂点は upd_vtx、その頂点を含む三角形は upd_tri に設定する
+///
+/// @param [inout] mesh         三角形メッシュ（vtx_norm を更新する）
+/// @param [inout] vnorm        差分更新用データ
+/// @param [in]    num          移動した頂点数
+/// @param [in]    vtx_id       移動した頂点番号 [num]（重複可）
+/// @return リターンコード   =0 正常  !=0 異常（頂点番号が範囲外、更新しない）
+///
+int
+npt_vnorm_update(
+        NPT_MESH*    mesh,
+        NPT_VNORM*   vnorm,
+        int          num,
+        const int*   vtx_id
+    );
+
+
+///
+/// 頂点法線ベクトルの差分更新用データ領域解放
+///
+/// @param [inout] vnorm        差分更新用データ
+/// @return なし
+///
+void
+npt_vnorm_free(
+        NPT_VNORM*   vnorm
+    );
+
+
+////////////////////////////////////////////////////////////////////////////
+///
+/// 空間充填曲線による並べ替え
+///
+///   STL 等の入力順の三角形、頂点を空間充填曲線（Morton順 または Hilbert順）の
+///   順に並べ替え、配列アクセスの局所性を高める。
+///   頂点は座標、三角形は重心の曲線上の位置（バウンディングボックスを
+///   各軸 2^21 に分割した格子上のキー）の昇順とする。
+///   キーが同じ場合は元の順序を保つ。
+///
+////////////////////////////////////////////////////////////////////////////
+
+#define NPT_REORDER_MORTON   0   ///< Morton順（Z順）
+#define NPT_REORDER_HILBERT  1   ///< Hilbert順
+
+///
+/// メッシュの並べ替え
+///    頂点座標、頂点法線ベクトル、三角形の頂点番号を並べ替え、
+///    三角形の頂点番号を新しい頂点番号に付け替える（三角形内の頂点の並び順は変えない）
+///
+/// @param [inout] mesh         三角形メッシュ（vtx_norm は NULL 可）
+/// @param [in]    curve        空間充填曲線 NPT_REORDER_MORTON / NPT_REORDER_HILBERT
+/// @param [out]   vtx_perm     新しい頂点番号 i の元の頂点番号 vtx_perm[i] [num_vtx]（NULL 可）
+/// @param [out]   tri_perm     新しい三角形番号 i の元の三角形番号 tri_perm[i] [num_tri]（NULL 可）
+/// @return リターンコード   =0 正常  !=0 異常（メモリ確保失敗、curve 不正）
+/// @attention
+///     三角形単位の配列（長田パッチパラメータ等）は tri_perm で並べ替えること。
+///     辺共有形式の長田パッチパラメータは並べ替え後に生成すること
+///
+int
+npt_mesh_reorder(
+        NPT_MESH*  mesh,
+        int        curve,
+        int*       vtx_perm,
+        int*       tri_perm
+    );
+
+#ifdef __cplusplus
+} // extern "C" or extern
+#else
+#endif
+
+
+#endif // _NPT_MESH_H_
@@ -0,0 +1,139 @@
+#ifndef _NPT_MPI_H_
+#define _NPT_MPI_H_
+
+/*
+ * Npatch - Nagata Patch Library
+ *
+ * Copyright (c) 2015-2016 Advanced Institute for Computational Science, RIKEN.
+ * All rights reserved.
+ *
+ */
+
+////////////////////////////////////////////////////////////////////////////
+///
+/// 長田パッチ MPI領域分割メッシュの処理 関数 (C++/C)
+///
+///   三角形をランクに分割した表面メッシュを対象とする。
+///   各ランクは自ランクの三角形と、その頂点（全体で一意な頂点番号 gid 付き）を持つ。
+///   分割境界の頂点は複数のランクが持つ（共有頂点）。
+///
+///   処理の流れ
+///       npt_mpi_halo_crt()   : 共有頂点と隣接ランクの抽出（ランク0への集約なし）
+///       npt_mpi_vtx_norm()   : 頂点法線の部分和を隣接ランクと交換して頂点法線を求める
+///       npt_mpi_param_crt()  : 長田パッチパラメータ生成
+///
+///   一致の保証
+///       共有頂点の法線は、その頂点を持つランクの部分和をランク番号の昇順に
+///       加算するため、全ランクでビット単位で一致する。
+///       辺の制御点は gid の小さい頂点から大きい頂点の向きで計算するため、
+///       ランク内外を問わず辺を共有する２つのパッチで完全に一致する
+///       （共有頂点の座標が全ランクで一致していることが前提）。
+///
+///   ビルド
+///       MPI を使用する場合のみ -D_NPT_MPI_ （cmake -Dwith_MPI=ON）を指定する。
+///       指定しない場合、本ヘッダの関数はライブラリに含まれない。
+///
+////////////////////////////////////////////////////////////////////////////
+
+#include <mpi.h>
+#include "Npt_Mesh.h"
+
+#ifdef __cplusplus
+extern "C" {  // for C++
+#else
+#endif
+
+///
+/// 分割境界の共有頂点（ハロー）情報
+///    隣接ランク nbr_rank[k] と共有する頂点の自ランクでの頂点番号は
+///    nbr_vtx[ nbr_ptr[k] ] - nbr_vtx[ nbr_ptr[k+1]-1 ]（gid の昇順）。
+///    同じ並びを相手ランクも持つため、交換バッファの順序は一致する。
+///
+typedef struct {
+    MPI_Comm   comm;         ///< コミュニケータ
+    int        rank;         ///< 自ランク番号
+    int        num_nbr;      ///< 隣接ランク数
+    int*       nbr_rank;     ///< 隣接ランク番号（昇順） [num_nbr]
+    int*       nbr_ptr;      ///< 共有頂点リストの開始位置 [num_nbr+1]
+    int*       nbr_vtx;      ///< 共有頂点の頂点番号 [nbr_ptr[num_nbr]]
+    int        num_shared;   ///< 共有頂点数（重複なし）
+} NPT_MPI_HALO;
+
+
+///
+/// 共有頂点情報の生成
+///    頂点の gid を gid % ランク数 のランクに集め、複数ランクに現れる gid を
+///    共有頂点として各ランクに返す（全対全通信２回、ランク0への集約なし）。
+///
+/// @param [in]    comm         コミュニケータ
+/// @param [in]    mesh         自ランクの三角形メッシュ
+/// @param [in]    gid          頂点の全体番号（0以上、自ランク内で重複なし） [mesh->num_vtx]
+/// @param [out]   halo         共有頂点情報（領域は内部で確保する）
+/// @return リターンコード   =0 正常  !=0 異常（メモリ確保失敗、通信エラー、gid の重複）
+/// @attention
+///     集団通信のため全ランクで呼び出すこと。
+///     自ランク内に同じ gid の頂点が複数あるランクが１つでもあれば全ランクで異常を返す
+///     （STL の読込み直後等は頂点を統合してから呼び出すこと）。
+///     使用後は npt_mpi_halo_free() で領域を解放すること
+///
+int
+npt_mpi_halo_crt(
+        MPI_Comm         comm,
+        NPT_MESH*        mesh,
+        const long long* gid,
+        NPT_MPI_HALO*    halo
+    );
+
+
+///
+/// 共有頂点情報の領域解放
+///
+/// @param [inout] halo         共有頂点情報
+/// @return なし
+///
+void
+npt_mpi_halo_free(
+        NPT_MPI_HALO*  halo
+    );
+
+
+///
+/// 頂点法線ベクトルの計算（分割境界の部分和の交換あり）
+///    頂点法線は隣接三角形の法線の面積重み付き和を単位ベクトル化したもの
+///
+/// @param [in]    halo         共有頂点情報
+/// @param [inout] mesh         自ランクの三角形メッシュ（vtx_norm を設定する）
+/// @return リターンコード   =0 正常  !=0 異常（メモリ確保失敗、通信エラー）
+/// @attention
+///     隣接ランクとの通信を含むため全ランクで呼び出すこと
+///
+int
+npt_mpi_vtx_norm(
+        NPT_MPI_HALO*  halo,
+        NPT_MESH*      mesh
+    );
+
+
+///
+/// 長田パッチパラメータ生成（辺の向きを gid で統一）
+///    通信は行わない
+///
+/// @param [in]    mesh         三角形メッシュ（vtx_norm 設定済み）
+/// @param [in]    gid          頂点の全体番号 [mesh->num_vtx]
+/// @param [out]   npatch       長田パッチパラメータ [mesh->num_tri]
+/// @return リターンコード   =0 正常
+///
+int
+npt_mpi_param_crt(
+        NPT_MESH*        mesh,
+        const long long* gid,
+        NPT_REAL         npatch[][7][3]
+    );
+
+#ifdef __cplusplus
+} // extern "C" or extern
+#else
+#endif
+
+
+#endif // _NPT_MPI_H_
@@ -0,0 +1,137 @@
+#ifndef _NPT_PIPE_H_
+#define _NPT_PIPE_H_
+
+/*
+ * Npatch - Nagata Patch Library
+ *
+ * Copyright (c) 2015-2016 Advanced Institute for Computational Science, RIKEN.
+ * All rights reserved.
+ *
+ */
+
+////////////////////////////////////////////////////////////////////////////
+///
+/// 長田パッチ パイプライン処理（STL読み込み - 細分割 - STL出力） 関数 (C++/C)
+///
+///   STLファイルを読み込み、長田パッチで細分割した三角形をバイナリSTLに出力する。
+///   処理段階
+///       READ    : ファイル読み込み
+///       WELD    : 頂点の結合（座標が一致する頂点を共有）、面の法線の頂点への加算
+///       NORMAL  : 頂点法線の単位ベクトル化、空間充填曲線による並べ替え（npt_mesh_reorder）
+///       PARAM   : 長田パッチパラメータ生成
+///       REFINE  : 各パッチの細分割（npt_correct_pnt、辺の分割数 level）
+///       WRITE   : ファイル出力
+///
+///   三角形をチャンク（一定数の三角形）単位に分割し、段階を重ねて実行する。
+///       前半  READ -> WELD        : 次のチャンクの読み込みと現在のチャンクの結合を並行
+///       後半  PARAM -> REFINE -> WRITE
+///                                 : 出力待ちのチャンク数を depth 以下に制限して
+///                                   複数チャンクの計算と出力を並行
+///   頂点法線は全三角形の結合後に確定するため、前半と後半の間（NORMAL）で同期する。
+///   後半のチャンクは並べ替え後の三角形の順であり、空間的にまとまっている。
+///
+///   並行処理には OpenMP のタスクを使用する。出力を行うスレッドは、出力する
+///   チャンクの計算が開始されていなければ自ら計算するため、スレッド数１でも動作する。
+///   OpenMP を使用しない場合は各段階を順に実行する。
+///
+///   辺の制御点、辺上の細分割点は頂点番号の小さい頂点から大きい頂点の向きで
+///   計算するため、隣接パッチの共有辺の点はビット単位で一致し、出力の三角形に
+///   隙間は生じない。
+///   面積０の三角形（結合後に頂点が重なるもの）は除外する。
+///
+////////////////////////////////////////////////////////////////////////////
+
+#include "Npt_Mesh.h"
+
+#ifdef __cplusplus
+extern "C" {  // for C++
+#else
+#endif
+
+///
+/// リターンコード
+///
+#define NPT_PIPE_OK          0   ///< 正常
+#define NPT_PIPE_ERR_OPEN    1   ///< ファイルオープン失敗
+#define NPT_PIPE_ERR_FORMAT  2   ///< 入力ファイルのフォーマット不正
+#define NPT_PIPE_ERR_MEMORY  3   ///< メモリ確保失敗
+#define NPT_PIPE_ERR_WRITE   4   ///< ファイル出力失敗
+#define NPT_PIPE_ERR_PARAM   5   ///< 引数不正
+
+/// 細分割数の上限
+#define NPT_PIPE_MAX_LEVEL   64
+
+///
+/// 処理段階
+///
+enum {
+    NPT_PIPE_T_READ = 0,       ///< ファイル読み込み
+    NPT_PIPE_T_WELD,           ///< 頂点の結合、面の法線の加算
+    NPT_PIPE_T_NORMAL,         ///< 頂点法線の確定、並べ替え
+    NPT_PIPE_T_PARAM,          ///< 長田パッチパラメータ生成
+    NPT_PIPE_T_REFINE,         ///< 細分割
+    NPT_PIPE_T_WRITE,          ///< ファイル出力
+    NPT_PIPE_NUM_STAGE
+};
+
+///
+/// パイプライン処理の設定
+///
+typedef struct {
+    const char*  in_file;    ///< 入力STLファイル（バイナリ/アスキー）
+    const char*  out_file;   ///< 出力STLファイル（バイナリ）  NULL: 出力しない
+    int          level;      ///< 細分割数（辺の分割数 1-NPT_PIPE_MAX_LEVEL、パッチあたり level*level 三角形）
+    int          chunk;      ///< チャンクの三角形数（出力三角形数 chunk*level*level が 262144 を超える場合は縮小する）
+    int          depth;      ///< 処理中（出力待ち）のチャンク数の上限  =1: 各段階を順に実行
+    int          reorder;    ///< 並べ替え NPT_REORDER_MORTON / NPT_REORDER_HILBERT  <0: 並べ替えなし
+} NPT_PIPE_PARAM;
+
+///
+/// パイプライン処理の結果
+///
+typedef struct {
+    int     num_tri;                    ///< 入力三角形数
+    int     num_vtx;                    ///< 結合後の頂点数
+    int     num_drop;                   ///< 除外した三角形数（面積０）
+    long long num_out;                  ///< 出力三角形数
+    double  time[NPT_PIPE_NUM_STAGE];   ///< 段階ごとの処理時間 (sec)（全スレッドの合計）
+    double  time_total;                 ///< 全体の経過時間 (sec)
+} NPT_PIPE_RESULT;
+
+
+///
+/// パイプライン処理の設定の初期化（既定値の設定）
+///    level=2  chunk=4096  depth=4  reorder=NPT_REORDER_HILBERT
+///
+/// @param [out]   prm          パイプライン処理の設定
+/// @return なし
+///
+void
+npt_pipe_param_init(
+        NPT_PIPE_PARAM*  prm
+    );
+
+
+///
+/// パイプライン処理の実行
+///
+/// @param [in]    prm          パイプライン処理の設定
+/// @param [out]   res          パイプライン処理の結果（NULL 可）
+/// @return リターンコード   =NPT_PIPE_OK 正常  !=NPT_PIPE_OK 異常
+/// @attention
+///     バイナリSTLの判定は npt_stl_read() と同じくファイルサイズで行う。
+///     アスキーSTLは npt_stl_read() で全体を読み込んでから処理する（読み込みの並行なし）。
+///
+int
+npt_pipe_run(
+        const NPT_PIPE_PARAM*  prm,
+        NPT_PIPE_RESULT*       res
+    );
+
+#ifdef __cplusplus
+} // extern "C" or extern
+#else
+#endif
+
+
+#endif // _NPT_PIPE_H_
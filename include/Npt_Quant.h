@@ -0,0 +1,244 @@
+#ifndef _NPT_QUANT_H_
+#define _NPT_QUANT_H_
+
+/*
+ * Npatch - Nagata Patch Library
+ *
+ * Copyright (c) 2015-2016 Advanced Institute for Computational Science, RIKEN.
+ * All rights reserved.
+ *
+ */
+
+////////////////////////////////////////////////////////////////////////////
+///
+/// 長田パッチ 制御点の量子化（圧縮）格納 関数 (C++/C)
+///
+///   制御点は三角形の近傍にあるため、平坦な三角形上の基準位置
+///   （辺の3等分点、重心）からのずれ（ワールド座標系の成分）を
+///   16bit整数に量子化して格納する。
+///   復元は基準位置にずれを加えるのみであり、座標系の計算（平方根、除算）は不要である。
+///
+///   基準位置
+///       cp_side1_1 : (2*p1+  p2)/3     cp_side1_2 : (  p1+2*p2)/3
+///       cp_side2_1 : (2*p2+  p3)/3     cp_side2_2 : (  p2+2*p3)/3
+///       cp_side3_1 : (2*p3+  p1)/3     cp_side3_2 : (  p3+2*p1)/3
+///       cp_center  : (p1+p2+p3)/3
+///
+///   誤差評価
+///       scale は21成分のずれの絶対値の最大値であり、辺の長さではない
+///       （平坦に近いパッチほど小さく、辺の長さとの比はパッチの曲がりに依存する）。
+///       各制御点の誤差は各成分で scale/(2*NPT_QUANT_MAX) 以下
+///       （NPT_QUANT_MAX=32767、scale との比 1.53e-5）であり、ユークリッド距離では
+///       sqrt(3)*scale/(2*NPT_QUANT_MAX) 以下となる。
+///       三角形内(0<=xi<=eta<=1)ではベジェ基底は非負で総和が1のため、
+///       曲面補間点の誤差も制御点と同じ上限となる。
+///       これに基準位置の計算と補間の丸め誤差が加わる。
+///
+///   格納サイズ
+///       48byte/パッチ（倍精度 7x3x8=168byte、単精度 7x3x4=84byte）
+///
+////////////////////////////////////////////////////////////////////////////
+
+#include "Npt.h"
+
+#ifdef __cplusplus
+extern "C" {  // for C++
+#else
+#endif
+
+/// 量子化の最大値
+#define NPT_QUANT_MAX  32767
+
+///
+/// 量子化した長田パッチパラメータ
+///    q[0]-q[6] は cp_side1_1, cp_side1_2, cp_side2_1, cp_side2_2,
+///    cp_side3_1, cp_side3_2, cp_center の順
+///
+typedef struct {
+    short  q[7][3];   ///< 基準位置からのずれ（scale/NPT_QUANT_MAX 単位）
+    short  pad;       ///< 予備（4byte境界合わせ）
+    float  scale;     ///< ずれの絶対値の最大値
+} NPT_QPATCH;
+
+
+///
+/// 量子化用 制御点の基準位置取得
+///
+/// @param [in]    p1           長田パッチ 頂点１座標
+/// @param [in]    p2           長田パッチ 頂点２座標
+/// @param [in]    p3           長田パッチ 頂点３座標
+/// @param [out]   ref          制御点の基準位置
+/// @return なし
+///
+INLINE void
+npt_qpatch_ref(
+        NPT_REAL  p1[3],
+        NPT_REAL  p2[3],
+        NPT_REAL  p3[3],
+        NPT_REAL  ref[7][3]
+    )
+{
+    const NPT_REAL third = (NPT_REAL)( 1.0/3.0 );
+    int      i;
+
+    for( i=0; i<3; i++ ) {
+        ref[0][i] = ( 2.0*p1[i] +     p2[i] ) * third;
+        ref[1][i] = (     p1[i] + 2.0*p2[i] ) * third;
+        ref[2][i] = ( 2.0*p2[i] +     p3[i] ) * third;
+        ref[3][i] = (     p2[i] + 2.0*p3[i] ) * third;
+        ref[4][i] = ( 2.0*p3[i] +     p1[i] ) * third;
+        ref[5][i] = (     p3[i] + 2.0*p1[i] ) * third;
+        ref[6][i] = ( p1[i] + p2[i] + p3[i] ) * third;
+    }
+}
+
+
+///
+/// 量子化した長田パッチパラメータの復元
+///
+/// @param [in]    p1           長田パッチ 頂点１座標
+/// @param [in]    p2           長田パッチ 頂点２座標
+/// @param [in]    p3           長田パッチ 頂点３座標
+/// @param [in]    qpatch       量子化した長田パッチパラメータ
+/// @param [out]   cp           長田パッチパラメータ（制御点 cp_side1_1-cp_center の順）
+/// @return なし
+///
+INLINE void
+npt_qpatch_decode(
+        NPT_REAL    p1[3],
+        NPT_REAL    p2[3],
+        NPT_REAL    p3[3],
+        const NPT_QPATCH* qpatch,
+        NPT_REAL    cp[7][3]
+    )
+{
+    NPT_REAL unit = (NPT_REAL)qpatch->scale * (NPT_REAL)( 1.0/NPT_QUANT_MAX );
+    int      i, j;
+
+    npt_qpatch_ref( p1, p2, p3, cp );
+
+    for( i=0; i<7; i++ ) {
+        for( j=0; j<3; j++ ) {
+            cp[i][j] += unit*qpatch->q[i][j];
+        }
+    }
+}
+
+
+///
+/// 長田パッチ 近似曲面補正（量子化パラメータ版）
+///    入力：η、ξパラメータ
+///    基準位置を制御点とする３次ベジェ曲面は平坦な三角形と一致するため、
+///    制御点を復元せず、三角形の線形補間にずれのベジェ補間を加えて求める
+///    （座標の絶対値が大きい場合の丸め誤差を抑えるため頂点１からの差で補間する）
+///
+/// @param [in]    eta          入力点座標 長田パッチ ηパラメータ
+/// @param [in]    xi           入力点座標 長田パッチ ξパラメータ
+/// @param [in]    p1           長田パッチ 頂点１座標
+/// @param [in]    p2           長田パッチ 頂点２座標
+/// @param [in]    p3           長田パッチ 頂点３座標
+/// @param [in]    qpatch       量子化した長田パッチパラメータ
+/// @param [out]   pos_o        出力点座標（曲面補正後の点）
+/// @return なし
+///
+INLINE void
+npt_correct_pnt_q(
+        NPT_REAL    eta,
+        NPT_REAL    xi,
+        NPT_REAL    p1[3],
+        NPT_REAL    p2[3],
+        NPT_REAL    p3[3],
+        const NPT_QPATCH* qpatch,
+        NPT_REAL    pos_o[3]
+    )
+{
+    NPT_REAL unit = (NPT_REAL)qpatch->scale * (NPT_REAL)( 1.0/NPT_QUANT_MAX );
+    NPT_REAL u, v, w, b[7];
+    int      i, j;
+
+    // npt_correct_pnt() と同じ u,v,w と制御点の重み
+    u = eta - xi;
+    v = xi;
+    w = 1.0 - eta;
+    b[0] = 3.0*u*w*w;   b[1] = 3.0*u*u*w;
+    b[2] = 3.0*u*u*v;   b[3] = 3.0*u*v*v;
+    b[4] = 3.0*v*v*w;   b[5] = 3.0*v*w*w;
+    b[6] = 6.0*u*v*w;
+
+    for( j=0; j<3; j++ ) {
+        NPT_REAL d = 0.0;
+        for( i=0; i<7; i++ ) d += b[i]*qpatch->q[i][j];
+        pos_o[j] = p1[j] + ( u*( p2[j] - p1[j] ) + v*( p3[j] - p1[j] ) + unit*d );
+    }
+}
+
+
+///
+/// 長田パッチパラメータの量子化
+///
+/// @param [in]    p1           長田パッチ 頂点１座標
+/// @param [in]    p2           長田パッチ 頂点２座標
+/// @param [in]    p3           長田パッチ 頂点３座標
+/// @param [in]    cp           長田パッチパラメータ（制御点 cp_side1_1-cp_center の順）
+/// @param [out]   qpatch       量子化した長田パッチパラメータ
+/// @return 制御点の誤差（ユークリッド距離）の上限 sqrt(3)*scale/(2*NPT_QUANT_MAX)
+///
+NPT_REAL
+npt_qpatch_encode(
+        NPT_REAL    p1[3],
+        NPT_REAL    p2[3],
+        NPT_REAL    p3[3],
+        NPT_REAL    cp[7][3],
+        NPT_QPATCH* qpatch
+    );
+
+
+///
+/// 長田パッチパラメータの量子化（複数パッチ）
+///
+/// @param [in]    num          パッチ数
+/// @param [in]    tri          三角形の頂点座標 tri[i][0-2]
+/// @param [in]    npatch       長田パッチパラメータ npatch[i][0-6]
+/// @param [out]   qpatch       量子化した長田パッチパラメータ [num]
+/// @return 制御点の誤差（ユークリッド距離）の上限の最大値
+///
+NPT_REAL
+npt_qpatch_encode_n(
+        int         num,
+        NPT_REAL    tri[][3][3],
+        NPT_REAL    npatch[][7][3],
+        NPT_QPATCH* qpatch
+    );
+
+
+///
+/// 長田パッチ 近似曲面補正（量子化パラメータ版 複数点）
+///    点iはパッチ tri_id[i] 上の (eta[i], xi[i]) とする
+///
+/// @param [in]    num          点数
+/// @param [in]    tri_id       パッチ番号 [num]
+/// @param [in]    eta          ηパラメータ [num]
+/// @param [in]    xi           ξパラメータ [num]
+/// @param [in]    tri          三角形の頂点座標
+/// @param [in]    qpatch       量子化した長田パッチパラメータ
+/// @param [out]   pos_o        出力点座標 [num]
+/// @return なし
+///
+void
+npt_correct_pnt_q_n(
+        int         num,
+        const int*  tri_id,
+        NPT_REAL*   eta,
+        NPT_REAL*   xi,
+        NPT_REAL    tri[][3][3],
+        const NPT_QPATCH* qpatch,
+        NPT_REAL    pos_o[][3]
+    );
+
+#ifdef __cplusplus
+} // extern "C" or extern
+#else
+#endif
+
+
+#endif // _NPT_QUANT_H_
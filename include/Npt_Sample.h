@@ -0,0 +1,95 @@
+#ifndef _NPT_SAMPLE_H_
+#define _NPT_SAMPLE_H_
+
+/*
+ * Npatch - Nagata Patch Library
+ *
+ * Copyright (c) 2015-2016 Advanced Institute for Computational Science, RIKEN.
+ * All rights reserved.
+ *
+ */
+
+////////////////////////////////////////////////////////////////////////////
+///
+/// 長田パッチ 曲面上の点の一様配置（ポアソンディスク） 関数 (C++/C)
+///
+///   曲面上に互いの距離が spacing 以上となる点を、曲面の面積に対して一様に配置する。
+///       候補点   : パッチの面積（npt_integ_area_mesh）に比例した数
+///                  （面積 spacing^2 あたり NPT_SAMPLE_DENSITY 個）の候補点を、
+///                  パッチ上に面積要素 |x_eta × x_xi| に比例する確率で配置する。
+///       選択     : 一辺 spacing の格子のセルのハッシュ値で候補点を並べ替え（空間ハッシュ、
+///                  ハッシュ値は 4x4x4 セルのブロック単位とし近傍のセルを連続した位置に置く）、
+///                  候補点を順に、近傍27セルの採用済みの点との距離が spacing 以上の場合に採用する。
+///   並列化
+///       候補点の生成、並べ替え、出力は三角形、候補点単位のスレッド並列とする。
+///       選択はセル座標の偶奇による８つのグループごとに、同じグループのセル（互いに隣接しない）を
+///       並列に処理する。各セルは候補点を乱数の優先度順に１点ずつ処理し（ラウンド）、
+///       全グループを１点ずつ繰り返すことで、グループによる密度の偏りを抑える。
+///   乱数は三角形番号、候補点番号から求めるため、結果はスレッド数によらず一致する。
+///
+///   距離は３次元の直線距離とする。採用される点の密度は面積 spacing^2 あたり約0.5点である。
+///   作業領域は候補点あたり約 75 バイト（倍精度）を使用する。
+///
+////////////////////////////////////////////////////////////////////////////
+
+#include "Npt_Mesh.h"
+
+#ifdef __cplusplus
+extern "C" {  // for C++
+#else
+#endif
+
+#define NPT_SAMPLE_DENSITY    3.0     ///< 候補点の密度（面積 spacing^2 あたりの候補点数）
+#define NPT_SAMPLE_CELL_BITS  21      ///< セル座標のビット数（１方向のセル数の上限 2^21）
+
+///
+/// 曲面上の点
+///
+typedef struct {
+    long long    num;        ///< 点数
+    int*         tri;        ///< 三角形番号 [num]
+    NPT_REAL*    eta;        ///< ηパラメータ [num]
+    NPT_REAL*    xi;         ///< ξパラメータ [num]
+    NPT_REAL   (*pos)[3];    ///< 曲面上の座標 [num]
+    NPT_REAL   (*norm)[3];   ///< 単位法線ベクトル [num]
+    long long    num_cand;   ///< 候補点数
+} NPT_SAMPLE;
+
+
+///
+/// 曲面上の点の一様配置
+///    点は三角形番号順（同じ三角形では候補点の生成順）に格納する
+///
+/// @param [in]    mesh         三角形メッシュ（vtx_norm 設定済み）
+/// @param [in]    spacing      点の最小距離
+/// @param [in]    seed         乱数の種
+/// @param [out]   res          曲面上の点（npt_sample_free() で解放）
+/// @return リターンコード   =0 正常  !=0 異常（メモリ確保失敗、spacing 不正、セル数が上限を超える）
+///
+int
+npt_sample_mesh(
+        NPT_MESH*     mesh,
+        NPT_REAL      spacing,
+        unsigned int  seed,
+        NPT_SAMPLE*   res
+    );
+
+
+///
+/// 曲面上の点の領域解放
+///
+/// @param [inout] res          曲面上の点
+/// @return なし
+///
+void
+npt_sample_free(
+        NPT_SAMPLE*   res
+    );
+
+#ifdef __cplusplus
+} // extern "C" or extern
+#else
+#endif
+
+
+#endif // _NPT_SAMPLE_H_
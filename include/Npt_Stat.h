@@ -0,0 +1,218 @@
+#ifndef _NPT_STAT_H_
+#define _NPT_STAT_H_
+
+/*
+ * Npatch - Nagata Patch Library
+ *
+ * Copyright (c) 2015-2016 Advanced Institute for Computational Science, RIKEN.
+ * All rights reserved.
+ *
+ */
+
+////////////////////////////////////////////////////////////////////////////
+///
+/// 長田パッチ 実行時統計（縮退処理の回数、処理時間） 関数 (C++/C)
+///
+///   制御点計算の縮退処理（中点による代替、逆行補正）の発生回数と
+///   処理段階ごとの処理時間をスレッド単位に集計する。
+///
+///   有効化
+///       ビルド時  : -D_NPT_STAT_ （cmake -Dwith_stat=ON）で計測処理を組み込む。
+///                   指定しない場合、計測処理は組み込まれず（オーバーヘッドなし）、
+///                   npt_stat_get() は常に０を返す。
+///       実行時    : 環境変数 NPT_STAT=レベル または npt_stat_enable(レベル) で計測を開始する。
+///                     1 : カウンタ、複数パッチ一括処理関数（*_n）のタイマ
+///                     2 : 1 に加え、パッチ単位、辺単位のタイマ
+///                   停止時（レベル0）のオーバーヘッドはフラグ判定のみ。
+///
+///   計測時のオーバーヘッド
+///       カウンタはスレッドごとの領域への加算のみ（排他制御なし）。
+///       レベル2のタイマは区間ごとに時刻を２回取得するため、１パッチあたり
+///       数百ns程度の負荷となる（処理時間の内訳を見る場合のみ使用する）。
+///
+///   スレッド番号（omp_get_thread_num()）が NPT_STAT_MAX_THREAD 以上の場合、
+///   および入れ子の並列領域では複数スレッドが同じ領域に加算するため、
+///   値は概数となる。
+///
+////////////////////////////////////////////////////////////////////////////
+
+#include "Npt.h"
+
+#ifdef __cplusplus
+extern "C" {  // for C++
+#else
+#endif
+
+/// 集計する最大スレッド数
+#define NPT_STAT_MAX_THREAD  256
+
+///
+/// カウンタ種類
+///
+enum {
+    NPT_STAT_PARAM_CRT = 0,      ///< npt_param_crt 呼び出し回数（パッチ数）
+    NPT_STAT_P11,                ///< 制御点p11計算回数（辺数）
+    NPT_STAT_P11_PARALLEL,       ///< 中点代替：両端の接平面が平行
+    NPT_STAT_P11_PERPENDICULAR,  ///< 中点代替：辺と法線が直交（接平面と辺が重なる）
+    NPT_STAT_P11_NO_LINE,        ///< 中点代替：接平面の交線なし（CalcIntersectionLine 失敗）
+    NPT_STAT_CORRECT_START,      ///< 逆行補正：始点側
+    NPT_STAT_CORRECT_END,        ///< 逆行補正：終点側
+    NPT_STAT_CORRECT_FAIL,       ///< 逆行補正の交点計算失敗（中点代替）
+    NPT_STAT_NUM_COUNTER
+};
+
+///
+/// タイマ種類
+///
+enum {
+    NPT_STAT_T_PARAM_CRT = 0,    ///< npt_param_crt（パッチ単位、レベル2）
+    NPT_STAT_T_P11,              ///< npt_param_calcP11（辺単位、レベル2）
+    NPT_STAT_T_CORRECT_P11,      ///< npt_param_correctP11（辺単位、レベル2）
+    NPT_STAT_T_PARAM_CRT_N,      ///< npt_param_crt_n
+    NPT_STAT_T_CVT_POS_N,        ///< npt_cvt_pos_to_eta_xi_n
+    NPT_STAT_T_CORRECT_PNT_N,    ///< npt_correct_pnt_n
+    NPT_STAT_T_CORRECT_PNT2_N,   ///< npt_correct_pnt2_n
+    NPT_STAT_T_MOVE_VERTEX_N,    ///< npt_move_vertex_n
+    NPT_STAT_T_SUBDIV_N,         ///< npt_subdiv_n
+    NPT_STAT_T_PARAM_UPDATE_N,   ///< npt_param_update_n
+    NPT_STAT_NUM_TIMER
+};
+
+///
+/// 統計値（全スレッドの合計）
+///
+typedef struct {
+    long long  count[NPT_STAT_NUM_COUNTER];  ///< カウンタ
+    double     time [NPT_STAT_NUM_TIMER];    ///< 処理時間の合計 (sec)（スレッドの合計）
+    long long  ntime[NPT_STAT_NUM_TIMER];    ///< 計測回数
+} NPT_STAT;
+
+
+///
+/// 計測処理が組み込まれているか
+///
+/// @return =1 組み込みあり(-D_NPT_STAT_)  =0 なし
+///
+int
+npt_stat_available( void );
+
+
+///
+/// 計測の開始/停止
+///
+/// @param [in]    level        =0 停止  =1 カウンタ、一括処理関数のタイマ  =2 全タイマ
+/// @return なし
+///
+void
+npt_stat_enable(
+        int  level
+    );
+
+
+///
+/// 計測レベルの取得
+///
+/// @return 計測レベル（=0 停止中）
+///
+int
+npt_stat_is_enabled( void );
+
+
+///
+/// 統計値の取得（全スレッドの合計）
+///
+/// @param [out]   stat         統計値
+/// @return なし
+/// @attention
+///     並列領域の外で呼び出すこと
+///
+void
+npt_stat_get(
+        NPT_STAT*  stat
+    );
+
+
+///
+/// 統計値のリセット
+///
+/// @return なし
+/// @attention
+///     並列領域の外で呼び出すこと
+///
+void
+npt_stat_reset( void );
+
+
+///
+/// カウンタ名の取得
+///
+/// @param [in]    id           カウンタ種類
+/// @return カウンタ名（範囲外は NULL）
+///
+const char*
+npt_stat_counter_name(
+        int  id
+    );
+
+
+///
+/// タイマ名の取得
+///
+/// @param [in]    id           タイマ種類
+/// @return タイマ名（範囲外は NULL）
+///
+const char*
+npt_stat_timer_name(
+        int  id
+    );
+
+
+///
+/// 統計値の出力
+///
+/// @param [in]    fp           出力先
+/// @return なし
+///
+void
+npt_stat_print(
+        FILE*  fp
+    );
+
+
+////////////////////////////////////////////////////////////////////////////
+///
+/// ライブラリ内部の計測用マクロ
+///
+////////////////////////////////////////////////////////////////////////////
+
+#ifdef _NPT_STAT_
+
+extern int npt_stat_flag;
+
+void   npt_stat_add_count( int id );
+void   npt_stat_add_time ( int id, double t0 );
+double npt_stat_wtime( void );
+
+#define NPT_STAT_COUNT(id)       do{ if( npt_stat_flag ) npt_stat_add_count( id ); }while(0)
+#define NPT_STAT_TIME_START(t0)  double t0 = ( npt_stat_flag ? npt_stat_wtime() : 0.0 )
+#define NPT_STAT_TIME_END(id,t0) do{ if( npt_stat_flag ) npt_stat_add_time( id, t0 ); }while(0)
+#define NPT_STAT_TIME_START2(t0)  double t0 = ( npt_stat_flag >= 2 ? npt_stat_wtime() : 0.0 )
+#define NPT_STAT_TIME_END2(id,t0) do{ if( npt_stat_flag >= 2 ) npt_stat_add_time( id, t0 ); }while(0)
+
+#else
+
+#define NPT_STAT_COUNT(id)
+#define NPT_STAT_TIME_START(t0)
+#define NPT_STAT_TIME_END(id,t0)
+#define NPT_STAT_TIME_START2(t0)
+#define NPT_STAT_TIME_END2(id,t0)
+
+#endif
+
+#ifdef __cplusplus
+} // extern "C" or extern
+#else
+#endif
+
+
+#endif // _NPT_STAT_H_
@@ -0,0 +1,95 @@
+#ifndef _NPT_STL_H_
+#define _NPT_STL_H_
+
+/*
+ * Npatch - Nagata Patch Library
+ *
+ * Copyright (c) 2015-2016 Advanced Institute for Computational Science, RIKEN.
+ * All rights reserved.
+ *
+ */
+
+////////////////////////////////////////////////////////////////////////////
+///
+/// STLファイル読み込み (C++/C)
+///   - ファイルはmmapでマップし、三角形の範囲をスレッドに分割して
+///     SoA形式の配列に直接格納する
+///   - バイナリSTL/アスキーSTLともに対応する（自動判定）
+///   - スレッド並列はOpenMPを使用する（-Dwith_OMP=ON でビルドした場合）
+///
+////////////////////////////////////////////////////////////////////////////
+
+#include "Npt.h"
+
+#ifdef __cplusplus
+extern "C" {  // for C++
+#else
+#endif
+
+// リターンコード
+#define NPT_STL_OK          0   ///< 正常
+#define NPT_STL_ERR_OPEN    1   ///< ファイルオープン/マップ失敗
+#define NPT_STL_ERR_FORMAT  2   ///< フォーマット不正
+#define NPT_STL_ERR_MEMORY  3   ///< メモリ確保失敗
+
+///
+/// STLデータ（SoA形式）
+///    三角形iの頂点j(0-2)の座標は x[3*i+j], y[3*i+j], z[3*i+j]
+///    三角形iの面の法線ベクトルは nx[i], ny[i], nz[i]
+///    面の法線ベクトルはファイルに記述された値をそのまま格納する
+///
+typedef struct {
+    int        num_tri;   ///< 三角形数
+    NPT_REAL*  x;         ///< 頂点X座標 [num_tri*3]
+    NPT_REAL*  y;         ///< 頂点Y座標 [num_tri*3]
+    NPT_REAL*  z;         ///< 頂点Z座標 [num_tri*3]
+    NPT_REAL*  nx;        ///< 面の法線ベクトルX成分 [num_tri]
+    NPT_REAL*  ny;        ///< 面の法線ベクトルY成分 [num_tri]
+    NPT_REAL*  nz;        ///< 面の法線ベクトルZ成分 [num_tri]
+} NPT_STL;
+
+
+///
+/// STLファイル読み込み
+///
+/// @param [in]    file_name    STLファイル名
+/// @param [out]   stl          STLデータ（領域は内部で確保する）
+/// @return リターンコード   =NPT_STL_OK 正常  !=NPT_STL_OK 異常
+/// @attention
+///     バイナリ/アスキーの判定はファイルサイズ(84+50*三角形数)で行う。
+///     サイズが一致しない場合はアスキーとして読み込み、三角形が無い場合または
+///     フォーマット不正の場合に、サイズが 84+50*三角形数 より大きければ
+///     （末尾に余分なデータがあるバイナリ）バイナリとして読み込む。
+///     いずれでも三角形が無い場合は NPT_STL_ERR_FORMAT とする（84byte の三角形数0のバイナリを除く）。
+///     アスキーSTLは各三角形（"facet normal" から "endfacet" まで）の "vertex" がちょうど３つで、
+///     数値の直後が空白であること（それ以外は NPT_STL_ERR_FORMAT）。
+///     バイナリSTLはリトルエンディアンの単精度実数として読み込む。
+///     三角形数は INT_MAX/3 までとする（超える場合は NPT_STL_ERR_MEMORY）。
+/// @attention
+///     使用後は npt_stl_free() で領域を解放すること
+///
+int
+npt_stl_read(
+        const char*  file_name,
+        NPT_STL*     stl
+    );
+
+
+///
+/// STLデータ領域解放
+///
+/// @param [inout] stl          STLデータ
+/// @return なし
+///
+void
+npt_stl_free(
+        NPT_STL*     stl
+    );
+
+#ifdef __cplusplus
+} // extern "C" or extern
+#else
+#endif
+
+
+#endif // _NPT_STL_H_
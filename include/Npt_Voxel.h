@@ -0,0 +1,141 @@
+#ifndef _NPT_VOXEL_H_
+#define _NPT_VOXEL_H_
+
+/*
+ * Npatch - Nagata Patch Library
+ *
+ * Copyright (c) 2015-2016 Advanced Institute for Computational Science, RIKEN.
+ * All rights reserved.
+ *
+ */
+
+////////////////////////////////////////////////////////////////////////////
+///
+/// 長田パッチ 閉曲面の内外判定によるボクセル化 関数 (C++/C)
+///
+///   直交格子の各行（y, z のセル中心を通る x 軸に平行な直線）とパッチの交点を求め、
+///   交点を x の順に並べ、交点の間（奇数番目から偶数番目）のセルを内部とする（走査線法）。
+///       交差判定 : パッチを 4^depth 個の平面三角形に分割し、yz 平面に投影した三角形と
+///                  行の点の包含判定を行う。分割点のうち辺上の点は頂点番号の小さい頂点から
+///                  辺の制御点で求め、包含判定は辺の向きを座標順に統一し、点が辺上にある場合は
+///                  記号摂動（y+ε, z+ε^2）で判定するため、辺を共有するパッチで交点の
+///                  重複、欠落がない。
+///       交点     : 平面三角形との交点から Newton 法で曲面上の交点に修正する。
+///   行を NPT_VOXEL_TILE x NPT_VOXEL_TILE のタイルに分け、タイルに掛かるパッチ（制御点の
+///   包含箱）の一覧をあらかじめ作成し、タイル単位にスレッド並列で処理する。
+///   パッチの分割はタイルごとに行い、タイル内の全ての行で再利用する。
+///
+///   結果はセルあたり１ビット（1:内部 0:外部）とし、x 方向の行を 32 ビット単位の語に
+///   詰めて格納する（10^9 セルで約 125MB）。タイルは互いに異なる行を書き込むため、
+///   結果はスレッド数によらない。
+///
+///   交点の数が奇数の行（閉じていない曲面、自己交差）は最後の交点以降を外部とする。
+///   分割三角形と曲面のずれ（分割の深さとともに小さくなる）のため、曲面に接する行では
+///   交点の組の有無が曲面と異なる場合がある。
+///
+///   切断セル（npt_voxel_cut）は、セルの行あたり複数の走査線（セル内部に nsub x nsub 本、
+///   y, z の下側の面上に各 nsub 本）と曲面の交点を同じ方法で求め、走査線ごとの曲面の外部
+///   （流体）の長さからセルの体積率、下側の x, y, z の面の開口率を求める。x 方向には交点で
+///   区切った厳密な長さ、y, z 方向には走査線の中点則による近似（誤差 O(1/nsub^2)）となる。
+///   交点または曲面の内外が混在する走査線のあるセル（曲面近傍の帯）のみを出力する。
+///
+////////////////////////////////////////////////////////////////////////////
+
+#include "Npt_Mesh.h"
+
+#ifdef __cplusplus
+extern "C" {  // for C++
+#else
+#endif
+
+#define NPT_VOXEL_MAX_DEPTH   4      ///< パッチの分割の深さの最大値
+#define NPT_VOXEL_TILE       32      ///< タイルの１辺の行数
+#define NPT_VOXEL_MAX_SUB    16      ///< 切断セルの辺あたりの走査線の分割数の最大値
+
+/// x 方向の行あたりの語数
+#define NPT_VOXEL_ROW_WORDS(nx)   ( ((nx) + 31) / 32 )
+
+/// セル (i,j,k) のビット（grid は NPT_VOXEL_GRID*）
+#define NPT_VOXEL_GET(flag, grid, i, j, k) \
+    ( ( (flag)[ ((size_t)(k)*(grid)->size[1] + (j))*NPT_VOXEL_ROW_WORDS((grid)->size[0]) + (i)/32 ] >> ((i)%32) ) & 1u )
+
+///
+/// 直交格子
+///
+typedef struct {
+    NPT_REAL   org[3];       ///< 原点（セル (0,0,0) の最小座標）
+    NPT_REAL   pitch[3];     ///< セルの大きさ
+    int        size[3];      ///< セル数 nx, ny, nz
+} NPT_VOXEL_GRID;
+
+///
+/// 切断セル
+///
+///   順序はタイル（z, y の順）、タイル内のセルの行（k, j の順）、i の順とし、スレッド数によらない。
+///   出力されないセルは全体が流体または固体（npt_voxel_mesh() のフラグで判別）。
+///   格子の上側の境界の面（i=nx, j=ny, k=nz）の開口率は出力しない。
+///
+typedef struct {
+    long long    num;        ///< 切断セル数
+    int        (*idx)[3];    ///< セル番号 (i,j,k) [num]
+    NPT_REAL*    vol;        ///< 流体（曲面の外部）の体積率 [num]
+    NPT_REAL   (*area)[3];   ///< 下側の x, y, z の面（x=org+i*pitch 等）の流体の開口率 [num]
+} NPT_VOXEL_CUT;
+
+
+///
+/// 閉曲面のボクセル化
+///
+/// @param [in]    mesh         三角形メッシュ（vtx_norm 設定済み、閉曲面）
+/// @param [in]    grid         直交格子
+/// @param [in]    depth        パッチの分割の深さ（0-NPT_VOXEL_MAX_DEPTH、通常は 2）
+/// @param [out]   flag         セルの内外フラグ [nz*ny*NPT_VOXEL_ROW_WORDS(nx)]（呼び出し側で確保）
+/// @return リターンコード   =0 正常  =1 異常（メモリ確保失敗、引数不正）  =2 交点の数が奇数の行がある
+///
+int
+npt_voxel_mesh(
+        NPT_MESH*              mesh,
+        const NPT_VOXEL_GRID*  grid,
+        int                    depth,
+        unsigned int*          flag
+    );
+
+
+///
+/// 切断セルの体積率と面の開口率
+///
+/// @param [in]    mesh         三角形メッシュ（vtx_norm 設定済み、閉曲面）
+/// @param [in]    grid         直交格子
+/// @param [in]    depth        パッチの分割の深さ（0-NPT_VOXEL_MAX_DEPTH、通常は 2）
+/// @param [in]    nsub         セルの辺あたりの走査線の分割数（1-NPT_VOXEL_MAX_SUB、通常は 4）
+/// @param [out]   cut          切断セル（npt_voxel_cut_free() で解放）
+/// @return リターンコード   =0 正常  =1 異常（メモリ確保失敗、引数不正）  =2 交点の数が奇数の走査線がある
+///
+int
+npt_voxel_cut(
+        NPT_MESH*              mesh,
+        const NPT_VOXEL_GRID*  grid,
+        int                    depth,
+        int                    nsub,
+        NPT_VOXEL_CUT*         cut
+    );
+
+
+///
+/// 切断セルの領域解放
+///
+/// @param [inout] cut          切断セル
+/// @return なし
+///
+void
+npt_voxel_cut_free(
+        NPT_VOXEL_CUT*         cut
+    );
+
+#ifdef __cplusplus
+} // extern "C" or extern
+#else
+#endif
+
+
+#endif // _NPT_VOXEL_H_
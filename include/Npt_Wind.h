@@ -0,0 +1,159 @@
+#ifndef _NPT_WIND_H_
+#define _NPT_WIND_H_
+
+/*
+ * Npatch - Nagata Patch Library
+ *
+ * Copyright (c) 2015-2016 Advanced Institute for Computational Science, RIKEN.
+ * All rights reserved.
+ *
+ */
+
+////////////////////////////////////////////////////////////////////////////
+///
+/// 長田パッチ 一般化巻き数による点の内外判定 関数 (C++/C)
+///
+///   点 q の一般化巻き数（曲面が q を見込む立体角 / 4π）
+///       w(q) = 1/(4π) ∫ (x-q).N / |x-q|^3 dA      （N は外向き単位法線）
+///   を求める。閉曲面（三角形の頂点の並びが外向き法線の右回り）では内部で 1、外部で 0 となり、
+///   穴、重なりのある曲面でも滑らかに変化するため、w > 0.5 を内部とする判定は
+///   走査線の交点の偶奇による判定（npt_voxel_mesh）と異なり閉じていない曲面にも使える。
+///
+///   パッチの包含箱の階層（NPT_BVH）の節点ごとに、節点のパッチの曲面積分による
+///   多重極展開（展開中心 c、双極子 D = ∫N dA、２次 C = ∫(x-c)N^T dA）を作成し、
+///       遠方 : |q-c| > beta * r（r は c を中心とし節点のパッチの制御点を含む球の半径）の節点は
+///              ２次までの展開で近似する
+///       近傍 : 葉の節点のパッチを曲面上で求積する。包含箱の対角長に比べて近い点は
+///              npt_subdiv() で再帰的に４分割し、分割の深さが NPT_WIND_MAX_DEPTH の子パッチは
+///              頂点の平面三角形の立体角（厳密な式）とする。
+///   展開の誤差は (r/|q-c|)^3 程度であり、beta が大きいほど正確で遅い（通常は 2）。
+///   点単位に OpenMP でスレッド並列に処理し、結果はスレッド数によらない。積分は倍精度で行う。
+///
+////////////////////////////////////////////////////////////////////////////
+
+#include "Npt_Mesh.h"
+#include "Npt_Bvh.h"
+
+#ifdef __cplusplus
+extern "C" {  // for C++
+#else
+#endif
+
+#define NPT_WIND_MAX_DEPTH   6     ///< 近傍のパッチの分割の深さの最大値
+
+///
+/// 多重極展開（パッチ、または節点のパッチの和）
+///
+typedef struct {
+    double     area;         ///< 表面積
+    double     cen[3];       ///< 展開中心（面積重心）
+    double     rad;          ///< 展開中心から制御点までの最大距離
+    double     dip[3];       ///< 双極子 ∫N dA
+    double     quad[3][3];   ///< ２次 ∫(x-cen)_i N_j dA
+} NPT_WIND_MOMENT;
+
+///
+/// 一般化巻き数の評価用データ
+///
+typedef struct {
+    int                num;      ///< パッチ数
+    NPT_REAL         (*tri)[3][3]; ///< 三角形の頂点座標 [num]
+    NPT_REAL         (*cp)[7][3];  ///< 長田パッチパラメータ [num]
+    NPT_WIND_MOMENT*   patch;    ///< パッチの展開 [num]
+    NPT_WIND_MOMENT*   node;     ///< 節点の展開 [bvh.num_node]
+    NPT_BVH            bvh;      ///< パッチの包含箱の階層
+} NPT_WIND;
+
+
+///
+/// 一般化巻き数の評価用データの作成（複数パッチ）
+///
+/// @param [in]    num          三角形数
+/// @param [in]    tri          三角形の頂点座標 [num]
+/// @param [in]    npatch       長田パッチパラメータ [num]
+/// @param [out]   wind         評価用データ（npt_wind_free() で解放）
+/// @return リターンコード   =0 正常  !=0 異常（メモリ確保失敗）
+///
+int
+npt_wind_crt_n(
+        int          num,
+        NPT_REAL     tri   [][3][3],
+        NPT_REAL     npatch[][7][3],
+        NPT_WIND*    wind
+    );
+
+
+///
+/// 一般化巻き数の評価用データの作成（三角形メッシュ）
+///    長田パッチパラメータは npt_mesh_param_get() で三角形ごとに求める
+///
+/// @param [in]    mesh         三角形メッシュ（vtx_norm 設定済み）
+/// @param [out]   wind         評価用データ（npt_wind_free() で解放）
+/// @return リターンコード   =0 正常  !=0 異常（メモリ確保失敗）
+///
+int
+npt_wind_crt(
+        NPT_MESH*    mesh,
+        NPT_WIND*    wind
+    );
+
+
+///
+/// 一般化巻き数の評価用データの領域解放
+///
+/// @param [inout] wind         評価用データ
+/// @return なし
+///
+void
+npt_wind_free(
+        NPT_WIND*    wind
+    );
+
+
+///
+/// 一般化巻き数（複数点）
+///
+/// @param [in]    wind         評価用データ
+/// @param [in]    num          点数
+/// @param [in]    pos          点の座標 [num]
+/// @param [in]    beta         遠方の展開を使う距離（展開の半径との比 >0、通常は 2）
+/// @param [out]   wn           一般化巻き数 [num]
+/// @return リターンコード   =0 正常  !=0 異常（beta 不正）
+///
+int
+npt_wind_eval_n(
+        const NPT_WIND*  wind,
+        int              num,
+        NPT_REAL         pos[][3],
+        NPT_REAL         beta,
+        NPT_REAL*        wn
+    );
+
+
+///
+/// 点の内外判定（複数点）
+///    一般化巻き数が 0.5 より大きい点を内部とする
+///
+/// @param [in]    wind         評価用データ
+/// @param [in]    num          点数
+/// @param [in]    pos          点の座標 [num]
+/// @param [in]    beta         遠方の展開を使う距離（展開の半径との比 >0、通常は 2）
+/// @param [out]   inside       内外フラグ（1:内部 0:外部） [num]
+/// @return リターンコード   =0 正常  !=0 異常（beta 不正）
+///
+int
+npt_wind_inside_n(
+        const NPT_WIND*  wind,
+        int              num,
+        NPT_REAL         pos[][3],
+        NPT_REAL         beta,
+        unsigned char*   inside
+    );
+
+#ifdef __cplusplus
+} // extern "C" or extern
+#else
+#endif
+
+
+#endif // _NPT_WIND_H_
@@ -63,7 +63,7 @@ echo -I@NPT_DIR@/include
 ;;
 
 --libs)
-echo -L@NPT_DIR@/lib -l@NPT_LIB@
+echo -L@NPT_DIR@/lib -l@NPT_LIB@ @OMP_FLAGS@
 ;;
 
 *)
@@ -160,3 +160,107 @@ fnpt_move_vertex_ (
             cp_side3_1_n, cp_side3_2_n, cp_center_n
         );
 }
+
+
+// 長田パッチパラメータ生成（複数パッチ）
+void
+fnpt_param_crt_n_ (
+        int*      num,
+        NPT_REAL  tri     [][3][3],
+        NPT_REAL  tri_norm[][3][3],
+        NPT_REAL  npatch  [][7][3],
+        int*      ret
+   )
+{
+    *ret = npt_param_crt_n( *num, tri, tri_norm, npatch );
+}
+
+
+// 長田パッチパラメータ更新（複数パッチ、フレーム間の再利用）
+void
+fnpt_param_update_n_ (
+        int*      num,
+        NPT_REAL  tri         [][3][3],
+        NPT_REAL  tri_norm    [][3][3],
+        NPT_REAL* tol,
+        NPT_REAL  tri_ref     [][3][3],
+        NPT_REAL  tri_norm_ref[][3][3],
+        NPT_REAL  npatch      [][7][3],
+        int*      num_state,
+        int*      ret
+   )
+{
+    *ret = npt_param_update_n( *num, tri, tri_norm, *tol, tri_ref, tri_norm_ref, npatch, num_state );
+}
+
+
+// 長田パッチ η、ξパラメータ取得（複数点）
+void
+fnpt_cvt_pos_to_eta_xi_n_ (
+        int*      num,
+        NPT_REAL  pos[][3],
+        NPT_REAL  tri[][3][3],
+        NPT_REAL* eta,
+        NPT_REAL* xi
+     )
+{
+    npt_cvt_pos_to_eta_xi_n( *num, pos, tri, eta, xi );
+}
+
+
+// 長田パッチ 近似曲面補正（複数点）
+//    入力：η、ξパラメータ
+void
+fnpt_correct_pnt_n_ (
+        int*      num,
+        NPT_REAL* eta,
+        NPT_REAL* xi,
+        NPT_REAL  tri   [][3][3],
+        NPT_REAL  npatch[][7][3],
+        NPT_REAL  pos_o [][3]
+    )
+{
+    npt_correct_pnt_n( *num, eta, xi, tri, npatch, pos_o );
+}
+
+
+// 長田パッチ 近似曲面補正（複数点）
+void
+fnpt_correct_pnt2_n_ (
+        int*      num,
+        NPT_REAL  pos   [][3],
+        NPT_REAL  tri   [][3][3],
+        NPT_REAL  npatch[][7][3],
+        NPT_REAL  pos_o [][3]
+    )
+{
+    npt_correct_pnt2_n( *num, pos, tri, npatch, pos_o );
+}
+
+
+// 長田パッチ 頂点移動に伴う長田パッチパラメータ更新（複数パッチ）
+void
+fnpt_move_vertex_n_ (
+        int*      num,
+        NPT_REAL  tri     [][3][3],
+        NPT_REAL  npatch  [][7][3],
+        NPT_REAL  tri_n   [][3][3],
+        NPT_REAL  npatch_n[][7][3]
+    )
+{
+    npt_move_vertex_n( *num, tri, npatch, tri_n, npatch_n );
+}
+
+
+// 長田パッチ １-４分割（複数パッチ）
+void
+fnpt_subdiv_n_ (
+        int*      num,
+        NPT_REAL  tri     [][3][3],
+        NPT_REAL  npatch  [][7][3],
+        NPT_REAL  tri_o   [][3][3],
+        NPT_REAL  npatch_o[][7][3]
+    )
+{
+    npt_subdiv_n( *num, tri, npatch, tri_o, npatch_o );
+}
@@ -16,6 +16,7 @@
 
 #include "CalcGeo.h"
 #include "Npt.h"
+#include "Npt_Stat.h"
 #include <stdlib.h>
 
 //------------------------------------------------------------------
@@ -73,6 +74,9 @@ npt_param_crt(
 {
     NPT_REAL d1, d2, d3;
 
+    NPT_STAT_COUNT( NPT_STAT_PARAM_CRT );
+    NPT_STAT_TIME_START2( t_stat );
+
     // 接平面：平面の方程式 D 計算
     //    平面の方程式  Ax + By + Cz = D
     d1 = CalcPlaneD( p1, norm1 );
@@ -138,6 +142,8 @@ npt_param_crt(
            cp_center    // [out] 中央制御点
         );
 
+    NPT_STAT_TIME_END2( NPT_STAT_T_PARAM_CRT, t_stat );
+
     return 0;
 }
 
@@ -192,6 +198,7 @@ npt_param_calcControlPointEdge(
 
     // 制御点p11取得
     //     2次多項式と同様
+    NPT_STAT_TIME_START2( t_p11 );
     npt_param_calcP11(
               p1,        // [in]  頂点１座標
               norm1,     // [in]  頂点１ベクトル
@@ -202,8 +209,10 @@ npt_param_calcControlPointEdge(
               norm_base, // [in]  曲線平面II（基準面）の法線ベクトル
               p11        // [out] 制御点座標
          );
+    NPT_STAT_TIME_END2( NPT_STAT_T_P11, t_p11 );
 
     // 制御点p11逆行補正対応
+    NPT_STAT_TIME_START2( t_correct );
     npt_param_correctP11(
               p11,       // [in]  制御点座標
               p1,        // [in]  頂点１座標
@@ -212,6 +221,7 @@ npt_param_calcControlPointEdge(
               p11_0,     // [out] 制御点座標（補正後 1番目の制御点用）
               p11_1      // [out] 制御点座標（補正後 2番目の制御点用）
          );
+    NPT_STAT_TIME_END2( NPT_STAT_T_CORRECT_P11, t_correct );
 
     // 制御点(3次多項式用) 設定
     cp1_e[0] = ( p1[0] + 2.0*p11_0[0] ) / 3.0;
@@ -292,11 +302,14 @@ npt_param_calcP11(
     NPT_REAL d_pos_x_base;   // 基準面 pos_xでの原点からの距離(+-)
 
 
+    NPT_STAT_COUNT( NPT_STAT_P11 );
+
     //------------------------------------------------
     // 平面の並行判定
     //------------------------------------------------
     NPT_REAL asw = CalcInProduct( norm1, norm2 );
     if( (1.0-fabs(asw)) < NPT_ALW_V ) { // 平面が同方向
+        NPT_STAT_COUNT( NPT_STAT_P11_PARALLEL );
         // 制御点座標をp1,p2の中点とする
         p11[0] = ( p1[0] + p2[0] ) / 2.0;
         p11[1] = ( p1[1] + p2[1] ) / 2.0;
@@ -312,6 +325,7 @@ npt_param_calcP11(
     CalcNormalize( vec_p1p2 );
     asw = CalcInProduct( vec_p1p2, norm1 );
     if( fabs(asw) < NPT_ALW_V ) {
+        NPT_STAT_COUNT( NPT_STAT_P11_PERPENDICULAR );
         // 制御点座標をp1,p2の中点とする
         p11[0] = ( p1[0] + p2[0] ) / 2.0;
         p11[1] = ( p1[1] + p2[1] ) / 2.0;
@@ -320,6 +334,7 @@ npt_param_calcP11(
     }
     asw = CalcInProduct( vec_p1p2, norm2 );
     if( fabs(asw) < NPT_ALW_V ) {
+        NPT_STAT_COUNT( NPT_STAT_P11_PERPENDICULAR );
         // 制御点座標をp1,p2の中点とする
         p11[0] = ( p1[0] + p2[0] ) / 2.0;
         p11[1] = ( p1[1] + p2[1] ) / 2.0;
@@ -344,6 +359,7 @@ npt_param_calcP11(
     } else {
         // 交線なし
         // 制御点座標をp1,p2の中点とする
+        NPT_STAT_COUNT( NPT_STAT_P11_NO_LINE );
         p11[0] = ( p1[0] + p2[0] ) / 2.0;
         p11[1] = ( p1[1] + p2[1] ) / 2.0;
         p11[2] = ( p1[2] + p2[2] ) / 2.0;
@@ -423,10 +439,12 @@ npt_param_correctP11(
     asw = CalcInProduct( vec_p1_p2, vec_p1_p11 );
     if( asw < 0.0 ) {
         mode = -1;   // -1: 始点側逆行
+        NPT_STAT_COUNT( NPT_STAT_CORRECT_START );
     } else {
         asw = CalcInProduct( vec_p1_p2, vec_p2_p11 );
         if( asw > 0.0 ) {
             mode = 1;   // 1:終点側逆行
+            NPT_STAT_COUNT( NPT_STAT_CORRECT_END );
         } else {
             mode = 0;   // 補正なし
             p11_0[0] = p11[0]; p11_0[1] = p11[1]; p11_0[2] = p11[2];
@@ -468,6 +486,7 @@ npt_param_correctP11(
                  );
         if( !bRet ) {
             printf("#### WARNING correctP11:CalcCrossPointLine() 1-1\n");
+            NPT_STAT_COUNT( NPT_STAT_CORRECT_FAIL );
             printf("  p1 = %lg %lg %lg\n",p1[0],p1[1],p1[2]);
             printf("  p11= %lg %lg %lg\n",p11[0],p11[1],p11[2]);
             printf("  p2 = %lg %lg %lg\n",p2[0],p2[1],p2[2]);
@@ -496,6 +515,7 @@ npt_param_correctP11(
                  );
         if( !bRet ) {
             printf("#### WARNING correctP11:CalcCrossPointLine() 1-2\n");
+            NPT_STAT_COUNT( NPT_STAT_CORRECT_FAIL );
             printf("  p2 = %lg %lg %lg\n",p2[0],p2[1],p2[2]);
             printf("  p11= %lg %lg %lg\n",p11[0],p11[1],p11[2]);
             printf("  p1 = %lg %lg %lg\n",p1[0],p1[1],p1[2]);
@@ -528,6 +548,7 @@ npt_param_correctP11(
                  );
         if( !bRet ) {
             printf("#### WARNING correctP11:CalcCrossPointLine() 2-1\n");
+            NPT_STAT_COUNT( NPT_STAT_CORRECT_FAIL );
             printf("  p1 = %lg %lg %lg\n",p1[0],p1[1],p1[2]);
             printf("  p11= %lg %lg %lg\n",p11[0],p11[1],p11[2]);
             printf("  p2 = %lg %lg %lg\n",p2[0],p2[1],p2[2]);
@@ -556,6 +577,7 @@ npt_param_correctP11(
                  );
         if( !bRet ) {
             printf("#### WARNING correctP11:CalcCrossPointLine() 2-2\n");
+            NPT_STAT_COUNT( NPT_STAT_CORRECT_FAIL );
             printf("  p2 = %lg %lg %lg\n",p2[0],p2[1],p2[2]);
             printf("  p11= %lg %lg %lg\n",p11[0],p11[1],p11[2]);
             printf("  p1 = %lg %lg %lg\n",p1[0],p1[1],p1[2]);
@@ -0,0 +1,836 @@
+/*
+ * Npatch - Nagata Patch Library
+ *
+ * Copyright (c) 2015-2016 Advanced Institute for Computational Science, RIKEN.
+ * All rights reserved.
+ *
+ */
+
+////////////////////////////////////////////////////////////////////////////
+///
+/// 長田パッチ 複数パッチ一括処理 関数
+///
+////////////////////////////////////////////////////////////////////////////
+
+
+#include "CalcGeo.h"
+#include "Npt.h"
+#include "Npt_Stat.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// 命令セット別の実装（GCC/Clang、x86 のみ）
+//    ループ本体を target 属性付きで命令セット別にコンパイルし、実行時に選択する。
+//    flatten によりループ内のインライン関数を展開してからベクトル化させる。
+//    積和演算への縮約（AVX-512F は FMA 命令を含む）を止めるため、どの実装も
+//    汎用実装とビット単位で一致する。縮約はこのファイルのコンパイルオプション
+//    -ffp-contract=off（CMake で設定、configure の場合は CXXFLAGS に指定）と
+//    FP_CONTRACT プラグマ（Clang）で止める。
+//    GCC の AVX-512F 実装は SLP（基本ブロック内）ベクトル化を止める。move_vertex の
+//    ３成分の演算が２要素ベクトルと拡張レジスタ間の移動に分割され、汎用実装より遅くなるため
+//    （他の実装の生成コードは変わらない）。
+#ifdef __clang__
+#pragma STDC FP_CONTRACT OFF
+#endif
+#if ( defined(__GNUC__) || defined(__clang__) ) && ( defined(__x86_64__) || defined(__i386__) )
+#define NPT_BATCH_DISPATCH
+#define NPT_BATCH_AVX2     __attribute__(( target("avx2"), flatten ))
+#ifdef __clang__
+#define NPT_BATCH_AVX512   __attribute__(( target("avx512f"), flatten ))
+#else
+#define NPT_BATCH_AVX512   __attribute__(( target("avx512f"), optimize("no-tree-slp-vectorize"), flatten ))
+#endif
+#endif
+
+// 実装の呼び出し単位（点数、三角形数）
+#define NPT_BATCH_BLOCK  256
+
+// 命令セット別の実装（区間 [i0,i1) を処理する）
+typedef struct {
+    void (*cvt_pos)     ( int i0, int i1, NPT_REAL pos[][3], NPT_REAL tri[][3][3],
+                          NPT_REAL* eta, NPT_REAL* xi );
+    void (*correct_pnt) ( int i0, int i1, NPT_REAL* eta, NPT_REAL* xi,
+                          NPT_REAL tri[][3][3], NPT_REAL npatch[][7][3], NPT_REAL pos_o[][3] );
+    void (*correct_pnt2)( int i0, int i1, NPT_REAL pos[][3],
+                          NPT_REAL tri[][3][3], NPT_REAL npatch[][7][3], NPT_REAL pos_o[][3] );
+    void (*move_vertex) ( int i0, int i1, NPT_REAL tri[][3][3], NPT_REAL npatch[][7][3],
+                          NPT_REAL tri_n[][3][3], NPT_REAL npatch_n[][7][3] );
+} npt_batch_kern;
+
+// プロトタイプ宣言
+static void npt_batch_cvtPos( int i0, int i1, NPT_REAL pos[][3], NPT_REAL tri[][3][3],
+                              NPT_REAL* eta, NPT_REAL* xi );
+static void npt_batch_correctPnt( int i0, int i1, NPT_REAL* eta, NPT_REAL* xi,
+                                  NPT_REAL tri[][3][3], NPT_REAL npatch[][7][3], NPT_REAL pos_o[][3] );
+static void npt_batch_correctPnt2( int i0, int i1, NPT_REAL pos[][3],
+                                   NPT_REAL tri[][3][3], NPT_REAL npatch[][7][3], NPT_REAL pos_o[][3] );
+static void npt_batch_moveVertex( int i0, int i1, NPT_REAL tri[][3][3], NPT_REAL npatch[][7][3],
+                                  NPT_REAL tri_n[][3][3], NPT_REAL npatch_n[][7][3] );
+static int  npt_batch_updateTri( NPT_REAL tri[3][3], NPT_REAL tri_norm[3][3], NPT_REAL tol,
+                                 NPT_REAL tri_ref[3][3], NPT_REAL tri_norm_ref[3][3], NPT_REAL npatch[7][3],
+                                 int* err );
+static int  npt_batch_near( NPT_REAL a[3][3], NPT_REAL b[3][3], NPT_REAL tol2 );
+static void npt_subdiv_mid( const NPT_REAL a[3], const NPT_REAL b[3], NPT_REAL c[3] );
+static int  npt_simd_supported( int level );
+static int  npt_simd_init_env( const char** bad );
+static int  npt_simd_level_get( void );
+static const npt_batch_kern* npt_batch_sel( void );
+
+// 汎用実装（コンパイル時の命令セット）
+static const npt_batch_kern npt_batch_kern_generic = {
+    npt_batch_cvtPos, npt_batch_correctPnt, npt_batch_correctPnt2, npt_batch_moveVertex
+};
+
+#ifdef NPT_BATCH_DISPATCH
+
+// 命令セット別の実装の生成
+//    汎用実装を target 属性付きの関数から呼び出し、flatten で展開させる
+#define NPT_BATCH_VARIANT( attr, sfx ) \
+static attr void npt_batch_cvtPos##sfx( int i0, int i1, NPT_REAL pos[][3], NPT_REAL tri[][3][3], \
+                                        NPT_REAL* eta, NPT_REAL* xi ) \
+    { npt_batch_cvtPos( i0, i1, pos, tri, eta, xi ); } \
+static attr void npt_batch_correctPnt##sfx( int i0, int i1, NPT_REAL* eta, NPT_REAL* xi, \
+                                            NPT_REAL tri[][3][3], NPT_REAL npatch[][7][3], NPT_REAL pos_o[][3] ) \
+    { npt_batch_correctPnt( i0, i1, eta, xi, tri, npatch, pos_o ); } \
+static attr void npt_batch_correctPnt2##sfx( int i0, int i1, NPT_REAL pos[][3], \
+                                             NPT_REAL tri[][3][3], NPT_REAL npatch[][7][3], NPT_REAL pos_o[][3] ) \
+    { npt_batch_correctPnt2( i0, i1, pos, tri, npatch, pos_o ); } \
+static attr void npt_batch_moveVertex##sfx( int i0, int i1, NPT_REAL tri[][3][3], NPT_REAL npatch[][7][3], \
+                                            NPT_REAL tri_n[][3][3], NPT_REAL npatch_n[][7][3] ) \
+    { npt_batch_moveVertex( i0, i1, tri, npatch, tri_n, npatch_n ); } \
+static const npt_batch_kern npt_batch_kern##sfx = { \
+    npt_batch_cvtPos##sfx, npt_batch_correctPnt##sfx, npt_batch_correctPnt2##sfx, npt_batch_moveVertex##sfx \
+};
+
+NPT_BATCH_VARIANT( NPT_BATCH_AVX2,   _avx2   )
+NPT_BATCH_VARIANT( NPT_BATCH_AVX512, _avx512 )
+
+#endif
+
+// 命令セット別の実装（NPT_SIMD_GENERIC-NPT_SIMD_AVX512）
+static const npt_batch_kern* const npt_simd_kern[NPT_SIMD_AVX512+1] = {
+#ifdef NPT_BATCH_DISPATCH
+    &npt_batch_kern_generic, &npt_batch_kern_avx2, &npt_batch_kern_avx512
+#else
+    &npt_batch_kern_generic, &npt_batch_kern_generic, &npt_batch_kern_generic
+#endif
+};
+
+// 選択中の命令セット（-1:未選択）
+//    C++98 で使用できるよう int とし、読み書きは OpenMP の atomic で行う。
+//    初回の選択は名前付き critical の中で未選択の場合のみ設定する
+static int npt_simd_level = -1;
+
+// #################################################################
+//    公開関数
+// #################################################################
+
+/// 長田パッチパラメータ生成（複数パッチ）
+///
+/// @param [in]    num          三角形数
+/// @param [in]    tri          三角形の頂点座標 [num]
+/// @param [in]    tri_norm     三角形の頂点法線ベクトル（単位ベクトル） [num]
+/// @param [out]   npatch       長田パッチパラメータ [num]
+/// @return リターンコード   =0 正常  !=0 異常（異常となった三角形数）
+int
+npt_param_crt_n(
+        int       num,
+        NPT_REAL  tri     [][3][3],
+        NPT_REAL  tri_norm[][3][3],
+        NPT_REAL  npatch  [][7][3]
+   )
+{
+    int i;
+    int nerr = 0;
+
+    NPT_STAT_TIME_START( t_stat );
+
+#pragma omp parallel for schedule(static) reduction(+:nerr)
+    for( i=0; i<num; i++ ) {
+        int ret = npt_param_crt(
+                      tri[i][0], tri_norm[i][0],
+                      tri[i][1], tri_norm[i][1],
+                      tri[i][2], tri_norm[i][2],
+                      npatch[i][0], npatch[i][1], npatch[i][2], npatch[i][3],
+                      npatch[i][4], npatch[i][5], npatch[i][6]
+                  );
+        if( ret != 0 ) nerr++;
+    }
+
+    NPT_STAT_TIME_END( NPT_STAT_T_PARAM_CRT_N, t_stat );
+
+    return nerr;
+}
+
+
+/// 長田パッチパラメータ更新（複数パッチ、フレーム間の再利用）
+///
+/// @param [in]    num          三角形数
+/// @param [in]    tri          三角形の頂点座標 [num]
+/// @param [in]    tri_norm     三角形の頂点法線ベクトル（単位ベクトル） [num]
+/// @param [in]    tol          許容差（頂点座標は三角形の最大辺長との比、法線ベクトルは差の長さ）
+/// @param [inout] tri_ref      基準の三角形の頂点座標 [num]
+/// @param [inout] tri_norm_ref 基準の三角形の頂点法線ベクトル [num]
+/// @param [inout] npatch       長田パッチパラメータ [num]
+/// @param [out]   num_state    区分ごとの三角形数 [NPT_UPDATE_NUM]（NULL 可）
+/// @return リターンコード   =0 正常  !=0 異常（再生成で異常となった三角形数）
+int
+npt_param_update_n(
+        int       num,
+        NPT_REAL  tri         [][3][3],
+        NPT_REAL  tri_norm    [][3][3],
+        NPT_REAL  tol,
+        NPT_REAL  tri_ref     [][3][3],
+        NPT_REAL  tri_norm_ref[][3][3],
+        NPT_REAL  npatch      [][7][3],
+        int*      num_state
+   )
+{
+    int i;
+    int nerr = 0, nkeep = 0, nmove = 0, ncrt = 0;
+
+    NPT_STAT_TIME_START( t_stat );
+
+    // 再生成する三角形は局所的に偏るため動的に割り当てる
+#pragma omp parallel for schedule(dynamic,NPT_BATCH_BLOCK) reduction(+:nerr,nkeep,nmove,ncrt)
+    for( i=0; i<num; i++ ) {
+        int err = 0;
+        int state = npt_batch_updateTri(
+                        tri[i], tri_norm[i], tol,
+                        tri_ref[i], tri_norm_ref[i], npatch[i], &err
+                    );
+        if( state == NPT_UPDATE_KEEP ) nkeep++;
+        else if( state == NPT_UPDATE_MOVE ) nmove++;
+        else ncrt++;
+        nerr += err;
+    }
+
+    NPT_STAT_TIME_END( NPT_STAT_T_PARAM_UPDATE_N, t_stat );
+
+    if( num_state != NULL ) {
+        num_state[NPT_UPDATE_KEEP] = nkeep;
+        num_state[NPT_UPDATE_MOVE] = nmove;
+        num_state[NPT_UPDATE_CRT]  = ncrt;
+    }
+
+    return nerr;
+}
+
+
+/// 長田パッチ η、ξパラメータ取得（複数点）
+///
+/// @param [in]    num          点数（三角形数）
+/// @param [in]    pos          入力点座標 [num]
+/// @param [in]    tri          三角形の頂点座標 [num]
+/// @param [out]   eta          ηパラメータ [num]
+/// @param [out]   xi           ξパラメータ [num]
+/// @return なし
+void
+npt_cvt_pos_to_eta_xi_n(
+        int       num,
+        NPT_REAL  pos[][3],
+        NPT_REAL  tri[][3][3],
+        NPT_REAL* eta,
+        NPT_REAL* xi
+   )
+{
+    const npt_batch_kern* kern = npt_batch_sel();
+    int nblk = ( num + NPT_BATCH_BLOCK - 1 ) / NPT_BATCH_BLOCK;
+    int b;
+
+    NPT_STAT_TIME_START( t_stat );
+
+#pragma omp parallel for schedule(static)
+    for( b=0; b<nblk; b++ ) {
+        int i0 = b*NPT_BATCH_BLOCK;
+        int i1 = ( num - i0 < NPT_BATCH_BLOCK ) ? num : i0 + NPT_BATCH_BLOCK;
+        kern->cvt_pos( i0, i1, pos, tri, eta, xi );
+    }
+
+    NPT_STAT_TIME_END( NPT_STAT_T_CVT_POS_N, t_stat );
+}
+
+
+/// 長田パッチ 近似曲面補正（複数点）
+///
+/// @param [in]    num          点数（三角形数）
+/// @param [in]    eta          ηパラメータ [num]
+/// @param [in]    xi           ξパラメータ [num]
+/// @param [in]    tri          三角形の頂点座標 [num]
+/// @param [in]    npatch       長田パッチパラメータ [num]
+/// @param [out]   pos_o        出力点座標（曲面補正後の点） [num]
+/// @return なし
+void
+npt_correct_pnt_n(
+        int       num,
+        NPT_REAL* eta,
+        NPT_REAL* xi,
+        NPT_REAL  tri   [][3][3],
+        NPT_REAL  npatch[][7][3],
+        NPT_REAL  pos_o [][3]
+   )
+{
+    const npt_batch_kern* kern = npt_batch_sel();
+    int nblk = ( num + NPT_BATCH_BLOCK - 1 ) / NPT_BATCH_BLOCK;
+    int b;
+
+    NPT_STAT_TIME_START( t_stat );
+
+#pragma omp parallel for schedule(static)
+    for( b=0; b<nblk; b++ ) {
+        int i0 = b*NPT_BATCH_BLOCK;
+        int i1 = ( num - i0 < NPT_BATCH_BLOCK ) ? num : i0 + NPT_BATCH_BLOCK;
+        kern->correct_pnt( i0, i1, eta, xi, tri, npatch, pos_o );
+    }
+
+    NPT_STAT_TIME_END( NPT_STAT_T_CORRECT_PNT_N, t_stat );
+}
+
+
+/// 長田パッチ 近似曲面補正（複数点）
+///
+/// @param [in]    num          点数（三角形数）
+/// @param [in]    pos          入力点座標 [num]
+/// @param [in]    tri          三角形の頂点座標 [num]
+/// @param [in]    npatch       長田パッチパラメータ [num]
+/// @param [out]   pos_o        出力点座標（曲面補正後の点） [num]
+/// @return なし
+void
+npt_correct_pnt2_n(
+        int       num,
+        NPT_REAL  pos   [][3],
+        NPT_REAL  tri   [][3][3],
+        NPT_REAL  npatch[][7][3],
+        NPT_REAL  pos_o [][3]
+   )
+{
+    const npt_batch_kern* kern = npt_batch_sel();
+    int nblk = ( num + NPT_BATCH_BLOCK - 1 ) / NPT_BATCH_BLOCK;
+    int b;
+
+    NPT_STAT_TIME_START( t_stat );
+
+#pragma omp parallel for schedule(static)
+    for( b=0; b<nblk; b++ ) {
+        int i0 = b*NPT_BATCH_BLOCK;
+        int i1 = ( num - i0 < NPT_BATCH_BLOCK ) ? num : i0 + NPT_BATCH_BLOCK;
+        kern->correct_pnt2( i0, i1, pos, tri, npatch, pos_o );
+    }
+
+    NPT_STAT_TIME_END( NPT_STAT_T_CORRECT_PNT2_N, t_stat );
+}
+
+
+/// 長田パッチ 頂点移動に伴う長田パッチパラメータ更新（複数パッチ）
+///
+/// @param [in]    num          三角形数
+/// @param [in]    tri          三角形の頂点座標 [num]
+/// @param [in]    npatch       長田パッチパラメータ [num]
+/// @param [in]    tri_n        移動後 三角形の頂点座標 [num]
+/// @param [out]   npatch_n     移動後 長田パッチパラメータ [num]
+/// @return なし
+void
+npt_move_vertex_n(
+        int       num,
+        NPT_REAL  tri     [][3][3],
+        NPT_REAL  npatch  [][7][3],
+        NPT_REAL  tri_n   [][3][3],
+        NPT_REAL  npatch_n[][7][3]
+   )
+{
+    const npt_batch_kern* kern = npt_batch_sel();
+    int nblk = ( num + NPT_BATCH_BLOCK - 1 ) / NPT_BATCH_BLOCK;
+    int b;
+
+    NPT_STAT_TIME_START( t_stat );
+
+#pragma omp parallel for schedule(static)
+    for( b=0; b<nblk; b++ ) {
+        int i0 = b*NPT_BATCH_BLOCK;
+        int i1 = ( num - i0 < NPT_BATCH_BLOCK ) ? num : i0 + NPT_BATCH_BLOCK;
+        kern->move_vertex( i0, i1, tri, npatch, tri_n, npatch_n );
+    }
+
+    NPT_STAT_TIME_END( NPT_STAT_T_MOVE_VERTEX_N, t_stat );
+}
+
+
+/// 長田パッチ １-４分割（複数パッチ）
+///
+/// @param [in]    num          三角形数
+/// @param [in]    tri          三角形の頂点座標 [num]
+/// @param [in]    npatch       長田パッチパラメータ [num]
+/// @param [out]   tri_o        子パッチの頂点座標 [4*num]
+/// @param [out]   npatch_o     子パッチの長田パッチパラメータ [4*num]
+/// @return なし
+void
+npt_subdiv_n(
+        int       num,
+        NPT_REAL  tri     [][3][3],
+        NPT_REAL  npatch  [][7][3],
+        NPT_REAL  tri_o   [][3][3],
+        NPT_REAL  npatch_o[][7][3]
+   )
+{
+    int i;
+
+    NPT_STAT_TIME_START( t_stat );
+
+#pragma omp parallel for schedule(static)
+    for( i=0; i<num; i++ ) {
+        npt_subdiv(
+                tri[i], npatch[i],
+                tri_o + 4*i, npatch_o + 4*i
+            );
+    }
+
+    NPT_STAT_TIME_END( NPT_STAT_T_SUBDIV_N, t_stat );
+}
+
+
+/// 長田パッチ １-４分割
+///    ３次三角形ベジェのブロッサム f(X,Y,Z)（X,Y,Z は親パッチ上の点、対称かつ各引数に線形）を
+///    {X,Y,Z} と表す。親パッチの制御点は {P1,P1,P2}=cp_side1_1 等であり、
+///    頂点 A,B,C の子パッチの制御点は {A,A,B}=cp_side1_1 等となる。
+///    中点を含むブロッサムは線形性 {M12,Y,Z} = ( {P1,Y,Z} + {P2,Y,Z} )/2 により
+///    親パッチの制御点の平均を繰り返して求める。
+///
+/// @param [in]    tri          三角形の頂点座標
+/// @param [in]    npatch       長田パッチパラメータ
+/// @param [out]   tri_o        子パッチの頂点座標 [4]
+/// @param [out]   npatch_o     子パッチの長田パッチパラメータ [4]
+/// @return なし
+void
+npt_subdiv(
+        NPT_REAL  tri     [3][3],
+        NPT_REAL  npatch  [7][3],
+        NPT_REAL  tri_o   [4][3][3],
+        NPT_REAL  npatch_o[4][7][3]
+    )
+{
+    // 子パッチの頂点、制御点（子パッチ c の g[ child[c][0-9] ]）
+    //    頂点 A,B,C  {A,A,A} {B,B,B} {C,C,C}
+    //    制御点      {A,A,B} {A,B,B} {B,B,C} {B,C,C} {A,C,C} {A,A,C} {A,B,C}
+    static const int child[4][10] = {
+        {  0, 15, 27,   10, 12, 32, 35, 26, 25, 29 },    // P1,  M12, M31
+        { 15,  1, 21,   14, 13, 16, 18, 39, 43, 42 },    // M12, P2,  M23
+        { 27, 21,  2,   44, 47, 20, 19, 22, 24, 46 },    // M31, M23, P3
+        { 15, 21, 27,   43, 39, 47, 44, 35, 32, 49 }     // M12, M23, M31
+    };
+    NPT_REAL g[50][3];
+    int      c, j, k;
+
+    // 親パッチの頂点、制御点
+    for( k=0; k<3; k++ ) {
+        g[0][k] = tri[0][k];                // {P1,P1,P1}
+        g[1][k] = tri[1][k];                // {P2,P2,P2}
+        g[2][k] = tri[2][k];                // {P3,P3,P3}
+        g[3][k] = npatch[0][k];             // {P1,P1,P2}  cp_side1_1
+        g[4][k] = npatch[1][k];             // {P1,P2,P2}  cp_side1_2
+        g[5][k] = npatch[2][k];             // {P2,P2,P3}  cp_side2_1
+        g[6][k] = npatch[3][k];             // {P2,P3,P3}  cp_side2_2
+        g[7][k] = npatch[4][k];             // {P1,P3,P3}  cp_side3_1
+        g[8][k] = npatch[5][k];             // {P1,P1,P3}  cp_side3_2
+        g[9][k] = npatch[6][k];             // {P1,P2,P3}  cp_center
+    }
+
+    // 辺1 (P1-P2)
+    npt_subdiv_mid( g[ 0], g[ 3], g[10] );   // {P1,P1,M12}     = ( {P1,P1,P1} + {P1,P1,P2} )/2
+    npt_subdiv_mid( g[ 3], g[ 4], g[11] );   // {P1,P2,M12}     = ( {P1,P1,P2} + {P1,P2,P2} )/2
+    npt_subdiv_mid( g[10], g[11], g[12] );   // {P1,M12,M12}    = ( {P1,P1,M12} + {P1,P2,M12} )/2
+    npt_subdiv_mid( g[ 4], g[ 1], g[13] );   // {P2,P2,M12}     = ( {P1,P2,P2} + {P2,P2,P2} )/2
+    npt_subdiv_mid( g[11], g[13], g[14] );   // {P2,M12,M12}    = ( {P1,P2,M12} + {P2,P2,M12} )/2
+    npt_subdiv_mid( g[12], g[14], g[15] );   // {M12,M12,M12}   = ( {P1,M12,M12} + {P2,M12,M12} )/2
+    // 辺2 (P2-P3)
+    npt_subdiv_mid( g[ 1], g[ 5], g[16] );   // {P2,P2,M23}     = ( {P2,P2,P2} + {P2,P2,P3} )/2
+    npt_subdiv_mid( g[ 5], g[ 6], g[17] );   // {P2,P3,M23}     = ( {P2,P2,P3} + {P2,P3,P3} )/2
+    npt_subdiv_mid( g[16], g[17], g[18] );   // {P2,M23,M23}    = ( {P2,P2,M23} + {P2,P3,M23} )/2
+    npt_subdiv_mid( g[ 6], g[ 2], g[19] );   // {P3,P3,M23}     = ( {P2,P3,P3} + {P3,P3,P3} )/2
+    npt_subdiv_mid( g[17], g[19], g[20] );   // {P3,M23,M23}    = ( {P2,P3,M23} + {P3,P3,M23} )/2
+    npt_subdiv_mid( g[18], g[20], g[21] );   // {M23,M23,M23}   = ( {P2,M23,M23} + {P3,M23,M23} )/2
+    // 辺3 (P3-P1)
+    npt_subdiv_mid( g[ 2], g[ 7], g[22] );   // {P3,P3,M31}     = ( {P3,P3,P3} + {P1,P3,P3} )/2
+    npt_subdiv_mid( g[ 7], g[ 8], g[23] );   // {P1,P3,M31}     = ( {P1,P3,P3} + {P1,P1,P3} )/2
+    npt_subdiv_mid( g[22], g[23], g[24] );   // {P3,M31,M31}    = ( {P3,P3,M31} + {P1,P3,M31} )/2
+    npt_subdiv_mid( g[ 8], g[ 0], g[25] );   // {P1,P1,M31}     = ( {P1,P1,P3} + {P1,P1,P1} )/2
+    npt_subdiv_mid( g[23], g[25], g[26] );   // {P1,M31,M31}    = ( {P1,P3,M31} + {P1,P1,M31} )/2
+    npt_subdiv_mid( g[24], g[26], g[27] );   // {M31,M31,M31}   = ( {P3,M31,M31} + {P1,M31,M31} )/2
+    // 内部（子パッチ間の辺、中央）
+    npt_subdiv_mid( g[ 9], g[ 3], g[28] );   // {P1,P2,M31}     = ( {P1,P2,P3} + {P1,P1,P2} )/2
+    npt_subdiv_mid( g[25], g[28], g[29] );   // {P1,M12,M31}    = ( {P1,P1,M31} + {P1,P2,M31} )/2
+    npt_subdiv_mid( g[ 5], g[ 4], g[30] );   // {P2,P2,M31}     = ( {P2,P2,P3} + {P1,P2,P2} )/2
+    npt_subdiv_mid( g[28], g[30], g[31] );   // {P2,M12,M31}    = ( {P1,P2,M31} + {P2,P2,M31} )/2
+    npt_subdiv_mid( g[29], g[31], g[32] );   // {M12,M12,M31}   = ( {P1,M12,M31} + {P2,M12,M31} )/2
+    npt_subdiv_mid( g[ 6], g[ 9], g[33] );   // {P2,P3,M31}     = ( {P2,P3,P3} + {P1,P2,P3} )/2
+    npt_subdiv_mid( g[33], g[28], g[34] );   // {P2,M31,M31}    = ( {P2,P3,M31} + {P1,P2,M31} )/2
+    npt_subdiv_mid( g[26], g[34], g[35] );   // {M12,M31,M31}   = ( {P1,M31,M31} + {P2,M31,M31} )/2
+    npt_subdiv_mid( g[ 4], g[ 9], g[36] );   // {P1,P2,M23}     = ( {P1,P2,P2} + {P1,P2,P3} )/2
+    npt_subdiv_mid( g[ 9], g[ 7], g[37] );   // {P1,P3,M23}     = ( {P1,P2,P3} + {P1,P3,P3} )/2
+    npt_subdiv_mid( g[36], g[37], g[38] );   // {P1,M23,M23}    = ( {P1,P2,M23} + {P1,P3,M23} )/2
+    npt_subdiv_mid( g[38], g[18], g[39] );   // {M12,M23,M23}   = ( {P1,M23,M23} + {P2,M23,M23} )/2
+    npt_subdiv_mid( g[ 3], g[ 8], g[40] );   // {P1,P1,M23}     = ( {P1,P1,P2} + {P1,P1,P3} )/2
+    npt_subdiv_mid( g[40], g[36], g[41] );   // {P1,M12,M23}    = ( {P1,P1,M23} + {P1,P2,M23} )/2
+    npt_subdiv_mid( g[36], g[16], g[42] );   // {P2,M12,M23}    = ( {P1,P2,M23} + {P2,P2,M23} )/2
+    npt_subdiv_mid( g[41], g[42], g[43] );   // {M12,M12,M23}   = ( {P1,M12,M23} + {P2,M12,M23} )/2
+    npt_subdiv_mid( g[34], g[24], g[44] );   // {M23,M31,M31}   = ( {P2,M31,M31} + {P3,M31,M31} )/2
+    npt_subdiv_mid( g[30], g[33], g[45] );   // {P2,M23,M31}    = ( {P2,P2,M31} + {P2,P3,M31} )/2
+    npt_subdiv_mid( g[33], g[22], g[46] );   // {P3,M23,M31}    = ( {P2,P3,M31} + {P3,P3,M31} )/2
+    npt_subdiv_mid( g[45], g[46], g[47] );   // {M23,M23,M31}   = ( {P2,M23,M31} + {P3,M23,M31} )/2
+    npt_subdiv_mid( g[28], g[23], g[48] );   // {P1,M23,M31}    = ( {P1,P2,M31} + {P1,P3,M31} )/2
+    npt_subdiv_mid( g[48], g[45], g[49] );   // {M12,M23,M31}   = ( {P1,M23,M31} + {P2,M23,M31} )/2
+
+    for( c=0; c<4; c++ ) {
+        for( j=0; j<3; j++ ) {
+            for( k=0; k<3; k++ ) tri_o[c][j][k] = g[ child[c][j] ][k];
+        }
+        for( j=0; j<7; j++ ) {
+            for( k=0; k<3; k++ ) npatch_o[c][j][k] = g[ child[c][3+j] ][k];
+        }
+    }
+}
+
+
+/// 複数パッチ一括処理の命令セット取得
+///
+/// @return 選択中の命令セット（NPT_SIMD_GENERIC, NPT_SIMD_AVX2, NPT_SIMD_AVX512）
+int
+npt_simd_get( void )
+{
+    npt_batch_sel();
+
+    return npt_simd_level_get();
+}
+
+
+/// 複数パッチ一括処理の命令セット指定
+///
+/// @param [in]    level        命令セット（NPT_SIMD_GENERIC, NPT_SIMD_AVX2, NPT_SIMD_AVX512）
+/// @return リターンコード   =0 正常  =1 CPU（またはコンパイラ）が未対応（選択は変更しない）
+int
+npt_simd_set( int level )
+{
+    if( !npt_simd_supported( level ) ) return 1;
+
+#pragma omp critical (npt_simd_sel)
+    {
+#pragma omp atomic write
+        npt_simd_level = level;
+    }
+
+    return 0;
+}
+
+
+/// 命令セット名称
+///
+/// @param [in]    level        命令セット
+/// @return 名称（"generic", "avx2", "avx512"、範囲外の場合は "unknown"）
+const char*
+npt_simd_name( int level )
+{
+    switch( level ) {
+    case NPT_SIMD_GENERIC : return "generic";
+    case NPT_SIMD_AVX2    : return "avx2";
+    case NPT_SIMD_AVX512  : return "avx512";
+    }
+    return "unknown";
+}
+
+
+// #################################################################
+//    非公開（プライベート）関数
+// #################################################################
+
+// η、ξパラメータ取得（区間 [i0,i1)）
+static void
+npt_batch_cvtPos(
+        int       i0,               // [in]  開始位置
+        int       i1,               // [in]  終了位置（この位置は含まない）
+        NPT_REAL  pos[][3],         // [in]  入力点座標
+        NPT_REAL  tri[][3][3],      // [in]  三角形の頂点座標
+        NPT_REAL* eta,              // [out] ηパラメータ
+        NPT_REAL* xi                // [out] ξパラメータ
+    )
+{
+    int i;
+
+    for( i=i0; i<i1; i++ ) {
+        npt_cvt_pos_to_eta_xi(
+                pos[i],
+                tri[i][0], tri[i][1], tri[i][2],
+                &eta[i], &xi[i]
+            );
+    }
+}
+
+
+// 近似曲面補正（区間 [i0,i1)、η、ξ指定）
+static void
+npt_batch_correctPnt(
+        int       i0,               // [in]  開始位置
+        int       i1,               // [in]  終了位置（この位置は含まない）
+        NPT_REAL* eta,              // [in]  ηパラメータ
+        NPT_REAL* xi,               // [in]  ξパラメータ
+        NPT_REAL  tri   [][3][3],   // [in]  三角形の頂点座標
+        NPT_REAL  npatch[][7][3],   // [in]  長田パッチパラメータ
+        NPT_REAL  pos_o [][3]       // [out] 出力点座標
+    )
+{
+    int i;
+
+    for( i=i0; i<i1; i++ ) {
+        npt_correct_pnt(
+                eta[i], xi[i],
+                tri[i][0], tri[i][1], tri[i][2],
+                npatch[i][0], npatch[i][1], npatch[i][2], npatch[i][3],
+                npatch[i][4], npatch[i][5], npatch[i][6],
+                pos_o[i]
+            );
+    }
+}
+
+
+// 近似曲面補正（区間 [i0,i1)、座標指定）
+static void
+npt_batch_correctPnt2(
+        int       i0,               // [in]  開始位置
+        int       i1,               // [in]  終了位置（この位置は含まない）
+        NPT_REAL  pos   [][3],      // [in]  入力点座標
+        NPT_REAL  tri   [][3][3],   // [in]  三角形の頂点座標
+        NPT_REAL  npatch[][7][3],   // [in]  長田パッチパラメータ
+        NPT_REAL  pos_o [][3]       // [out] 出力点座標
+    )
+{
+    int i;
+
+    for( i=i0; i<i1; i++ ) {
+        npt_correct_pnt2(
+                pos[i],
+                tri[i][0], tri[i][1], tri[i][2],
+                npatch[i][0], npatch[i][1], npatch[i][2], npatch[i][3],
+                npatch[i][4], npatch[i][5], npatch[i][6],
+                pos_o[i]
+            );
+    }
+}
+
+
+// 頂点移動に伴うパラメータ更新（区間 [i0,i1)）
+static void
+npt_batch_moveVertex(
+        int       i0,               // [in]  開始位置
+        int       i1,               // [in]  終了位置（この位置は含まない）
+        NPT_REAL  tri     [][3][3], // [in]  三角形の頂点座標
+        NPT_REAL  npatch  [][7][3], // [in]  長田パッチパラメータ
+        NPT_REAL  tri_n   [][3][3], // [in]  移動後 三角形の頂点座標
+        NPT_REAL  npatch_n[][7][3]  // [out] 移動後 長田パッチパラメータ
+    )
+{
+    int i;
+
+    for( i=i0; i<i1; i++ ) {
+        npt_move_vertex(
+                tri[i][0], tri[i][1], tri[i][2],
+                npatch[i][0], npatch[i][1], npatch[i][2], npatch[i][3],
+                npatch[i][4], npatch[i][5], npatch[i][6],
+                tri_n[i][0], tri_n[i][1], tri_n[i][2],
+                npatch_n[i][0], npatch_n[i][1], npatch_n[i][2], npatch_n[i][3],
+                npatch_n[i][4], npatch_n[i][5], npatch_n[i][6]
+            );
+    }
+}
+
+
+// フレーム間の長田パッチパラメータ更新（１三角形）
+//    戻り値は更新の区分（NPT_UPDATE_KEEP, NPT_UPDATE_MOVE, NPT_UPDATE_CRT）
+static int
+npt_batch_updateTri(
+        NPT_REAL  tri         [3][3], // [in]    三角形の頂点座標
+        NPT_REAL  tri_norm    [3][3], // [in]    三角形の頂点法線ベクトル
+        NPT_REAL  tol,                // [in]    許容差
+        NPT_REAL  tri_ref     [3][3], // [inout] 基準の三角形の頂点座標
+        NPT_REAL  tri_norm_ref[3][3], // [inout] 基準の三角形の頂点法線ベクトル
+        NPT_REAL  npatch      [7][3], // [inout] 長田パッチパラメータ
+        int*      err                 // [out]   =1 再生成で異常
+    )
+{
+    NPT_REAL mat[4][3];
+    NPT_REAL tri_m[3][3], norm_m[3][3];
+    NPT_REAL len2 = 0.0, d[3];
+    int      j;
+
+    *err = 0;
+
+    if( tol >= 0.0 ) {
+        // 最大辺長
+        for( j=0; j<3; j++ ) {
+            CalcVec( tri[j], tri[(j+1)%3], d );
+            NPT_REAL l2 = CalcInProduct( d, d );
+            if( l2 > len2 ) len2 = l2;
+        }
+
+        // 基準と一致
+        if( npt_batch_near( tri, tri_ref, tol*tol*len2 ) &&
+            npt_batch_near( tri_norm, tri_norm_ref, tol*tol ) ) {
+            return NPT_UPDATE_KEEP;
+        }
+
+        // 基準を剛体移動したものと一致
+        //    （縮退した三角形の変換マトリクスは NaN を含み、一致しない）
+        npt_move_vertex_mat( tri_ref[0], tri_ref[1], tri_ref[2], tri[0], tri[1], tri[2], mat );
+        for( j=0; j<3; j++ ) {
+            Calc_3dMat43Multi13( tri_ref[j], mat, tri_m[j] );
+            Calc_3dMat43Vec13( tri_norm_ref[j], mat, norm_m[j] );
+        }
+        if( npt_batch_near( tri, tri_m, tol*tol*len2 ) &&
+            npt_batch_near( tri_norm, norm_m, tol*tol ) ) {
+            Calc_3dMat43Pntn( mat, 7, npatch, npatch );
+            memcpy( tri_ref,      tri_m,  sizeof(tri_m) );
+            memcpy( tri_norm_ref, norm_m, sizeof(norm_m) );
+            return NPT_UPDATE_MOVE;
+        }
+    }
+
+    // 再生成
+    int ret = npt_param_crt(
+                  tri[0], tri_norm[0],
+                  tri[1], tri_norm[1],
+                  tri[2], tri_norm[2],
+                  npatch[0], npatch[1], npatch[2], npatch[3],
+                  npatch[4], npatch[5], npatch[6]
+              );
+    if( ret != 0 ) *err = 1;
+    memcpy( tri_ref,      tri,      sizeof(NPT_REAL)*9 );
+    memcpy( tri_norm_ref, tri_norm, sizeof(NPT_REAL)*9 );
+
+    return NPT_UPDATE_CRT;
+}
+
+
+// ３点の差がすべて許容差以内か（NaN を含む場合は 0）
+static int
+npt_batch_near(
+        NPT_REAL  a[3][3],            // [in]  点１-３
+        NPT_REAL  b[3][3],            // [in]  点１-３
+        NPT_REAL  tol2                // [in]  許容差の２乗
+    )
+{
+    NPT_REAL d[3];
+    int      j;
+
+    for( j=0; j<3; j++ ) {
+        CalcVec( a[j], b[j], d );
+        if( !( CalcInProduct( d, d ) <= tol2 ) ) return 0;
+    }
+
+    return 1;
+}
+
+
+// ２点の中点  c = ( a + b )/2
+//    a, b を入れ替えても結果はビット単位で一致する
+static void
+npt_subdiv_mid(
+        const NPT_REAL a[3],       // [in]    点
+        const NPT_REAL b[3],       // [in]    点
+        NPT_REAL       c[3]        // [out]   中点
+    )
+{
+    c[0] = ( a[0] + b[0] )*0.5;
+    c[1] = ( a[1] + b[1] )*0.5;
+    c[2] = ( a[2] + b[2] )*0.5;
+}
+
+
+// 命令セットの対応判定（コンパイラと実行中の CPU の両方）
+static int
+npt_simd_supported(
+        int level                   // [in]  命令セット
+    )
+{
+    switch( level ) {
+    case NPT_SIMD_GENERIC : return 1;
+#ifdef NPT_BATCH_DISPATCH
+    case NPT_SIMD_AVX2    : return __builtin_cpu_supports( "avx2" ) ? 1 : 0;
+    case NPT_SIMD_AVX512  : return __builtin_cpu_supports( "avx512f" ) ? 1 : 0;
+#endif
+    }
+    return 0;
+}
+
+
+// 命令セットの初期値
+//    環境変数 NPT_SIMD（generic, avx2, avx512 または 0-2）で上限を指定できる。
+//    数値の範囲外は 0-2 に丸め、それ以外の文字列は汎用実装とする（bad に設定する）。
+//    未設定の場合、および CPU が未対応の場合は対応する最上位の命令セットとする
+static int
+npt_simd_init_env(
+        const char** bad            // [out] 不正な指定（正常な場合は NULL）
+    )
+{
+    const char* env = getenv( "NPT_SIMD" );
+    int         level = NPT_SIMD_AVX512;
+
+    *bad = NULL;
+    if( env != NULL && env[0] != '\0' ) {
+        char* end;
+        long  val = strtol( env, &end, 10 );
+        if( end != env && *end == '\0' ) {
+            level = ( val < NPT_SIMD_GENERIC ) ? NPT_SIMD_GENERIC :
+                    ( val > NPT_SIMD_AVX512  ) ? NPT_SIMD_AVX512  : (int)val;
+        }
+        else if( strcmp( env, "generic" ) == 0 ) level = NPT_SIMD_GENERIC;
+        else if( strcmp( env, "avx2"    ) == 0 ) level = NPT_SIMD_AVX2;
+        else if( strcmp( env, "avx512"  ) == 0 ) level = NPT_SIMD_AVX512;
+        else {
+            level = NPT_SIMD_GENERIC;
+            *bad  = env;
+        }
+    }
+    while( level > NPT_SIMD_GENERIC && !npt_simd_supported( level ) ) level--;
+
+    return level;
+}
+
+
+// 選択中の命令セットの読み出し（-1:未選択）
+static int
+npt_simd_level_get( void )
+{
+    int level;
+
+#pragma omp atomic read
+    level = npt_simd_level;
+
+    return level;
+}
+
+
+// 実装の選択
+//    初回の呼び出し時に命令セットを決める（以降は npt_simd_set() で変更する）。
+//    複数のスレッドが同時に初回の呼び出しを行った場合も、最初に設定した値を全スレッドで使用する。
+//    OpenMP 以外のスレッドからの同時の初回呼び出しでも、選択は環境変数と CPU で決まるため同じ値となる
+static const npt_batch_kern*
+npt_batch_sel( void )
+{
+    int level = npt_simd_level_get();
+
+    if( level < 0 ) {
+#pragma omp critical (npt_simd_sel)
+        {
+            level = npt_simd_level_get();
+            if( level < 0 ) {
+                const char* bad;
+
+                level = npt_simd_init_env( &bad );
+                if( bad != NULL ) {
+                    fprintf( stderr, "Npatch: unknown NPT_SIMD=%s, using %s\n", bad, npt_simd_name( level ) );
+                }
+#pragma omp atomic write
+                npt_simd_level = level;
+            }
+        }
+    }
+    return npt_simd_kern[level];
+}
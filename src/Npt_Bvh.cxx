@@ -0,0 +1,225 @@
+/*
+ * Npatch - Nagata Patch Library
+ *
+ * Copyright (c) 2015-2016 Advanced Institute for Computational Science, RIKEN.
+ * All rights reserved.
+ *
+ */
+
+////////////////////////////////////////////////////////////////////////////
+///
+/// 長田パッチ 包含箱の階層（BVH） 関数
+///
+////////////////////////////////////////////////////////////////////////////
+
+
+#include "Npt_Bvh.h"
+#include <stdlib.h>
+#include <algorithm>
+
+// 検索時の節点スタックの大きさ（中央値分割のため深さは log2(要素数) 程度）
+#define NPT_BVH_STACK   128
+
+// 要素の中心座標による比較
+struct npt_bvh_less {
+    const NPT_REAL (*cen)[3];
+    int              axis;
+    bool operator()( int a, int b ) const {
+        if( cen[a][axis] != cen[b][axis] ) return cen[a][axis] < cen[b][axis];
+        return a < b;
+    }
+};
+
+//------------------------------------------------------------------
+//  プロトタイプ宣言
+//------------------------------------------------------------------
+static int  npt_bvh_build( NPT_BVH* bvh, NPT_REAL box[][2][3], const NPT_REAL (*cen)[3], int first, int num );
+
+
+// #################################################################
+//    公開関数
+// #################################################################
+
+/// 包含箱の階層の作成
+///
+/// @param [in]    num          要素数
+/// @param [in]    box          要素の包含箱（[0]最小 [1]最大） [num]
+/// @param [out]   bvh          包含箱の階層
+/// @return リターンコード   =0 正常  !=0 異常（メモリ確保失敗）
+int
+npt_bvh_crt(
+        int          num,
+        NPT_REAL     box[][2][3],
+        NPT_BVH*     bvh
+    )
+{
+    int max_node = ( num > 0 ) ? 2*num : 1;
+    int i, k;
+
+    bvh->num_prim = num;
+    bvh->num_node = 0;
+    bvh->box   = (NPT_REAL(*)[2][3])malloc( max_node*sizeof(NPT_REAL[2][3]) );
+    bvh->child = (int(*)[2])malloc( max_node*sizeof(int[2]) );
+    bvh->range = (int(*)[2])malloc( max_node*sizeof(int[2]) );
+    bvh->idx   = (int*)malloc( (num > 0 ? num : 1)*sizeof(int) );
+    NPT_REAL (*cen)[3] = (NPT_REAL(*)[3])malloc( (num > 0 ? num : 1)*sizeof(NPT_REAL[3]) );
+    if( bvh->box == NULL || bvh->child == NULL || bvh->range == NULL || bvh->idx == NULL || cen == NULL ) {
+        free( cen );
+        npt_bvh_free( bvh );
+        return 1;
+    }
+
+    for( i=0; i<num; i++ ) {
+        bvh->idx[i] = i;
+        for( k=0; k<3; k++ ) cen[i][k] = 0.5*( box[i][0][k] + box[i][1][k] );
+    }
+    if( num > 0 ) {
+        npt_bvh_build( bvh, box, cen, 0, num );
+    }
+
+    free( cen );
+    return 0;
+}
+
+
+/// 包含箱の階層の領域解放
+///
+/// @param [inout] bvh          包含箱の階層
+/// @return なし
+void
+npt_bvh_free(
+        NPT_BVH*     bvh
+    )
+{
+    free( bvh->box );
+    free( bvh->child );
+    free( bvh->range );
+    free( bvh->idx );
+    bvh->box   = NULL;
+    bvh->child = NULL;
+    bvh->range = NULL;
+    bvh->idx   = NULL;
+    bvh->num_node = 0;
+}
+
+
+/// 包含箱と重なる要素の検索
+///
+/// @param [in]    bvh          包含箱の階層
+/// @param [in]    box          検索する包含箱（[0]最小 [1]最大）
+/// @param [in]    elem_box     要素の包含箱 [num_prim]
+/// @param [in]    max          list の大きさ
+/// @param [out]   list         重なる要素の番号 [max]
+/// @return 重なる要素数
+int
+npt_bvh_query(
+        const NPT_BVH*  bvh,
+        NPT_REAL        box[2][3],
+        NPT_REAL        elem_box[][2][3],
+        int             max,
+        int*            list
+    )
+{
+    int stack[NPT_BVH_STACK];
+    int sp  = 0;
+    int num = 0;
+    int i;
+
+    if( bvh->num_node == 0 ) return 0;
+
+    stack[sp++] = 0;
+    while( sp > 0 ) {
+        int nd = stack[--sp];
+        if( !npt_bvh_overlap( bvh->box[nd], box ) ) continue;
+
+        if( bvh->child[nd][0] < 0 ) {
+            for( i=0; i<bvh->range[nd][1]; i++ ) {
+                int ip = bvh->idx[ bvh->range[nd][0] + i ];
+                if( npt_bvh_overlap( elem_box[ip], box ) ) {
+                    if( num < max ) list[num] = ip;
+                    num++;
+                }
+            }
+        }
+        else {
+            stack[sp++] = bvh->child[nd][1];
+            stack[sp++] = bvh->child[nd][0];
+        }
+    }
+    return num;
+}
+
+
+/// 包含箱の重なり判定
+///
+/// @param [in]    a            包含箱（[0]最小 [1]最大）
+/// @param [in]    b            包含箱（[0]最小 [1]最大）
+/// @return 重なる（接する場合を含む）場合 1、それ以外は 0
+int
+npt_bvh_overlap(
+        NPT_REAL     a[2][3],
+        NPT_REAL     b[2][3]
+    )
+{
+    return ( a[0][0] <= b[1][0] && b[0][0] <= a[1][0] &&
+             a[0][1] <= b[1][1] && b[0][1] <= a[1][1] &&
+             a[0][2] <= b[1][2] && b[0][2] <= a[1][2] ) ? 1 : 0;
+}
+
+
+// #################################################################
+//    非公開（プライベート）関数
+// #################################################################
+
+// 節点の作成（idx[first] から num 個の要素、再帰）
+//    節点番号を返す
+static int
+npt_bvh_build(
+        NPT_BVH*         bvh,      // [inout] 包含箱の階層
+        NPT_REAL         box[][2][3], // [in] 要素の包含箱
+        const NPT_REAL (*cen)[3],  // [in]    要素の中心座標
+        int              first,    // [in]    idx の先頭位置
+        int              num       // [in]    要素数
+    )
+{
+    int      nd = bvh->num_node++;
+    NPT_REAL cmin[3], cmax[3];
+    int      i, k;
+
+    // 節点の包含箱、中心座標の範囲
+    for( k=0; k<3; k++ ) {
+        bvh->box[nd][0][k] = box[ bvh->idx[first] ][0][k];
+        bvh->box[nd][1][k] = box[ bvh->idx[first] ][1][k];
+        cmin[k] = cmax[k] = cen[ bvh->idx[first] ][k];
+    }
+    for( i=1; i<num; i++ ) {
+        int ip = bvh->idx[first+i];
+        for( k=0; k<3; k++ ) {
+            if( box[ip][0][k] < bvh->box[nd][0][k] ) bvh->box[nd][0][k] = box[ip][0][k];
+            if( box[ip][1][k] > bvh->box[nd][1][k] ) bvh->box[nd][1][k] = box[ip][1][k];
+            if( cen[ip][k] < cmin[k] ) cmin[k] = cen[ip][k];
+            if( cen[ip][k] > cmax[k] ) cmax[k] = cen[ip][k];
+        }
+    }
+    bvh->range[nd][0] = first;
+    bvh->range[nd][1] = num;
+
+    if( num <= NPT_BVH_LEAF ) {
+        bvh->child[nd][0] = bvh->child[nd][1] = -1;
+        return nd;
+    }
+
+    // 中心座標の範囲が最大の軸で中央値により分割
+    npt_bvh_less less;
+    less.cen  = cen;
+    less.axis = 0;
+    for( k=1; k<3; k++ ) {
+        if( cmax[k] - cmin[k] > cmax[less.axis] - cmin[less.axis] ) less.axis = k;
+    }
+    int half = num/2;
+    std::nth_element( bvh->idx + first, bvh->idx + first + half, bvh->idx + first + num, less );
+
+    bvh->child[nd][0] = npt_bvh_build( bvh, box, cen, first,        half       );
+    bvh->child[nd][1] = npt_bvh_build( bvh, box, cen, first + half, num - half );
+    return nd;
+}
@@ -0,0 +1,329 @@
+/*
+ * Npatch - Nagata Patch Library
+ *
+ * Copyright (c) 2015-2016 Advanced Institute for Computational Science, RIKEN.
+ * All rights reserved.
+ *
+ */
+
+////////////////////////////////////////////////////////////////////////////
+///
+/// 長田パッチ パラメータの遅延生成キャッシュ 関数
+///
+////////////////////////////////////////////////////////////////////////////
+
+
+#include "Npt_Cache.h"
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// シャード
+//    block[b][m] にシャード内の格納位置 n = b*NPT_CACHE_BLOCK + m のパッチを格納する
+//    ブロック表は作成時に最大数を確保し、以後再確保しない（ロックなしの参照で表が動かないため）
+struct npt_cache_shard {
+    int            num;              // 生成済みパッチ数
+    int            max_block;        // ブロック表の大きさ
+    int            num_block;        // 確保済みブロック数
+    NPT_REAL   (**block)[7][3];      // ブロック表 [max_block]
+#ifdef _OPENMP
+    omp_lock_t     lock;             // 生成時のロック
+#endif
+    char           pad[64];          // 隣接シャードとのキャッシュライン共有の回避
+};
+
+//------------------------------------------------------------------
+//  プロトタイプ宣言
+//------------------------------------------------------------------
+static int       npt_cache_shardId( int itri );
+static NPT_REAL* npt_cache_gen( NPT_CACHE* cache, int itri );
+
+
+// #################################################################
+//    公開関数
+// #################################################################
+
+/// キャッシュの作成
+///
+/// @param [in]    mesh         三角形メッシュ（vtx_norm 設定済み）
+/// @param [out]   cache        キャッシュ
+/// @return リターンコード   =0 正常  !=0 異常（メモリ確保失敗）
+int
+npt_cache_crt(
+        NPT_MESH*    mesh,
+        NPT_CACHE*   cache
+    )
+{
+    int  num_tri = mesh->num_tri;
+    int  cnt[NPT_CACHE_NUM_SHARD];
+    int  i, s;
+
+    cache->mesh  = mesh;
+    cache->slot  = (volatile int*)malloc( (num_tri > 0 ? num_tri : 1)*sizeof(int) );
+    cache->shard = calloc( NPT_CACHE_NUM_SHARD, sizeof(npt_cache_shard) );
+    if( cache->slot == NULL || cache->shard == NULL ) {
+        free( (void*)cache->slot );
+        free( cache->shard );
+        cache->slot  = NULL;
+        cache->shard = NULL;
+        return 1;
+    }
+    for( i=0; i<num_tri; i++ ) {
+        cache->slot[i] = -1;
+    }
+
+    // シャードごとの三角形数からブロック表の大きさを決める
+    for( s=0; s<NPT_CACHE_NUM_SHARD; s++ ) {
+        cnt[s] = 0;
+    }
+    for( i=0; i<num_tri; i+=NPT_CACHE_SHARD_TRI ) {
+        int n = num_tri - i;
+        cnt[ npt_cache_shardId( i ) ] += ( n < NPT_CACHE_SHARD_TRI ) ? n : NPT_CACHE_SHARD_TRI;
+    }
+
+    npt_cache_shard* shard = (npt_cache_shard*)cache->shard;
+    int              err   = 0;
+    for( s=0; s<NPT_CACHE_NUM_SHARD; s++ ) {
+        shard[s].max_block = ( cnt[s] + NPT_CACHE_BLOCK - 1 ) / NPT_CACHE_BLOCK;
+        shard[s].block     = (NPT_REAL(**)[7][3])calloc( shard[s].max_block > 0 ? shard[s].max_block : 1,
+                                                          sizeof(NPT_REAL(*)[7][3]) );
+        if( shard[s].block == NULL ) err = 1;
+#ifdef _OPENMP
+        omp_init_lock( &shard[s].lock );
+#endif
+    }
+    if( err ) {
+        npt_cache_free( cache );
+        return 1;
+    }
+
+    return 0;
+}
+
+
+/// キャッシュの全パッチの無効化
+///
+/// @param [inout] cache        キャッシュ
+/// @return なし
+void
+npt_cache_clear(
+        NPT_CACHE*   cache
+    )
+{
+    npt_cache_shard* shard = (npt_cache_shard*)cache->shard;
+    int              i, s;
+
+    for( i=0; i<cache->mesh->num_tri; i++ ) {
+        cache->slot[i] = -1;
+    }
+    for( s=0; s<NPT_CACHE_NUM_SHARD; s++ ) {
+        shard[s].num = 0;
+    }
+#pragma omp flush
+}
+
+
+/// キャッシュの領域解放
+///
+/// @param [inout] cache        キャッシュ
+/// @return なし
+void
+npt_cache_free(
+        NPT_CACHE*   cache
+    )
+{
+    npt_cache_shard* shard = (npt_cache_shard*)cache->shard;
+    int              s, b;
+
+    if( shard != NULL ) {
+        for( s=0; s<NPT_CACHE_NUM_SHARD; s++ ) {
+            if( shard[s].block != NULL ) {
+                for( b=0; b<shard[s].num_block; b++ ) {
+                    free( shard[s].block[b] );
+                }
+                free( shard[s].block );
+            }
+#ifdef _OPENMP
+            omp_destroy_lock( &shard[s].lock );
+#endif
+        }
+    }
+    free( (void*)cache->slot );
+    free( cache->shard );
+    cache->slot  = NULL;
+    cache->shard = NULL;
+}
+
+
+/// 長田パッチパラメータの参照
+///
+/// @param [inout] cache        キャッシュ
+/// @param [in]    itri         三角形番号
+/// @return 長田パッチパラメータ（7x3実数）の先頭  NULL: メモリ確保失敗
+const NPT_REAL*
+npt_cache_get(
+        NPT_CACHE*   cache,
+        int          itri
+    )
+{
+    int n = cache->slot[itri];
+
+    if( n < 0 ) {
+        return npt_cache_gen( cache, itri );
+    }
+
+    // 格納位置の読み出し後にパッチを読む（生成側の書き込みとの順序の保証）
+#pragma omp flush
+    npt_cache_shard* sh = (npt_cache_shard*)cache->shard + npt_cache_shardId( itri );
+    return &sh->block[ n / NPT_CACHE_BLOCK ][ n % NPT_CACHE_BLOCK ][0][0];
+}
+
+
+/// 長田パッチ 近似曲面補正（キャッシュ 複数点）
+///
+/// @param [inout] cache        キャッシュ
+/// @param [in]    num          点数
+/// @param [in]    tri_id       三角形番号 [num]
+/// @param [in]    eta          ηパラメータ [num]
+/// @param [in]    xi           ξパラメータ [num]
+/// @param [out]   pos_o        出力点座標 [num]
+/// @return リターンコード   =0 正常  !=0 異常（メモリ確保失敗）
+int
+npt_cache_correct_pnt_n(
+        NPT_CACHE*   cache,
+        int          num,
+        const int*   tri_id,
+        NPT_REAL*    eta,
+        NPT_REAL*    xi,
+        NPT_REAL     pos_o[][3]
+    )
+{
+    NPT_MESH* mesh = cache->mesh;
+    int       err  = 0;
+
+#pragma omp parallel
+    {
+        const NPT_REAL (*cp)[3] = NULL;
+        int              id_last = -1;
+        int              i;
+
+        // 同一三角形の点が連続する場合は参照を省略する
+#pragma omp for schedule(static) reduction(+:err)
+        for( i=0; i<num; i++ ) {
+            int id = tri_id[i];
+            if( id != id_last ) {
+                cp = (const NPT_REAL(*)[3])npt_cache_get( cache, id );
+                id_last = id;
+            }
+            if( cp == NULL ) {
+                err++;
+                id_last = -1;
+                continue;
+            }
+            npt_correct_pnt(
+                    eta[i], xi[i],
+                    mesh->vtx[ mesh->tri[id][0] ],
+                    mesh->vtx[ mesh->tri[id][1] ],
+                    mesh->vtx[ mesh->tri[id][2] ],
+                    (NPT_REAL*)cp[0], (NPT_REAL*)cp[1], (NPT_REAL*)cp[2], (NPT_REAL*)cp[3],
+                    (NPT_REAL*)cp[4], (NPT_REAL*)cp[5], (NPT_REAL*)cp[6],
+                    pos_o[i]
+                );
+        }
+    }
+
+    return ( err == 0 ) ? 0 : 1;
+}
+
+
+/// 生成済みのパッチ数、スラブのメモリ量
+///
+/// @param [in]    cache        キャッシュ
+/// @param [out]   bytes        スラブとして確保済みのメモリ量 (byte)（NULL 可）
+/// @return 生成済みのパッチ数
+int
+npt_cache_num(
+        NPT_CACHE*   cache,
+        size_t*      bytes
+    )
+{
+    npt_cache_shard* shard = (npt_cache_shard*)cache->shard;
+    int              num = 0, num_block = 0;
+    int              s;
+
+#pragma omp flush
+    for( s=0; s<NPT_CACHE_NUM_SHARD; s++ ) {
+        num       += shard[s].num;
+        num_block += shard[s].num_block;
+    }
+    if( bytes != NULL ) {
+        *bytes = (size_t)num_block*NPT_CACHE_BLOCK*sizeof(NPT_REAL[7][3]);
+    }
+    return num;
+}
+
+
+// #################################################################
+//    非公開（プライベート）関数
+// #################################################################
+
+// 三角形のシャード番号
+static int
+npt_cache_shardId(
+        int          itri          // [in]    三角形番号
+    )
+{
+    return ( itri / NPT_CACHE_SHARD_TRI ) & ( NPT_CACHE_NUM_SHARD - 1 );
+}
+
+
+// パッチの生成（シャードのロックを取って生成、格納する）
+//    ロック取得後に格納位置を再確認し、他のスレッドが生成済みであればそれを返す。
+//    パッチを書き込んでから格納位置を公開するため、ロックを取らずに参照する
+//    スレッドが書き込み途中のパッチを読むことはない。
+//    OpenMP 無効時はロック、flush とも無く、１スレッドからの参照のみを想定する。
+static NPT_REAL*
+npt_cache_gen(
+        NPT_CACHE*   cache,        // [inout] キャッシュ
+        int          itri          // [in]    三角形番号
+    )
+{
+    npt_cache_shard* sh = (npt_cache_shard*)cache->shard + npt_cache_shardId( itri );
+    NPT_REAL*        cp = NULL;
+    int              n, b;
+
+#ifdef _OPENMP
+    omp_set_lock( &sh->lock );
+#endif
+
+    n = cache->slot[itri];
+    if( n >= 0 ) {
+        cp = &sh->block[ n / NPT_CACHE_BLOCK ][ n % NPT_CACHE_BLOCK ][0][0];
+    }
+    else {
+        n = sh->num;
+        b = n / NPT_CACHE_BLOCK;
+        if( b < sh->max_block ) {
+            if( b == sh->num_block ) {
+                sh->block[b] = (NPT_REAL(*)[7][3])malloc( NPT_CACHE_BLOCK*sizeof(NPT_REAL[7][3]) );
+                if( sh->block[b] != NULL ) sh->num_block++;
+            }
+            if( b < sh->num_block ) {
+                npt_mesh_param_get( cache->mesh, itri, sh->block[b][ n % NPT_CACHE_BLOCK ] );
+                cp = &sh->block[b][ n % NPT_CACHE_BLOCK ][0][0];
+#pragma omp flush
+                sh->num = n + 1;
+                cache->slot[itri] = n;
+#pragma omp flush
+            }
+        }
+    }
+
+#ifdef _OPENMP
+    omp_unset_lock( &sh->lock );
+#endif
+    return cp;
+}
@@ -0,0 +1,456 @@
+/*
+ * Npatch - Nagata Patch Library
+ *
+ * Copyright (c) 2015-2016 Advanced Institute for Computational Science, RIKEN.
+ * All rights reserved.
+ *
+ */
+
+////////////////////////////////////////////////////////////////////////////
+///
+/// 長田パッチ 曲率の評価 関数
+///
+////////////////////////////////////////////////////////////////////////////
+
+
+#include "Npt_Curv.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+// 頂点の最小二乗の係数の数（正規方程式の対称 3x3 行列 6、右辺 3）
+#define NPT_CURV_NUM_TENSOR  9
+
+//------------------------------------------------------------------
+//  プロトタイプ宣言
+//------------------------------------------------------------------
+static int  npt_curv_calc( double eta, double xi, NPT_REAL tri[3][3], NPT_REAL cp[7][3], NPT_CURV* curv );
+static void npt_curv_ctrl( NPT_REAL tri[3][3], NPT_REAL cp[7][3], double b[10][3] );
+static void npt_curv_step2( const double b[10][3], const double t[3], double q[6][3] );
+static void npt_curv_step1( const double q[6][3], const double t[3], double l[3][3] );
+static void npt_curv_step0( const double l[3][3], const double t[3], double scale, double x[3] );
+static void npt_curv_basis( const double n[3], double t1[3], double t2[3] );
+static void npt_curv_principal( const double n[3], const double t1[3], const double t2[3],
+                                double a11, double a12, double a22, NPT_CURV* curv );
+
+
+// #################################################################
+//    公開関数
+// #################################################################
+
+/// 曲率の評価
+///
+/// @param [in]    eta          ηパラメータ
+/// @param [in]    xi           ξパラメータ
+/// @param [in]    tri          三角形の頂点座標
+/// @param [in]    npatch       長田パッチパラメータ
+/// @param [out]   curv         曲率の評価結果
+/// @return リターンコード   =0 正常  !=0 異常（接ベクトルが平行）
+int
+npt_curv_eval(
+        NPT_REAL     eta,
+        NPT_REAL     xi,
+        NPT_REAL     tri   [3][3],
+        NPT_REAL     npatch[7][3],
+        NPT_CURV*    curv
+    )
+{
+    return npt_curv_calc( eta, xi, tri, npatch, curv );
+}
+
+
+/// 曲面上の点と接ベクトル（１次微分）
+///
+/// @param [in]    eta          ηパラメータ
+/// @param [in]    xi           ξパラメータ
+/// @param [in]    tri          三角形の頂点座標
+/// @param [in]    npatch       長田パッチパラメータ
+/// @param [out]   pos          曲面上の点
+/// @param [out]   d_eta        ηによる微分 x_eta
+/// @param [out]   d_xi         ξによる微分 x_xi
+/// @return なし
+void
+npt_curv_tangent(
+        NPT_REAL     eta,
+        NPT_REAL     xi,
+        NPT_REAL     tri   [3][3],
+        NPT_REAL     npatch[7][3],
+        NPT_REAL     pos  [3],
+        NPT_REAL     d_eta[3],
+        NPT_REAL     d_xi [3]
+    )
+{
+    static const double de[3] = { -1.0,  1.0, 0.0 };
+    static const double dx[3] = {  0.0, -1.0, 1.0 };
+    double tau[3] = { 1.0 - eta, eta - xi, xi };
+    double b[10][3], q[6][3], l[3][3], x[3], xe[3], xx[3];
+    int    k;
+
+    npt_curv_ctrl( tri, npatch, b );
+    npt_curv_step2( b, tau, q );
+    npt_curv_step1( q, tau, l );
+    npt_curv_step0( l, tau, 1.0, x  );
+    npt_curv_step0( l, de,  3.0, xe );
+    npt_curv_step0( l, dx,  3.0, xx );
+    for( k=0; k<3; k++ ) {
+        pos[k]   = x[k];
+        d_eta[k] = xe[k];
+        d_xi[k]  = xx[k];
+    }
+}
+
+
+/// 曲率の評価（複数点）
+///
+/// @param [in]    num          点数（三角形数）
+/// @param [in]    eta          ηパラメータ [num]
+/// @param [in]    xi           ξパラメータ [num]
+/// @param [in]    tri          三角形の頂点座標 [num]
+/// @param [in]    npatch       長田パッチパラメータ [num]
+/// @param [out]   curv         曲率の評価結果 [num]
+/// @return リターンコード   =0 正常  !=0 異常（異常となった点数）
+int
+npt_curv_eval_n(
+        int          num,
+        NPT_REAL*    eta,
+        NPT_REAL*    xi,
+        NPT_REAL     tri   [][3][3],
+        NPT_REAL     npatch[][7][3],
+        NPT_CURV*    curv
+    )
+{
+    int ng = 0;
+    int i;
+
+#pragma omp parallel for schedule(static) reduction(+:ng)
+    for( i=0; i<num; i++ ) {
+        ng += npt_curv_calc( eta[i], xi[i], tri[i], npatch[i], &curv[i] );
+    }
+    return ng;
+}
+
+
+/// メッシュの頂点の曲率の評価
+///
+/// @param [in]    mesh         三角形メッシュ（vtx_norm 設定済み）
+/// @param [out]   curv         頂点の曲率の評価結果 [num_vtx]
+/// @return リターンコード   =0 正常  !=0 異常（メモリ確保失敗）
+int
+npt_curv_vtx_mesh(
+        NPT_MESH*    mesh,
+        NPT_CURV*    curv
+    )
+{
+    int num_tri = mesh->num_tri;
+    int num_vtx = mesh->num_vtx;
+    int i, j, k;
+
+    double (*tc)[3][NPT_CURV_NUM_TENSOR] =
+        (double(*)[3][NPT_CURV_NUM_TENSOR])malloc( (num_tri > 0 ? num_tri : 1)*sizeof(double[3][NPT_CURV_NUM_TENSOR]) );
+    double (*vc)[NPT_CURV_NUM_TENSOR] =
+        (double(*)[NPT_CURV_NUM_TENSOR])malloc( (num_vtx > 0 ? num_vtx : 1)*sizeof(double[NPT_CURV_NUM_TENSOR]) );
+    if( tc == NULL || vc == NULL ) {
+        free( tc );
+        free( vc );
+        return 1;
+    }
+
+    // 三角形の頂点ごとの最小二乗の係数（頂点から出る２辺の法曲率）
+#pragma omp parallel for schedule(static) private(j,k)
+    for( i=0; i<num_tri; i++ ) {
+        for( j=0; j<3; j++ ) {
+            int     iv = mesh->tri[i][j];
+            double* w  = tc[i][j];
+            double  n[3], t1[3], t2[3];
+
+            for( k=0; k<3; k++ ) n[k] = mesh->vtx_norm[iv][k];
+            npt_curv_basis( n, t1, t2 );
+            for( k=0; k<NPT_CURV_NUM_TENSOR; k++ ) w[k] = 0.0;
+
+            // 頂点jから頂点j+1, j+2 への辺の法曲率（両端の法線の差 -(n_w - n_v)・d/|d|^2）
+            for( int m=1; m<3; m++ ) {
+                int    iw = mesh->tri[i][(j+m)%3];
+                double d[3], dn[3], l2, c, s, kn;
+                for( k=0; k<3; k++ ) {
+                    d[k]  = (double)mesh->vtx[iw][k] - mesh->vtx[iv][k];
+                    dn[k] = (double)mesh->vtx_norm[iw][k] - mesh->vtx_norm[iv][k];
+                }
+                c  = d[0]*t1[0] + d[1]*t1[1] + d[2]*t1[2];
+                s  = d[0]*t2[0] + d[1]*t2[1] + d[2]*t2[2];
+                l2 = c*c + s*s;
+                if( l2 <= 0.0 ) continue;
+                kn = -( dn[0]*d[0] + dn[1]*d[1] + dn[2]*d[2] )/( d[0]*d[0] + d[1]*d[1] + d[2]*d[2] );
+
+                // kn = a11 c^2 + 2 a12 c s + a22 s^2 の正規方程式
+                double r[3] = { c*c/l2, 2.0*c*s/l2, s*s/l2 };
+                w[0] += r[0]*r[0];  w[1] += r[0]*r[1];  w[2] += r[0]*r[2];
+                w[3] += r[1]*r[1];  w[4] += r[1]*r[2];  w[5] += r[2]*r[2];
+                w[6] += r[0]*kn;    w[7] += r[1]*kn;    w[8] += r[2]*kn;
+            }
+        }
+    }
+
+    // 頂点ごとの和（三角形番号順）
+    memset( vc, 0, (num_vtx > 0 ? num_vtx : 1)*sizeof(double[NPT_CURV_NUM_TENSOR]) );
+    for( i=0; i<num_tri; i++ ) {
+        for( j=0; j<3; j++ ) {
+            int iv = mesh->tri[i][j];
+            for( k=0; k<NPT_CURV_NUM_TENSOR; k++ ) vc[iv][k] += tc[i][j][k];
+        }
+    }
+
+    // 頂点法線の接平面での形状作用素（最小二乗解）の主曲率、主方向
+#pragma omp parallel for schedule(static) private(k)
+    for( i=0; i<num_vtx; i++ ) {
+        double n[3], t1[3], t2[3], det;
+        double* w = vc[i];
+
+        memset( &curv[i], 0, sizeof(NPT_CURV) );
+        for( k=0; k<3; k++ ) {
+            curv[i].pos[k]  = mesh->vtx[i][k];
+            curv[i].norm[k] = mesh->vtx_norm[i][k];
+            n[k] = mesh->vtx_norm[i][k];
+        }
+
+        // 3x3 対称行列の Cramer の公式（方向が３つ未満の頂点は解かない）
+        det = w[0]*( w[3]*w[5] - w[4]*w[4] ) - w[1]*( w[1]*w[5] - w[4]*w[2] ) + w[2]*( w[1]*w[4] - w[3]*w[2] );
+        if( !( det > 1.0e-12*( w[0] + w[3] + w[5] )*( w[0] + w[3] + w[5] )*( w[0] + w[3] + w[5] ) ) ) continue;
+        double a11 = ( w[6]*( w[3]*w[5] - w[4]*w[4] ) - w[1]*( w[7]*w[5] - w[4]*w[8] ) + w[2]*( w[7]*w[4] - w[3]*w[8] ) )/det;
+        double a12 = ( w[0]*( w[7]*w[5] - w[4]*w[8] ) - w[6]*( w[1]*w[5] - w[4]*w[2] ) + w[2]*( w[1]*w[8] - w[7]*w[2] ) )/det;
+        double a22 = ( w[0]*( w[3]*w[8] - w[7]*w[4] ) - w[1]*( w[1]*w[8] - w[7]*w[2] ) + w[6]*( w[1]*w[4] - w[3]*w[2] ) )/det;
+
+        npt_curv_basis( n, t1, t2 );
+        npt_curv_principal( n, t1, t2, a11, a12, a22, &curv[i] );
+
+        curv[i].ff1[0] = 1.0;
+        curv[i].ff1[1] = 0.0;
+        curv[i].ff1[2] = 1.0;
+        curv[i].ff2[0] = curv[i].k[0];
+        curv[i].ff2[1] = 0.0;
+        curv[i].ff2[2] = curv[i].k[1];
+    }
+
+    free( tc );
+    free( vc );
+    return 0;
+}
+
+
+// #################################################################
+//    非公開（プライベート）関数
+// #################################################################
+
+// 曲率の計算
+//    ３次三角形ベジェのブロッサム b(t1,t2,t3) により
+//        x = b(τ,τ,τ)  x_d = 3 b(τ,τ,d)  x_dd' = 6 b(τ,d,d')
+//    （τ = (w,u,v)、eta方向 d_eta = (-1,1,0)、xi方向 d_xi = (0,-1,1)）
+static int
+npt_curv_calc(
+        double    eta,             // [in]    ηパラメータ
+        double    xi,              // [in]    ξパラメータ
+        NPT_REAL  tri[3][3],       // [in]    三角形の頂点座標
+        NPT_REAL  cp[7][3],        // [in]    長田パッチパラメータ
+        NPT_CURV* curv             // [out]   曲率の評価結果
+    )
+{
+    static const double d_eta[3] = { -1.0,  1.0, 0.0 };
+    static const double d_xi [3] = {  0.0, -1.0, 1.0 };
+    double tau[3] = { 1.0 - eta, eta - xi, xi };
+    double b[10][3], q[6][3], l[3][3], le[3][3], lx[3][3];
+    double x[3], xe[3], xx[3], xee[3], xex[3], xxx[3], n[3];
+    double E, F, G, L, M, N, det, len;
+    int    k;
+
+    npt_curv_ctrl( tri, cp, b );
+    npt_curv_step2( b, tau, q );
+    npt_curv_step1( q, tau,   l  );
+    npt_curv_step1( q, d_eta, le );
+    npt_curv_step1( q, d_xi,  lx );
+    npt_curv_step0( l,  tau,   1.0, x   );
+    npt_curv_step0( l,  d_eta, 3.0, xe  );
+    npt_curv_step0( l,  d_xi,  3.0, xx  );
+    npt_curv_step0( le, d_eta, 6.0, xee );
+    npt_curv_step0( le, d_xi,  6.0, xex );
+    npt_curv_step0( lx, d_xi,  6.0, xxx );
+
+    memset( curv, 0, sizeof(NPT_CURV) );
+    for( k=0; k<3; k++ ) curv->pos[k] = x[k];
+
+    n[0] = xe[1]*xx[2] - xe[2]*xx[1];
+    n[1] = xe[2]*xx[0] - xe[0]*xx[2];
+    n[2] = xe[0]*xx[1] - xe[1]*xx[0];
+    len  = sqrt( n[0]*n[0] + n[1]*n[1] + n[2]*n[2] );
+    if( len == 0.0 ) return 1;
+    for( k=0; k<3; k++ ) n[k] /= len;
+
+    E = xe[0]*xe[0] + xe[1]*xe[1] + xe[2]*xe[2];
+    F = xe[0]*xx[0] + xe[1]*xx[1] + xe[2]*xx[2];
+    G = xx[0]*xx[0] + xx[1]*xx[1] + xx[2]*xx[2];
+    L = xee[0]*n[0] + xee[1]*n[1] + xee[2]*n[2];
+    M = xex[0]*n[0] + xex[1]*n[1] + xex[2]*n[2];
+    N = xxx[0]*n[0] + xxx[1]*n[1] + xxx[2]*n[2];
+    det = E*G - F*F;
+    if( det <= 0.0 ) return 1;
+
+    // 接平面の正規直交基底 t1 = x_eta/|x_eta|、t2 = n × t1 での形状作用素
+    //    x_eta = sE t1、x_xi = (F/sE) t1 + (sqrt(det)/sE) t2
+    double sE = sqrt( E ), sD = sqrt( det );
+    double t1[3], t2[3];
+    for( k=0; k<3; k++ ) t1[k] = xe[k]/sE;
+    t2[0] = n[1]*t1[2] - n[2]*t1[1];
+    t2[1] = n[2]*t1[0] - n[0]*t1[2];
+    t2[2] = n[0]*t1[1] - n[1]*t1[0];
+    double a11 = L/E;
+    double a12 = ( M - F*a11 )/sD;
+    double a22 = ( N - 2.0*F*M/E + F*F*L/(E*E) )/( det/E );
+
+    npt_curv_principal( n, t1, t2, a11, a12, a22, curv );
+    curv->ff1[0] = E;
+    curv->ff1[1] = F;
+    curv->ff1[2] = G;
+    curv->ff2[0] = L;
+    curv->ff2[1] = M;
+    curv->ff2[2] = N;
+    return 0;
+}
+
+
+// ３次の制御点
+//    P1, cp_side1_1, cp_side1_2, P2, cp_side2_1, cp_side2_2, P3, cp_side3_1, cp_side3_2, cp_center の順
+static void
+npt_curv_ctrl(
+        NPT_REAL  tri[3][3],       // [in]    三角形の頂点座標
+        NPT_REAL  cp[7][3],        // [in]    長田パッチパラメータ
+        double    b[10][3]         // [out]   ３次の制御点
+    )
+{
+    int k;
+
+    for( k=0; k<3; k++ ) {
+        b[0][k] = tri[0][k];  b[1][k] = cp[0][k];  b[2][k] = cp[1][k];
+        b[3][k] = tri[1][k];  b[4][k] = cp[2][k];  b[5][k] = cp[3][k];
+        b[6][k] = tri[2][k];  b[7][k] = cp[4][k];  b[8][k] = cp[5][k];
+        b[9][k] = cp[6][k];
+    }
+}
+
+
+// de Casteljau の１段（３次 -> ２次）
+//    制御点の順 b: 300,210,120,030,021,012,003,102,201,111  q: 200,110,020,011,002,101
+//    （添字は w,u,v の次数）
+static void
+npt_curv_step2(
+        const double  b[10][3],    // [in]    ３次の制御点
+        const double  t[3],        // [in]    引数 (w,u,v)
+        double        q[6][3]      // [out]   ２次の制御点
+    )
+{
+    int k;
+
+    for( k=0; k<3; k++ ) {
+        q[0][k] = t[0]*b[0][k] + t[1]*b[1][k] + t[2]*b[8][k];
+        q[1][k] = t[0]*b[1][k] + t[1]*b[2][k] + t[2]*b[9][k];
+        q[2][k] = t[0]*b[2][k] + t[1]*b[3][k] + t[2]*b[4][k];
+        q[3][k] = t[0]*b[9][k] + t[1]*b[4][k] + t[2]*b[5][k];
+        q[4][k] = t[0]*b[7][k] + t[1]*b[5][k] + t[2]*b[6][k];
+        q[5][k] = t[0]*b[8][k] + t[1]*b[9][k] + t[2]*b[7][k];
+    }
+}
+
+
+// de Casteljau の１段（２次 -> １次）
+//    l: 100,010,001
+static void
+npt_curv_step1(
+        const double  q[6][3],     // [in]    ２次の制御点
+        const double  t[3],        // [in]    引数 (w,u,v)
+        double        l[3][3]      // [out]   １次の制御点
+    )
+{
+    int k;
+
+    for( k=0; k<3; k++ ) {
+        l[0][k] = t[0]*q[0][k] + t[1]*q[1][k] + t[2]*q[5][k];
+        l[1][k] = t[0]*q[1][k] + t[1]*q[2][k] + t[2]*q[3][k];
+        l[2][k] = t[0]*q[5][k] + t[1]*q[3][k] + t[2]*q[4][k];
+    }
+}
+
+
+// de Casteljau の最終段（１次 -> 点）
+static void
+npt_curv_step0(
+        const double  l[3][3],     // [in]    １次の制御点
+        const double  t[3],        // [in]    引数 (w,u,v)
+        double        scale,       // [in]    倍率
+        double        x[3]         // [out]   点（微分）
+    )
+{
+    int k;
+
+    for( k=0; k<3; k++ ) {
+        x[k] = scale*( t[0]*l[0][k] + t[1]*l[1][k] + t[2]*l[2][k] );
+    }
+}
+
+
+// 接平面の正規直交基底（法線の最小成分の軸との外積）
+static void
+npt_curv_basis(
+        const double  n[3],        // [in]    単位法線ベクトル
+        double        t1[3],       // [out]   接平面の基底1
+        double        t2[3]        // [out]   接平面の基底2 = n × t1
+    )
+{
+    double a[3], len;
+    int    k;
+
+    int ax = ( fabs(n[0]) <= fabs(n[1]) && fabs(n[0]) <= fabs(n[2]) ) ? 0 : ( fabs(n[1]) <= fabs(n[2]) ) ? 1 : 2;
+    a[0] = a[1] = a[2] = 0.0;
+    a[ax] = 1.0;
+    t1[0] = a[1]*n[2] - a[2]*n[1];
+    t1[1] = a[2]*n[0] - a[0]*n[2];
+    t1[2] = a[0]*n[1] - a[1]*n[0];
+    len = sqrt( t1[0]*t1[0] + t1[1]*t1[1] + t1[2]*t1[2] );
+    for( k=0; k<3; k++ ) t1[k] /= len;
+    t2[0] = n[1]*t1[2] - n[2]*t1[1];
+    t2[1] = n[2]*t1[0] - n[0]*t1[2];
+    t2[2] = n[0]*t1[1] - n[1]*t1[0];
+}
+
+
+// 接平面の正規直交基底 (t1,t2) での形状作用素（対称 2x2）の固有値、固有ベクトル
+//    k[0] >= k[1]、dir[1] = n × dir[0]
+static void
+npt_curv_principal(
+        const double  n[3],        // [in]    単位法線ベクトル
+        const double  t1[3],       // [in]    接平面の基底1
+        const double  t2[3],       // [in]    接平面の基底2
+        double        a11,         // [in]    形状作用素 (1,1)
+        double        a12,         // [in]    形状作用素 (1,2)
+        double        a22,         // [in]    形状作用素 (2,2)
+        NPT_CURV*     curv         // [out]   曲率の評価結果
+    )
+{
+    double hm = 0.5*( a11 + a22 );
+    double hd = 0.5*( a11 - a22 );
+    double r  = sqrt( hd*hd + a12*a12 );
+    double th = ( r > 0.0 ) ? 0.5*atan2( a12, hd ) : 0.0;
+    double c  = cos( th ), s = sin( th );
+    double d0[3];
+    int    k;
+
+    for( k=0; k<3; k++ ) d0[k] = c*t1[k] + s*t2[k];
+
+    for( k=0; k<3; k++ ) {
+        curv->norm[k]   = n[k];
+        curv->dir[0][k] = d0[k];
+    }
+    curv->dir[1][0] = n[1]*d0[2] - n[2]*d0[1];
+    curv->dir[1][1] = n[2]*d0[0] - n[0]*d0[2];
+    curv->dir[1][2] = n[0]*d0[1] - n[1]*d0[0];
+    curv->k[0]    = hm + r;
+    curv->k[1]    = hm - r;
+    curv->k_gauss = ( hm + r )*( hm - r );
+    curv->k_mean  = hm;
+}
@@ -0,0 +1,403 @@
+/*
+ * Npatch - Nagata Patch Library
+ *
+ * Copyright (c) 2015-2016 Advanced Institute for Computational Science, RIKEN.
+ * All rights reserved.
+ *
+ */
+
+////////////////////////////////////////////////////////////////////////////
+///
+/// 長田パッチ 曲面の積分 関数
+///
+////////////////////////////////////////////////////////////////////////////
+
+
+#include "Npt_Integ.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+// 求積公式の最大点数
+#define NPT_INTEG_MAX_PNT   16
+
+// 積分量の数（表面積、体積、１次モーメント3、２次モーメント6）
+#define NPT_INTEG_NUM_SUM   11
+
+// 求積公式の点の軌道（重心座標）
+//    type 0 : (1/3,1/3,1/3)          1点
+//    type 1 : (a,b,b) a=1-2b          3点
+//    type 2 : (a,b,c) c=1-a-b         6点
+struct npt_integ_orbit {
+    int     type;
+    double  w;      // 重み（三角形の面積で正規化、合計1）
+    double  a, b;
+};
+
+// Dunavant (1985) の求積公式（次数 1-8）
+static const npt_integ_orbit npt_integ_orbit_tab[] = {
+    // 次数1  1点
+    { 0,  1.000000000000000, 0.0, 0.0 },
+    // 次数2  3点
+    { 1,  0.333333333333333333, 0.666666666666666667, 0.166666666666666667 },
+    // 次数3  4点
+    { 0, -0.562500000000000, 0.0, 0.0 },
+    { 1,  0.520833333333333333, 0.600000000000000, 0.200000000000000 },
+    // 次数4  6点
+    { 1,  0.223381589678011, 0.108103018168070, 0.445948490915965 },
+    { 1,  0.109951743655322, 0.816847572980459, 0.091576213509771 },
+    // 次数5  7点
+    { 0,  0.225000000000000, 0.0, 0.0 },
+    { 1,  0.132394152788506, 0.059715871789770, 0.470142064105115 },
+    { 1,  0.125939180544827, 0.797426985353087, 0.101286507323456 },
+    // 次数6  12点
+    { 1,  0.116786275726379, 0.501426509658179, 0.249286745170910 },
+    { 1,  0.050844906370207, 0.873821971016996, 0.063089014491502 },
+    { 2,  0.082851075618374, 0.053145049844817, 0.310352451033784 },
+    // 次数7  13点
+    { 0, -0.149570044467682, 0.0, 0.0 },
+    { 1,  0.175615257433208, 0.479308067841920, 0.260345966079040 },
+    { 1,  0.053347235608838, 0.869739794195568, 0.065130102902216 },
+    { 2,  0.077113760890257, 0.048690315425316, 0.312865496004874 },
+    // 次数8  16点
+    { 0,  0.144315607677787, 0.0, 0.0 },
+    { 1,  0.095091634267285, 0.081414823414554, 0.459292588292723 },
+    { 1,  0.103217370534718, 0.658861384496480, 0.170569307751760 },
+    { 1,  0.032458497623198, 0.898905543365938, 0.050547228317031 },
+    { 2,  0.027230314174435, 0.008394777409958, 0.263112829634638 },
+};
+
+// 次数ごとの軌道の先頭位置、軌道数
+static const int npt_integ_orbit_idx[NPT_INTEG_MAX_DEGREE+1][2] = {
+    { 0, 0 }, { 0, 1 }, { 1, 1 }, { 2, 2 }, { 4, 2 }, { 6, 3 }, { 9, 3 }, { 12, 4 }, { 16, 5 }
+};
+
+// 求積点の基底関数値（制御点 P1, cp_side1_1, cp_side1_2, P2, cp_side2_1, cp_side2_2,
+// P3, cp_side3_1, cp_side3_2, cp_center の順）と eta, xi による微分
+struct npt_integ_pnt {
+    double  w;          // 重み（パラメータ領域の面積 1/2 を含む）
+    double  bs[10];     // 基底関数値
+    double  d_eta[10];  // eta による微分
+    double  d_xi[10];   // xi による微分
+};
+
+//------------------------------------------------------------------
+//  プロトタイプ宣言
+//------------------------------------------------------------------
+static int  npt_integ_table( int degree, npt_integ_pnt pnt[NPT_INTEG_MAX_PNT] );
+static void npt_integ_basis( double w, double u, double v, npt_integ_pnt* pnt );
+static int  npt_integ_run( int num, NPT_REAL (*tri)[3][3], NPT_REAL (*npatch)[7][3], NPT_MESH* mesh,
+                           int degree, NPT_INTEG* res );
+static void npt_integ_patch( NPT_REAL tri[3][3], NPT_REAL cp[7][3], const double ref[3],
+                             int num_pnt, const npt_integ_pnt* pnt, double sum[NPT_INTEG_NUM_SUM] );
+
+
+// #################################################################
+//    公開関数
+// #################################################################
+
+/// 曲面の積分（複数パッチ）
+///
+/// @param [in]    num          三角形数
+/// @param [in]    tri          三角形の頂点座標 [num]
+/// @param [in]    npatch       長田パッチパラメータ [num]
+/// @param [in]    degree       求積公式の次数
+/// @param [out]   res          積分の結果
+/// @return リターンコード   =0 正常  !=0 異常（メモリ確保失敗、degree 不正）
+int
+npt_integ_n(
+        int          num,
+        NPT_REAL     tri   [][3][3],
+        NPT_REAL     npatch[][7][3],
+        int          degree,
+        NPT_INTEG*   res
+    )
+{
+    return npt_integ_run( num, tri, npatch, NULL, degree, res );
+}
+
+
+/// 曲面の積分（三角形メッシュ）
+///
+/// @param [in]    mesh         三角形メッシュ（vtx_norm 設定済み）
+/// @param [in]    degree       求積公式の次数
+/// @param [out]   res          積分の結果
+/// @return リターンコード   =0 正常  !=0 異常（メモリ確保失敗、degree 不正）
+int
+npt_integ_mesh(
+        NPT_MESH*    mesh,
+        int          degree,
+        NPT_INTEG*   res
+    )
+{
+    return npt_integ_run( mesh->num_tri, NULL, NULL, mesh, degree, res );
+}
+
+
+/// パッチごとの表面積（三角形メッシュ）
+///
+/// @param [in]    mesh         三角形メッシュ（vtx_norm 設定済み）
+/// @param [in]    degree       求積公式の次数
+/// @param [out]   area         パッチの表面積 [num_tri]
+/// @return リターンコード   =0 正常  !=0 異常（degree 不正）
+int
+npt_integ_area_mesh(
+        NPT_MESH*    mesh,
+        int          degree,
+        NPT_REAL*    area
+    )
+{
+    npt_integ_pnt pnt[NPT_INTEG_MAX_PNT];
+    int           num_pnt;
+    int           i;
+
+    if( degree < 1 || degree > NPT_INTEG_MAX_DEGREE ) return 1;
+    num_pnt = npt_integ_table( degree, pnt );
+
+#pragma omp parallel for schedule(static)
+    for( i=0; i<mesh->num_tri; i++ ) {
+        double   s[NPT_INTEG_NUM_SUM], ref[3];
+        NPT_REAL t[3][3], cp[7][3];
+        int      l, m;
+
+        for( l=0; l<3; l++ ) {
+            for( m=0; m<3; m++ ) t[l][m] = mesh->vtx[ mesh->tri[i][l] ][m];
+        }
+        for( m=0; m<3; m++ ) ref[m] = t[0][m];
+        for( l=0; l<NPT_INTEG_NUM_SUM; l++ ) s[l] = 0.0;
+        npt_mesh_param_get( mesh, i, cp );
+        npt_integ_patch( t, cp, ref, num_pnt, pnt, s );
+        area[i] = s[0];
+    }
+    return 0;
+}
+
+
+// #################################################################
+//    非公開（プライベート）関数
+// #################################################################
+
+// 求積点の作成
+//    求積点数を返す
+static int
+npt_integ_table(
+        int            degree,     // [in]    求積公式の次数
+        npt_integ_pnt  pnt[NPT_INTEG_MAX_PNT] // [out] 求積点
+    )
+{
+    int num = 0;
+    int i, k;
+
+    for( i=0; i<npt_integ_orbit_idx[degree][1]; i++ ) {
+        const npt_integ_orbit* ob = &npt_integ_orbit_tab[ npt_integ_orbit_idx[degree][0] + i ];
+        double bc[6][3];
+        int    nb;
+
+        if( ob->type == 0 ) {
+            bc[0][0] = bc[0][1] = bc[0][2] = 1.0/3.0;
+            nb = 1;
+        }
+        else if( ob->type == 1 ) {
+            double a = 1.0 - 2.0*ob->b, b = ob->b;
+            bc[0][0] = a; bc[0][1] = b; bc[0][2] = b;
+            bc[1][0] = b; bc[1][1] = a; bc[1][2] = b;
+            bc[2][0] = b; bc[2][1] = b; bc[2][2] = a;
+            nb = 3;
+        }
+        else {
+            double a = ob->a, b = ob->b, c = 1.0 - ob->a - ob->b;
+            bc[0][0] = a; bc[0][1] = b; bc[0][2] = c;
+            bc[1][0] = a; bc[1][1] = c; bc[1][2] = b;
+            bc[2][0] = b; bc[2][1] = a; bc[2][2] = c;
+            bc[3][0] = b; bc[3][1] = c; bc[3][2] = a;
+            bc[4][0] = c; bc[4][1] = a; bc[4][2] = b;
+            bc[5][0] = c; bc[5][1] = b; bc[5][2] = a;
+            nb = 6;
+        }
+        for( k=0; k<nb; k++ ) {
+            // 重心座標 (w,u,v) の w は頂点1、u は頂点2、v は頂点3 の重み
+            npt_integ_basis( bc[k][0], bc[k][1], bc[k][2], &pnt[num] );
+            pnt[num].w = 0.5*ob->w;
+            num++;
+        }
+    }
+    return num;
+}
+
+
+// 基底関数値と eta, xi による微分
+//    x(u,v,w) の u,v,w による偏微分 x_u, x_v, x_w から
+//    x_eta = x_u - x_w  (u = eta - xi, w = 1 - eta)
+//    x_xi  = x_v - x_u  (v = xi)
+static void
+npt_integ_basis(
+        double          w,         // [in]    重心座標（頂点1）
+        double          u,         // [in]    重心座標（頂点2）
+        double          v,         // [in]    重心座標（頂点3）
+        npt_integ_pnt*  pnt        // [out]   求積点
+    )
+{
+    //                      P1      c11      c12      P2     c21      c22      P3     c31      c32      cc
+    double bs[10] = { w*w*w, 3*u*w*w, 3*u*u*w, u*u*u, 3*u*u*v, 3*u*v*v, v*v*v, 3*v*v*w, 3*v*w*w, 6*u*v*w };
+    double du[10] = { 0,     3*w*w,   6*u*w,   3*u*u, 6*u*v,   3*v*v,   0,     0,       0,       6*v*w   };
+    double dv[10] = { 0,     0,       0,       0,     3*u*u,   6*u*v,   3*v*v, 6*v*w,   3*w*w,   6*u*w   };
+    double dw[10] = { 3*w*w, 6*u*w,   3*u*u,   0,     0,       0,       0,     3*v*v,   6*v*w,   6*u*v   };
+    int    j;
+
+    for( j=0; j<10; j++ ) {
+        pnt->bs[j]    = bs[j];
+        pnt->d_eta[j] = du[j] - dw[j];
+        pnt->d_xi[j]  = dv[j] - du[j];
+    }
+}
+
+
+// 曲面の積分
+//    mesh != NULL の場合はメッシュ、それ以外は tri, npatch の配列を対象とする
+static int
+npt_integ_run(
+        int          num,          // [in]    三角形数
+        NPT_REAL   (*tri)[3][3],   // [in]    三角形の頂点座標 [num]
+        NPT_REAL   (*npatch)[7][3],// [in]    長田パッチパラメータ [num]
+        NPT_MESH*    mesh,         // [in]    三角形メッシュ
+        int          degree,       // [in]    求積公式の次数
+        NPT_INTEG*   res           // [out]   積分の結果
+    )
+{
+    npt_integ_pnt pnt[NPT_INTEG_MAX_PNT];
+    double        sum[NPT_INTEG_NUM_SUM];
+    double        ref[3] = { 0.0, 0.0, 0.0 };
+    int           num_pnt, num_blk;
+    int           ib, j, k;
+
+    memset( res, 0, sizeof(NPT_INTEG) );
+    if( degree < 1 || degree > NPT_INTEG_MAX_DEGREE ) return 1;
+    if( num <= 0 ) return 0;
+
+    num_pnt = npt_integ_table( degree, pnt );
+    num_blk = ( num + NPT_INTEG_BLOCK - 1 )/NPT_INTEG_BLOCK;
+    double (*part)[NPT_INTEG_NUM_SUM] = (double(*)[NPT_INTEG_NUM_SUM])malloc( num_blk*sizeof(double[NPT_INTEG_NUM_SUM]) );
+    if( part == NULL ) return 1;
+
+    // 積分の基準点（座標の大きさによる桁落ちを抑える）
+    for( k=0; k<3; k++ ) {
+        ref[k] = ( mesh != NULL ) ? mesh->vtx[ mesh->tri[0][0] ][k] : tri[0][0][k];
+    }
+
+    // ブロック単位の部分和
+#pragma omp parallel for schedule(dynamic)
+    for( ib=0; ib<num_blk; ib++ ) {
+        double   s[NPT_INTEG_NUM_SUM];
+        NPT_REAL t[3][3], cp[7][3];
+        int      i0 = ib*NPT_INTEG_BLOCK;
+        int      i1 = ( i0 + NPT_INTEG_BLOCK < num ) ? i0 + NPT_INTEG_BLOCK : num;
+        int      i, l, m;
+
+        for( l=0; l<NPT_INTEG_NUM_SUM; l++ ) s[l] = 0.0;
+        for( i=i0; i<i1; i++ ) {
+            if( mesh != NULL ) {
+                for( l=0; l<3; l++ ) {
+                    for( m=0; m<3; m++ ) t[l][m] = mesh->vtx[ mesh->tri[i][l] ][m];
+                }
+                npt_mesh_param_get( mesh, i, cp );
+                npt_integ_patch( t, cp, ref, num_pnt, pnt, s );
+            }
+            else {
+                npt_integ_patch( tri[i], npatch[i], ref, num_pnt, pnt, s );
+            }
+        }
+        for( l=0; l<NPT_INTEG_NUM_SUM; l++ ) part[ib][l] = s[l];
+    }
+
+    // ブロック番号順に加算（スレッド数によらない）
+    for( j=0; j<NPT_INTEG_NUM_SUM; j++ ) sum[j] = 0.0;
+    for( ib=0; ib<num_blk; ib++ ) {
+        for( j=0; j<NPT_INTEG_NUM_SUM; j++ ) sum[j] += part[ib][j];
+    }
+    free( part );
+
+    // 重心、重心まわりの２次モーメント、慣性テンソル
+    double c[3] = { 0.0, 0.0, 0.0 };
+    double mm[3][3];
+    res->area   = sum[0];
+    res->volume = sum[1];
+    if( sum[1] != 0.0 ) {
+        for( k=0; k<3; k++ ) c[k] = sum[2+k]/sum[1];
+    }
+    mm[0][0] = sum[5];  mm[1][1] = sum[6];  mm[2][2] = sum[7];
+    mm[0][1] = mm[1][0] = sum[8];
+    mm[0][2] = mm[2][0] = sum[9];
+    mm[1][2] = mm[2][1] = sum[10];
+    for( j=0; j<3; j++ ) {
+        for( k=0; k<3; k++ ) mm[j][k] -= sum[1]*c[j]*c[k];
+    }
+    for( j=0; j<3; j++ ) {
+        res->cen[j] = ref[j] + c[j];
+        for( k=0; k<3; k++ ) {
+            res->inertia[j][k] = ( j == k ) ? mm[0][0] + mm[1][1] + mm[2][2] - mm[j][j] : -mm[j][k];
+        }
+    }
+    return 0;
+}
+
+
+// １パッチの積分（sum に加算）
+//    sum[0]    表面積         |N|
+//    sum[1]    体積           x.N/3
+//    sum[2-4]  １次モーメント x_i^2 N_i/2
+//    sum[5-7]  ２次モーメント x_i^3 N_i/3              (xx, yy, zz)
+//    sum[8-10] ２次モーメント x_i^2 x_j N_i/2          (xy, xz, yz)
+//    （N = x_eta × x_xi、x は基準点からの相対座標）
+static void
+npt_integ_patch(
+        NPT_REAL              tri[3][3],  // [in]    三角形の頂点座標
+        NPT_REAL              cp[7][3],   // [in]    長田パッチパラメータ
+        const double          ref[3],     // [in]    基準点
+        int                   num_pnt,    // [in]    求積点数
+        const npt_integ_pnt*  pnt,        // [in]    求積点
+        double                sum[NPT_INTEG_NUM_SUM] // [inout] 積分値
+    )
+{
+    double p[10][3];
+    int    q, j, k;
+
+    // 制御点（基底関数の順）
+    for( k=0; k<3; k++ ) {
+        p[0][k] = tri[0][k] - ref[k];
+        p[1][k] = cp[0][k]  - ref[k];
+        p[2][k] = cp[1][k]  - ref[k];
+        p[3][k] = tri[1][k] - ref[k];
+        p[4][k] = cp[2][k]  - ref[k];
+        p[5][k] = cp[3][k]  - ref[k];
+        p[6][k] = tri[2][k] - ref[k];
+        p[7][k] = cp[4][k]  - ref[k];
+        p[8][k] = cp[5][k]  - ref[k];
+        p[9][k] = cp[6][k]  - ref[k];
+    }
+
+    for( q=0; q<num_pnt; q++ ) {
+        double x[3] = { 0.0, 0.0, 0.0 }, xe[3] = { 0.0, 0.0, 0.0 }, xx[3] = { 0.0, 0.0, 0.0 };
+        double n[3], w = pnt[q].w;
+
+        for( j=0; j<10; j++ ) {
+            for( k=0; k<3; k++ ) {
+                x[k]  += pnt[q].bs[j]   *p[j][k];
+                xe[k] += pnt[q].d_eta[j]*p[j][k];
+                xx[k] += pnt[q].d_xi[j] *p[j][k];
+            }
+        }
+        n[0] = xe[1]*xx[2] - xe[2]*xx[1];
+        n[1] = xe[2]*xx[0] - xe[0]*xx[2];
+        n[2] = xe[0]*xx[1] - xe[1]*xx[0];
+
+        sum[0]  += w*sqrt( n[0]*n[0] + n[1]*n[1] + n[2]*n[2] );
+        sum[1]  += w*( x[0]*n[0] + x[1]*n[1] + x[2]*n[2] )/3.0;
+        for( k=0; k<3; k++ ) {
+            sum[2+k] += w*x[k]*x[k]*n[k]/2.0;
+            sum[5+k] += w*x[k]*x[k]*x[k]*n[k]/3.0;
+        }
+        sum[8]  += w*x[0]*x[0]*x[1]*n[0]/2.0;
+        sum[9]  += w*x[0]*x[0]*x[2]*n[0]/2.0;
+        sum[10] += w*x[1]*x[1]*x[2]*n[1]/2.0;
+    }
+}
@@ -0,0 +1,424 @@
+/*
+ * Npatch - Nagata Patch Library
+ *
+ * Copyright (c) 2015-2016 Advanced Institute for Computational Science, RIKEN.
+ * All rights reserved.
+ *
+ */
+
+////////////////////////////////////////////////////////////////////////////
+///
+/// 長田パッチ 曲面の交差検出 関数
+///
+////////////////////////////////////////////////////////////////////////////
+
+
+#include "Npt_Isect.h"
+#include "Npt_Bvh.h"
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <algorithm>
+
+// 検索結果の初期の大きさ
+#define NPT_ISECT_LIST   256
+
+// パッチの配列
+struct npt_isect_patch {
+    int          num;
+    NPT_REAL   (*tri)[3][3];     // 三角形の頂点座標 [num]
+    NPT_REAL   (*cp)[7][3];      // 長田パッチパラメータ [num]
+    NPT_REAL   (*box)[2][3];     // パッチの包含箱 [num]
+};
+
+// 交差するパッチの組の比較（tri[0], tri[1] の昇順）
+struct npt_isect_less {
+    bool operator()( const NPT_ISECT_PAIR& a, const NPT_ISECT_PAIR& b ) const {
+        if( a.tri[0] != b.tri[0] ) return a.tri[0] < b.tri[0];
+        return a.tri[1] < b.tri[1];
+    }
+};
+
+//------------------------------------------------------------------
+//  プロトタイプ宣言
+//------------------------------------------------------------------
+static int  npt_isect_prepare( NPT_MESH* mesh, npt_isect_patch* pt );
+static void npt_isect_release( npt_isect_patch* pt );
+static void npt_isect_box( NPT_REAL tri[3][3], NPT_REAL cp[7][3], NPT_REAL box[2][3] );
+static int  npt_isect_run( npt_isect_patch* pa, npt_isect_patch* pb, int (*self_tri)[3], int depth, NPT_ISECT* res );
+static int  npt_isect_patchPair( NPT_REAL tri_a[3][3], NPT_REAL cp_a[7][3], NPT_REAL tri_b[3][3], NPT_REAL cp_b[7][3],
+                                 int level, int* work, NPT_REAL pos[3] );
+static int  npt_isect_triPair( NPT_REAL ta[3][3], NPT_REAL tb[3][3], NPT_REAL pos[3] );
+static int  npt_isect_segTri( NPT_REAL p[3], NPT_REAL q[3], NPT_REAL t[3][3], NPT_REAL pos[3] );
+
+
+// #################################################################
+//    公開関数
+// #################################################################
+
+/// 自己交差の検出
+///
+/// @param [in]    mesh         三角形メッシュ（vtx_norm 設定済み）
+/// @param [in]    depth        分割の深さ
+/// @param [out]   res          交差検出の結果
+/// @return リターンコード   =0 正常  !=0 異常（メモリ確保失敗、depth 不正）
+int
+npt_isect_self(
+        NPT_MESH*    mesh,
+        int          depth,
+        NPT_ISECT*   res
+    )
+{
+    npt_isect_patch pt;
+    int             ret;
+
+    res->num_pair  = 0;
+    res->pair      = NULL;
+    res->num_cand  = 0;
+    res->num_limit = 0;
+    if( depth < 0 || depth > NPT_ISECT_MAX_DEPTH ) return 1;
+
+    if( npt_isect_prepare( mesh, &pt ) != 0 ) return 1;
+    ret = npt_isect_run( &pt, &pt, mesh->tri, depth, res );
+    npt_isect_release( &pt );
+
+    return ret;
+}
+
+
+/// ２つのメッシュの曲面の交差の検出
+///
+/// @param [in]    mesh_a       三角形メッシュa（vtx_norm 設定済み）
+/// @param [in]    mesh_b       三角形メッシュb（vtx_norm 設定済み）
+/// @param [in]    depth        分割の深さ
+/// @param [out]   res          交差検出の結果
+/// @return リターンコード   =0 正常  !=0 異常（メモリ確保失敗、depth 不正）
+int
+npt_isect_mesh(
+        NPT_MESH*    mesh_a,
+        NPT_MESH*    mesh_b,
+        int          depth,
+        NPT_ISECT*   res
+    )
+{
+    npt_isect_patch pa, pb;
+    int             ret;
+
+    res->num_pair  = 0;
+    res->pair      = NULL;
+    res->num_cand  = 0;
+    res->num_limit = 0;
+    if( depth < 0 || depth > NPT_ISECT_MAX_DEPTH ) return 1;
+
+    if( npt_isect_prepare( mesh_a, &pa ) != 0 ) return 1;
+    if( npt_isect_prepare( mesh_b, &pb ) != 0 ) {
+        npt_isect_release( &pa );
+        return 1;
+    }
+    ret = npt_isect_run( &pa, &pb, NULL, depth, res );
+    npt_isect_release( &pa );
+    npt_isect_release( &pb );
+
+    return ret;
+}
+
+
+/// 交差検出の結果の領域解放
+///
+/// @param [inout] res          交差検出の結果
+/// @return なし
+void
+npt_isect_free(
+        NPT_ISECT*   res
+    )
+{
+    free( res->pair );
+    res->pair     = NULL;
+    res->num_pair = 0;
+}
+
+
+// #################################################################
+//    非公開（プライベート）関数
+// #################################################################
+
+// パッチの頂点、長田パッチパラメータ、包含箱の作成
+static int
+npt_isect_prepare(
+        NPT_MESH*         mesh,    // [in]    三角形メッシュ
+        npt_isect_patch*  pt       // [out]   パッチの配列
+    )
+{
+    int num = mesh->num_tri;
+    int i;
+
+    pt->num = num;
+    pt->tri = (NPT_REAL(*)[3][3])malloc( (num > 0 ? num : 1)*sizeof(NPT_REAL[3][3]) );
+    pt->cp  = (NPT_REAL(*)[7][3])malloc( (num > 0 ? num : 1)*sizeof(NPT_REAL[7][3]) );
+    pt->box = (NPT_REAL(*)[2][3])malloc( (num > 0 ? num : 1)*sizeof(NPT_REAL[2][3]) );
+    if( pt->tri == NULL || pt->cp == NULL || pt->box == NULL ) {
+        npt_isect_release( pt );
+        return 1;
+    }
+
+#pragma omp parallel for schedule(static)
+    for( i=0; i<num; i++ ) {
+        int j, k;
+        for( j=0; j<3; j++ ) {
+            for( k=0; k<3; k++ ) pt->tri[i][j][k] = mesh->vtx[ mesh->tri[i][j] ][k];
+        }
+        npt_mesh_param_get( mesh, i, pt->cp[i] );
+        npt_isect_box( pt->tri[i], pt->cp[i], pt->box[i] );
+    }
+    return 0;
+}
+
+
+// パッチの配列の解放
+static void
+npt_isect_release(
+        npt_isect_patch*  pt       // [inout] パッチの配列
+    )
+{
+    free( pt->tri );
+    free( pt->cp );
+    free( pt->box );
+    pt->tri = NULL;
+    pt->cp  = NULL;
+    pt->box = NULL;
+}
+
+
+// パッチの包含箱（頂点と制御点の包含箱）
+static void
+npt_isect_box(
+        NPT_REAL  tri[3][3],       // [in]    三角形の頂点座標
+        NPT_REAL  cp[7][3],        // [in]    長田パッチパラメータ
+        NPT_REAL  box[2][3]        // [out]   包含箱
+    )
+{
+    int j, k;
+
+    for( k=0; k<3; k++ ) {
+        box[0][k] = box[1][k] = tri[0][k];
+    }
+    for( j=1; j<3; j++ ) {
+        for( k=0; k<3; k++ ) {
+            if( tri[j][k] < box[0][k] ) box[0][k] = tri[j][k];
+            if( tri[j][k] > box[1][k] ) box[1][k] = tri[j][k];
+        }
+    }
+    for( j=0; j<7; j++ ) {
+        for( k=0; k<3; k++ ) {
+            if( cp[j][k] < box[0][k] ) box[0][k] = cp[j][k];
+            if( cp[j][k] > box[1][k] ) box[1][k] = cp[j][k];
+        }
+    }
+}
+
+
+// 交差検出（パッチaごとに包含箱が重なるパッチbを検索し詳細判定）
+//    self_tri != NULL の場合は自己交差（pa == pb）とし、
+//    tri[0] < tri[1] かつ頂点を共有しない組のみ判定する
+static int
+npt_isect_run(
+        npt_isect_patch*  pa,      // [in]    パッチの配列a
+        npt_isect_patch*  pb,      // [in]    パッチの配列b
+        int            (*self_tri)[3], // [in] 自己交差の場合は三角形の頂点番号、２メッシュの場合は NULL
+        int               depth,   // [in]    分割の深さ
+        NPT_ISECT*        res      // [out]   交差検出の結果
+    )
+{
+    NPT_BVH                      bvh;
+    std::vector<NPT_ISECT_PAIR>  pair;
+    long long                    num_cand = 0, num_limit = 0;
+    int                          i;
+
+    if( npt_bvh_crt( pb->num, pb->box, &bvh ) != 0 ) return 1;
+
+#pragma omp parallel reduction(+:num_cand,num_limit)
+    {
+        std::vector<NPT_ISECT_PAIR> pair_t;
+        std::vector<int>            list( NPT_ISECT_LIST );
+
+#pragma omp for schedule(dynamic,64)
+        for( i=0; i<pa->num; i++ ) {
+            int n = npt_bvh_query( &bvh, pa->box[i], pb->box, (int)list.size(), &list[0] );
+            if( n > (int)list.size() ) {
+                list.resize( n );
+                n = npt_bvh_query( &bvh, pa->box[i], pb->box, n, &list[0] );
+            }
+
+            for( int m=0; m<n; m++ ) {
+                int            j = list[m];
+                NPT_ISECT_PAIR ip;
+
+                if( self_tri != NULL ) {
+                    if( j <= i ) continue;
+                    int share = 0;
+                    for( int a=0; a<3; a++ ) {
+                        for( int b=0; b<3; b++ ) {
+                            if( self_tri[i][a] == self_tri[j][b] ) share = 1;
+                        }
+                    }
+                    if( share ) continue;
+                }
+                num_cand++;
+
+                int work = NPT_ISECT_MAX_WORK;
+                int hit  = npt_isect_patchPair( pa->tri[i], pa->cp[i], pb->tri[j], pb->cp[j], depth, &work, ip.pos );
+                if( hit ) {
+                    ip.tri[0] = i;
+                    ip.tri[1] = j;
+                    ip.limit  = ( hit == 2 );
+                    pair_t.push_back( ip );
+                    if( ip.limit ) num_limit++;
+                }
+            }
+        }
+
+#pragma omp critical (npt_isect_merge)
+        {
+            pair.insert( pair.end(), pair_t.begin(), pair_t.end() );
+        }
+    }
+    npt_bvh_free( &bvh );
+
+    // スレッド数によらない順序とする
+    std::sort( pair.begin(), pair.end(), npt_isect_less() );
+
+    res->num_cand  = num_cand;
+    res->num_limit = num_limit;
+    res->num_pair = (int)pair.size();
+    res->pair     = (NPT_ISECT_PAIR*)malloc( (pair.size() > 0 ? pair.size() : 1)*sizeof(NPT_ISECT_PAIR) );
+    if( res->pair == NULL ) {
+        res->num_pair = 0;
+        return 1;
+    }
+    if( pair.size() > 0 ) {
+        memcpy( res->pair, &pair[0], pair.size()*sizeof(NPT_ISECT_PAIR) );
+    }
+    return 0;
+}
+
+
+// パッチの組の詳細判定（再帰）
+//    level=0 の場合は頂点の三角形どうしを判定し、
+//    それ以外は両方のパッチを４分割し包含箱が重なる子パッチの組を判定する
+//    交差する場合は 1 を返し、pos に近似の交点を設定する
+//    判定した組の数を work から減じ、0 となった場合は以降の組を判定せず交差するとみなして 2 を返し、
+//    pos に包含箱の重なりの中心を設定する
+static int
+npt_isect_patchPair(
+        NPT_REAL  tri_a[3][3],     // [in]    パッチaの頂点座標
+        NPT_REAL  cp_a[7][3],      // [in]    パッチaの長田パッチパラメータ
+        NPT_REAL  tri_b[3][3],     // [in]    パッチbの頂点座標
+        NPT_REAL  cp_b[7][3],      // [in]    パッチbの長田パッチパラメータ
+        int       level,           // [in]    残りの分割の深さ
+        int*      work,            // [inout] 判定できる組の残りの数
+        NPT_REAL  pos[3]           // [out]   近似の交点
+    )
+{
+    NPT_REAL sub_tri_a[4][3][3], sub_cp_a[4][7][3], box_a[4][2][3];
+    NPT_REAL sub_tri_b[4][3][3], sub_cp_b[4][7][3], box_b[4][2][3];
+    int      ca, cb, hit;
+
+    if( *work <= 0 ) {
+        npt_isect_box( tri_a, cp_a, box_a[0] );
+        npt_isect_box( tri_b, cp_b, box_b[0] );
+        for( ca=0; ca<3; ca++ ) {
+            NPT_REAL lo = ( box_a[0][0][ca] > box_b[0][0][ca] ) ? box_a[0][0][ca] : box_b[0][0][ca];
+            NPT_REAL hi = ( box_a[0][1][ca] < box_b[0][1][ca] ) ? box_a[0][1][ca] : box_b[0][1][ca];
+            pos[ca] = 0.5*( lo + hi );
+        }
+        return 2;
+    }
+    (*work)--;
+
+    if( level == 0 ) {
+        return npt_isect_triPair( tri_a, tri_b, pos );
+    }
+
+    npt_subdiv( tri_a, cp_a, sub_tri_a, sub_cp_a );
+    npt_subdiv( tri_b, cp_b, sub_tri_b, sub_cp_b );
+    for( ca=0; ca<4; ca++ ) {
+        npt_isect_box( sub_tri_a[ca], sub_cp_a[ca], box_a[ca] );
+        npt_isect_box( sub_tri_b[ca], sub_cp_b[ca], box_b[ca] );
+    }
+
+    for( ca=0; ca<4; ca++ ) {
+        for( cb=0; cb<4; cb++ ) {
+            if( !npt_bvh_overlap( box_a[ca], box_b[cb] ) ) continue;
+            hit = npt_isect_patchPair( sub_tri_a[ca], sub_cp_a[ca], sub_tri_b[cb], sub_cp_b[cb], level-1, work, pos );
+            if( hit ) return hit;
+        }
+    }
+    return 0;
+}
+
+
+// 三角形どうしの交差判定
+//    各三角形の辺ともう一方の三角形の交点を求め、交点の平均（交線の中点）を pos に設定する
+static int
+npt_isect_triPair(
+        NPT_REAL  ta[3][3],        // [in]    三角形a
+        NPT_REAL  tb[3][3],        // [in]    三角形b
+        NPT_REAL  pos[3]           // [out]   近似の交点
+    )
+{
+    NPT_REAL p[3], sum[3] = { 0.0, 0.0, 0.0 };
+    int      num = 0;
+    int      j, k;
+
+    for( j=0; j<3; j++ ) {
+        if( npt_isect_segTri( ta[j], ta[(j+1)%3], tb, p ) ) {
+            for( k=0; k<3; k++ ) sum[k] += p[k];
+            num++;
+        }
+        if( npt_isect_segTri( tb[j], tb[(j+1)%3], ta, p ) ) {
+            for( k=0; k<3; k++ ) sum[k] += p[k];
+            num++;
+        }
+    }
+    if( num == 0 ) return 0;
+
+    for( k=0; k<3; k++ ) pos[k] = sum[k]/num;
+    return 1;
+}
+
+
+// 線分と三角形の交点（Moller-Trumbore）
+//    線分が三角形と平行な場合は交差なしとする
+static int
+npt_isect_segTri(
+        NPT_REAL  p[3],            // [in]    線分の始点
+        NPT_REAL  q[3],            // [in]    線分の終点
+        NPT_REAL  t[3][3],         // [in]    三角形
+        NPT_REAL  pos[3]           // [out]   交点
+    )
+{
+    NPT_REAL e1[3], e2[3], d[3], s[3], h[3], g[3];
+    NPT_REAL det, u, v, r;
+
+    CalcVec( t[0], t[1], e1 );
+    CalcVec( t[0], t[2], e2 );
+    CalcVec( p, q, d );
+    CalcOutProduct( d, e2, h );
+    det = CalcInProduct( e1, h );
+    if( det == 0.0 ) return 0;
+
+    CalcVec( t[0], p, s );
+    u = CalcInProduct( s, h )/det;
+    if( u < 0.0 || u > 1.0 ) return 0;
+    CalcOutProduct( s, e1, g );
+    v = CalcInProduct( d, g )/det;
+    if( v < 0.0 || u + v > 1.0 ) return 0;
+    r = CalcInProduct( e2, g )/det;
+    if( r < 0.0 || r > 1.0 ) return 0;
+
+    pos[0] = p[0] + r*d[0];
+    pos[1] = p[1] + r*d[1];
+    pos[2] = p[2] + r*d[2];
+    return 1;
+}
+
@@ -0,0 +1,787 @@
+/*
+ * Npatch - Nagata Patch Library
+ *
+ * Copyright (c) 2015-2016 Advanced Institute for Computational Science, RIKEN.
+ * All rights reserved.
+ *
+ */
+
+////////////////////////////////////////////////////////////////////////////
+///
+/// 長田パッチ メッシュ単位の処理 関数
+///
+////////////////////////////////////////////////////////////////////////////
+
+
+#include "Npt_Mesh.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <algorithm>
+
+//------------------------------------------------------------------
+//  プロトタイプ宣言： Npt.cxx のプライベート関数
+//------------------------------------------------------------------
+void npt_param_calcControlPointEdge( NPT_REAL p1[3], NPT_REAL norm1[3], NPT_REAL d1, NPT_REAL p2[3], NPT_REAL norm2[3], NPT_REAL d2,
+           NPT_REAL cp1_e[3], NPT_REAL cp2_e[3] );
+void npt_param_calcControlPointCenter( NPT_REAL p1[3], NPT_REAL p2[3], NPT_REAL p3[3],
+           NPT_REAL cp1_p1p2[3], NPT_REAL cp2_p1p2[3], NPT_REAL cp1_p2p3[3], NPT_REAL cp2_p2p3[3], NPT_REAL cp1_p3p1[3], NPT_REAL cp2_p3p1[3],
+           NPT_REAL cp_center[3] );
+
+// 辺のソート用キー
+struct npt_edge_key {
+    uint64_t  key;    // (小さい頂点番号 << 32) | 大きい頂点番号
+    int       he;     // 3*三角形番号 + 辺番号
+    bool operator<( const npt_edge_key& o ) const { return key < o.key; }
+};
+
+// 並べ替え用キー
+struct npt_sfc_key {
+    uint64_t  key;    // 空間充填曲線上の位置
+    int       id;     // 元の番号
+    bool operator<( const npt_sfc_key& o ) const { return ( key < o.key ) || ( key == o.key && id < o.id ); }
+};
+
+// 空間充填曲線の格子の分割ビット数（各軸）
+#define NPT_SFC_BITS  21
+// Hilbert順の状態数（軸の置換 x 反転）
+#define NPT_SFC_STATE 48
+
+//------------------------------------------------------------------
+//  プロトタイプ宣言
+//------------------------------------------------------------------
+static uint64_t npt_sfc_spread( uint64_t x );
+static void     npt_sfc_hilbertTable( unsigned short table[NPT_SFC_STATE][8] );
+static uint64_t npt_sfc_calcKey( const NPT_REAL pos[3], const NPT_REAL bmin[3], const NPT_REAL scale[3], const unsigned short table[NPT_SFC_STATE][8] );
+static void     npt_vnorm_tri( NPT_MESH* mesh, NPT_VNORM* vnorm, int itri );
+static void     npt_vnorm_vtx( NPT_MESH* mesh, NPT_VNORM* vnorm, int ivtx );
+
+// #################################################################
+//    公開関数
+// #################################################################
+
+/// 三角形の長田パッチパラメータ生成（辺の向きを頂点番号で統一）
+///
+/// @param [in]    mesh         三角形メッシュ
+/// @param [in]    itri         三角形番号
+/// @param [out]   cp           長田パッチパラメータ（制御点 cp_side1_1-cp_center の順）
+/// @return なし
+void
+npt_mesh_param_get(
+        NPT_MESH*    mesh,
+        int          itri,
+        NPT_REAL     cp[7][3]
+    )
+{
+    int* tri = mesh->tri[itri];
+    int  j, k;
+
+    // 辺の制御点  頂点番号の小さい頂点 -> 大きい頂点 の向きで計算する
+    for( j=0; j<3; j++ ) {
+        int      v0 = tri[j];
+        int      v1 = tri[(j+1)%3];
+        NPT_REAL cp_e[2][3];
+        int      flip = ( v0 > v1 ) ? 1 : 0;
+        if( flip ) {
+            int wk = v0; v0 = v1; v1 = wk;
+        }
+        npt_param_calcControlPointEdge(
+               mesh->vtx[v0], mesh->vtx_norm[v0], CalcPlaneD( mesh->vtx[v0], mesh->vtx_norm[v0] ),
+               mesh->vtx[v1], mesh->vtx_norm[v1], CalcPlaneD( mesh->vtx[v1], mesh->vtx_norm[v1] ),
+               cp_e[0], cp_e[1]
+           );
+        for( k=0; k<3; k++ ) {
+            cp[2*j  ][k] = cp_e[flip  ][k];
+            cp[2*j+1][k] = cp_e[1-flip][k];
+        }
+    }
+
+    // 中央の制御点
+    npt_param_calcControlPointCenter(
+           mesh->vtx[tri[0]], mesh->vtx[tri[1]], mesh->vtx[tri[2]],
+           cp[0], cp[1], cp[2], cp[3], cp[4], cp[5],
+           cp[6]
+        );
+}
+
+
+/// 三角形の法線（辺ベクトルの外積、大きさは面積の２倍）
+///
+/// @param [in]    p1           頂点１座標
+/// @param [in]    p2           頂点２座標
+/// @param [in]    p3           頂点３座標
+/// @param [out]   norm         三角形の法線（単位ベクトル化しない）
+/// @return なし
+void
+npt_mesh_tri_norm(
+        NPT_REAL     p1[3],
+        NPT_REAL     p2[3],
+        NPT_REAL     p3[3],
+        NPT_REAL     norm[3]
+    )
+{
+    NPT_REAL vec12[3], vec13[3];
+
+    CalcVec( p1, p2, vec12 );
+    CalcVec( p1, p3, vec13 );
+    CalcOutProduct( vec12, vec13, norm );
+}
+
+
+/// 辺共有形式の長田パッチパラメータ生成
+///
+/// @param [in]    mesh         三角形メッシュ
+/// @param [out]   epatch       辺共有形式の長田パッチパラメータ（領域は内部で確保する）
+/// @return リターンコード   =0 正常  !=0 異常（メモリ確保失敗）
+int
+npt_epatch_crt(
+        NPT_MESH*    mesh,
+        NPT_EPATCH*  epatch
+    )
+{
+    int num_he = 3*mesh->num_tri;
+    int i, ie;
+
+    memset( epatch, 0, sizeof(NPT_EPATCH) );
+
+    //-------------------
+    //  辺の抽出
+    //-------------------
+    npt_edge_key* keys = (npt_edge_key*)malloc( (num_he > 0 ? num_he : 1)*sizeof(npt_edge_key) );
+    epatch->tri_edge   = (int(*)[3])malloc( (mesh->num_tri > 0 ? mesh->num_tri : 1)*sizeof(int[3]) );
+    if( keys == NULL || epatch->tri_edge == NULL ) {
+        free( keys );
+        npt_epatch_free( epatch );
+        return 1;
+    }
+
+#pragma omp parallel for schedule(static)
+    for( i=0; i<num_he; i++ ) {
+        uint64_t v0 = (uint64_t)mesh->tri[i/3][i%3];
+        uint64_t v1 = (uint64_t)mesh->tri[i/3][(i%3+1)%3];
+        keys[i].key = ( v0 < v1 ) ? ( (v0<<32) | v1 ) : ( (v1<<32) | v0 );
+        keys[i].he  = i;
+    }
+    std::sort( keys, keys + num_he );
+
+    // 辺数
+    int num_edge = 0;
+    for( i=0; i<num_he; i++ ) {
+        if( i == 0 || keys[i].key != keys[i-1].key ) num_edge++;
+    }
+
+    epatch->num_edge = num_edge;
+    epatch->edge_vtx = (int(*)[2])malloc( (num_edge > 0 ? num_edge : 1)*sizeof(int[2]) );
+    epatch->edge_cp  = (NPT_REAL(*)[2][3])malloc( (num_edge > 0 ? num_edge : 1)*sizeof(NPT_REAL[2][3]) );
+    if( epatch->edge_vtx == NULL || epatch->edge_cp == NULL ) {
+        free( keys );
+        npt_epatch_free( epatch );
+        return 1;
+    }
+
+    // 辺番号と向きの設定
+    ie = -1;
+    for( i=0; i<num_he; i++ ) {
+        if( i == 0 || keys[i].key != keys[i-1].key ) {
+            ie++;
+            epatch->edge_vtx[ie][0] = (int)( keys[i].key >> 32 );
+            epatch->edge_vtx[ie][1] = (int)( keys[i].key & 0xffffffffu );
+        }
+        int it = keys[i].he / 3;
+        int ip = keys[i].he % 3;
+        int flip = ( mesh->tri[it][ip] == epatch->edge_vtx[ie][0] ) ? 0 : 1;
+        epatch->tri_edge[it][ip] = 2*ie + flip;
+    }
+    free( keys );
+
+    //-------------------
+    //  辺の制御点
+    //-------------------
+    npt_epatch_update( mesh, epatch );
+
+    return 0;
+}
+
+
+/// 辺共有形式の長田パッチパラメータ 辺の制御点の再計算
+///
+/// @param [in]    mesh         三角形メッシュ
+/// @param [inout] epatch       辺共有形式の長田パッチパラメータ
+/// @return なし
+void
+npt_epatch_update(
+        NPT_MESH*    mesh,
+        NPT_EPATCH*  epatch
+    )
+{
+    int ie;
+
+#pragma omp parallel for schedule(static)
+    for( ie=0; ie<epatch->num_edge; ie++ ) {
+        int       v0 = epatch->edge_vtx[ie][0];
+        int       v1 = epatch->edge_vtx[ie][1];
+        NPT_REAL  d0 = CalcPlaneD( mesh->vtx[v0], mesh->vtx_norm[v0] );
+        NPT_REAL  d1 = CalcPlaneD( mesh->vtx[v1], mesh->vtx_norm[v1] );
+
+        npt_param_calcControlPointEdge(
+               mesh->vtx[v0], mesh->vtx_norm[v0], d0,
+               mesh->vtx[v1], mesh->vtx_norm[v1], d1,
+               epatch->edge_cp[ie][0],
+               epatch->edge_cp[ie][1]
+           );
+    }
+}
+
+
+/// 辺共有形式の長田パッチパラメータ領域解放
+///
+/// @param [inout] epatch       辺共有形式の長田パッチパラメータ
+/// @return なし
+void
+npt_epatch_free(
+        NPT_EPATCH*  epatch
+    )
+{
+    free( epatch->edge_vtx );
+    free( epatch->edge_cp );
+    free( epatch->tri_edge );
+    memset( epatch, 0, sizeof(NPT_EPATCH) );
+}
+
+
+/// 三角形の長田パッチパラメータ取得
+///
+/// @param [in]    mesh         三角形メッシュ
+/// @param [in]    epatch       辺共有形式の長田パッチパラメータ
+/// @param [in]    itri         三角形番号
+/// @param [out]   cp           長田パッチパラメータ（制御点 cp_side1_1-cp_center の順）
+/// @return なし
+void
+npt_epatch_get(
+        NPT_MESH*    mesh,
+        NPT_EPATCH*  epatch,
+        int          itri,
+        NPT_REAL     cp[7][3]
+    )
+{
+    int j, k;
+
+    // 辺の制御点（三角形の辺の向きに並べる）
+    for( j=0; j<3; j++ ) {
+        int ie   = epatch->tri_edge[itri][j] >> 1;
+        int flip = epatch->tri_edge[itri][j] & 1;
+        for( k=0; k<3; k++ ) {
+            cp[2*j  ][k] = epatch->edge_cp[ie][flip  ][k];
+            cp[2*j+1][k] = epatch->edge_cp[ie][1-flip][k];
+        }
+    }
+
+    // 中央の制御点
+    npt_param_calcControlPointCenter(
+           mesh->vtx[ mesh->tri[itri][0] ],
+           mesh->vtx[ mesh->tri[itri][1] ],
+           mesh->vtx[ mesh->tri[itri][2] ],
+           cp[0], cp[1], cp[2], cp[3], cp[4], cp[5],
+           cp[6]
+        );
+}
+
+
+/// 長田パッチ 近似曲面補正（辺共有形式 複数点）
+///
+/// @param [in]    mesh         三角形メッシュ
+/// @param [in]    epatch       辺共有形式の長田パッチパラメータ
+/// @param [in]    num          点数
+/// @param [in]    tri_id       三角形番号 [num]
+/// @param [in]    eta          ηパラメータ [num]
+/// @param [in]    xi           ξパラメータ [num]
+/// @param [out]   pos_o        出力点座標 [num]
+/// @return なし
+void
+npt_epatch_correct_pnt_n(
+        NPT_MESH*    mesh,
+        NPT_EPATCH*  epatch,
+        int          num,
+        const int*   tri_id,
+        NPT_REAL*    eta,
+        NPT_REAL*    xi,
+        NPT_REAL     pos_o[][3]
+    )
+{
+#pragma omp parallel
+    {
+        NPT_REAL cp[7][3];
+        int      id_last = -1;
+        int      i;
+
+        // 同一三角形の点が連続する場合は制御点の取得を省略する
+#pragma omp for schedule(static)
+        for( i=0; i<num; i++ ) {
+            int id = tri_id[i];
+            if( id != id_last ) {
+                npt_epatch_get( mesh, epatch, id, cp );
+                id_last = id;
+            }
+            npt_correct_pnt(
+                    eta[i], xi[i],
+                    mesh->vtx[ mesh->tri[id][0] ],
+                    mesh->vtx[ mesh->tri[id][1] ],
+                    mesh->vtx[ mesh->tri[id][2] ],
+                    cp[0], cp[1], cp[2], cp[3], cp[4], cp[5], cp[6],
+                    pos_o[i]
+                );
+        }
+    }
+}
+
+
+/// 頂点法線ベクトルの差分更新用データ生成
+///
+/// @param [inout] mesh         三角形メッシュ（vtx_norm を設定する）
+/// @param [out]   vnorm        差分更新用データ（領域は内部で確保する）
+/// @return リターンコード   =0 正常  !=0 異常（メモリ確保失敗）
+int
+npt_vnorm_crt(
+        NPT_MESH*    mesh,
+        NPT_VNORM*   vnorm
+    )
+{
+    int num_vtx = mesh->num_vtx;
+    int num_tri = mesh->num_tri;
+    int nv = ( num_vtx > 0 ) ? num_vtx : 1;
+    int nt = ( num_tri > 0 ) ? num_tri : 1;
+    int i, j;
+
+    memset( vnorm, 0, sizeof(NPT_VNORM) );
+    vnorm->num_vtx     = num_vtx;
+    vnorm->num_tri     = num_tri;
+    vnorm->vtx_tri_ptr = (int*)malloc( (num_vtx+1)*sizeof(int) );
+    vnorm->vtx_tri     = (int*)malloc( 3*nt*sizeof(int) );
+    vnorm->tri_norm    = (NPT_REAL(*)[3])malloc( nt*sizeof(NPT_REAL[3]) );
+    vnorm->upd_vtx     = (int*)malloc( nv*sizeof(int) );
+    vnorm->upd_tri     = (int*)malloc( nt*sizeof(int) );
+    vnorm->vtx_mark    = (unsigned char*)calloc( nv, sizeof(unsigned char) );
+    vnorm->tri_mark    = (unsigned char*)calloc( nt, sizeof(unsigned char) );
+    vnorm->mov_vtx     = (int*)malloc( nv*sizeof(int) );
+    if( vnorm->vtx_tri_ptr == NULL || vnorm->vtx_tri == NULL || vnorm->tri_norm == NULL ||
+        vnorm->upd_vtx == NULL || vnorm->upd_tri == NULL ||
+        vnorm->vtx_mark == NULL || vnorm->tri_mark == NULL || vnorm->mov_vtx == NULL ) {
+        npt_vnorm_free( vnorm );
+        return 1;
+    }
+
+    //-------------------
+    //  頂点の周囲の三角形（三角形番号の昇順）
+    //-------------------
+    int* ptr = vnorm->vtx_tri_ptr;
+    int* pos = vnorm->upd_vtx;     // 格納位置（作業用）
+    memset( ptr, 0, (num_vtx+1)*sizeof(int) );
+    for( i=0; i<num_tri; i++ ) {
+        for( j=0; j<3; j++ ) ptr[ mesh->tri[i][j] + 1 ]++;
+    }
+    for( i=0; i<num_vtx; i++ ) {
+        ptr[i+1] += ptr[i];
+        pos[i] = ptr[i];
+    }
+    for( i=0; i<num_tri; i++ ) {
+        for( j=0; j<3; j++ ) vnorm->vtx_tri[ pos[ mesh->tri[i][j] ]++ ] = i;
+    }
+
+    //-------------------
+    //  三角形の法線、頂点法線ベクトル
+    //-------------------
+#pragma omp parallel for schedule(static)
+    for( i=0; i<num_tri; i++ ) {
+        npt_vnorm_tri( mesh, vnorm, i );
+    }
+
+#pragma omp parallel for schedule(static)
+    for( i=0; i<num_vtx; i++ ) {
+        npt_vnorm_vtx( mesh, vnorm, i );
+    }
+
+    return 0;
+}
+
+
+/// 頂点法線ベクトルの差分更新
+///
+/// @param [inout] mesh         三角形メッシュ（vtx_norm を更新する）
+/// @param [inout] vnorm        差分更新用データ
+/// @param [in]    num          移動した頂点数
+/// @param [in]    vtx_id       移動した頂点番号 [num]（重複可）
+/// @return リターンコード   =0 正常  !=0 異常（頂点番号が範囲外、更新しない）
+int
+npt_vnorm_update(
+        NPT_MESH*    mesh,
+        NPT_VNORM*   vnorm,
+        int          num,
+        const int*   vtx_id
+    )
+{
+    const int*     ptr  = vnorm->vtx_tri_ptr;
+    const int*     vt   = vnorm->vtx_tri;
+    unsigned char* mark = vnorm->vtx_mark;
+    int            num_mov = 0, num_upd = 0, num_upd_tri = 0;
+    int            i, k, p;
+
+    for( i=0; i<num; i++ ) {
+        if( vtx_id[i] < 0 || vtx_id[i] >= vnorm->num_vtx ) return 1;
+    }
+
+    //-------------------
+    //  移動した頂点（重複を除く、印 1）
+    //-------------------
+    for( i=0; i<num; i++ ) {
+        int iv = vtx_id[i];
+        if( mark[iv] == 0 ) {
+            mark[iv] = 1;
+            vnorm->mov_vtx[num_mov++] = iv;
+        }
+    }
+
+    //-------------------
+    //  移動した頂点を含む三角形の法線
+    //     三角形の頂点のうち最初の移動した頂点が計算する（同じ三角形を複数のスレッドで計算しない）
+    //-------------------
+#pragma omp parallel for schedule(static) private(p)
+    for( i=0; i<num_mov; i++ ) {
+        int iv = vnorm->mov_vtx[i];
+        for( p=ptr[iv]; p<ptr[iv+1]; p++ ) {
+            int* tri = mesh->tri[ vt[p] ];
+            int  owner = mark[tri[0]] ? tri[0] : ( mark[tri[1]] ? tri[1] : tri[2] );
+            if( owner == iv ) npt_vnorm_tri( mesh, vnorm, vt[p] );
+        }
+    }
+
+    //-------------------
+    //  法線ベクトルを再計算する頂点（移動した頂点を含む三角形の頂点、印 2）
+    //-------------------
+    for( i=0; i<num_mov; i++ ) {
+        int iv = vnorm->mov_vtx[i];
+        for( p=ptr[iv]; p<ptr[iv+1]; p++ ) {
+            for( k=0; k<3; k++ ) {
+                int jv = mesh->tri[ vt[p] ][k];
+                if( ( mark[jv] & 2 ) == 0 ) {
+                    mark[jv] |= 2;
+                    vnorm->upd_vtx[num_upd++] = jv;
+                }
+            }
+        }
+    }
+
+#pragma omp parallel for schedule(static)
+    for( i=0; i<num_upd; i++ ) {
+        npt_vnorm_vtx( mesh, vnorm, vnorm->upd_vtx[i] );
+    }
+
+    //-------------------
+    //  頂点法線ベクトルが変化した頂点を含む三角形
+    //-------------------
+    for( i=0; i<num_upd; i++ ) {
+        int iv = vnorm->upd_vtx[i];
+        for( p=ptr[iv]; p<ptr[iv+1]; p++ ) {
+            if( vnorm->tri_mark[ vt[p] ] == 0 ) {
+                vnorm->tri_mark[ vt[p] ] = 1;
+                vnorm->upd_tri[num_upd_tri++] = vt[p];
+            }
+        }
+    }
+
+    // 印の消去
+    for( i=0; i<num_mov; i++ ) mark[ vnorm->mov_vtx[i] ] = 0;
+    for( i=0; i<num_upd; i++ ) mark[ vnorm->upd_vtx[i] ] = 0;
+    for( i=0; i<num_upd_tri; i++ ) vnorm->tri_mark[ vnorm->upd_tri[i] ] = 0;
+
+    vnorm->num_upd_vtx = num_upd;
+    vnorm->num_upd_tri = num_upd_tri;
+
+    return 0;
+}
+
+
+/// 頂点法線ベクトルの差分更新用データ領域解放
+///
+/// @param [inout] vnorm        差分更新用データ
+/// @return なし
+void
+npt_vnorm_free(
+        NPT_VNORM*   vnorm
+    )
+{
+    free( vnorm->vtx_tri_ptr );
+    free( vnorm->vtx_tri );
+    free( vnorm->tri_norm );
+    free( vnorm->upd_vtx );
+    free( vnorm->upd_tri );
+    free( vnorm->vtx_mark );
+    free( vnorm->tri_mark );
+    free( vnorm->mov_vtx );
+    memset( vnorm, 0, sizeof(NPT_VNORM) );
+}
+
+
+/// メッシュの並べ替え
+///
+/// @param [inout] mesh         三角形メッシュ（vtx_norm は NULL 可）
+/// @param [in]    curve        空間充填曲線 NPT_REORDER_MORTON / NPT_REORDER_HILBERT
+/// @param [out]   vtx_perm     新しい頂点番号 i の元の頂点番号 vtx_perm[i] [num_vtx]（NULL 可）
+/// @param [out]   tri_perm     新しい三角形番号 i の元の三角形番号 tri_perm[i] [num_tri]（NULL 可）
+/// @return リターンコード   =0 正常  !=0 異常（メモリ確保失敗、curve 不正）
+int
+npt_mesh_reorder(
+        NPT_MESH*  mesh,
+        int        curve,
+        int*       vtx_perm,
+        int*       tri_perm
+    )
+{
+    int      num_vtx = mesh->num_vtx;
+    int      num_tri = mesh->num_tri;
+    int      num_max = ( num_vtx > num_tri ) ? num_vtx : num_tri;
+    NPT_REAL bmin[3], bmax[3], scale[3];
+    unsigned short  table[NPT_SFC_STATE][8];
+    unsigned short (*ptable)[8] = NULL;
+    int      i, k;
+
+    if( curve != NPT_REORDER_MORTON && curve != NPT_REORDER_HILBERT ) return 1;
+    if( num_vtx <= 0 ) return 0;
+
+    npt_sfc_key* keys = (npt_sfc_key*)malloc( num_max*sizeof(npt_sfc_key) );
+    int*         inv  = (int*)malloc( num_vtx*sizeof(int) );
+    NPT_REAL   (*rbuf)[3] = (NPT_REAL(*)[3])malloc( num_max*sizeof(NPT_REAL[3]) );
+    int        (*ibuf)[3] = (int(*)[3])rbuf;
+    if( keys == NULL || inv == NULL || rbuf == NULL ) {
+        free( keys );
+        free( inv );
+        free( rbuf );
+        return 1;
+    }
+
+    if( curve == NPT_REORDER_HILBERT ) {
+        npt_sfc_hilbertTable( table );
+        ptable = table;
+    }
+
+    //-------------------
+    //  バウンディングボックス
+    //-------------------
+    for( k=0; k<3; k++ ) bmin[k] = bmax[k] = mesh->vtx[0][k];
+    for( i=1; i<num_vtx; i++ ) {
+        for( k=0; k<3; k++ ) {
+            if( mesh->vtx[i][k] < bmin[k] ) bmin[k] = mesh->vtx[i][k];
+            if( mesh->vtx[i][k] > bmax[k] ) bmax[k] = mesh->vtx[i][k];
+        }
+    }
+    for( k=0; k<3; k++ ) {
+        NPT_REAL w = bmax[k] - bmin[k];
+        scale[k] = ( w > 0.0 ) ? (NPT_REAL)( (1 << NPT_SFC_BITS) - 1 ) / w : 0.0;
+    }
+
+    //-------------------
+    //  頂点
+    //-------------------
+#pragma omp parallel for schedule(static)
+    for( i=0; i<num_vtx; i++ ) {
+        keys[i].key = npt_sfc_calcKey( mesh->vtx[i], bmin, scale, ptable );
+        keys[i].id  = i;
+    }
+    std::sort( keys, keys + num_vtx );
+
+    for( i=0; i<num_vtx; i++ ) {
+        inv[ keys[i].id ] = i;
+        if( vtx_perm != NULL ) vtx_perm[i] = keys[i].id;
+    }
+    for( i=0; i<num_vtx; i++ ) {
+        for( k=0; k<3; k++ ) rbuf[i][k] = mesh->vtx[ keys[i].id ][k];
+    }
+    memcpy( mesh->vtx, rbuf, num_vtx*sizeof(NPT_REAL[3]) );
+    if( mesh->vtx_norm != NULL ) {
+        for( i=0; i<num_vtx; i++ ) {
+            for( k=0; k<3; k++ ) rbuf[i][k] = mesh->vtx_norm[ keys[i].id ][k];
+        }
+        memcpy( mesh->vtx_norm, rbuf, num_vtx*sizeof(NPT_REAL[3]) );
+    }
+
+    //-------------------
+    //  三角形（重心）  頂点番号の付け替えも行う
+    //-------------------
+#pragma omp parallel for schedule(static) private(k)
+    for( i=0; i<num_tri; i++ ) {
+        NPT_REAL g[3];
+        for( k=0; k<3; k++ ) {
+            mesh->tri[i][k] = inv[ mesh->tri[i][k] ];
+        }
+        for( k=0; k<3; k++ ) {
+            g[k] = ( mesh->vtx[ mesh->tri[i][0] ][k] + mesh->vtx[ mesh->tri[i][1] ][k]
+                   + mesh->vtx[ mesh->tri[i][2] ][k] ) / 3.0;
+        }
+        keys[i].key = npt_sfc_calcKey( g, bmin, scale, ptable );
+        keys[i].id  = i;
+    }
+    std::sort( keys, keys + num_tri );
+
+    for( i=0; i<num_tri; i++ ) {
+        for( k=0; k<3; k++ ) ibuf[i][k] = mesh->tri[ keys[i].id ][k];
+        if( tri_perm != NULL ) tri_perm[i] = keys[i].id;
+    }
+    memcpy( mesh->tri, ibuf, num_tri*sizeof(int[3]) );
+
+    free( keys );
+    free( inv );
+    free( rbuf );
+
+    return 0;
+}
+
+
+// #################################################################
+//    非公開（プライベート）関数
+// #################################################################
+
+/// ビットの分散（下位 NPT_SFC_BITS ビットを３ビット間隔に配置）
+///
+/// @param [in]    x            値
+/// @return 分散した値
+static uint64_t
+npt_sfc_spread(
+        uint64_t  x
+    )
+{
+    x &= 0x1fffff;
+    x = ( x | (x << 32) ) & 0x1f00000000ffffULL;
+    x = ( x | (x << 16) ) & 0x1f0000ff0000ffULL;
+    x = ( x | (x <<  8) ) & 0x100f00f00f00f00fULL;
+    x = ( x | (x <<  4) ) & 0x10c30c30c30c30c3ULL;
+    x = ( x | (x <<  2) ) & 0x1249249249249249ULL;
+    return x;
+}
+
+
+/// Hilbert順の状態遷移表の作成
+///    Skilling の方法（座標の転置形式への変換）をビット位置ごとの状態遷移として表す。
+///    状態は下位ビットに適用する軸の置換と反転（6 x 8 = 48通り）で、
+///    状態 s と入力（各軸の１ビット x0<<2|x1<<1|x2）に対し
+///    table[s][入力] = 次の状態 << 3 | グレイ符号化後の出力３ビット
+///
+/// @param [out]   table        状態遷移表
+/// @return なし
+static void
+npt_sfc_hilbertTable(
+        unsigned short  table[NPT_SFC_STATE][8]
+    )
+{
+    static const int perm_list[6][3] = { {0,1,2}, {0,2,1}, {1,0,2}, {1,2,0}, {2,0,1}, {2,1,0} };
+    int s, in, k, j;
+
+    for( s=0; s<NPT_SFC_STATE; s++ ) {
+        for( in=0; in<8; in++ ) {
+            int perm[3], flip[3], b[3], y[3], t;
+            for( k=0; k<3; k++ ) {
+                perm[k] = perm_list[s >> 3][k];
+                flip[k] = ( s >> (2-k) ) & 1;
+                b[k]    = ( ( in >> (2-perm[k]) ) & 1 ) ^ flip[k];
+            }
+
+            // 下位ビットへの操作  b[k]=1: 軸0を反転  b[k]=0: 軸0と軸kを交換
+            for( k=0; k<3; k++ ) {
+                if( b[k] ) {
+                    flip[0] ^= 1;
+                } else {
+                    t = perm[0]; perm[0] = perm[k]; perm[k] = t;
+                    t = flip[0]; flip[0] = flip[k]; flip[k] = t;
+                }
+            }
+            for( j=0; j<6; j++ ) {
+                if( perm_list[j][0] == perm[0] && perm_list[j][1] == perm[1] ) break;
+            }
+
+            // グレイ符号化
+            y[0] = b[0];
+            y[1] = b[1] ^ y[0];
+            y[2] = b[2] ^ y[1];
+
+            table[s][in] = (unsigned short)( ( ( (j << 3) | (flip[0] << 2) | (flip[1] << 1) | flip[2] ) << 3 )
+                                           | ( y[0] << 2 ) | ( y[1] << 1 ) | y[2] );
+        }
+    }
+}
+
+
+/// 空間充填曲線のキー
+///
+/// @param [in]    pos          座標
+/// @param [in]    bmin         バウンディングボックスの最小座標
+/// @param [in]    scale        格子への変換係数
+/// @param [in]    table        Hilbert順の状態遷移表（NULL の場合 Morton順）
+/// @return キー（3*NPT_SFC_BITS ビット）
+static uint64_t
+npt_sfc_calcKey(
+        const NPT_REAL        pos[3],
+        const NPT_REAL        bmin[3],
+        const NPT_REAL        scale[3],
+        const unsigned short  table[NPT_SFC_STATE][8]
+    )
+{
+    const uint32_t nmax = (1u << NPT_SFC_BITS) - 1;
+    uint32_t x[3];
+    int      k;
+
+    for( k=0; k<3; k++ ) {
+        NPT_REAL c = ( pos[k] - bmin[k] )*scale[k];
+        x[k] = ( c <= 0.0 ) ? 0 : ( c >= (NPT_REAL)nmax ) ? nmax : (uint32_t)c;
+    }
+
+    // Morton順  各軸のビットを交互に並べる
+    uint64_t key = ( npt_sfc_spread( x[0] ) << 2 ) | ( npt_sfc_spread( x[1] ) << 1 ) | npt_sfc_spread( x[2] );
+    if( table == NULL ) return key;
+
+    // Hilbert順  上位ビットから状態遷移で出力を求める
+    //   出力は上位のビット位置の出力 x2 の累積パリティで反転する
+    uint64_t hkey = 0;
+    unsigned s = 0, par = 0;
+    for( k=NPT_SFC_BITS-1; k>=0; k-- ) {
+        unsigned e = table[s][ ( key >> (3*k) ) & 7 ];
+        hkey = ( hkey << 3 ) | ( ( e & 7 ) ^ par );
+        par ^= 0u - ( e & 1 );
+        par &= 7;
+        s = e >> 3;
+    }
+    return hkey;
+}
+
+
+// 三角形の法線（辺ベクトルの外積）
+static void
+npt_vnorm_tri(
+        NPT_MESH*    mesh,          // [in]    三角形メッシュ
+        NPT_VNORM*   vnorm,         // [inout] 差分更新用データ
+        int          itri           // [in]    三角形番号
+    )
+{
+    int* tri = mesh->tri[itri];
+
+    npt_mesh_tri_norm( mesh->vtx[tri[0]], mesh->vtx[tri[1]], mesh->vtx[tri[2]], vnorm->tri_norm[itri] );
+}
+
+
+// 頂点法線ベクトル（周囲の三角形の法線の和を三角形番号の昇順に求め、単位ベクトル化）
+static void
+npt_vnorm_vtx(
+        NPT_MESH*    mesh,          // [inout] 三角形メッシュ
+        NPT_VNORM*   vnorm,         // [in]    差分更新用データ
+        int          ivtx           // [in]    頂点番号
+    )
+{
+    NPT_REAL* norm = mesh->vtx_norm[ivtx];
+    int       p;
+
+    norm[0] = norm[1] = norm[2] = 0.0;
+    for( p=vnorm->vtx_tri_ptr[ivtx]; p<vnorm->vtx_tri_ptr[ivtx+1]; p++ ) {
+        NPT_REAL* n = vnorm->tri_norm[ vnorm->vtx_tri[p] ];
+        norm[0] += n[0];
+        norm[1] += n[1];
+        norm[2] += n[2];
+    }
+    CalcNormalize( norm );
+}
@@ -0,0 +1,505 @@
+/*
+ * Npatch - Nagata Patch Library
+ *
+ * Copyright (c) 2015-2016 Advanced Institute for Computational Science, RIKEN.
+ * All rights reserved.
+ *
+ */
+
+////////////////////////////////////////////////////////////////////////////
+///
+/// 長田パッチ MPI領域分割メッシュの処理 関数
+///
+///   -D_NPT_MPI_ を指定した場合のみコンパイルする
+///
+////////////////////////////////////////////////////////////////////////////
+
+#ifdef _NPT_MPI_
+
+#include "Npt_Mpi.h"
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+#ifdef _REAL_IS_DOUBLE_
+#define NPT_MPI_REAL  MPI_DOUBLE
+#else
+#define NPT_MPI_REAL  MPI_FLOAT
+#endif
+
+//------------------------------------------------------------------
+//  プロトタイプ宣言： Npt.cxx のプライベート関数
+//------------------------------------------------------------------
+void npt_param_calcControlPointEdge( NPT_REAL p1[3], NPT_REAL norm1[3], NPT_REAL d1, NPT_REAL p2[3], NPT_REAL norm2[3], NPT_REAL d2,
+           NPT_REAL cp1_e[3], NPT_REAL cp2_e[3] );
+void npt_param_calcControlPointCenter( NPT_REAL p1[3], NPT_REAL p2[3], NPT_REAL p3[3],
+           NPT_REAL cp1_p1p2[3], NPT_REAL cp2_p1p2[3], NPT_REAL cp1_p2p3[3], NPT_REAL cp2_p2p3[3], NPT_REAL cp1_p3p1[3], NPT_REAL cp2_p3p1[3],
+           NPT_REAL cp_center[3] );
+
+//------------------------------------------------------------------
+//  プロトタイプ宣言： プライベート関数
+//------------------------------------------------------------------
+static int npt_mpi_check_err( MPI_Comm comm, int err );
+static int npt_mpi_exchange( MPI_Comm comm, int nproc, const int* send_cnt, const long long* send_buf,
+           int* recv_cnt, long long** recv_buf );
+
+// gid とランク（または頂点番号）の組
+struct npt_mpi_pair {
+    long long  gid;
+    int        val;
+    bool operator<( const npt_mpi_pair& o ) const {
+        return ( gid < o.gid ) || ( gid == o.gid && val < o.val );
+    }
+};
+
+// (ランク, gid) の順の比較
+struct npt_mpi_by_rank {
+    bool operator()( const npt_mpi_pair& a, const npt_mpi_pair& b ) const {
+        return ( a.val < b.val ) || ( a.val == b.val && a.gid < b.gid );
+    }
+};
+
+// #################################################################
+//    公開関数
+// #################################################################
+
+/// 共有頂点情報の生成
+///
+/// @param [in]    comm         コミュニケータ
+/// @param [in]    mesh         自ランクの三角形メッシュ
+/// @param [in]    gid          頂点の全体番号（0以上、自ランク内で重複なし） [mesh->num_vtx]
+/// @param [out]   halo         共有頂点情報（領域は内部で確保する）
+/// @return リターンコード   =0 正常  !=0 異常（メモリ確保失敗、通信エラー、gid の重複）
+int
+npt_mpi_halo_crt(
+        MPI_Comm         comm,
+        NPT_MESH*        mesh,
+        const long long* gid,
+        NPT_MPI_HALO*    halo
+    )
+{
+    int          nproc, rank;
+    int          num_vtx = mesh->num_vtx;
+    int          i, j, k, err = 0;
+    int*         send_cnt = NULL;
+    int*         recv_cnt = NULL;
+    int*         send_pos = NULL;
+    long long*   send_buf = NULL;
+    long long*   recv_buf = NULL;
+    npt_mpi_pair* home    = NULL;
+    npt_mpi_pair* local   = NULL;
+    npt_mpi_pair* nbr     = NULL;
+    int          num_home = 0, num_nbr_pair = 0;
+
+    memset( halo, 0, sizeof(NPT_MPI_HALO) );
+    MPI_Comm_size( comm, &nproc );
+    MPI_Comm_rank( comm, &rank );
+    halo->comm = comm;
+    halo->rank = rank;
+
+    send_cnt = (int*)calloc( nproc, sizeof(int) );
+    recv_cnt = (int*)calloc( nproc, sizeof(int) );
+    send_pos = (int*)calloc( nproc+1, sizeof(int) );
+    send_buf = (long long*)malloc( (num_vtx > 0 ? num_vtx : 1)*sizeof(long long) );
+    local    = (npt_mpi_pair*)malloc( (num_vtx > 0 ? num_vtx : 1)*sizeof(npt_mpi_pair) );
+    if( send_cnt == NULL || recv_cnt == NULL || send_pos == NULL || send_buf == NULL || local == NULL ) err = 1;
+    if( npt_mpi_check_err( comm, err ) ) goto error;
+
+    //-------------------
+    //  自ランクの頂点を gid の昇順に並べる（同じ gid の頂点が複数ある場合は異常）
+    //-------------------
+    for( i=0; i<num_vtx; i++ ) {
+        local[i].gid = gid[i];
+        local[i].val = i;
+    }
+    std::sort( local, local + num_vtx );
+    for( i=1; i<num_vtx; i++ ) {
+        if( local[i].gid == local[i-1].gid ) err = 1;
+    }
+    if( npt_mpi_check_err( comm, err ) ) goto error;
+
+    //-------------------
+    //  gid を担当ランク (gid % nproc) に送る
+    //-------------------
+    for( i=0; i<num_vtx; i++ ) send_cnt[ gid[i] % nproc ]++;
+    for( k=0; k<nproc; k++ ) send_pos[k+1] = send_pos[k] + send_cnt[k];
+    for( i=0; i<num_vtx; i++ ) send_buf[ send_pos[ gid[i] % nproc ]++ ] = gid[i];
+
+    err = npt_mpi_exchange( comm, nproc, send_cnt, send_buf, recv_cnt, &recv_buf );
+    if( npt_mpi_check_err( comm, err ) ) goto error;
+
+    //-------------------
+    //  担当ランク：複数ランクに現れる gid について (gid, 相手ランク) を各ランクに返す
+    //-------------------
+    for( k=0; k<nproc; k++ ) num_home += recv_cnt[k];
+    home = (npt_mpi_pair*)malloc( (num_home > 0 ? num_home : 1)*sizeof(npt_mpi_pair) );
+    if( home == NULL ) err = 1;
+    if( npt_mpi_check_err( comm, err ) ) goto error;
+
+    for( k=0, i=0; k<nproc; k++ ) {
+        for( j=0; j<recv_cnt[k]; j++, i++ ) {
+            home[i].gid = recv_buf[i];
+            home[i].val = k;
+        }
+    }
+    std::sort( home, home + num_home );
+
+    // 返信数
+    for( k=0; k<nproc; k++ ) send_cnt[k] = 0;
+    for( i=0; i<num_home; ) {
+        int n = 1;
+        while( i+n < num_home && home[i+n].gid == home[i].gid ) n++;
+        if( n > 1 ) {
+            for( j=0; j<n; j++ ) send_cnt[ home[i+j].val ] += 2*(n-1);
+        }
+        i += n;
+    }
+    free( send_buf );
+    send_pos[0] = 0;
+    for( k=0; k<nproc; k++ ) send_pos[k+1] = send_pos[k] + send_cnt[k];
+    send_buf = (long long*)malloc( (send_pos[nproc] > 0 ? send_pos[nproc] : 1)*sizeof(long long) );
+    if( send_buf == NULL ) err = 1;
+    if( npt_mpi_check_err( comm, err ) ) goto error;
+
+    for( i=0; i<num_home; ) {
+        int n = 1;
+        while( i+n < num_home && home[i+n].gid == home[i].gid ) n++;
+        if( n > 1 ) {
+            for( j=0; j<n; j++ ) {
+                int r = home[i+j].val;
+                for( k=0; k<n; k++ ) {
+                    if( k == j ) continue;
+                    send_buf[ send_pos[r]++ ] = home[i].gid;
+                    send_buf[ send_pos[r]++ ] = home[i+k].val;
+                }
+            }
+        }
+        i += n;
+    }
+    free( home );
+    home = NULL;
+    free( recv_buf );
+    recv_buf = NULL;
+
+    err = npt_mpi_exchange( comm, nproc, send_cnt, send_buf, recv_cnt, &recv_buf );
+    if( npt_mpi_check_err( comm, err ) ) goto error;
+
+    //-------------------
+    //  自ランク：(相手ランク, gid) の順に並べ、頂点番号に変換する
+    //-------------------
+    for( k=0; k<nproc; k++ ) num_nbr_pair += recv_cnt[k]/2;
+    nbr   = (npt_mpi_pair*)malloc( (num_nbr_pair > 0 ? num_nbr_pair : 1)*sizeof(npt_mpi_pair) );
+    halo->nbr_vtx = (int*)malloc( (num_nbr_pair > 0 ? num_nbr_pair : 1)*sizeof(int) );
+    if( nbr == NULL || halo->nbr_vtx == NULL ) err = 1;
+    if( npt_mpi_check_err( comm, err ) ) goto error;
+
+    // 相手ランクを上位に置いたキーで並べる（相手ランク、gid の昇順）
+    for( i=0; i<num_nbr_pair; i++ ) {
+        nbr[i].gid = recv_buf[2*i];
+        nbr[i].val = (int)recv_buf[2*i+1];
+    }
+    std::sort( nbr, nbr + num_nbr_pair, npt_mpi_by_rank() );
+
+    halo->num_nbr = 0;
+    for( i=0; i<num_nbr_pair; i++ ) {
+        if( i == 0 || nbr[i].val != nbr[i-1].val ) halo->num_nbr++;
+    }
+    halo->nbr_rank = (int*)malloc( (halo->num_nbr > 0 ? halo->num_nbr : 1)*sizeof(int) );
+    halo->nbr_ptr  = (int*)malloc( (halo->num_nbr+1)*sizeof(int) );
+    if( halo->nbr_rank == NULL || halo->nbr_ptr == NULL ) err = 1;
+    if( npt_mpi_check_err( comm, err ) ) goto error;
+
+    for( i=0, k=-1; i<num_nbr_pair; i++ ) {
+        npt_mpi_pair key = { nbr[i].gid, -1 };
+        npt_mpi_pair* p  = std::lower_bound( local, local + num_vtx, key );
+        if( i == 0 || nbr[i].val != nbr[i-1].val ) {
+            k++;
+            halo->nbr_rank[k] = nbr[i].val;
+            halo->nbr_ptr [k] = i;
+        }
+        halo->nbr_vtx[i] = p->val;
+    }
+    halo->nbr_ptr[halo->num_nbr] = num_nbr_pair;
+
+    // 共有頂点数（重複なし）
+    std::sort( nbr, nbr + num_nbr_pair );
+    for( i=0; i<num_nbr_pair; i++ ) {
+        if( i == 0 || nbr[i].gid != nbr[i-1].gid ) halo->num_shared++;
+    }
+
+    free( send_cnt );
+    free( recv_cnt );
+    free( send_pos );
+    free( send_buf );
+    free( recv_buf );
+    free( local );
+    free( nbr );
+    return 0;
+
+error:
+    free( send_cnt );
+    free( recv_cnt );
+    free( send_pos );
+    free( send_buf );
+    free( recv_buf );
+    free( home );
+    free( local );
+    free( nbr );
+    npt_mpi_halo_free( halo );
+    return 1;
+}
+
+
+/// 共有頂点情報の領域解放
+///
+/// @param [inout] halo         共有頂点情報
+/// @return なし
+void
+npt_mpi_halo_free(
+        NPT_MPI_HALO*  halo
+    )
+{
+    free( halo->nbr_rank );
+    free( halo->nbr_ptr );
+    free( halo->nbr_vtx );
+    halo->nbr_rank   = NULL;
+    halo->nbr_ptr    = NULL;
+    halo->nbr_vtx    = NULL;
+    halo->num_nbr    = 0;
+    halo->num_shared = 0;
+}
+
+
+/// 頂点法線ベクトルの計算（分割境界の部分和の交換あり）
+///
+/// @param [in]    halo         共有頂点情報
+/// @param [inout] mesh         自ランクの三角形メッシュ（vtx_norm を設定する）
+/// @return リターンコード   =0 正常  !=0 異常（メモリ確保失敗、通信エラー）
+int
+npt_mpi_vtx_norm(
+        NPT_MPI_HALO*  halo,
+        NPT_MESH*      mesh
+    )
+{
+    int          num_vtx = mesh->num_vtx;
+    int          num_buf = ( halo->num_nbr > 0 ) ? halo->nbr_ptr[halo->num_nbr] : 0;
+    int          i, k, l, err = 0;
+    NPT_REAL   (*part)[3]  = (NPT_REAL(*)[3])malloc( (num_vtx > 0 ? num_vtx : 1)*sizeof(NPT_REAL[3]) );
+    NPT_REAL   (*sbuf)[3]  = (NPT_REAL(*)[3])malloc( (num_buf > 0 ? num_buf : 1)*sizeof(NPT_REAL[3]) );
+    NPT_REAL   (*rbuf)[3]  = (NPT_REAL(*)[3])malloc( (num_buf > 0 ? num_buf : 1)*sizeof(NPT_REAL[3]) );
+    MPI_Request* req       = (MPI_Request*)malloc( (2*halo->num_nbr + 1)*sizeof(MPI_Request) );
+
+    if( part == NULL || sbuf == NULL || rbuf == NULL || req == NULL ) err = 1;
+    if( npt_mpi_check_err( halo->comm, err ) ) {
+        free( part ); free( sbuf ); free( rbuf ); free( req );
+        return 1;
+    }
+
+    //-------------------
+    //  自ランクの部分和（面積重み付き）
+    //-------------------
+    memset( part, 0, num_vtx*sizeof(NPT_REAL[3]) );
+    for( i=0; i<mesh->num_tri; i++ ) {
+        NPT_REAL norm[3];
+        int*     tri = mesh->tri[i];
+        npt_mesh_tri_norm( mesh->vtx[tri[0]], mesh->vtx[tri[1]], mesh->vtx[tri[2]], norm );
+        for( k=0; k<3; k++ ) {
+            part[tri[k]][0] += norm[0];
+            part[tri[k]][1] += norm[1];
+            part[tri[k]][2] += norm[2];
+        }
+    }
+
+    //-------------------
+    //  隣接ランクと共有頂点の部分和を交換
+    //-------------------
+    for( k=0; k<halo->num_nbr; k++ ) {
+        int n0 = halo->nbr_ptr[k];
+        int n  = halo->nbr_ptr[k+1] - n0;
+        for( i=0; i<n; i++ ) {
+            int iv = halo->nbr_vtx[n0+i];
+            sbuf[n0+i][0] = part[iv][0];
+            sbuf[n0+i][1] = part[iv][1];
+            sbuf[n0+i][2] = part[iv][2];
+        }
+        MPI_Irecv( rbuf[n0], 3*n, NPT_MPI_REAL, halo->nbr_rank[k], 0, halo->comm, &req[2*k] );
+        MPI_Isend( sbuf[n0], 3*n, NPT_MPI_REAL, halo->nbr_rank[k], 0, halo->comm, &req[2*k+1] );
+    }
+    if( halo->num_nbr > 0 &&
+        MPI_Waitall( 2*halo->num_nbr, req, MPI_STATUSES_IGNORE ) != MPI_SUCCESS ) err = 2;
+
+    //-------------------
+    //  ランク番号の昇順に加算（全ランクで加算順序が同じになる）
+    //     共有頂点は 0 から、自ランクの番号の位置で自ランクの部分和を加える
+    //-------------------
+    if( err == 0 ) {
+        // 共有頂点の印  -1:非共有  0:未加算  1:自ランク加算済み
+        int* state = (int*)malloc( (num_vtx > 0 ? num_vtx : 1)*sizeof(int) );
+        if( state == NULL ) {
+            err = 1;
+        } else {
+            for( i=0; i<num_vtx; i++ ) state[i] = -1;
+            for( i=0; i<num_buf; i++ ) {
+                int iv = halo->nbr_vtx[i];
+                state[iv] = 0;
+                mesh->vtx_norm[iv][0] = mesh->vtx_norm[iv][1] = mesh->vtx_norm[iv][2] = 0.0;
+            }
+
+            for( k=0; k<=halo->num_nbr; k++ ) {
+                // 自ランクの部分和を加える位置
+                if( k == halo->num_nbr || halo->nbr_rank[k] > halo->rank ) {
+                    for( i=0; i<num_vtx; i++ ) {
+                        if( state[i] == 0 ) {
+                            for( l=0; l<3; l++ ) mesh->vtx_norm[i][l] += part[i][l];
+                            state[i] = 1;
+                        }
+                    }
+                }
+                if( k == halo->num_nbr ) break;
+                for( i=halo->nbr_ptr[k]; i<halo->nbr_ptr[k+1]; i++ ) {
+                    int iv = halo->nbr_vtx[i];
+                    for( l=0; l<3; l++ ) mesh->vtx_norm[iv][l] += rbuf[i][l];
+                }
+            }
+
+            // 非共有頂点
+            for( i=0; i<num_vtx; i++ ) {
+                if( state[i] < 0 ) {
+                    for( l=0; l<3; l++ ) mesh->vtx_norm[i][l] = part[i][l];
+                }
+            }
+            free( state );
+
+            // 単位ベクトル化
+            for( i=0; i<num_vtx; i++ ) {
+                CalcNormalize( mesh->vtx_norm[i] );
+            }
+        }
+    }
+
+    free( part );
+    free( sbuf );
+    free( rbuf );
+    free( req );
+    return npt_mpi_check_err( halo->comm, err ) ? 1 : 0;
+}
+
+
+/// 長田パッチパラメータ生成（辺の向きを gid で統一）
+///
+/// @param [in]    mesh         三角形メッシュ（vtx_norm 設定済み）
+/// @param [in]    gid          頂点の全体番号 [mesh->num_vtx]
+/// @param [out]   npatch       長田パッチパラメータ [mesh->num_tri]
+/// @return リターンコード   =0 正常
+int
+npt_mpi_param_crt(
+        NPT_MESH*        mesh,
+        const long long* gid,
+        NPT_REAL         npatch[][7][3]
+    )
+{
+    int i;
+
+#pragma omp parallel for schedule(static)
+    for( i=0; i<mesh->num_tri; i++ ) {
+        int*      tri = mesh->tri[i];
+        NPT_REAL* p[3];
+        int       j, k;
+
+        for( j=0; j<3; j++ ) p[j] = mesh->vtx[ tri[j] ];
+
+        // 辺の制御点  gid の小さい頂点 -> 大きい頂点 の向きで計算する
+        for( j=0; j<3; j++ ) {
+            int      v0 = tri[j];
+            int      v1 = tri[(j+1)%3];
+            NPT_REAL cp[2][3];
+            int      flip = ( gid[v0] > gid[v1] ) ? 1 : 0;
+            if( flip ) {
+                int wk = v0; v0 = v1; v1 = wk;
+            }
+            npt_param_calcControlPointEdge(
+                   mesh->vtx[v0], mesh->vtx_norm[v0], CalcPlaneD( mesh->vtx[v0], mesh->vtx_norm[v0] ),
+                   mesh->vtx[v1], mesh->vtx_norm[v1], CalcPlaneD( mesh->vtx[v1], mesh->vtx_norm[v1] ),
+                   cp[0], cp[1]
+               );
+            for( k=0; k<3; k++ ) {
+                npatch[i][2*j  ][k] = cp[flip  ][k];
+                npatch[i][2*j+1][k] = cp[1-flip][k];
+            }
+        }
+
+        // 中央の制御点
+        npt_param_calcControlPointCenter(
+               p[0], p[1], p[2],
+               npatch[i][0], npatch[i][1], npatch[i][2],
+               npatch[i][3], npatch[i][4], npatch[i][5],
+               npatch[i][6]
+            );
+    }
+
+    return 0;
+}
+
+
+// #################################################################
+//    非公開（プライベート）関数
+// #################################################################
+
+/// 全ランクの異常の有無（いずれかのランクで異常なら全ランクで !=0 を返す）
+static int
+npt_mpi_check_err( MPI_Comm comm, int err )
+{
+    int gerr = 0;
+    if( MPI_Allreduce( &err, &gerr, 1, MPI_INT, MPI_MAX, comm ) != MPI_SUCCESS ) return 2;
+    return gerr;
+}
+
+
+/// 全対全通信（送信数の交換と可変長データの交換）
+///    recv_buf は内部で確保する
+static int
+npt_mpi_exchange(
+        MPI_Comm         comm,
+        int              nproc,
+        const int*       send_cnt,
+        const long long* send_buf,
+        int*             recv_cnt,
+        long long**      recv_buf
+    )
+{
+    int* sdsp = (int*)malloc( nproc*sizeof(int) );
+    int* rdsp = (int*)malloc( nproc*sizeof(int) );
+    int  k, num_recv = 0, err = 0;
+
+    *recv_buf = NULL;
+    if( sdsp == NULL || rdsp == NULL ) {
+        free( sdsp );
+        free( rdsp );
+        return 1;
+    }
+    if( MPI_Alltoall( (void*)send_cnt, 1, MPI_INT, recv_cnt, 1, MPI_INT, comm ) != MPI_SUCCESS ) err = 2;
+
+    if( err == 0 ) {
+        sdsp[0] = rdsp[0] = 0;
+        for( k=1; k<nproc; k++ ) {
+            sdsp[k] = sdsp[k-1] + send_cnt[k-1];
+            rdsp[k] = rdsp[k-1] + recv_cnt[k-1];
+        }
+        num_recv = rdsp[nproc-1] + recv_cnt[nproc-1];
+        *recv_buf = (long long*)malloc( (num_recv > 0 ? num_recv : 1)*sizeof(long long) );
+        if( *recv_buf == NULL ) err = 1;
+    }
+    // 確保失敗時も相手ランクが待たないよう、全ランクで判定する
+    if( npt_mpi_check_err( comm, err ) == 0 ) {
+        if( MPI_Alltoallv( (void*)send_buf, (int*)send_cnt, sdsp, MPI_LONG_LONG,
+                           *recv_buf, recv_cnt, rdsp, MPI_LONG_LONG, comm ) != MPI_SUCCESS ) err = 2;
+    } else if( err == 0 ) {
+        err = 1;
+    }
+
+    free( sdsp );
+    free( rdsp );
+    return err;
+}
+
+#endif // _NPT_MPI_
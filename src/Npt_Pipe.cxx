@@ -0,0 +1,869 @@
+/*
+ * Npatch - Nagata Patch Library
+ *
+ * Copyright (c) 2015-2016 Advanced Institute for Computational Science, RIKEN.
+ * All rights reserved.
+ *
+ */
+
+////////////////////////////////////////////////////////////////////////////
+///
+/// 長田パッチ パイプライン処理（STL読み込み - 細分割 - STL出力） 関数
+///
+////////////////////////////////////////////////////////////////////////////
+
+
+#include "Npt_Pipe.h"
+#include "Npt_Stl.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#else
+#include <sys/time.h>
+#endif
+
+// バイナリSTL ヘッダサイズ、１三角形のレコードサイズ
+#define NPT_PIPE_BIN_HEADER   84
+#define NPT_PIPE_BIN_RECORD   50
+
+// チャンクあたりの出力三角形数の上限（出力バッファ 約13MB/チャンク）
+#define NPT_PIPE_MAX_OUT      262144
+
+// ジョブの状態
+#define NPT_PIPE_JOB_WAIT     0   // 未実行
+#define NPT_PIPE_JOB_RUN      1   // 実行中
+#define NPT_PIPE_JOB_DONE     2   // 完了
+
+// パイプライン処理の作業領域
+struct npt_pipe_ctx {
+    const NPT_PIPE_PARAM* prm;
+    int            level;            // 細分割数
+    int            chunk;            // チャンクの三角形数
+    int            depth;            // 処理中のチャンク数の上限
+
+    // 入力
+    FILE*          fp;               // バイナリSTL
+    NPT_STL        stl;              // アスキーSTL（全体を読み込む）
+    int            binary;           // =1 バイナリ
+    int            num_tri;          // 入力三角形数
+
+    // 前半（READ -> WELD）  ダブルバッファ
+    unsigned char* raw[2];           // ファイルの読み込み領域
+    NPT_REAL     (*rbuf[2])[3][3];   // チャンクの三角形の頂点座標
+    int            rnum[2];          // チャンクの三角形数
+    volatile int   rstate[2];        // 読み込みジョブの状態
+    volatile int   rjob[2];          // 読み込みジョブのチャンク番号
+    int            rerr;             // 読み込みエラー
+
+    // 結合後のメッシュ
+    NPT_MESH       mesh;             // vtx_norm は WELD の間は面の法線の和
+    int            cap_vtx;          // 頂点の領域サイズ
+    int*           hash;             // 頂点のハッシュ表（頂点番号、-1:空き）
+    uint32_t       hash_mask;        // ハッシュ表のサイズ-1
+
+    // 後半（PARAM -> REFINE -> WRITE）  depth 個のスロット
+    NPT_REAL     (*cp)[7][3];        // 長田パッチパラメータ [depth*chunk]
+    NPT_REAL     (*pts)[3];          // 細分割の格子点 [depth*(level+1)*(level+2)/2]
+    unsigned char* out;              // 出力レコード [depth*chunk*level*level*50]
+    volatile int*  cstate;           // 計算ジョブの状態 [depth]
+    volatile int*  cjob;             // 計算ジョブのチャンク番号 [depth]
+    FILE*          fo;               // 出力ファイル
+    int            werr;             // 出力エラー
+
+    double         time[NPT_PIPE_NUM_STAGE];
+};
+
+//------------------------------------------------------------------
+//  プロトタイプ宣言： プライベート関数
+//------------------------------------------------------------------
+static double   npt_pipe_wtime( void );
+static void     npt_pipe_addTime( npt_pipe_ctx* ctx, int stage, double t0 );
+static int      npt_pipe_claim( volatile int* state, volatile int* job, int c );
+static void     npt_pipe_finish( volatile int* state );
+static void     npt_pipe_wait( volatile int* state );
+static int      npt_pipe_open( npt_pipe_ctx* ctx );
+static void     npt_pipe_readJob( npt_pipe_ctx* ctx, int c, int b );
+static int      npt_pipe_weld( npt_pipe_ctx* ctx, int b );
+static int      npt_pipe_findVertex( npt_pipe_ctx* ctx, const NPT_REAL v[3] );
+static uint32_t npt_pipe_hashVertex( const NPT_REAL v[3] );
+static void     npt_pipe_normal( npt_pipe_ctx* ctx );
+static void     npt_pipe_compJob( npt_pipe_ctx* ctx, int c, int s );
+static void     npt_pipe_param( npt_pipe_ctx* ctx, int c, int s );
+static void     npt_pipe_refine( npt_pipe_ctx* ctx, int c, int s );
+static void     npt_pipe_write( npt_pipe_ctx* ctx, int c );
+static int      npt_pipe_chunkSize( npt_pipe_ctx* ctx, int num, int c );
+static void     npt_pipe_free( npt_pipe_ctx* ctx );
+
+
+// #################################################################
+//    公開関数
+// #################################################################
+
+/// パイプライン処理の設定の初期化（既定値の設定）
+///
+/// @param [out]   prm          パイプライン処理の設定
+/// @return なし
+void
+npt_pipe_param_init(
+        NPT_PIPE_PARAM*  prm
+    )
+{
+    prm->in_file  = NULL;
+    prm->out_file = NULL;
+    prm->level    = 2;
+    prm->chunk    = 4096;
+    prm->depth    = 4;
+    prm->reorder  = NPT_REORDER_HILBERT;
+}
+
+
+/// パイプライン処理の実行
+///
+/// @param [in]    prm          パイプライン処理の設定
+/// @param [out]   res          パイプライン処理の結果（NULL 可）
+/// @return リターンコード   =NPT_PIPE_OK 正常  !=NPT_PIPE_OK 異常
+int
+npt_pipe_run(
+        const NPT_PIPE_PARAM*  prm,
+        NPT_PIPE_RESULT*       res
+    )
+{
+    npt_pipe_ctx ctx;
+    int          ret;
+    int          c, s, num_chunk, num_drop = 0;
+    double       t_start = npt_pipe_wtime();
+    double       t0;
+
+    if( prm == NULL || prm->in_file == NULL || prm->level < 1 || prm->level > NPT_PIPE_MAX_LEVEL ||
+        prm->chunk < 1 || prm->depth < 1 ) {
+        return NPT_PIPE_ERR_PARAM;
+    }
+
+    memset( &ctx, 0, sizeof(ctx) );
+    ctx.prm   = prm;
+    ctx.level = prm->level;
+    ctx.depth = prm->depth;
+    ctx.chunk = prm->chunk;
+    if( ctx.chunk > NPT_PIPE_MAX_OUT/(ctx.level*ctx.level) ) {
+        ctx.chunk = NPT_PIPE_MAX_OUT/(ctx.level*ctx.level);
+        if( ctx.chunk < 1 ) ctx.chunk = 1;
+    }
+
+    //-------------------
+    //  入力ファイル
+    //-------------------
+    t0  = npt_pipe_wtime();
+    ret = npt_pipe_open( &ctx );
+    npt_pipe_addTime( &ctx, NPT_PIPE_T_READ, t0 );
+    if( ret != NPT_PIPE_OK ) {
+        npt_pipe_free( &ctx );
+        return ret;
+    }
+
+    //-------------------
+    //  前半  READ -> WELD
+    //    次のチャンクの読み込みをタスクとし、現在のチャンクの結合と並行する
+    //-------------------
+    num_chunk = ( ctx.num_tri + ctx.chunk - 1 )/ctx.chunk;
+    ret = NPT_PIPE_OK;
+
+#pragma omp parallel
+#pragma omp single
+    {
+        ctx.rjob[0]   = 0;
+        ctx.rstate[0] = NPT_PIPE_JOB_WAIT;
+        for( c=0; c<num_chunk; c++ ) {
+            int b = c & 1;
+            npt_pipe_readJob( &ctx, c, b );
+            npt_pipe_wait( &ctx.rstate[b] );
+            if( ctx.rerr != NPT_PIPE_OK ) break;
+
+            if( c+1 < num_chunk ) {
+                ctx.rjob[1-b]   = c+1;
+                ctx.rstate[1-b] = NPT_PIPE_JOB_WAIT;
+#pragma omp flush
+                if( ctx.depth > 1 ) {
+                    int cn = c+1;
+#pragma omp task firstprivate(cn, b) shared(ctx)
+                    npt_pipe_readJob( &ctx, cn, 1-b );
+                }
+            }
+
+            t0 = npt_pipe_wtime();
+            int r = npt_pipe_weld( &ctx, b );
+            npt_pipe_addTime( &ctx, NPT_PIPE_T_WELD, t0 );
+            if( r != NPT_PIPE_OK ) {
+                ret = r;
+                // 読み込みタスクの終了を待つ
+                if( c+1 < num_chunk ) {
+                    npt_pipe_readJob( &ctx, c+1, 1-b );
+                    npt_pipe_wait( &ctx.rstate[1-b] );
+                }
+                break;
+            }
+
+            if( c+1 < num_chunk && ctx.depth == 1 ) {
+                npt_pipe_readJob( &ctx, c+1, 1-b );
+            }
+        }
+    }
+
+    if( ret == NPT_PIPE_OK ) ret = ctx.rerr;
+    if( ret != NPT_PIPE_OK ) {
+        npt_pipe_free( &ctx );
+        return ret;
+    }
+    num_drop = ctx.num_tri - ctx.mesh.num_tri;
+
+    //-------------------
+    //  NORMAL  頂点法線の確定、並べ替え
+    //-------------------
+    t0 = npt_pipe_wtime();
+    npt_pipe_normal( &ctx );
+    if( prm->reorder >= 0 ) {
+        if( npt_mesh_reorder( &ctx.mesh, prm->reorder, NULL, NULL ) != 0 ) {
+            npt_pipe_free( &ctx );
+            return NPT_PIPE_ERR_MEMORY;
+        }
+    }
+    npt_pipe_addTime( &ctx, NPT_PIPE_T_NORMAL, t0 );
+
+    //-------------------
+    //  後半  PARAM -> REFINE -> WRITE
+    //-------------------
+    long long num_out = (long long)ctx.mesh.num_tri*ctx.level*ctx.level;
+    int       num_pts = (ctx.level+1)*(ctx.level+2)/2;
+    size_t    out_size = (size_t)ctx.chunk*ctx.level*ctx.level*NPT_PIPE_BIN_RECORD;
+
+    if( num_out > 0xffffffffLL ) {
+        npt_pipe_free( &ctx );
+        return NPT_PIPE_ERR_PARAM;
+    }
+    ctx.cp     = (NPT_REAL(*)[7][3])malloc( (size_t)ctx.depth*ctx.chunk*sizeof(NPT_REAL[7][3]) );
+    ctx.pts    = (NPT_REAL(*)[3])malloc( (size_t)ctx.depth*num_pts*sizeof(NPT_REAL[3]) );
+    ctx.out    = (unsigned char*)malloc( ctx.depth*out_size );
+    ctx.cstate = (volatile int*)malloc( ctx.depth*sizeof(int) );
+    ctx.cjob   = (volatile int*)malloc( ctx.depth*sizeof(int) );
+    if( ctx.cp == NULL || ctx.pts == NULL || ctx.out == NULL || ctx.cstate == NULL || ctx.cjob == NULL ) {
+        npt_pipe_free( &ctx );
+        return NPT_PIPE_ERR_MEMORY;
+    }
+    for( s=0; s<ctx.depth; s++ ) {
+        ctx.cstate[s] = NPT_PIPE_JOB_DONE;
+        ctx.cjob[s]   = -1;
+    }
+
+    if( prm->out_file != NULL ) {
+        unsigned char header[NPT_PIPE_BIN_HEADER];
+        uint32_t      n = (uint32_t)num_out;
+
+        t0 = npt_pipe_wtime();
+        memset( header, 0, sizeof(header) );
+        snprintf( (char*)header, 80, "Npatch npt_pipe_run level=%d", ctx.level );
+        memcpy( header+80, &n, sizeof(uint32_t) );
+        ctx.fo = fopen( prm->out_file, "wb" );
+        if( ctx.fo == NULL ) {
+            npt_pipe_free( &ctx );
+            return NPT_PIPE_ERR_OPEN;
+        }
+        if( fwrite( header, 1, sizeof(header), ctx.fo ) != sizeof(header) ) ctx.werr = NPT_PIPE_ERR_WRITE;
+        npt_pipe_addTime( &ctx, NPT_PIPE_T_WRITE, t0 );
+    }
+
+    num_chunk = ( ctx.mesh.num_tri + ctx.chunk - 1 )/ctx.chunk;
+
+#pragma omp parallel
+#pragma omp single
+    {
+        int next_write = 0;
+
+        for( c=0; c<num_chunk; c++ ) {
+            s = c % ctx.depth;
+
+            // スロットが空くまで出力する（キューの深さの制限）
+            while( next_write <= c - ctx.depth ) {
+                npt_pipe_write( &ctx, next_write );
+                next_write++;
+            }
+
+            ctx.cjob[s]   = c;
+            ctx.cstate[s] = NPT_PIPE_JOB_WAIT;
+#pragma omp flush
+            {
+                int cc = c, ss = s;
+#pragma omp task firstprivate(cc, ss) shared(ctx)
+                npt_pipe_compJob( &ctx, cc, ss );
+            }
+
+            // 計算が完了したチャンクを順に出力する
+#pragma omp flush
+            while( next_write <= c && ctx.cstate[ next_write % ctx.depth ] == NPT_PIPE_JOB_DONE ) {
+                npt_pipe_write( &ctx, next_write );
+                next_write++;
+#pragma omp flush
+            }
+        }
+        while( next_write < num_chunk ) {
+            npt_pipe_write( &ctx, next_write );
+            next_write++;
+        }
+    }
+
+    if( ctx.fo != NULL ) {
+        t0 = npt_pipe_wtime();
+        if( fclose( ctx.fo ) != 0 ) ctx.werr = NPT_PIPE_ERR_WRITE;
+        ctx.fo = NULL;
+        npt_pipe_addTime( &ctx, NPT_PIPE_T_WRITE, t0 );
+    }
+    ret = ctx.werr;
+
+    if( res != NULL ) {
+        res->num_tri    = ctx.num_tri;
+        res->num_vtx    = ctx.mesh.num_vtx;
+        res->num_drop   = num_drop;
+        res->num_out    = num_out;
+        for( s=0; s<NPT_PIPE_NUM_STAGE; s++ ) res->time[s] = ctx.time[s];
+        res->time_total = npt_pipe_wtime() - t_start;
+    }
+
+    npt_pipe_free( &ctx );
+    return ret;
+}
+
+
+// #################################################################
+//    非公開（プライベート）関数
+// #################################################################
+
+// 経過時間 (sec)
+static double
+npt_pipe_wtime( void )
+{
+#ifdef _OPENMP
+    return omp_get_wtime();
+#else
+    struct timeval tv;
+    gettimeofday( &tv, NULL );
+    return (double)tv.tv_sec + 1.0e-6*(double)tv.tv_usec;
+#endif
+}
+
+
+// 処理時間の加算
+static void
+npt_pipe_addTime(
+        npt_pipe_ctx*  ctx,        // [inout] 作業領域
+        int            stage,      // [in]    処理段階
+        double         t0          // [in]    開始時刻
+    )
+{
+    double dt = npt_pipe_wtime() - t0;
+#pragma omp atomic
+    ctx->time[stage] += dt;
+}
+
+
+// ジョブの実行権の取得
+//    スロットのジョブがチャンク c で未実行の場合のみ実行中とし 1 を返す
+//    （他のスレッドが先に実行し、スロットが次のチャンクに再利用された後に
+//      開始されたタスクは実行しない）
+static int
+npt_pipe_claim(
+        volatile int*  state,      // [inout] ジョブの状態
+        volatile int*  job,        // [in]    ジョブのチャンク番号
+        int            c           // [in]    チャンク番号
+    )
+{
+    int ok = 0;
+#pragma omp critical (npt_pipe_job)
+    {
+        if( *state == NPT_PIPE_JOB_WAIT && *job == c ) {
+            *state = NPT_PIPE_JOB_RUN;
+            ok = 1;
+        }
+    }
+    return ok;
+}
+
+
+// ジョブの完了
+static void
+npt_pipe_finish(
+        volatile int*  state       // [inout] ジョブの状態
+    )
+{
+#pragma omp flush
+#pragma omp critical (npt_pipe_job)
+    {
+        *state = NPT_PIPE_JOB_DONE;
+    }
+#pragma omp flush
+}
+
+
+// ジョブの完了待ち
+//    他のスレッドが実行中の場合のみ待つ（未実行のジョブは呼び出し側で実行しておく）
+static void
+npt_pipe_wait(
+        volatile int*  state       // [in]    ジョブの状態
+    )
+{
+    for(;;) {
+#pragma omp flush
+        if( *state == NPT_PIPE_JOB_DONE ) break;
+    }
+#pragma omp flush
+}
+
+
+// 入力ファイルのオープン
+//    バイナリSTLはヘッダを読み、チャンク単位に読み込む
+//    アスキーSTLは npt_stl_read() で全体を読み込む
+static int
+npt_pipe_open(
+        npt_pipe_ctx*  ctx         // [inout] 作業領域
+    )
+{
+    unsigned char header[NPT_PIPE_BIN_HEADER];
+    uint32_t      num_bin = 0;
+    long          size;
+    int           b;
+
+    FILE* fp = fopen( ctx->prm->in_file, "rb" );
+    if( fp == NULL ) {
+        printf( "#### ERROR npt_pipe_run: file open error file_name=%s\n", ctx->prm->in_file );
+        return NPT_PIPE_ERR_OPEN;
+    }
+    fseek( fp, 0, SEEK_END );
+    size = ftell( fp );
+    fseek( fp, 0, SEEK_SET );
+    if( size >= NPT_PIPE_BIN_HEADER && fread( header, 1, NPT_PIPE_BIN_HEADER, fp ) == NPT_PIPE_BIN_HEADER ) {
+        memcpy( &num_bin, header+80, sizeof(uint32_t) );
+    }
+
+    // バイナリ判定（npt_stl_read と同じくサイズで判定する）
+    if( size >= NPT_PIPE_BIN_HEADER &&
+        (uint64_t)NPT_PIPE_BIN_HEADER + (uint64_t)NPT_PIPE_BIN_RECORD*num_bin == (uint64_t)size ) {
+        if( num_bin > 0x7fffffffu ) {
+            fclose( fp );
+            return NPT_PIPE_ERR_FORMAT;
+        }
+        ctx->fp      = fp;
+        ctx->binary  = 1;
+        ctx->num_tri = (int)num_bin;
+    } else {
+        fclose( fp );
+        int ret = npt_stl_read( ctx->prm->in_file, &ctx->stl );
+        if( ret != NPT_STL_OK ) {
+            return ( ret == NPT_STL_ERR_MEMORY ) ? NPT_PIPE_ERR_MEMORY :
+                   ( ret == NPT_STL_ERR_OPEN   ) ? NPT_PIPE_ERR_OPEN   : NPT_PIPE_ERR_FORMAT;
+        }
+        ctx->binary  = 0;
+        ctx->num_tri = ctx->stl.num_tri;
+    }
+
+    // 作業領域
+    for( b=0; b<2; b++ ) {
+        ctx->raw[b]  = (unsigned char*)malloc( (size_t)ctx->chunk*NPT_PIPE_BIN_RECORD );
+        ctx->rbuf[b] = (NPT_REAL(*)[3][3])malloc( (size_t)ctx->chunk*sizeof(NPT_REAL[3][3]) );
+        if( ctx->raw[b] == NULL || ctx->rbuf[b] == NULL ) return NPT_PIPE_ERR_MEMORY;
+    }
+    ctx->cap_vtx       = 1024;
+    ctx->hash_mask     = 4096 - 1;
+    ctx->mesh.vtx      = (NPT_REAL(*)[3])malloc( ctx->cap_vtx*sizeof(NPT_REAL[3]) );
+    ctx->mesh.vtx_norm = (NPT_REAL(*)[3])malloc( ctx->cap_vtx*sizeof(NPT_REAL[3]) );
+    ctx->mesh.tri      = (int(*)[3])malloc( (size_t)(ctx->num_tri > 0 ? ctx->num_tri : 1)*sizeof(int[3]) );
+    ctx->hash          = (int*)malloc( (ctx->hash_mask+1)*sizeof(int) );
+    if( ctx->mesh.vtx == NULL || ctx->mesh.vtx_norm == NULL || ctx->mesh.tri == NULL || ctx->hash == NULL ) {
+        return NPT_PIPE_ERR_MEMORY;
+    }
+    memset( ctx->hash, 0xff, (ctx->hash_mask+1)*sizeof(int) );
+
+    return NPT_PIPE_OK;
+}
+
+
+// 読み込みジョブ（チャンク c をバッファ b に読み込む）
+//    未実行の場合のみ実行する
+static void
+npt_pipe_readJob(
+        npt_pipe_ctx*  ctx,        // [inout] 作業領域
+        int            c,          // [in]    チャンク番号
+        int            b           // [in]    バッファ番号
+    )
+{
+    int i, j, k;
+
+    if( !npt_pipe_claim( &ctx->rstate[b], &ctx->rjob[b], c ) ) return;
+
+    double t0  = npt_pipe_wtime();
+    int    num = npt_pipe_chunkSize( ctx, ctx->num_tri, c );
+    int    ofs = c*ctx->chunk;
+    NPT_REAL (*tri)[3][3] = ctx->rbuf[b];
+
+    if( ctx->binary ) {
+        if( fread( ctx->raw[b], NPT_PIPE_BIN_RECORD, num, ctx->fp ) != (size_t)num ) {
+            ctx->rerr = NPT_PIPE_ERR_FORMAT;
+            num = 0;
+        }
+        for( i=0; i<num; i++ ) {
+            float rec[12];   // 法線(3) + 頂点(3x3)
+            memcpy( rec, ctx->raw[b] + (size_t)NPT_PIPE_BIN_RECORD*i, sizeof(rec) );
+            for( j=0; j<3; j++ ) {
+                // -0.0 は 0.0 とする（結合のため）
+                for( k=0; k<3; k++ ) tri[i][j][k] = (NPT_REAL)rec[3+3*j+k] + (NPT_REAL)0.0;
+            }
+        }
+    } else {
+        for( i=0; i<num; i++ ) {
+            for( j=0; j<3; j++ ) {
+                tri[i][j][0] = ctx->stl.x[3*(ofs+i)+j] + (NPT_REAL)0.0;
+                tri[i][j][1] = ctx->stl.y[3*(ofs+i)+j] + (NPT_REAL)0.0;
+                tri[i][j][2] = ctx->stl.z[3*(ofs+i)+j] + (NPT_REAL)0.0;
+            }
+        }
+    }
+    ctx->rnum[b] = num;
+
+    npt_pipe_addTime( ctx, NPT_PIPE_T_READ, t0 );
+    npt_pipe_finish( &ctx->rstate[b] );
+}
+
+
+// 頂点の結合（バッファ b のチャンク）
+//    三角形を結合後の頂点番号でメッシュに追加し、面の法線（面積重み）を頂点に加算する
+static int
+npt_pipe_weld(
+        npt_pipe_ctx*  ctx,        // [inout] 作業領域
+        int            b           // [in]    バッファ番号
+    )
+{
+    NPT_REAL (*tri)[3][3] = ctx->rbuf[b];
+    int i, j, k;
+
+    for( i=0; i<ctx->rnum[b]; i++ ) {
+        int iv[3];
+        for( j=0; j<3; j++ ) {
+            iv[j] = npt_pipe_findVertex( ctx, tri[i][j] );
+            if( iv[j] < 0 ) return NPT_PIPE_ERR_MEMORY;
+        }
+        if( iv[0] == iv[1] || iv[1] == iv[2] || iv[2] == iv[0] ) continue;
+
+        NPT_REAL n[3];
+        npt_mesh_tri_norm( tri[i][0], tri[i][1], tri[i][2], n );
+
+        int it = ctx->mesh.num_tri++;
+        for( j=0; j<3; j++ ) {
+            ctx->mesh.tri[it][j] = iv[j];
+            for( k=0; k<3; k++ ) ctx->mesh.vtx_norm[ iv[j] ][k] += n[k];
+        }
+    }
+    return NPT_PIPE_OK;
+}
+
+
+// 頂点番号の検索（未登録の場合は追加する）
+//    座標がビット単位で一致する頂点を同一とする
+static int
+npt_pipe_findVertex(
+        npt_pipe_ctx*   ctx,       // [inout] 作業領域
+        const NPT_REAL  v[3]       // [in]    頂点座標
+    )
+{
+    uint32_t h = npt_pipe_hashVertex( v ) & ctx->hash_mask;
+    int      i, k;
+
+    for(;;) {
+        int iv = ctx->hash[h];
+        if( iv < 0 ) break;
+        if( memcmp( ctx->mesh.vtx[iv], v, sizeof(NPT_REAL[3]) ) == 0 ) return iv;
+        h = ( h + 1 ) & ctx->hash_mask;
+    }
+
+    // 頂点の追加
+    if( ctx->mesh.num_vtx >= ctx->cap_vtx ) {
+        int cap = 2*ctx->cap_vtx;
+        NPT_REAL (*vtx)[3]  = (NPT_REAL(*)[3])realloc( ctx->mesh.vtx,      (size_t)cap*sizeof(NPT_REAL[3]) );
+        if( vtx == NULL ) return -1;
+        ctx->mesh.vtx = vtx;
+        NPT_REAL (*norm)[3] = (NPT_REAL(*)[3])realloc( ctx->mesh.vtx_norm, (size_t)cap*sizeof(NPT_REAL[3]) );
+        if( norm == NULL ) return -1;
+        ctx->mesh.vtx_norm = norm;
+        ctx->cap_vtx = cap;
+    }
+    int iv = ctx->mesh.num_vtx++;
+    for( k=0; k<3; k++ ) {
+        ctx->mesh.vtx[iv][k]      = v[k];
+        ctx->mesh.vtx_norm[iv][k] = 0.0;
+    }
+    ctx->hash[h] = iv;
+
+    // ハッシュ表の拡張（使用率 1/2 以下に保つ）
+    if( 2*(uint32_t)ctx->mesh.num_vtx > ctx->hash_mask ) {
+        uint32_t mask = 2*( ctx->hash_mask + 1 ) - 1;
+        int*     hash = (int*)malloc( (mask+1)*sizeof(int) );
+        if( hash == NULL ) return -1;
+        memset( hash, 0xff, (mask+1)*sizeof(int) );
+        for( i=0; i<ctx->mesh.num_vtx; i++ ) {
+            uint32_t hh = npt_pipe_hashVertex( ctx->mesh.vtx[i] ) & mask;
+            while( hash[hh] >= 0 ) hh = ( hh + 1 ) & mask;
+            hash[hh] = i;
+        }
+        free( ctx->hash );
+        ctx->hash      = hash;
+        ctx->hash_mask = mask;
+    }
+    return iv;
+}
+
+
+// 頂点座標のハッシュ値（FNV-1a）
+static uint32_t
+npt_pipe_hashVertex(
+        const NPT_REAL  v[3]       // [in]    頂点座標
+    )
+{
+    unsigned char b[sizeof(NPT_REAL[3])];
+    uint64_t      h = 14695981039346656037ULL;
+    size_t        i;
+
+    memcpy( b, v, sizeof(b) );
+    for( i=0; i<sizeof(b); i++ ) {
+        h ^= b[i];
+        h *= 1099511628211ULL;
+    }
+    return (uint32_t)( h ^ (h >> 32) );
+}
+
+
+// 頂点法線の確定（面の法線の和を単位ベクトル化する）
+static void
+npt_pipe_normal(
+        npt_pipe_ctx*  ctx         // [inout] 作業領域
+    )
+{
+    int i;
+
+#pragma omp parallel for schedule(static)
+    for( i=0; i<ctx->mesh.num_vtx; i++ ) {
+        NPT_REAL* n = ctx->mesh.vtx_norm[i];
+        NPT_REAL  len = sqrt( n[0]*n[0] + n[1]*n[1] + n[2]*n[2] );
+        if( len > 0.0 ) {
+            n[0] /= len;
+            n[1] /= len;
+            n[2] /= len;
+        }
+    }
+}
+
+
+// 計算ジョブ（チャンク c をスロット s で計算する）
+//    未実行の場合のみ実行する
+static void
+npt_pipe_compJob(
+        npt_pipe_ctx*  ctx,        // [inout] 作業領域
+        int            c,          // [in]    チャンク番号
+        int            s           // [in]    スロット番号
+    )
+{
+    if( !npt_pipe_claim( &ctx->cstate[s], &ctx->cjob[s], c ) ) return;
+
+    double t0 = npt_pipe_wtime();
+    npt_pipe_param( ctx, c, s );
+    npt_pipe_addTime( ctx, NPT_PIPE_T_PARAM, t0 );
+
+    t0 = npt_pipe_wtime();
+    npt_pipe_refine( ctx, c, s );
+    npt_pipe_addTime( ctx, NPT_PIPE_T_REFINE, t0 );
+
+    npt_pipe_finish( &ctx->cstate[s] );
+}
+
+
+// 長田パッチパラメータ生成（チャンク c）
+//    辺の制御点は頂点番号の小さい頂点 -> 大きい頂点の向きで計算する（npt_mesh_param_get）
+static void
+npt_pipe_param(
+        npt_pipe_ctx*  ctx,        // [inout] 作業領域
+        int            c,          // [in]    チャンク番号
+        int            s           // [in]    スロット番号
+    )
+{
+    NPT_MESH*     mesh   = &ctx->mesh;
+    NPT_REAL    (*npatch)[7][3] = ctx->cp + (size_t)s*ctx->chunk;
+    int           num    = npt_pipe_chunkSize( ctx, mesh->num_tri, c );
+    int           i;
+
+    for( i=0; i<num; i++ ) {
+        npt_mesh_param_get( mesh, c*ctx->chunk + i, npatch[i] );
+    }
+}
+
+
+// 細分割（チャンク c）
+//    格子点 (eta, xi) = (a/level, b/level)  0<=b<=a<=level を曲面補正し、
+//    上向き (a,b)(a+1,b)(a+1,b+1) と 下向き (a,b)(a+1,b+1)(a,b+1) の三角形を出力する
+//    辺上の格子点は辺の３次ベジェ曲線を頂点番号の小さい頂点から評価し、
+//    隣接パッチと座標をビット単位で一致させる
+static void
+npt_pipe_refine(
+        npt_pipe_ctx*  ctx,        // [inout] 作業領域
+        int            c,          // [in]    チャンク番号
+        int            s           // [in]    スロット番号
+    )
+{
+    NPT_MESH*      mesh   = &ctx->mesh;
+    int            level  = ctx->level;
+    int            num_pts = (level+1)*(level+2)/2;
+    NPT_REAL     (*npatch)[7][3] = ctx->cp + (size_t)s*ctx->chunk;
+    NPT_REAL     (*pts)[3] = ctx->pts + (size_t)s*num_pts;
+    unsigned char* rec    = ctx->out + (size_t)s*ctx->chunk*level*level*NPT_PIPE_BIN_RECORD;
+    int            num    = npt_pipe_chunkSize( ctx, mesh->num_tri, c );
+    NPT_REAL       dl     = 1.0/level;
+    int            i, a, b, k, m;
+
+    for( i=0; i<num; i++ ) {
+        int*      tri = mesh->tri[ c*ctx->chunk + i ];
+        NPT_REAL (*cp)[3] = npatch[i];
+
+        // 内部の格子点
+        for( a=2; a<level; a++ ) {
+            for( b=1; b<a; b++ ) {
+                npt_correct_pnt( a*dl, b*dl,
+                        mesh->vtx[tri[0]], mesh->vtx[tri[1]], mesh->vtx[tri[2]],
+                        cp[0], cp[1], cp[2], cp[3], cp[4], cp[5], cp[6],
+                        pts[ a*(a+1)/2 + b ] );
+            }
+        }
+
+        // 辺上の格子点  辺1: (k,0)  辺2: (level,k)  辺3: (level-k,level-k)  k=0-level
+        for( m=0; m<3; m++ ) {
+            int v0 = tri[m], v1 = tri[(m+1)%3];
+            for( k=0; k<=level; k++ ) {
+                int      ia = ( m == 0 ) ? k : ( m == 1 ) ? level : level-k;
+                int      ib = ( m == 0 ) ? 0 : ( m == 1 ) ? k     : level-k;
+                NPT_REAL t, w, c0, c1, c2, c3;
+                NPT_REAL *q0, *q1, *q2, *q3;
+                // k*(1/level) は k=level で 1 とならない場合があり、頂点の座標が一致しなくなるため
+                // k/level（正しく丸めた商）とする
+                if( v0 < v1 ) {
+                    t  = (NPT_REAL)k/level;
+                    q0 = mesh->vtx[v0]; q1 = cp[2*m];   q2 = cp[2*m+1]; q3 = mesh->vtx[v1];
+                } else {
+                    t  = (NPT_REAL)(level-k)/level;
+                    q0 = mesh->vtx[v1]; q1 = cp[2*m+1]; q2 = cp[2*m];   q3 = mesh->vtx[v0];
+                }
+                w  = 1.0 - t;
+                c0 = w*w*w;
+                c1 = 3.0*t*w*w;
+                c2 = 3.0*t*t*w;
+                c3 = t*t*t;
+                NPT_REAL* pt = pts[ ia*(ia+1)/2 + ib ];
+                pt[0] = q0[0]*c0 + q1[0]*c1 + q2[0]*c2 + q3[0]*c3;
+                pt[1] = q0[1]*c0 + q1[1]*c1 + q2[1]*c2 + q3[1]*c3;
+                pt[2] = q0[2]*c0 + q1[2]*c1 + q2[2]*c2 + q3[2]*c3;
+            }
+        }
+
+        for( a=0; a<level; a++ ) {
+            for( b=0; b<=a; b++ ) {
+                for( m=0; m<2; m++ ) {
+                    int q[3];
+                    if( m == 1 && b == a ) break;
+                    q[0] = a*(a+1)/2 + b;
+                    if( m == 0 ) {
+                        q[1] = (a+1)*(a+2)/2 + b;
+                        q[2] = (a+1)*(a+2)/2 + b+1;
+                    } else {
+                        q[1] = (a+1)*(a+2)/2 + b+1;
+                        q[2] = a*(a+1)/2 + b+1;
+                    }
+
+                    NPT_REAL n[3];
+                    float    f[12];
+                    uint16_t attr = 0;
+                    npt_mesh_tri_norm( pts[q[0]], pts[q[1]], pts[q[2]], n );
+                    NPT_REAL len = sqrt( n[0]*n[0] + n[1]*n[1] + n[2]*n[2] );
+                    for( k=0; k<3; k++ ) {
+                        f[k]   = ( len > 0.0 ) ? (float)( n[k]/len ) : 0.0f;
+                        f[3+k] = (float)pts[q[0]][k];
+                        f[6+k] = (float)pts[q[1]][k];
+                        f[9+k] = (float)pts[q[2]][k];
+                    }
+                    memcpy( rec,    f,     sizeof(f) );
+                    memcpy( rec+48, &attr, sizeof(attr) );
+                    rec += NPT_PIPE_BIN_RECORD;
+                }
+            }
+        }
+    }
+}
+
+
+// チャンク c の出力
+//    計算が開始されていなければ自ら計算し、他のスレッドが計算中であれば完了を待つ
+static void
+npt_pipe_write(
+        npt_pipe_ctx*  ctx,        // [inout] 作業領域
+        int            c           // [in]    チャンク番号
+    )
+{
+    int s = c % ctx->depth;
+
+    npt_pipe_compJob( ctx, c, s );
+    npt_pipe_wait( &ctx->cstate[s] );
+
+    if( ctx->fo == NULL || ctx->werr != NPT_PIPE_OK ) return;
+
+    double t0   = npt_pipe_wtime();
+    int    num  = npt_pipe_chunkSize( ctx, ctx->mesh.num_tri, c )*ctx->level*ctx->level;
+    if( fwrite( ctx->out + (size_t)s*ctx->chunk*ctx->level*ctx->level*NPT_PIPE_BIN_RECORD,
+                NPT_PIPE_BIN_RECORD, num, ctx->fo ) != (size_t)num ) {
+        ctx->werr = NPT_PIPE_ERR_WRITE;
+    }
+    npt_pipe_addTime( ctx, NPT_PIPE_T_WRITE, t0 );
+}
+
+
+// チャンク c の三角形数
+static int
+npt_pipe_chunkSize(
+        npt_pipe_ctx*  ctx,        // [in]    作業領域
+        int            num,        // [in]    全体の三角形数
+        int            c           // [in]    チャンク番号
+    )
+{
+    int n = num - c*ctx->chunk;
+    return ( n < ctx->chunk ) ? n : ctx->chunk;
+}
+
+
+// 作業領域の解放
+static void
+npt_pipe_free(
+        npt_pipe_ctx*  ctx         // [inout] 作業領域
+    )
+{
+    int b;
+
+    if( ctx->fp != NULL ) fclose( ctx->fp );
+    if( ctx->fo != NULL ) fclose( ctx->fo );
+    npt_stl_free( &ctx->stl );
+    for( b=0; b<2; b++ ) {
+        free( ctx->raw[b] );
+        free( ctx->rbuf[b] );
+    }
+    free( ctx->mesh.vtx );
+    free( ctx->mesh.vtx_norm );
+    free( ctx->mesh.tri );
+    free( ctx->hash );
+    free( ctx->cp );
+    free( ctx->pts );
+    free( ctx->out );
+    free( (void*)ctx->cstate );
+    free( (void*)ctx->cjob );
+    memset( ctx, 0, sizeof(npt_pipe_ctx) );
+}
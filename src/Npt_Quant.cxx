@@ -0,0 +1,142 @@
+/*
+ * Npatch - Nagata Patch Library
+ *
+ * Copyright (c) 2015-2016 Advanced Institute for Computational Science, RIKEN.
+ * All rights reserved.
+ *
+ */
+
+////////////////////////////////////////////////////////////////////////////
+///
+/// 長田パッチ 制御点の量子化（圧縮）格納 関数
+///
+////////////////////////////////////////////////////////////////////////////
+
+
+#include "Npt_Quant.h"
+#include <stdlib.h>
+
+// #################################################################
+//    公開関数
+// #################################################################
+
+/// 長田パッチパラメータの量子化
+///
+/// @param [in]    p1           長田パッチ 頂点１座標
+/// @param [in]    p2           長田パッチ 頂点２座標
+/// @param [in]    p3           長田パッチ 頂点３座標
+/// @param [in]    cp           長田パッチパラメータ（制御点 cp_side1_1-cp_center の順）
+/// @param [out]   qpatch       量子化した長田パッチパラメータ
+/// @return 制御点の誤差（ユークリッド距離）の上限 sqrt(3)*scale/(2*NPT_QUANT_MAX)
+NPT_REAL
+npt_qpatch_encode(
+        NPT_REAL    p1[3],
+        NPT_REAL    p2[3],
+        NPT_REAL    p3[3],
+        NPT_REAL    cp[7][3],
+        NPT_QPATCH* qpatch
+    )
+{
+    NPT_REAL ref[7][3];
+    NPT_REAL dl[7][3];
+    NPT_REAL dmax = 0.0;
+    int      i, j;
+
+    npt_qpatch_ref( p1, p2, p3, ref );
+
+    // 基準位置からのずれ
+    for( i=0; i<7; i++ ) {
+        for( j=0; j<3; j++ ) {
+            dl[i][j] = cp[i][j] - ref[i][j];
+            if( fabs(dl[i][j]) > dmax ) dmax = fabs(dl[i][j]);
+        }
+    }
+
+    // 復元時と同じ単位で量子化する（scaleはfloatに丸めてから使用する）
+    qpatch->scale = (float)dmax;
+    if( (NPT_REAL)qpatch->scale < dmax ) {
+        qpatch->scale = (float)( dmax*(1.0+1.0e-6) );
+    }
+    qpatch->pad = 0;
+
+    NPT_REAL unit = (NPT_REAL)qpatch->scale * (NPT_REAL)( 1.0/NPT_QUANT_MAX );
+    for( i=0; i<7; i++ ) {
+        for( j=0; j<3; j++ ) {
+            NPT_REAL wk = ( unit > 0.0 ) ? dl[i][j]/unit : 0.0;
+            long     iq = lround( wk );
+            if( iq >  NPT_QUANT_MAX ) iq =  NPT_QUANT_MAX;
+            if( iq < -NPT_QUANT_MAX ) iq = -NPT_QUANT_MAX;
+            qpatch->q[i][j] = (short)iq;
+        }
+    }
+
+    return 0.5*sqrt(3.0)*unit;
+}
+
+
+/// 長田パッチパラメータの量子化（複数パッチ）
+///
+/// @param [in]    num          パッチ数
+/// @param [in]    tri          三角形の頂点座標 tri[i][0-2]
+/// @param [in]    npatch       長田パッチパラメータ npatch[i][0-6]
+/// @param [out]   qpatch       量子化した長田パッチパラメータ [num]
+/// @return 制御点の誤差（ユークリッド距離）の上限の最大値
+NPT_REAL
+npt_qpatch_encode_n(
+        int         num,
+        NPT_REAL    tri[][3][3],
+        NPT_REAL    npatch[][7][3],
+        NPT_QPATCH* qpatch
+    )
+{
+    NPT_REAL err_max = 0.0;
+
+#pragma omp parallel
+    {
+        NPT_REAL err_thr = 0.0;
+        int      i;
+
+#pragma omp for schedule(static)
+        for( i=0; i<num; i++ ) {
+            NPT_REAL err = npt_qpatch_encode( tri[i][0], tri[i][1], tri[i][2], npatch[i], &qpatch[i] );
+            if( err > err_thr ) err_thr = err;
+        }
+#pragma omp critical (npt_qpatch_encode_n)
+        {
+            if( err_thr > err_max ) err_max = err_thr;
+        }
+    }
+
+    return err_max;
+}
+
+
+/// 長田パッチ 近似曲面補正（量子化パラメータ版 複数点）
+///
+/// @param [in]    num          点数
+/// @param [in]    tri_id       パッチ番号 [num]
+/// @param [in]    eta          ηパラメータ [num]
+/// @param [in]    xi           ξパラメータ [num]
+/// @param [in]    tri          三角形の頂点座標
+/// @param [in]    qpatch       量子化した長田パッチパラメータ
+/// @param [out]   pos_o        出力点座標 [num]
+/// @return なし
+void
+npt_correct_pnt_q_n(
+        int         num,
+        const int*  tri_id,
+        NPT_REAL*   eta,
+        NPT_REAL*   xi,
+        NPT_REAL    tri[][3][3],
+        const NPT_QPATCH* qpatch,
+        NPT_REAL    pos_o[][3]
+    )
+{
+    int i;
+
+#pragma omp parallel for schedule(static)
+    for( i=0; i<num; i++ ) {
+        int id = tri_id[i];
+        npt_correct_pnt_q( eta[i], xi[i], tri[id][0], tri[id][1], tri[id][2], &qpatch[id], pos_o[i] );
+    }
+}
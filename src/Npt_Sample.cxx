@@ -0,0 +1,757 @@
+/*
+ * Npatch - Nagata Patch Library
+ *
+ * Copyright (c) 2015-2016 Advanced Institute for Computational Science, RIKEN.
+ * All rights reserved.
+ *
+ */
+
+////////////////////////////////////////////////////////////////////////////
+///
+/// 長田パッチ 曲面上の点の一様配置 関数
+///
+////////////////////////////////////////////////////////////////////////////
+
+
+#include "Npt_Sample.h"
+#include "Npt_Integ.h"
+#include "Npt_Curv.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+
+// パッチの面積の求積公式の次数
+#define NPT_SAMPLE_DEGREE     5
+
+// 面積要素による棄却の最大試行回数（超えた場合は最後の点を採用する）
+#define NPT_SAMPLE_MAX_TRY    64
+
+// 面積要素の最大値の推定の余裕（頂点、辺の中点、重心での最大値に対する倍率）
+#define NPT_SAMPLE_JMAX_SAFE  1.25
+
+// ハッシュ値を共有するブロックの大きさ（一辺 2^NPT_SAMPLE_BLOCK_SHIFT セル）
+//    近傍のセルが連続した位置に並ぶため、近傍27セルの参照のキャッシュ効率が良くなる
+#define NPT_SAMPLE_BLOCK_SHIFT  2
+
+// 並べ替え、セル作成の分割数（スレッド数によらない固定の分割）
+#define NPT_SAMPLE_CHUNK      256
+
+typedef unsigned long long npt_sample_u64;
+
+// 候補点
+//    (hash, cell, prio, idx) の順に並べ替える
+struct npt_sample_item {
+    npt_sample_u64  hash;     // セルを含むブロックのハッシュ値
+    npt_sample_u64  cell;     // セル番号 ix | iy<<21 | iz<<42
+    npt_sample_u64  prio;     // 優先度（乱数）
+    long long       idx;      // 候補点番号（生成順）
+    NPT_REAL        pos[3];   // 曲面上の座標
+};
+
+// セル（同じセル番号の候補点の範囲）
+struct npt_sample_cell {
+    npt_sample_u64  hash;     // セルを含むブロックのハッシュ値
+    npt_sample_u64  cell;     // セル番号
+    long long       start;    // 先頭の候補点（並べ替え後の位置）
+    long long       num;      // 候補点数
+};
+
+// 候補点の比較
+struct npt_sample_less {
+    bool operator()( const npt_sample_item& a, const npt_sample_item& b ) const {
+        if( a.hash != b.hash ) return a.hash < b.hash;
+        if( a.cell != b.cell ) return a.cell < b.cell;
+        if( a.prio != b.prio ) return a.prio < b.prio;
+        return a.idx < b.idx;
+    }
+};
+
+// セルの比較
+struct npt_sample_cell_less {
+    bool operator()( const npt_sample_cell& a, const npt_sample_cell& b ) const {
+        if( a.hash != b.hash ) return a.hash < b.hash;
+        return a.cell < b.cell;
+    }
+};
+
+// 近傍27セルの相対位置（採用済みの点が近い可能性の高い順：自セル、面、辺、頂点）
+static const int npt_sample_nbr[27][3] = {
+    {  0, 0, 0 },
+    { -1, 0, 0 }, {  1, 0, 0 }, {  0,-1, 0 }, {  0, 1, 0 }, {  0, 0,-1 }, {  0, 0, 1 },
+    { -1,-1, 0 }, {  1,-1, 0 }, { -1, 1, 0 }, {  1, 1, 0 },
+    { -1, 0,-1 }, {  1, 0,-1 }, { -1, 0, 1 }, {  1, 0, 1 },
+    {  0,-1,-1 }, {  0, 1,-1 }, {  0,-1, 1 }, {  0, 1, 1 },
+    { -1,-1,-1 }, {  1,-1,-1 }, { -1, 1,-1 }, {  1, 1,-1 },
+    { -1,-1, 1 }, {  1,-1, 1 }, { -1, 1, 1 }, {  1, 1, 1 } };
+
+// 作業領域
+struct npt_sample_work {
+    int                num_tri;
+    NPT_REAL*          area;      // パッチの面積 [num_tri]
+    long long*         off;       // 三角形の候補点の先頭 [num_tri+1]
+    long long          num_cand;
+    double             bmin[3];   // 格子の原点
+    npt_sample_item*   item;      // 候補点 [num_cand]
+    npt_sample_cell*   cell;      // セル [num_cell]
+    long long          num_cell;
+    long long*         dir;       // ハッシュ値の上位 dir_bits ビットによるセルの索引 [2^dir_bits+1]
+    int                dir_bits;
+    unsigned char*     acc;       // 採用フラグ（並べ替え後の位置）[num_cand]
+    unsigned char*     flag;      // 採用フラグ（生成順）[num_cand]
+    long long*         out_off;   // 三角形の出力の先頭 [num_tri+1]
+};
+
+//------------------------------------------------------------------
+//  プロトタイプ宣言
+//------------------------------------------------------------------
+static npt_sample_u64 npt_sample_mix( npt_sample_u64 z );
+static double         npt_sample_rand( npt_sample_u64* s );
+static npt_sample_u64 npt_sample_seed( unsigned int seed, int tri );
+static npt_sample_u64 npt_sample_hash( npt_sample_u64 cell );
+static void   npt_sample_patch( NPT_MESH* mesh, int i, NPT_REAL tri[3][3], NPT_REAL cp[7][3], double* jmax );
+static void   npt_sample_draw( NPT_REAL tri[3][3], NPT_REAL cp[7][3], double jmax, npt_sample_u64* s,
+                               NPT_REAL* eta, NPT_REAL* xi, NPT_REAL pos[3], NPT_REAL d_eta[3], NPT_REAL d_xi[3] );
+static int    npt_sample_gen( NPT_MESH* mesh, NPT_REAL spacing, unsigned int seed, npt_sample_work* wk );
+static int    npt_sample_key( NPT_REAL spacing, npt_sample_work* wk );
+static void   npt_sample_sort( npt_sample_item* item, long long num );
+static int    npt_sample_cells( npt_sample_work* wk );
+static int    npt_sample_select( NPT_REAL spacing, npt_sample_work* wk );
+static int    npt_sample_reject( NPT_REAL pos[3], npt_sample_u64 cell, NPT_REAL spacing, npt_sample_work* wk );
+static long long npt_sample_find( npt_sample_u64 cell, npt_sample_work* wk );
+static int    npt_sample_output( NPT_MESH* mesh, unsigned int seed, npt_sample_work* wk, NPT_SAMPLE* res );
+static void   npt_sample_release( npt_sample_work* wk );
+
+
+// #################################################################
+//    公開関数
+// #################################################################
+
+/// 曲面上の点の一様配置
+///
+/// @param [in]    mesh         三角形メッシュ（vtx_norm 設定済み）
+/// @param [in]    spacing      点の最小距離
+/// @param [in]    seed         乱数の種
+/// @param [out]   res          曲面上の点（npt_sample_free() で解放）
+/// @return リターンコード   =0 正常  !=0 異常（メモリ確保失敗、spacing 不正、セル数が上限を超える）
+int
+npt_sample_mesh(
+        NPT_MESH*     mesh,
+        NPT_REAL      spacing,
+        unsigned int  seed,
+        NPT_SAMPLE*   res
+    )
+{
+    npt_sample_work wk;
+
+    memset( res, 0, sizeof(NPT_SAMPLE) );
+    if( !(spacing > 0.0) ) return 1;
+
+    memset( &wk, 0, sizeof(wk) );
+    wk.num_tri = mesh->num_tri;
+
+    if( npt_sample_gen   ( mesh, spacing, seed, &wk ) != 0 ||
+        npt_sample_key   ( spacing, &wk )             != 0 ||
+        npt_sample_cells ( &wk )                      != 0 ||
+        npt_sample_select( spacing, &wk )             != 0 ||
+        npt_sample_output( mesh, seed, &wk, res )     != 0 ) {
+        npt_sample_release( &wk );
+        npt_sample_free( res );
+        return 1;
+    }
+    npt_sample_release( &wk );
+    return 0;
+}
+
+
+/// 曲面上の点の領域解放
+///
+/// @param [inout] res          曲面上の点
+/// @return なし
+void
+npt_sample_free(
+        NPT_SAMPLE*   res
+    )
+{
+    if( res->tri  ) free( res->tri );
+    if( res->eta  ) free( res->eta );
+    if( res->xi   ) free( res->xi );
+    if( res->pos  ) free( res->pos );
+    if( res->norm ) free( res->norm );
+    memset( res, 0, sizeof(NPT_SAMPLE) );
+}
+
+
+// #################################################################
+//    非公開（プライベート）関数
+// #################################################################
+
+// 64ビットの混合関数（splitmix64）
+static npt_sample_u64
+npt_sample_mix(
+        npt_sample_u64  z          // [in]    値
+    )
+{
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+
+// [0,1) の一様乱数
+static double
+npt_sample_rand(
+        npt_sample_u64* s          // [inout] 乱数の状態
+    )
+{
+    *s += 0x9E3779B97F4A7C15ULL;
+    return (double)(npt_sample_mix( *s ) >> 11) * (1.0/9007199254740992.0);
+}
+
+
+// 三角形の乱数の状態の初期値
+static npt_sample_u64
+npt_sample_seed(
+        unsigned int    seed,      // [in]    乱数の種
+        int             tri        // [in]    三角形番号
+    )
+{
+    return npt_sample_mix( ((npt_sample_u64)seed << 32 | (npt_sample_u64)(unsigned int)tri)
+                           + 0x9E3779B97F4A7C15ULL );
+}
+
+
+// セルのハッシュ値
+//    セル座標を NPT_SAMPLE_BLOCK_SHIFT ビット右シフトしたブロック番号のハッシュ値とする
+static npt_sample_u64
+npt_sample_hash(
+        npt_sample_u64  cell       // [in]    セル番号
+    )
+{
+    npt_sample_u64 mask = ((npt_sample_u64)1 << NPT_SAMPLE_CELL_BITS) - 1;
+    npt_sample_u64 blk  = 0;
+    int            l;
+
+    for( l=0; l<3; l++ ) {
+        blk |= ((cell >> (NPT_SAMPLE_CELL_BITS*l)) & mask) >> NPT_SAMPLE_BLOCK_SHIFT << (NPT_SAMPLE_CELL_BITS*l);
+    }
+    return npt_sample_mix( blk + 0x9E3779B97F4A7C15ULL );
+}
+
+
+// パッチの頂点座標、パラメータと面積要素の最大値の推定
+static void
+npt_sample_patch(
+        NPT_MESH*       mesh,      // [in]    三角形メッシュ
+        int             i,         // [in]    三角形番号
+        NPT_REAL        tri[3][3], // [out]   三角形の頂点座標
+        NPT_REAL        cp[7][3],  // [out]   長田パッチパラメータ
+        double*         jmax       // [out]   面積要素の最大値
+    )
+{
+    static const NPT_REAL pnt[7][2] = {
+        { 0.0, 0.0 }, { 1.0, 0.0 }, { 1.0, 1.0 },
+        { 0.5, 0.0 }, { 1.0, 0.5 }, { 0.5, 0.5 }, { 2.0/3.0, 1.0/3.0 } };
+    NPT_REAL pos[3], d_eta[3], d_xi[3];
+    double   jm = 0.0;
+    int      k, m;
+
+    for( k=0; k<3; k++ ) {
+        for( m=0; m<3; m++ ) tri[k][m] = mesh->vtx[ mesh->tri[i][k] ][m];
+    }
+    npt_mesh_param_get( mesh, i, cp );
+
+    for( k=0; k<7; k++ ) {
+        double n[3], j;
+        npt_curv_tangent( pnt[k][0], pnt[k][1], tri, cp, pos, d_eta, d_xi );
+        n[0] = (double)d_eta[1]*d_xi[2] - (double)d_eta[2]*d_xi[1];
+        n[1] = (double)d_eta[2]*d_xi[0] - (double)d_eta[0]*d_xi[2];
+        n[2] = (double)d_eta[0]*d_xi[1] - (double)d_eta[1]*d_xi[0];
+        j = sqrt( n[0]*n[0] + n[1]*n[1] + n[2]*n[2] );
+        if( j > jm ) jm = j;
+    }
+    *jmax = jm * NPT_SAMPLE_JMAX_SAFE;
+}
+
+
+// パッチ上の点の生成
+//    (eta,xi) はパラメータ三角形 0<=xi<=eta<=1 上の一様乱数とし、
+//    面積要素 |x_eta × x_xi| に比例する確率で採用する（棄却法）
+static void
+npt_sample_draw(
+        NPT_REAL        tri[3][3], // [in]    三角形の頂点座標
+        NPT_REAL        cp[7][3],  // [in]    長田パッチパラメータ
+        double          jmax,      // [in]    面積要素の最大値
+        npt_sample_u64* s,         // [inout] 乱数の状態
+        NPT_REAL*       eta,       // [out]   ηパラメータ
+        NPT_REAL*       xi,        // [out]   ξパラメータ
+        NPT_REAL        pos[3],    // [out]   曲面上の座標
+        NPT_REAL        d_eta[3],  // [out]   ηによる微分
+        NPT_REAL        d_xi[3]    // [out]   ξによる微分
+    )
+{
+    int k;
+
+    for( k=0; k<NPT_SAMPLE_MAX_TRY; k++ ) {
+        double a = npt_sample_rand( s );
+        double b = npt_sample_rand( s );
+        double c = npt_sample_rand( s );
+        double n[3];
+
+        *eta = (NPT_REAL)( a > b ? a : b );
+        *xi  = (NPT_REAL)( a > b ? b : a );
+        npt_curv_tangent( *eta, *xi, tri, cp, pos, d_eta, d_xi );
+        n[0] = (double)d_eta[1]*d_xi[2] - (double)d_eta[2]*d_xi[1];
+        n[1] = (double)d_eta[2]*d_xi[0] - (double)d_eta[0]*d_xi[2];
+        n[2] = (double)d_eta[0]*d_xi[1] - (double)d_eta[1]*d_xi[0];
+        if( c*jmax <= sqrt( n[0]*n[0] + n[1]*n[1] + n[2]*n[2] ) ) break;
+    }
+}
+
+
+// 候補点の生成
+//    三角形iの候補点数は floor(面積*NPT_SAMPLE_DENSITY/spacing^2 + 乱数) とする
+static int
+npt_sample_gen(
+        NPT_MESH*        mesh,     // [in]    三角形メッシュ
+        NPT_REAL         spacing,  // [in]    点の最小距離
+        unsigned int     seed,     // [in]    乱数の種
+        npt_sample_work* wk        // [inout] 作業領域
+    )
+{
+    double dens = NPT_SAMPLE_DENSITY / ((double)spacing*spacing);
+    int    i;
+
+    wk->area = (NPT_REAL*)malloc( sizeof(NPT_REAL)*(wk->num_tri > 0 ? wk->num_tri : 1) );
+    wk->off  = (long long*)malloc( sizeof(long long)*(wk->num_tri+1) );
+    if( wk->area == NULL || wk->off == NULL ) return 1;
+
+    if( npt_integ_area_mesh( mesh, NPT_SAMPLE_DEGREE, wk->area ) != 0 ) return 1;
+
+#pragma omp parallel for schedule(static)
+    for( i=0; i<wk->num_tri; i++ ) {
+        npt_sample_u64 s = npt_sample_seed( seed, i );
+        wk->off[i+1] = (long long)( wk->area[i]*dens + npt_sample_rand( &s ) );
+    }
+    wk->off[0] = 0;
+    for( i=0; i<wk->num_tri; i++ ) wk->off[i+1] += wk->off[i];
+    wk->num_cand = wk->off[wk->num_tri];
+
+    wk->item = (npt_sample_item*)malloc( sizeof(npt_sample_item)*(wk->num_cand > 0 ? wk->num_cand : 1) );
+    if( wk->item == NULL ) return 1;
+
+#pragma omp parallel for schedule(dynamic,64)
+    for( i=0; i<wk->num_tri; i++ ) {
+        npt_sample_u64 s = npt_sample_seed( seed, i );
+        NPT_REAL       t[3][3], cp[7][3], eta, xi, d_eta[3], d_xi[3];
+        double         jmax;
+        long long      k;
+
+        if( wk->off[i+1] == wk->off[i] ) continue;
+        npt_sample_rand( &s );   // 候補点数の乱数
+        npt_sample_patch( mesh, i, t, cp, &jmax );
+        for( k=wk->off[i]; k<wk->off[i+1]; k++ ) {
+            npt_sample_item* it = &wk->item[k];
+            npt_sample_draw( t, cp, jmax, &s, &eta, &xi, it->pos, d_eta, d_xi );
+            it->idx  = k;
+            it->prio = npt_sample_mix( (npt_sample_u64)k + npt_sample_seed( seed, -1 ) );
+        }
+    }
+    return 0;
+}
+
+
+// 候補点のセル番号とハッシュ値
+//    格子の原点は候補点の座標の最小値とする
+static int
+npt_sample_key(
+        NPT_REAL         spacing,  // [in]    点の最小距離（セルの大きさ）
+        npt_sample_work* wk        // [inout] 作業領域
+    )
+{
+    NPT_REAL  cmin[NPT_SAMPLE_CHUNK][3];
+    NPT_REAL  bmin[3];
+    long long n = wk->num_cand;
+    double    lim = (double)(1 << NPT_SAMPLE_CELL_BITS);
+    int       c, m, err = 0;
+    long long k;
+
+    if( n == 0 ) return 0;
+
+#pragma omp parallel for schedule(static)
+    for( c=0; c<NPT_SAMPLE_CHUNK; c++ ) {
+        long long k0 = n*c/NPT_SAMPLE_CHUNK, k1 = n*(c+1)/NPT_SAMPLE_CHUNK;
+        long long j;
+        int       l;
+        for( l=0; l<3; l++ ) cmin[c][l] = ( k0 < k1 ) ? wk->item[k0].pos[l] : wk->item[0].pos[l];
+        for( j=k0; j<k1; j++ ) {
+            for( l=0; l<3; l++ ) {
+                if( wk->item[j].pos[l] < cmin[c][l] ) cmin[c][l] = wk->item[j].pos[l];
+            }
+        }
+    }
+    for( m=0; m<3; m++ ) bmin[m] = cmin[0][m];
+    for( c=1; c<NPT_SAMPLE_CHUNK; c++ ) {
+        for( m=0; m<3; m++ ) if( cmin[c][m] < bmin[m] ) bmin[m] = cmin[c][m];
+    }
+    for( m=0; m<3; m++ ) wk->bmin[m] = bmin[m];
+
+#pragma omp parallel for schedule(static) reduction(+:err)
+    for( k=0; k<n; k++ ) {
+        npt_sample_item* it = &wk->item[k];
+        npt_sample_u64   key = 0;
+        int              l;
+        for( l=0; l<3; l++ ) {
+            double x = floor( ((double)it->pos[l] - bmin[l]) / spacing );
+            if( x < 0.0 ) x = 0.0;
+            if( x >= lim ) { err++; x = 0.0; }
+            key |= (npt_sample_u64)x << (NPT_SAMPLE_CELL_BITS*l);
+        }
+        it->cell = key;
+        it->hash = npt_sample_hash( key );
+    }
+    if( err > 0 ) return 1;
+
+    npt_sample_sort( wk->item, n );
+    return 0;
+}
+
+
+// 候補点の並べ替え
+//    NPT_SAMPLE_CHUNK 個に分割して並べ替え、隣り合う範囲を順に併合する
+static void
+npt_sample_sort(
+        npt_sample_item* item,     // [inout] 候補点
+        long long        num       // [in]    候補点数
+    )
+{
+    int c, w;
+
+#pragma omp parallel for schedule(dynamic,1)
+    for( c=0; c<NPT_SAMPLE_CHUNK; c++ ) {
+        std::sort( item + num*c/NPT_SAMPLE_CHUNK, item + num*(c+1)/NPT_SAMPLE_CHUNK, npt_sample_less() );
+    }
+    for( w=1; w<NPT_SAMPLE_CHUNK; w*=2 ) {
+#pragma omp parallel for schedule(dynamic,1)
+        for( c=0; c<NPT_SAMPLE_CHUNK; c+=2*w ) {
+            int c1 = c + w, c2 = c + 2*w;
+            if( c1 >= NPT_SAMPLE_CHUNK ) continue;
+            if( c2 > NPT_SAMPLE_CHUNK ) c2 = NPT_SAMPLE_CHUNK;
+            std::inplace_merge( item + num*c/NPT_SAMPLE_CHUNK, item + num*c1/NPT_SAMPLE_CHUNK,
+                                item + num*c2/NPT_SAMPLE_CHUNK, npt_sample_less() );
+        }
+    }
+}
+
+
+// セルとハッシュ値の索引の作成
+static int
+npt_sample_cells(
+        npt_sample_work* wk        // [inout] 作業領域
+    )
+{
+    long long cnum[NPT_SAMPLE_CHUNK+1];
+    long long n = wk->num_cand;
+    long long ndir, k;
+    int       c, sh;
+
+    if( n == 0 ) return 0;
+
+    // 分割ごとのセルの先頭の数
+#pragma omp parallel for schedule(static)
+    for( c=0; c<NPT_SAMPLE_CHUNK; c++ ) {
+        long long j, cnt = 0;
+        for( j=n*c/NPT_SAMPLE_CHUNK; j<n*(c+1)/NPT_SAMPLE_CHUNK; j++ ) {
+            if( j == 0 || wk->item[j].cell != wk->item[j-1].cell ) cnt++;
+        }
+        cnum[c+1] = cnt;
+    }
+    cnum[0] = 0;
+    for( c=0; c<NPT_SAMPLE_CHUNK; c++ ) cnum[c+1] += cnum[c];
+    wk->num_cell = cnum[NPT_SAMPLE_CHUNK];
+
+    wk->cell = (npt_sample_cell*)malloc( sizeof(npt_sample_cell)*wk->num_cell );
+    if( wk->cell == NULL ) return 1;
+
+#pragma omp parallel for schedule(static)
+    for( c=0; c<NPT_SAMPLE_CHUNK; c++ ) {
+        long long j, m = cnum[c];
+        for( j=n*c/NPT_SAMPLE_CHUNK; j<n*(c+1)/NPT_SAMPLE_CHUNK; j++ ) {
+            if( j == 0 || wk->item[j].cell != wk->item[j-1].cell ) {
+                wk->cell[m].hash  = wk->item[j].hash;
+                wk->cell[m].cell  = wk->item[j].cell;
+                wk->cell[m].start = j;
+                m++;
+            }
+        }
+    }
+#pragma omp parallel for schedule(static)
+    for( k=0; k<wk->num_cell; k++ ) {
+        long long e = ( k+1 < wk->num_cell ) ? wk->cell[k+1].start : n;
+        wk->cell[k].num = e - wk->cell[k].start;
+    }
+
+    // ハッシュ値の上位ビットによる索引（セル数以上の2のべき乗の大きさ）
+    wk->dir_bits = 0;
+    while( ((long long)1 << wk->dir_bits) < wk->num_cell && wk->dir_bits < 40 ) wk->dir_bits++;
+    ndir = (long long)1 << wk->dir_bits;
+    sh   = 64 - wk->dir_bits;
+
+    wk->dir = (long long*)malloc( sizeof(long long)*(ndir+1) );
+    if( wk->dir == NULL ) return 1;
+
+#pragma omp parallel for schedule(static)
+    for( k=0; k<wk->num_cell; k++ ) {
+        long long p  = ( sh < 64 ) ? (long long)(wk->cell[k].hash >> sh) : 0;
+        long long pp = ( k == 0 ) ? -1 : ( sh < 64 ) ? (long long)(wk->cell[k-1].hash >> sh) : 0;
+        long long q;
+        for( q=pp+1; q<=p; q++ ) wk->dir[q] = k;
+    }
+    {
+        long long pl = ( sh < 64 ) ? (long long)(wk->cell[wk->num_cell-1].hash >> sh) : 0;
+        for( k=pl+1; k<=ndir; k++ ) wk->dir[k] = wk->num_cell;
+    }
+    return 0;
+}
+
+
+// 候補点の選択
+//    セル座標の偶奇（８グループ）ごとに、同じグループのセルを並列に処理する。
+//    ラウンド r では各セルの r 番目（優先度順）の候補点を処理する。
+static int
+npt_sample_select(
+        NPT_REAL         spacing,  // [in]    点の最小距離
+        npt_sample_work* wk        // [inout] 作業領域
+    )
+{
+    long long* list;
+    long long* cnt;
+    long long  ph_start[9], n_act[8];
+    long long  max_num = 0, nkey, k;
+    int        ph;
+
+    wk->acc = (unsigned char*)calloc( (size_t)(wk->num_cand > 0 ? wk->num_cand : 1), 1 );
+    if( wk->acc == NULL ) return 1;
+    if( wk->num_cell == 0 ) return 0;
+
+    for( k=0; k<wk->num_cell; k++ ) {
+        if( wk->cell[k].num > max_num ) max_num = wk->cell[k].num;
+    }
+
+    // グループ、候補点数の降順に並べたセルの一覧（計数ソート）
+    nkey = 8*(max_num+1);
+    list = (long long*)malloc( sizeof(long long)*wk->num_cell );
+    cnt  = (long long*)calloc( (size_t)(nkey+1), sizeof(long long) );
+    if( list == NULL || cnt == NULL ) {
+        if( list ) free( list );
+        if( cnt  ) free( cnt );
+        return 1;
+    }
+    for( k=0; k<wk->num_cell; k++ ) {
+        npt_sample_u64 c = wk->cell[k].cell;
+        int p = (int)( (c & 1) | ((c >> NPT_SAMPLE_CELL_BITS) & 1) << 1 | ((c >> 2*NPT_SAMPLE_CELL_BITS) & 1) << 2 );
+        cnt[ p*(max_num+1) + (max_num - wk->cell[k].num) + 1 ]++;
+    }
+    for( k=0; k<nkey; k++ ) cnt[k+1] += cnt[k];
+    for( ph=0; ph<=8; ph++ ) ph_start[ph] = cnt[ ph*(max_num+1) ];
+    for( k=0; k<wk->num_cell; k++ ) {
+        npt_sample_u64 c = wk->cell[k].cell;
+        int p = (int)( (c & 1) | ((c >> NPT_SAMPLE_CELL_BITS) & 1) << 1 | ((c >> 2*NPT_SAMPLE_CELL_BITS) & 1) << 2 );
+        list[ cnt[ p*(max_num+1) + (max_num - wk->cell[k].num) ]++ ] = k;
+    }
+    free( cnt );
+    for( ph=0; ph<8; ph++ ) n_act[ph] = ph_start[ph+1] - ph_start[ph];
+
+    for( k=0; k<max_num; k++ ) {
+        for( ph=0; ph<8; ph++ ) {
+            long long* lp = list + ph_start[ph];
+            long long  c;
+
+            while( n_act[ph] > 0 && wk->cell[ lp[n_act[ph]-1] ].num <= k ) n_act[ph]--;
+
+#pragma omp parallel for schedule(dynamic,256)
+            for( c=0; c<n_act[ph]; c++ ) {
+                npt_sample_cell* cl = &wk->cell[ lp[c] ];
+                long long        j  = cl->start + k;
+                wk->acc[j] = (unsigned char)( npt_sample_reject( wk->item[j].pos, cl->cell, spacing, wk ) == 0 );
+            }
+        }
+    }
+    free( list );
+    return 0;
+}
+
+
+// 近傍27セルの採用済みの点との距離の判定
+//    距離が spacing 未満の点がある場合は 1 を返す
+//    候補点からセルまでの距離が spacing 以上の近傍セルは調べない
+//    未処理の候補点の採用フラグは 0 のため、同じセルの後の候補点は判定に含まれない
+static int
+npt_sample_reject(
+        NPT_REAL         pos[3],   // [in]    候補点の座標
+        npt_sample_u64   cell,     // [in]    候補点のセル番号
+        NPT_REAL         spacing,  // [in]    点の最小距離
+        npt_sample_work* wk        // [in]    作業領域
+    )
+{
+    npt_sample_u64 mask = ((npt_sample_u64)1 << NPT_SAMPLE_CELL_BITS) - 1;
+    long long      ic[3];
+    double         gap[3][2];
+    double         r2 = (double)spacing*spacing;
+    int            n, l;
+
+    for( l=0; l<3; l++ ) {
+        double lo;
+        ic[l] = (long long)((cell >> (NPT_SAMPLE_CELL_BITS*l)) & mask);
+        lo = wk->bmin[l] + (double)ic[l]*spacing;
+        gap[l][0] = (double)pos[l] - lo;
+        gap[l][1] = lo + spacing - (double)pos[l];
+        if( gap[l][0] < 0.0 ) gap[l][0] = 0.0;
+        if( gap[l][1] < 0.0 ) gap[l][1] = 0.0;
+    }
+
+    for( n=0; n<27; n++ ) {
+        const int*     o = npt_sample_nbr[n];
+        npt_sample_u64 key = 0;
+        double         g2 = 0.0;
+        long long      c, j, je;
+
+        for( l=0; l<3; l++ ) {
+            long long jc = ic[l] + o[l];
+            if( jc < 0 || jc > (long long)mask ) break;
+            if( o[l] != 0 ) g2 += gap[l][ o[l] > 0 ]*gap[l][ o[l] > 0 ];
+            key |= (npt_sample_u64)jc << (NPT_SAMPLE_CELL_BITS*l);
+        }
+        if( l < 3 || g2 >= r2 ) continue;
+        c = npt_sample_find( key, wk );
+        if( c < 0 ) continue;
+
+        je = wk->cell[c].start + wk->cell[c].num;
+        for( j=wk->cell[c].start; j<je; j++ ) {
+            double d[3];
+            if( !wk->acc[j] ) continue;
+            for( l=0; l<3; l++ ) d[l] = (double)wk->item[j].pos[l] - pos[l];
+            if( d[0]*d[0] + d[1]*d[1] + d[2]*d[2] < r2 ) return 1;
+        }
+    }
+    return 0;
+}
+
+
+// セルの検索
+//    セルが無い場合は -1 を返す
+static long long
+npt_sample_find(
+        npt_sample_u64   cell,     // [in]    セル番号
+        npt_sample_work* wk        // [in]    作業領域
+    )
+{
+    npt_sample_cell  key;
+    npt_sample_cell* c;
+    long long        p;
+
+    key.hash = npt_sample_hash( cell );
+    key.cell = cell;
+    p = ( wk->dir_bits > 0 ) ? (long long)(key.hash >> (64 - wk->dir_bits)) : 0;
+    c = std::lower_bound( wk->cell + wk->dir[p], wk->cell + wk->dir[p+1], key, npt_sample_cell_less() );
+    if( c == wk->cell + wk->dir[p+1] || c->hash != key.hash || c->cell != cell ) return -1;
+    return (long long)(c - wk->cell);
+}
+
+
+// 採用した点の出力
+//    三角形ごとに乱数を再生して (eta,xi)、座標、法線を求める
+static int
+npt_sample_output(
+        NPT_MESH*        mesh,     // [in]    三角形メッシュ
+        unsigned int     seed,     // [in]    乱数の種
+        npt_sample_work* wk,       // [inout] 作業領域
+        NPT_SAMPLE*      res       // [out]   曲面上の点
+    )
+{
+    long long n = wk->num_cand;
+    long long k, num;
+    int       i;
+
+    wk->flag    = (unsigned char*)calloc( (size_t)(n > 0 ? n : 1), 1 );
+    wk->out_off = (long long*)malloc( sizeof(long long)*(wk->num_tri+1) );
+    if( wk->flag == NULL || wk->out_off == NULL ) return 1;
+
+#pragma omp parallel for schedule(static)
+    for( k=0; k<n; k++ ) {
+        if( wk->acc[k] ) wk->flag[ wk->item[k].idx ] = 1;
+    }
+
+#pragma omp parallel for schedule(static)
+    for( i=0; i<wk->num_tri; i++ ) {
+        long long j, cnt = 0;
+        for( j=wk->off[i]; j<wk->off[i+1]; j++ ) cnt += wk->flag[j];
+        wk->out_off[i+1] = cnt;
+    }
+    wk->out_off[0] = 0;
+    for( i=0; i<wk->num_tri; i++ ) wk->out_off[i+1] += wk->out_off[i];
+    num = wk->out_off[wk->num_tri];
+
+    res->num      = num;
+    res->num_cand = n;
+    if( num == 0 ) return 0;
+    res->tri  = (int*)malloc( sizeof(int)*num );
+    res->eta  = (NPT_REAL*)malloc( sizeof(NPT_REAL)*num );
+    res->xi   = (NPT_REAL*)malloc( sizeof(NPT_REAL)*num );
+    res->pos  = (NPT_REAL(*)[3])malloc( sizeof(NPT_REAL)*3*num );
+    res->norm = (NPT_REAL(*)[3])malloc( sizeof(NPT_REAL)*3*num );
+    if( res->tri == NULL || res->eta == NULL || res->xi == NULL || res->pos == NULL || res->norm == NULL ) return 1;
+
+#pragma omp parallel for schedule(dynamic,64)
+    for( i=0; i<wk->num_tri; i++ ) {
+        npt_sample_u64 s = npt_sample_seed( seed, i );
+        NPT_REAL       t[3][3], cp[7][3], eta, xi, pos[3], d_eta[3], d_xi[3];
+        double         jmax;
+        long long      j, m = wk->out_off[i];
+
+        if( wk->out_off[i+1] == m ) continue;
+        npt_sample_rand( &s );   // 候補点数の乱数
+        npt_sample_patch( mesh, i, t, cp, &jmax );
+        for( j=wk->off[i]; j<wk->off[i+1]; j++ ) {
+            double nv[3], len;
+            int    l;
+
+            npt_sample_draw( t, cp, jmax, &s, &eta, &xi, pos, d_eta, d_xi );
+            if( !wk->flag[j] ) continue;
+
+            nv[0] = (double)d_eta[1]*d_xi[2] - (double)d_eta[2]*d_xi[1];
+            nv[1] = (double)d_eta[2]*d_xi[0] - (double)d_eta[0]*d_xi[2];
+            nv[2] = (double)d_eta[0]*d_xi[1] - (double)d_eta[1]*d_xi[0];
+            len   = sqrt( nv[0]*nv[0] + nv[1]*nv[1] + nv[2]*nv[2] );
+            if( len > 0.0 ) len = 1.0/len;
+
+            res->tri[m] = i;
+            res->eta[m] = eta;
+            res->xi [m] = xi;
+            for( l=0; l<3; l++ ) {
+                res->pos [m][l] = pos[l];
+                res->norm[m][l] = (NPT_REAL)(nv[l]*len);
+            }
+            m++;
+        }
+    }
+    return 0;
+}
+
+
+// 作業領域の解放
+static void
+npt_sample_release(
+        npt_sample_work* wk        // [inout] 作業領域
+    )
+{
+    if( wk->area    ) free( wk->area );
+    if( wk->off     ) free( wk->off );
+    if( wk->item    ) free( wk->item );
+    if( wk->cell    ) free( wk->cell );
+    if( wk->dir     ) free( wk->dir );
+    if( wk->acc     ) free( wk->acc );
+    if( wk->flag    ) free( wk->flag );
+    if( wk->out_off ) free( wk->out_off );
+    memset( wk, 0, sizeof(npt_sample_work) );
+}
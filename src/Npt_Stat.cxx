@@ -0,0 +1,294 @@
+/*
+ * Npatch - Nagata Patch Library
+ *
+ * Copyright (c) 2015-2016 Advanced Institute for Computational Science, RIKEN.
+ * All rights reserved.
+ *
+ */
+
+////////////////////////////////////////////////////////////////////////////
+///
+/// 長田パッチ 実行時統計（縮退処理の回数、処理時間） 関数
+///
+////////////////////////////////////////////////////////////////////////////
+
+
+#include "Npt_Stat.h"
+#include <stdlib.h>
+#include <string.h>
+#ifdef _OPENMP
+#include <omp.h>
+#elif defined(_WIN32)
+#include <time.h>
+#else
+#include <sys/time.h>
+#endif
+
+//------------------------------------------------------------------
+//  スレッドごとの統計値
+//------------------------------------------------------------------
+#ifdef _NPT_STAT_
+
+// 隣接スレッドの領域が同じキャッシュラインに載らないよう末尾を空ける
+typedef struct {
+    long long  count[NPT_STAT_NUM_COUNTER];
+    double     time [NPT_STAT_NUM_TIMER];
+    long long  ntime[NPT_STAT_NUM_TIMER];
+    char       pad[64];
+} npt_stat_thread;
+
+static npt_stat_thread npt_stat_data[NPT_STAT_MAX_THREAD];
+
+static int npt_stat_init_env( void );
+
+// 計測レベル（環境変数 NPT_STAT で初期化）
+int npt_stat_flag = npt_stat_init_env();
+
+#endif
+
+static const char* npt_stat_counter_str[NPT_STAT_NUM_COUNTER] = {
+    "param_crt",
+    "p11",
+    "p11_parallel",
+    "p11_perpendicular",
+    "p11_no_line",
+    "correct_start",
+    "correct_end",
+    "correct_fail"
+};
+
+static const char* npt_stat_timer_str[NPT_STAT_NUM_TIMER] = {
+    "param_crt",
+    "calc_p11",
+    "correct_p11",
+    "param_crt_n",
+    "cvt_pos_to_eta_xi_n",
+    "correct_pnt_n",
+    "correct_pnt2_n",
+    "move_vertex_n",
+    "subdiv_n",
+    "param_update_n"
+};
+
+// #################################################################
+//    公開関数
+// #################################################################
+
+/// 計測処理が組み込まれているか
+///
+/// @return =1 組み込みあり(-D_NPT_STAT_)  =0 なし
+int
+npt_stat_available( void )
+{
+#ifdef _NPT_STAT_
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+
+/// 計測の開始/停止
+///
+/// @param [in]    level        =0 停止  =1 カウンタ、一括処理関数のタイマ  =2 全タイマ
+/// @return なし
+void
+npt_stat_enable(
+        int  level
+    )
+{
+#ifdef _NPT_STAT_
+    npt_stat_flag = ( level < 0 ) ? 0 : ( level > 2 ? 2 : level );
+#else
+    (void)level;
+#endif
+}
+
+
+/// 計測レベルの取得
+///
+/// @return 計測レベル（=0 停止中）
+int
+npt_stat_is_enabled( void )
+{
+#ifdef _NPT_STAT_
+    return npt_stat_flag;
+#else
+    return 0;
+#endif
+}
+
+
+/// 統計値の取得（全スレッドの合計）
+///
+/// @param [out]   stat         統計値
+/// @return なし
+void
+npt_stat_get(
+        NPT_STAT*  stat
+    )
+{
+    memset( stat, 0, sizeof(NPT_STAT) );
+
+#ifdef _NPT_STAT_
+    int it, i;
+    for( it=0; it<NPT_STAT_MAX_THREAD; it++ ) {
+        for( i=0; i<NPT_STAT_NUM_COUNTER; i++ ) {
+            stat->count[i] += npt_stat_data[it].count[i];
+        }
+        for( i=0; i<NPT_STAT_NUM_TIMER; i++ ) {
+            stat->time [i] += npt_stat_data[it].time [i];
+            stat->ntime[i] += npt_stat_data[it].ntime[i];
+        }
+    }
+#endif
+}
+
+
+/// 統計値のリセット
+///
+/// @return なし
+void
+npt_stat_reset( void )
+{
+#ifdef _NPT_STAT_
+    memset( npt_stat_data, 0, sizeof(npt_stat_data) );
+#endif
+}
+
+
+/// カウンタ名の取得
+///
+/// @param [in]    id           カウンタ種類
+/// @return カウンタ名（範囲外は NULL）
+const char*
+npt_stat_counter_name(
+        int  id
+    )
+{
+    if( id < 0 || id >= NPT_STAT_NUM_COUNTER ) return NULL;
+    return npt_stat_counter_str[id];
+}
+
+
+/// タイマ名の取得
+///
+/// @param [in]    id           タイマ種類
+/// @return タイマ名（範囲外は NULL）
+const char*
+npt_stat_timer_name(
+        int  id
+    )
+{
+    if( id < 0 || id >= NPT_STAT_NUM_TIMER ) return NULL;
+    return npt_stat_timer_str[id];
+}
+
+
+/// 統計値の出力
+///
+/// @param [in]    fp           出力先
+/// @return なし
+void
+npt_stat_print(
+        FILE*  fp
+    )
+{
+    NPT_STAT stat;
+    int      i;
+
+    if( !npt_stat_available() ) {
+        fprintf( fp, "#### npt_stat: not available (build with -D_NPT_STAT_)\n" );
+        return;
+    }
+
+    npt_stat_get( &stat );
+
+    fprintf( fp, "#### npt_stat: counter\n" );
+    for( i=0; i<NPT_STAT_NUM_COUNTER; i++ ) {
+        fprintf( fp, "  %-22s %14lld\n", npt_stat_counter_str[i], stat.count[i] );
+    }
+    fprintf( fp, "#### npt_stat: timer     total(s)          count    avg(ns)\n" );
+    for( i=0; i<NPT_STAT_NUM_TIMER; i++ ) {
+        fprintf( fp, "  %-22s %12.6f %14lld %10.2f\n", npt_stat_timer_str[i],
+                 stat.time[i], stat.ntime[i],
+                 stat.ntime[i] > 0 ? 1.0e9*stat.time[i]/stat.ntime[i] : 0.0 );
+    }
+}
+
+
+#ifdef _NPT_STAT_
+
+/// 計測用 カウンタ加算（ライブラリ内部用）
+void
+npt_stat_add_count(
+        int  id
+    )
+{
+#ifdef _OPENMP
+    int it = omp_get_thread_num() % NPT_STAT_MAX_THREAD;
+#else
+    int it = 0;
+#endif
+    npt_stat_data[it].count[id]++;
+}
+
+
+/// 計測用 処理時間加算（ライブラリ内部用）
+///    t0 は NPT_STAT_TIME_START で取得した開始時刻
+///    （計測停止中に取得した開始時刻 0.0 は加算しない）
+void
+npt_stat_add_time(
+        int     id,
+        double  t0
+    )
+{
+#ifdef _OPENMP
+    int it = omp_get_thread_num() % NPT_STAT_MAX_THREAD;
+#else
+    int it = 0;
+#endif
+    if( t0 == 0.0 ) return;
+    npt_stat_data[it].time [id] += npt_stat_wtime() - t0;
+    npt_stat_data[it].ntime[id]++;
+}
+
+
+/// 計測用 経過時間 (sec)（ライブラリ内部用）
+double
+npt_stat_wtime( void )
+{
+#ifdef _OPENMP
+    return omp_get_wtime();
+#elif defined(_WIN32)
+    return (double)clock() / CLOCKS_PER_SEC;
+#else
+    struct timeval tv;
+    gettimeofday( &tv, NULL );
+    return (double)tv.tv_sec + 1.0e-6*(double)tv.tv_usec;
+#endif
+}
+
+#endif
+
+
+// #################################################################
+//    非公開（プライベート）関数
+// #################################################################
+
+#ifdef _NPT_STAT_
+
+/// 環境変数 NPT_STAT による計測レベルの初期値
+///    未設定の場合は 0（停止）、数値以外の場合は 1 とする
+static int
+npt_stat_init_env( void )
+{
+    const char* env = getenv( "NPT_STAT" );
+    int         level;
+
+    if( env == NULL || env[0] == '\0' ) return 0;
+    level = ( env[0] >= '0' && env[0] <= '9' ) ? atoi( env ) : 1;
+    return ( level > 2 ) ? 2 : level;
+}
+
+#endif
@@ -0,0 +1,557 @@
+/*
+ * Npatch - Nagata Patch Library
+ *
+ * Copyright (c) 2015-2016 Advanced Institute for Computational Science, RIKEN.
+ * All rights reserved.
+ *
+ */
+
+////////////////////////////////////////////////////////////////////////////
+///
+/// STLファイル読み込み 関数
+///
+////////////////////////////////////////////////////////////////////////////
+
+
+#include "Npt_Stl.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#ifdef _WIN32
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+// バイナリSTL ヘッダサイズ、１三角形のレコードサイズ
+#define NPT_STL_BIN_HEADER   84
+#define NPT_STL_BIN_RECORD   50
+
+// アスキーSTL 分割読み込みを行う最小ファイルサイズ
+#define NPT_STL_ASCII_SPLIT  (1024*1024)
+
+//------------------------------------------------------------------
+//  プロトタイプ宣言： プライベート関数
+//------------------------------------------------------------------
+static int  npt_stl_map( const char* file_name, const char** buf, size_t* size );
+static void npt_stl_unmap( const char* buf, size_t size );
+static int  npt_stl_alloc( int num_tri, NPT_STL* stl );
+static int  npt_stl_read_binary( const char* buf, uint32_t num_bin, NPT_STL* stl );
+static int  npt_stl_read_ascii( const char* buf, size_t size, NPT_STL* stl );
+static const char* npt_stl_next_facet( const char* buf, const char* p, const char* end );
+static const char* npt_stl_parse_facet( const char* p, const char* end, int i, NPT_STL* stl );
+static const char* npt_stl_next_vertex( const char* p, const char* end );
+static const char* npt_stl_parse_real( const char* p, const char* end, NPT_REAL* val );
+static const char* npt_stl_real_end( const char* p, const char* end );
+
+// #################################################################
+//    公開関数
+// #################################################################
+
+/// STLファイル読み込み
+///
+/// @param [in]    file_name    STLファイル名
+/// @param [out]   stl          STLデータ（領域は内部で確保する）
+/// @return リターンコード   =NPT_STL_OK 正常  !=NPT_STL_OK 異常
+int
+npt_stl_read(
+        const char*  file_name,
+        NPT_STL*     stl
+    )
+{
+    const char* buf;
+    size_t      size;
+    uint32_t    num_bin;
+    uint64_t    bin_size;
+    int         ret;
+
+    memset( stl, 0, sizeof(NPT_STL) );
+
+    ret = npt_stl_map( file_name, &buf, &size );
+    if( ret != NPT_STL_OK ) {
+        printf( "#### ERROR npt_stl_read: file open error file_name=%s\n", file_name );
+        return ret;
+    }
+
+    // バイナリ判定
+    //     先頭が"solid"のバイナリSTLも存在するため、サイズで判定する。
+    //     サイズが一致する場合はバイナリ、末尾に余分なデータがある場合は
+    //     アスキーとして読めない（三角形が無い）ときにバイナリとする
+    num_bin = 0;
+    if( size >= NPT_STL_BIN_HEADER ) {
+        memcpy( &num_bin, buf+80, sizeof(uint32_t) );
+    }
+    bin_size = (uint64_t)NPT_STL_BIN_HEADER + (uint64_t)NPT_STL_BIN_RECORD*num_bin;
+    if( size >= NPT_STL_BIN_HEADER && bin_size == (uint64_t)size ) {
+        ret = npt_stl_read_binary( buf, num_bin, stl );
+    } else {
+        ret = npt_stl_read_ascii( buf, size, stl );
+        if( ret == NPT_STL_ERR_FORMAT || ( ret == NPT_STL_OK && stl->num_tri == 0 ) ) {
+            npt_stl_free( stl );
+            if( size >= NPT_STL_BIN_HEADER && num_bin > 0 && bin_size < (uint64_t)size ) {
+                ret = npt_stl_read_binary( buf, num_bin, stl );
+            } else {
+                ret = NPT_STL_ERR_FORMAT;
+            }
+        }
+    }
+
+    npt_stl_unmap( buf, size );
+
+    if( ret != NPT_STL_OK ) {
+        printf( "#### ERROR npt_stl_read: read error file_name=%s ret=%d\n", file_name, ret );
+        npt_stl_free( stl );
+    }
+    return ret;
+}
+
+
+/// STLデータ領域解放
+///
+/// @param [inout] stl          STLデータ
+/// @return なし
+void
+npt_stl_free(
+        NPT_STL*     stl
+    )
+{
+    free( stl->x );
+    free( stl->y );
+    free( stl->z );
+    free( stl->nx );
+    free( stl->ny );
+    free( stl->nz );
+    memset( stl, 0, sizeof(NPT_STL) );
+}
+
+
+// #################################################################
+//    非公開（プライベート）関数
+// #################################################################
+
+// ファイルのマップ
+static int
+npt_stl_map(
+        const char*   file_name,   // [in]  ファイル名
+        const char**  buf,         // [out] ファイル先頭アドレス
+        size_t*       size         // [out] ファイルサイズ
+    )
+{
+#ifdef _WIN32
+    // mmapが使用できない環境では全体を読み込む
+    FILE* fp = fopen( file_name, "rb" );
+    if( fp == NULL ) return NPT_STL_ERR_OPEN;
+    fseek( fp, 0, SEEK_END );
+    long len = ftell( fp );
+    fseek( fp, 0, SEEK_SET );
+    if( len < 0 ) { fclose(fp); return NPT_STL_ERR_OPEN; }
+    char* wk = (char*)malloc( len > 0 ? len : 1 );
+    if( wk == NULL ) { fclose(fp); return NPT_STL_ERR_MEMORY; }
+    if( fread( wk, 1, len, fp ) != (size_t)len ) {
+        free( wk );
+        fclose( fp );
+        return NPT_STL_ERR_OPEN;
+    }
+    fclose( fp );
+    *buf  = wk;
+    *size = (size_t)len;
+    return NPT_STL_OK;
+#else
+    struct stat st;
+    int fd = open( file_name, O_RDONLY );
+    if( fd < 0 ) return NPT_STL_ERR_OPEN;
+    if( fstat( fd, &st ) != 0 ) {
+        close( fd );
+        return NPT_STL_ERR_OPEN;
+    }
+    *size = (size_t)st.st_size;
+    if( *size == 0 ) {
+        close( fd );
+        *buf = NULL;
+        return NPT_STL_ERR_FORMAT;
+    }
+    void* addr = mmap( NULL, *size, PROT_READ, MAP_PRIVATE, fd, 0 );
+    close( fd );
+    if( addr == MAP_FAILED ) return NPT_STL_ERR_OPEN;
+    // 各スレッドが別々の範囲を読むため先読みを指示しておく
+    madvise( addr, *size, MADV_WILLNEED );
+    *buf = (const char*)addr;
+    return NPT_STL_OK;
+#endif
+}
+
+
+// ファイルのアンマップ
+static void
+npt_stl_unmap(
+        const char*  buf,          // [in]  ファイル先頭アドレス
+        size_t       size          // [in]  ファイルサイズ
+    )
+{
+    if( buf == NULL ) return;
+#ifdef _WIN32
+    free( (void*)buf );
+#else
+    munmap( (void*)buf, size );
+#endif
+}
+
+
+// STLデータ領域確保
+static int
+npt_stl_alloc(
+        int       num_tri,         // [in]  三角形数
+        NPT_STL*  stl              // [out] STLデータ
+    )
+{
+    size_t nv = (size_t)num_tri*3;
+    size_t nf = (size_t)num_tri;
+
+    stl->num_tri = num_tri;
+    if( num_tri <= 0 ) return NPT_STL_OK;
+
+    stl->x  = (NPT_REAL*)malloc( nv*sizeof(NPT_REAL) );
+    stl->y  = (NPT_REAL*)malloc( nv*sizeof(NPT_REAL) );
+    stl->z  = (NPT_REAL*)malloc( nv*sizeof(NPT_REAL) );
+    stl->nx = (NPT_REAL*)malloc( nf*sizeof(NPT_REAL) );
+    stl->ny = (NPT_REAL*)malloc( nf*sizeof(NPT_REAL) );
+    stl->nz = (NPT_REAL*)malloc( nf*sizeof(NPT_REAL) );
+    if( stl->x  == NULL || stl->y  == NULL || stl->z  == NULL ||
+        stl->nx == NULL || stl->ny == NULL || stl->nz == NULL ) {
+        return NPT_STL_ERR_MEMORY;
+    }
+    return NPT_STL_OK;
+}
+
+
+// バイナリSTL読み込み
+//    レコードは50byte固定長のため、三角形の範囲をそのままスレッドに分割する
+//    頂点の位置 3*三角形番号 を int で扱うため、三角形数は INT_MAX/3 までとする
+static int
+npt_stl_read_binary(
+        const char*  buf,          // [in]  ファイル先頭アドレス
+        uint32_t     num_bin,      // [in]  三角形数
+        NPT_STL*     stl           // [out] STLデータ
+    )
+{
+    int i, j, ret;
+    int num_tri;
+
+    if( num_bin > (uint32_t)( INT_MAX/3 ) ) return NPT_STL_ERR_MEMORY;
+    num_tri = (int)num_bin;
+    ret = npt_stl_alloc( num_tri, stl );
+    if( ret != NPT_STL_OK ) return ret;
+
+#pragma omp parallel for private(j) schedule(static)
+    for( i=0; i<num_tri; i++ ) {
+        float rec[12];   // 法線(3) + 頂点(3x3)
+        memcpy( rec, buf + NPT_STL_BIN_HEADER + (size_t)NPT_STL_BIN_RECORD*i, sizeof(rec) );
+
+        stl->nx[i] = rec[0];
+        stl->ny[i] = rec[1];
+        stl->nz[i] = rec[2];
+        for( j=0; j<3; j++ ) {
+            stl->x[3*i+j] = rec[3+3*j];
+            stl->y[3*i+j] = rec[4+3*j];
+            stl->z[3*i+j] = rec[5+3*j];
+        }
+    }
+    return NPT_STL_OK;
+}
+
+
+// アスキーSTL読み込み
+//    ファイルをチャンクに分割し、チャンクの境界を"facet"の先頭に合わせる
+//    1パス目で各チャンクの三角形数を数え、2パス目で格納位置に直接書き込む
+static int
+npt_stl_read_ascii(
+        const char*  buf,          // [in]  ファイル先頭アドレス
+        size_t       size,         // [in]  ファイルサイズ
+        NPT_STL*     stl           // [out] STLデータ
+    )
+{
+    const char* end = buf + size;
+    const char* p;
+    int   num_chunk = 1;
+    int   ic, ret;
+    int   err = 0;
+
+    // 先頭は"solid"であること
+    p = buf;
+    while( p < end && (*p==' ' || *p=='\t' || *p=='\r' || *p=='\n') ) p++;
+    if( end - p < 5 || strncmp( p, "solid", 5 ) != 0 ) {
+        return NPT_STL_ERR_FORMAT;
+    }
+
+#ifdef _OPENMP
+    if( size >= NPT_STL_ASCII_SPLIT ) {
+        num_chunk = 4*omp_get_max_threads();
+    }
+#endif
+
+    const char** bound = (const char**)malloc( (num_chunk+1)*sizeof(const char*) );
+    int*         count = (int*)malloc( (num_chunk+1)*sizeof(int) );
+    if( bound == NULL || count == NULL ) {
+        free( bound );
+        free( count );
+        return NPT_STL_ERR_MEMORY;
+    }
+
+    // チャンク境界
+    bound[0] = npt_stl_next_facet( buf, buf, end );
+    for( ic=1; ic<num_chunk; ic++ ) {
+        const char* pos = buf + (size/num_chunk)*ic;
+        if( pos < bound[ic-1] ) pos = bound[ic-1];
+        bound[ic] = npt_stl_next_facet( buf, pos, end );
+    }
+    bound[num_chunk] = end;
+
+    // 1パス目：チャンク毎の三角形数
+#pragma omp parallel for private(p) schedule(dynamic)
+    for( ic=0; ic<num_chunk; ic++ ) {
+        int num = 0;
+        p = bound[ic];
+        while( p < bound[ic+1] ) {
+            num++;
+            p = npt_stl_next_facet( buf, p+5, bound[ic+1] );
+        }
+        count[ic] = num;
+    }
+
+    // 格納位置（累積和、三角形数は INT_MAX/3 まで）
+    int num_tri = 0;
+    for( ic=0; ic<num_chunk; ic++ ) {
+        int num = count[ic];
+        if( num > INT_MAX/3 - num_tri ) {
+            free( bound );
+            free( count );
+            return NPT_STL_ERR_MEMORY;
+        }
+        count[ic] = num_tri;
+        num_tri += num;
+    }
+    count[num_chunk] = num_tri;
+
+    ret = npt_stl_alloc( num_tri, stl );
+    if( ret != NPT_STL_OK ) {
+        free( bound );
+        free( count );
+        return ret;
+    }
+
+    // 2パス目：読み込み
+#pragma omp parallel for private(p) schedule(dynamic) reduction(+:err)
+    for( ic=0; ic<num_chunk; ic++ ) {
+        int i = count[ic];
+        p = bound[ic];
+        while( p < bound[ic+1] && i < count[ic+1] ) {
+            p = npt_stl_parse_facet( p, bound[ic+1], i, stl );
+            if( p == NULL ) {
+                err++;
+                break;
+            }
+            i++;
+            p = npt_stl_next_facet( buf, p, bound[ic+1] );
+        }
+        // 1パス目で数えた三角形数と一致すること
+        if( p != NULL && i != count[ic+1] ) err++;
+    }
+
+    free( bound );
+    free( count );
+
+    return ( err == 0 ) ? NPT_STL_OK : NPT_STL_ERR_FORMAT;
+}
+
+
+// 次の"facet normal"の先頭を探す
+//    "endfacet"は対象外。見つからない場合はendを返す
+static const char*
+npt_stl_next_facet(
+        const char*  buf,          // [in]  ファイル先頭アドレス
+        const char*  p,            // [in]  探索開始位置
+        const char*  end           // [in]  探索終了位置
+    )
+{
+    while( p < end ) {
+        p = (const char*)memchr( p, 'f', end - p );
+        if( p == NULL || end - p < 5 ) return end;
+        if( strncmp( p, "facet", 5 ) == 0 &&
+            ( p == buf || p[-1]==' ' || p[-1]=='\t' || p[-1]=='\n' || p[-1]=='\r' ) ) {
+            const char* q = p + 5;
+            while( q < end && (*q==' ' || *q=='\t') ) q++;
+            if( end - q >= 6 && strncmp( q, "normal", 6 ) == 0 ) {
+                return p;
+            }
+        }
+        p++;
+    }
+    return end;
+}
+
+
+// 1三角形分の読み込み
+//    pは"facet"の先頭。読み込み後の位置を返す（エラー時NULL）
+//    "endfacet"（無い場合は次の"facet normal"）までに"vertex"がちょうど３つ無い場合はエラー
+static const char*
+npt_stl_parse_facet(
+        const char*  p,            // [in]  "facet"の先頭
+        const char*  end,          // [in]  探索終了位置
+        int          i,            // [in]  三角形番号
+        NPT_STL*     stl           // [out] STLデータ
+    )
+{
+    const char* top = p;
+    const char* fend;
+    const char* q;
+    int j;
+
+    // "facet normal"
+    p += 5;
+    while( p < end && (*p==' ' || *p=='\t') ) p++;
+    p += 6;
+    if( (p = npt_stl_parse_real( p, end, &stl->nx[i] )) == NULL ) return NULL;
+    if( (p = npt_stl_parse_real( p, end, &stl->ny[i] )) == NULL ) return NULL;
+    if( (p = npt_stl_parse_real( p, end, &stl->nz[i] )) == NULL ) return NULL;
+
+    // 三角形の終端（"endfacet" または次の"facet normal"）
+    fend = npt_stl_next_facet( top, p, end );
+    q = p;
+    while( q < fend ) {
+        q = (const char*)memchr( q, 'e', fend - q );
+        if( q == NULL ) { q = fend; break; }
+        if( fend - q >= 8 && strncmp( q, "endfacet", 8 ) == 0 ) break;
+        q++;
+    }
+    fend = q;
+
+    // "vertex" x3（三角形の終端までにちょうど３つ）
+    for( j=0; j<3; j++ ) {
+        if( (p = npt_stl_next_vertex( p, fend )) == NULL ) return NULL;
+        if( (p = npt_stl_parse_real( p, fend, &stl->x[3*i+j] )) == NULL ) return NULL;
+        if( (p = npt_stl_parse_real( p, fend, &stl->y[3*i+j] )) == NULL ) return NULL;
+        if( (p = npt_stl_parse_real( p, fend, &stl->z[3*i+j] )) == NULL ) return NULL;
+    }
+    if( npt_stl_next_vertex( p, fend ) != NULL ) return NULL;
+    return p;
+}
+
+
+// 次の"vertex"の直後の位置を探す
+//    見つからない場合はNULLを返す
+static const char*
+npt_stl_next_vertex(
+        const char*  p,            // [in]  探索開始位置
+        const char*  end           // [in]  探索終了位置
+    )
+{
+    while( p < end ) {
+        p = (const char*)memchr( p, 'v', end - p );
+        if( p == NULL || end - p < 6 ) return NULL;
+        if( strncmp( p, "vertex", 6 ) == 0 ) return p + 6;
+        p++;
+    }
+    return NULL;
+}
+
+
+// 実数の読み込み
+//    仮数部が15桁以下かつ指数が±22以内の場合は、整数の仮数と10のべき乗の
+//    1回の乗除算で求める（倍精度で正しく丸められる）。それ以外はstrtodを使用する
+static const char*
+npt_stl_parse_real(
+        const char*  p,            // [in]  読み込み開始位置
+        const char*  end,          // [in]  探索終了位置
+        NPT_REAL*    val           // [out] 実数値
+    )
+{
+    static const double pow10[23] = {
+        1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+    const char* top;
+    uint64_t mant = 0;
+    int  nmant = 0;
+    int  ndig = 0;
+    int  exp10 = 0;
+    int  neg = 0;
+
+    while( p < end && (*p==' ' || *p=='\t' || *p=='\r' || *p=='\n') ) p++;
+    top = p;
+
+    if( p < end && (*p=='-' || *p=='+') ) {
+        neg = ( *p == '-' );
+        p++;
+    }
+    while( p < end && *p >= '0' && *p <= '9' ) {
+        if( ndig < 19 ) { mant = mant*10 + (*p-'0'); if( mant ) ndig++; }
+        else            { exp10++; ndig++; }
+        nmant++;
+        p++;
+    }
+    if( p < end && *p == '.' ) {
+        p++;
+        while( p < end && *p >= '0' && *p <= '9' ) {
+            if( ndig < 19 ) { mant = mant*10 + (*p-'0'); exp10--; if( mant ) ndig++; }
+            nmant++;
+            p++;
+        }
+    }
+    if( p < end && (*p=='e' || *p=='E') ) {
+        const char* q = p + 1;
+        int eneg = 0, e = 0;
+        if( q < end && (*q=='-' || *q=='+') ) {
+            eneg = ( *q == '-' );
+            q++;
+        }
+        if( q < end && *q >= '0' && *q <= '9' ) {
+            while( q < end && *q >= '0' && *q <= '9' ) {
+                if( e < 10000 ) e = e*10 + (*q-'0');
+                q++;
+            }
+            exp10 += eneg ? -e : e;
+            p = q;
+        }
+    }
+
+    // 仮数部の数字が無い場合（"e5" 等）は strtod で不正とする
+    if( ndig <= 15 && exp10 >= -22 && exp10 <= 22 && nmant > 0 ) {
+        double v = (double)mant;
+        if( exp10 < 0 ) v /= pow10[-exp10];
+        else            v *= pow10[exp10];
+        *val = (NPT_REAL)( neg ? -v : v );
+        return npt_stl_real_end( p, end );
+    }
+
+    // 一般の場合
+    char  wk[64];
+    char* wk_end;
+    int   len = (int)( end - top );
+    if( len > 63 ) len = 63;
+    memcpy( wk, top, len );
+    wk[len] = '\0';
+    double v = strtod( wk, &wk_end );
+    if( wk_end == wk ) return NULL;
+    *val = (NPT_REAL)v;
+    return npt_stl_real_end( top + ( wk_end - wk ), end );
+}
+
+
+// 実数の終端の確認
+//    数字の直後は空白または探索終了位置であること（"1.0abc" 等はエラー時NULL）
+static const char*
+npt_stl_real_end(
+        const char*  p,            // [in]  実数の直後の位置
+        const char*  end           // [in]  探索終了位置
+    )
+{
+    if( p < end && !(*p==' ' || *p=='\t' || *p=='\r' || *p=='\n') ) return NULL;
+    return p;
+}
@@ -0,0 +1,967 @@
+/*
+ * Npatch - Nagata Patch Library
+ *
+ * Copyright (c) 2015-2016 Advanced Institute for Computational Science, RIKEN.
+ * All rights reserved.
+ *
+ */
+
+////////////////////////////////////////////////////////////////////////////
+///
+/// 長田パッチ 閉曲面のボクセル化 関数
+///
+////////////////////////////////////////////////////////////////////////////
+
+
+#include "Npt_Voxel.h"
+#include "Npt_Curv.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+
+// 分割点の最大数（分割数 n=2^NPT_VOXEL_MAX_DEPTH のとき (n+1)(n+2)/2）
+#define NPT_VOXEL_MAX_PNT   ( ((1<<NPT_VOXEL_MAX_DEPTH)+1)*((1<<NPT_VOXEL_MAX_DEPTH)+2)/2 )
+
+// 交点の Newton 法の最大反復回数
+#define NPT_VOXEL_NEWTON    6
+
+// 交点の Newton 法の収束判定（セルの大きさに対する比）
+#define NPT_VOXEL_TOL       1.0e-3
+
+// タイルの交点の配列の初期の大きさ
+#define NPT_VOXEL_HIT       1024
+
+// 行との交点
+struct npt_voxel_hit {
+    int        row;      // タイル内の走査線番号
+    NPT_REAL   x;        // 交点の x 座標
+};
+
+// 交点の比較（行、x の昇順）
+struct npt_voxel_hit_less {
+    bool operator()( const npt_voxel_hit& a, const npt_voxel_hit& b ) const {
+        if( a.row != b.row ) return a.row < b.row;
+        return a.x < b.x;
+    }
+};
+
+// 交点の比較（x、走査線の昇順）
+struct npt_voxel_hit_less_x {
+    bool operator()( const npt_voxel_hit& a, const npt_voxel_hit& b ) const {
+        if( a.x != b.x ) return a.x < b.x;
+        return a.row < b.row;
+    }
+};
+
+// パッチの分割
+struct npt_voxel_tess {
+    int        n;                         // 辺の分割数
+    NPT_REAL   pos[NPT_VOXEL_MAX_PNT][3]; // 分割点の座標
+    NPT_REAL   par[NPT_VOXEL_MAX_PNT][2]; // 分割点の (eta,xi)
+};
+
+// タイルの交点の配列
+struct npt_voxel_buf {
+    int             num;
+    int             max;
+    npt_voxel_hit*  hit;
+};
+
+// セルの行の走査線
+//    セルの行 (j,k) の走査線 s は (y,z) = org + ((j,k) + off[s])*pitch を通る
+struct npt_voxel_sub {
+    int        num;          // セルの行あたりの走査線数
+    double   (*off)[2];      // セル内の位置（セルの大きさ単位）[num]
+    double     omin;         // 位置の最小値
+    double     omax;         // 位置の最大値
+};
+
+// タイルの交点の処理（交点の数が奇数の走査線数、メモリ確保失敗は -1 を返す）
+typedef int (*npt_voxel_proc)( npt_voxel_buf* buf, const NPT_VOXEL_GRID* grid, const npt_voxel_sub* sub,
+                               int tj, int tk, void* ctx );
+
+// 切断セルの配列（タイル単位）
+struct npt_voxel_cutBuf {
+    int          num;
+    int          max;
+    int        (*idx)[3];
+    NPT_REAL*    vol;
+    NPT_REAL   (*area)[3];
+};
+
+// 切断セルの走査の作業領域
+struct npt_voxel_cutCtx {
+    int                 nsub;     // セルの辺あたりの分割数
+    int                 ntj;      // y 方向のタイル数
+    npt_voxel_cutBuf*   tile;     // タイルの切断セル [num_tile]
+};
+
+// 切断セルの走査線のグループ（セル内部、y の下側の面、z の下側の面）
+#define NPT_VOXEL_NUM_GROUP  3
+
+//------------------------------------------------------------------
+//  プロトタイプ宣言
+//------------------------------------------------------------------
+static int    npt_voxel_check( const NPT_VOXEL_GRID* grid, int depth );
+static int    npt_voxel_scan( NPT_MESH* mesh, const NPT_VOXEL_GRID* grid, int depth, const npt_voxel_sub* sub,
+                              npt_voxel_proc proc, void* ctx );
+static void   npt_voxel_rows( NPT_REAL vmin, NPT_REAL vmax, NPT_REAL org, NPT_REAL pitch, int size,
+                              double omin, double omax, int* r0, int* r1 );
+static void   npt_voxel_tessellate( NPT_MESH* mesh, int itri, int n, NPT_REAL t[3][3], NPT_REAL cp[7][3], npt_voxel_tess* ts );
+static void   npt_voxel_edgePnt( NPT_MESH* mesh, int itri, NPT_REAL cp[7][3], int j, int m, int n, NPT_REAL pos[3] );
+static int    npt_voxel_edgeFunc( const NPT_REAL a[3], const NPT_REAL b[3], double py, double pz, double* f );
+static int    npt_voxel_subTri( NPT_REAL t[3][3], NPT_REAL cp[7][3], npt_voxel_tess* ts, const int v[3],
+                                const NPT_VOXEL_GRID* grid, const npt_voxel_sub* sub,
+                                int j0, int j1, int k0, int k1, int tj, int tk, npt_voxel_buf* buf );
+static NPT_REAL npt_voxel_refine( NPT_REAL t[3][3], NPT_REAL cp[7][3], double eta, double xi, double py, double pz,
+                                  double xflat, int n, const NPT_VOXEL_GRID* grid );
+static int    npt_voxel_fill( npt_voxel_buf* buf, const NPT_VOXEL_GRID* grid, const npt_voxel_sub* sub,
+                              int tj, int tk, void* ctx );
+static void   npt_voxel_setBits( unsigned int* row, int i0, int i1 );
+static int    npt_voxel_cutTile( npt_voxel_buf* buf, const NPT_VOXEL_GRID* grid, const npt_voxel_sub* sub,
+                                 int tj, int tk, void* ctx );
+static int    npt_voxel_cutSweep( const npt_voxel_hit* ev, int num_ev, const NPT_VOXEL_GRID* grid, int nsub,
+                                  int j, int k, npt_voxel_cutBuf* out );
+static int    npt_voxel_cutToggle( char* solid, int cnt[NPT_VOXEL_NUM_GROUP], int nsub, int s );
+static int    npt_voxel_cutAdd( npt_voxel_cutBuf* out, int i, int j, int k, NPT_REAL vol, NPT_REAL area[3] );
+
+
+// #################################################################
+//    公開関数
+// #################################################################
+
+/// 閉曲面のボクセル化
+///
+/// @param [in]    mesh         三角形メッシュ（vtx_norm 設定済み、閉曲面）
+/// @param [in]    grid         直交格子
+/// @param [in]    depth        パッチの分割の深さ（0-NPT_VOXEL_MAX_DEPTH、通常は 2）
+/// @param [out]   flag         セルの内外フラグ [nz*ny*NPT_VOXEL_ROW_WORDS(nx)]（呼び出し側で確保）
+/// @return リターンコード   =0 正常  =1 異常（メモリ確保失敗、引数不正）  =2 交点の数が奇数の行がある
+int
+npt_voxel_mesh(
+        NPT_MESH*              mesh,
+        const NPT_VOXEL_GRID*  grid,
+        int                    depth,
+        unsigned int*          flag
+    )
+{
+    double        off[1][2] = { { 0.5, 0.5 } };
+    npt_voxel_sub sub;
+    int           ny = grid->size[1], nz = grid->size[2];
+    int           nw = NPT_VOXEL_ROW_WORDS( grid->size[0] );
+    int           k;
+
+    if( npt_voxel_check( grid, depth ) != 0 ) return 1;
+
+#pragma omp parallel for schedule(static)
+    for( k=0; k<nz; k++ ) {
+        memset( flag + (size_t)k*ny*nw, 0, sizeof(unsigned int)*(size_t)ny*nw );
+    }
+
+    sub.num  = 1;
+    sub.off  = off;
+    sub.omin = sub.omax = 0.5;
+    return npt_voxel_scan( mesh, grid, depth, &sub, npt_voxel_fill, flag );
+}
+
+
+/// 切断セルの体積率と面の開口率
+///
+/// @param [in]    mesh         三角形メッシュ（vtx_norm 設定済み、閉曲面）
+/// @param [in]    grid         直交格子
+/// @param [in]    depth        パッチの分割の深さ（0-NPT_VOXEL_MAX_DEPTH、通常は 2）
+/// @param [in]    nsub         セルの辺あたりの走査線の分割数（1-NPT_VOXEL_MAX_SUB）
+/// @param [out]   cut          切断セル（npt_voxel_cut_free() で解放）
+/// @return リターンコード   =0 正常  =1 異常（メモリ確保失敗、引数不正）  =2 交点の数が奇数の走査線がある
+int
+npt_voxel_cut(
+        NPT_MESH*              mesh,
+        const NPT_VOXEL_GRID*  grid,
+        int                    depth,
+        int                    nsub,
+        NPT_VOXEL_CUT*         cut
+    )
+{
+    npt_voxel_sub    sub;
+    npt_voxel_cutCtx ctx;
+    int              ntj, num_tile;
+    int              a, b, s, it, ret;
+    long long        n;
+
+    memset( cut, 0, sizeof(NPT_VOXEL_CUT) );
+    if( npt_voxel_check( grid, depth ) != 0 ) return 1;
+    if( nsub < 1 || nsub > NPT_VOXEL_MAX_SUB ) return 1;
+
+    // 走査線（セル内部 nsub^2、y の下側の面 nsub、z の下側の面 nsub）
+    sub.num  = nsub*nsub + 2*nsub;
+    sub.off  = (double(*)[2])malloc( sizeof(double)*2*sub.num );
+    sub.omin = 0.0;
+    sub.omax = (nsub - 0.5)/nsub;
+    ntj      = (grid->size[1] + NPT_VOXEL_TILE - 1)/NPT_VOXEL_TILE;
+    num_tile = ntj*( (grid->size[2] + NPT_VOXEL_TILE - 1)/NPT_VOXEL_TILE );
+    ctx.nsub = nsub;
+    ctx.ntj  = ntj;
+    ctx.tile = (npt_voxel_cutBuf*)calloc( (size_t)num_tile, sizeof(npt_voxel_cutBuf) );
+    if( sub.off == NULL || ctx.tile == NULL ) {
+        if( sub.off  ) free( sub.off );
+        if( ctx.tile ) free( ctx.tile );
+        return 1;
+    }
+    s = 0;
+    for( b=0; b<nsub; b++ ) {
+        for( a=0; a<nsub; a++ ) {
+            sub.off[s][0] = (a + 0.5)/nsub;
+            sub.off[s][1] = (b + 0.5)/nsub;
+            s++;
+        }
+    }
+    for( a=0; a<2; a++ ) {
+        for( b=0; b<nsub; b++ ) {
+            sub.off[s][0] = ( a == 0 ) ? 0.0 : (b + 0.5)/nsub;
+            sub.off[s][1] = ( a == 0 ) ? (b + 0.5)/nsub : 0.0;
+            s++;
+        }
+    }
+
+    ret = npt_voxel_scan( mesh, grid, depth, &sub, npt_voxel_cutTile, &ctx );
+
+    // タイル順に連結する
+    n = 0;
+    for( it=0; it<num_tile; it++ ) n += ctx.tile[it].num;
+    if( ret != 1 && n > 0 ) {
+        cut->idx  = (int(*)[3])malloc( sizeof(int)*3*n );
+        cut->vol  = (NPT_REAL*)malloc( sizeof(NPT_REAL)*n );
+        cut->area = (NPT_REAL(*)[3])malloc( sizeof(NPT_REAL)*3*n );
+        if( cut->idx == NULL || cut->vol == NULL || cut->area == NULL ) {
+            npt_voxel_cut_free( cut );
+            ret = 1;
+        }
+    }
+    if( ret != 1 ) {
+        n = 0;
+        for( it=0; it<num_tile; it++ ) {
+            npt_voxel_cutBuf* tb = &ctx.tile[it];
+            if( tb->num == 0 ) continue;
+            memcpy( cut->idx [n], tb->idx,  sizeof(int)*3*tb->num );
+            memcpy( cut->vol + n, tb->vol,  sizeof(NPT_REAL)*tb->num );
+            memcpy( cut->area[n], tb->area, sizeof(NPT_REAL)*3*tb->num );
+            n += tb->num;
+        }
+        cut->num = n;
+    }
+
+    for( it=0; it<num_tile; it++ ) {
+        if( ctx.tile[it].idx  ) free( ctx.tile[it].idx );
+        if( ctx.tile[it].vol  ) free( ctx.tile[it].vol );
+        if( ctx.tile[it].area ) free( ctx.tile[it].area );
+    }
+    free( ctx.tile );
+    free( sub.off );
+    return ret;
+}
+
+
+/// 切断セルの領域解放
+///
+/// @param [inout] cut          切断セル
+/// @return なし
+void
+npt_voxel_cut_free(
+        NPT_VOXEL_CUT*         cut
+    )
+{
+    if( cut->idx  ) free( cut->idx );
+    if( cut->vol  ) free( cut->vol );
+    if( cut->area ) free( cut->area );
+    memset( cut, 0, sizeof(NPT_VOXEL_CUT) );
+}
+
+
+// #################################################################
+//    非公開（プライベート）関数
+// #################################################################
+
+// 引数の確認
+static int
+npt_voxel_check(
+        const NPT_VOXEL_GRID*  grid,      // [in]    直交格子
+        int                    depth      // [in]    パッチの分割の深さ
+    )
+{
+    int k;
+
+    if( depth < 0 || depth > NPT_VOXEL_MAX_DEPTH ) return 1;
+    for( k=0; k<3; k++ ) {
+        if( grid->size[k] <= 0 || !(grid->pitch[k] > 0.0) ) return 1;
+    }
+    return 0;
+}
+
+
+// 走査線とパッチの交点
+//    パッチをタイルに振り分け、タイル単位にスレッド並列で交点を求めて proc で処理する
+static int
+npt_voxel_scan(
+        NPT_MESH*              mesh,      // [in]    三角形メッシュ
+        const NPT_VOXEL_GRID*  grid,      // [in]    直交格子
+        int                    depth,     // [in]    パッチの分割の深さ
+        const npt_voxel_sub*   sub,       // [in]    セルの行の走査線
+        npt_voxel_proc         proc,      // [in]    タイルの交点の処理
+        void*                  ctx        // [inout] 処理の作業領域
+    )
+{
+    int   ny = grid->size[1], nz = grid->size[2];
+    int   ntj, ntk, num_tile;
+    int  (*range)[4];
+    int*  tile_off;
+    int*  tile_tri;
+    int   i, err = 0, odd = 0;
+
+    ntj      = (ny + NPT_VOXEL_TILE - 1)/NPT_VOXEL_TILE;
+    ntk      = (nz + NPT_VOXEL_TILE - 1)/NPT_VOXEL_TILE;
+    num_tile = ntj*ntk;
+
+    range    = (int(*)[4])malloc( sizeof(int)*4*(mesh->num_tri > 0 ? mesh->num_tri : 1) );
+    tile_off = (int*)calloc( (size_t)num_tile+1, sizeof(int) );
+    if( range == NULL || tile_off == NULL ) {
+        if( range    ) free( range );
+        if( tile_off ) free( tile_off );
+        return 1;
+    }
+
+    // パッチのセルの行の範囲（制御点の包含箱）
+#pragma omp parallel for schedule(static)
+    for( i=0; i<mesh->num_tri; i++ ) {
+        NPT_REAL cp[7][3], bmin[3], bmax[3];
+        int      l, m;
+
+        npt_mesh_param_get( mesh, i, cp );
+        for( m=0; m<3; m++ ) bmin[m] = bmax[m] = mesh->vtx[ mesh->tri[i][0] ][m];
+        for( l=1; l<10; l++ ) {
+            const NPT_REAL* p = ( l < 3 ) ? mesh->vtx[ mesh->tri[i][l] ] : cp[l-3];
+            for( m=0; m<3; m++ ) {
+                if( p[m] < bmin[m] ) bmin[m] = p[m];
+                if( p[m] > bmax[m] ) bmax[m] = p[m];
+            }
+        }
+        npt_voxel_rows( bmin[1], bmax[1], grid->org[1], grid->pitch[1], ny, sub->omin, sub->omax, &range[i][0], &range[i][1] );
+        npt_voxel_rows( bmin[2], bmax[2], grid->org[2], grid->pitch[2], nz, sub->omin, sub->omax, &range[i][2], &range[i][3] );
+    }
+
+    // タイルに掛かるパッチの一覧（タイル順、三角形番号順）
+    for( i=0; i<mesh->num_tri; i++ ) {
+        int tj, tk;
+        if( range[i][0] > range[i][1] || range[i][2] > range[i][3] ) continue;
+        for( tk=range[i][2]/NPT_VOXEL_TILE; tk<=range[i][3]/NPT_VOXEL_TILE; tk++ ) {
+            for( tj=range[i][0]/NPT_VOXEL_TILE; tj<=range[i][1]/NPT_VOXEL_TILE; tj++ ) tile_off[tk*ntj + tj + 1]++;
+        }
+    }
+    for( i=0; i<num_tile; i++ ) tile_off[i+1] += tile_off[i];
+    tile_tri = (int*)malloc( sizeof(int)*(tile_off[num_tile] > 0 ? tile_off[num_tile] : 1) );
+    if( tile_tri == NULL ) {
+        free( range );
+        free( tile_off );
+        return 1;
+    }
+    {
+        int* pos = (int*)malloc( sizeof(int)*num_tile );
+        if( pos == NULL ) {
+            free( range ); free( tile_off ); free( tile_tri );
+            return 1;
+        }
+        memcpy( pos, tile_off, sizeof(int)*num_tile );
+        for( i=0; i<mesh->num_tri; i++ ) {
+            int tj, tk;
+            if( range[i][0] > range[i][1] || range[i][2] > range[i][3] ) continue;
+            for( tk=range[i][2]/NPT_VOXEL_TILE; tk<=range[i][3]/NPT_VOXEL_TILE; tk++ ) {
+                for( tj=range[i][0]/NPT_VOXEL_TILE; tj<=range[i][1]/NPT_VOXEL_TILE; tj++ ) tile_tri[ pos[tk*ntj + tj]++ ] = i;
+            }
+        }
+        free( pos );
+    }
+
+    // タイル単位の走査
+#pragma omp parallel reduction(+:err,odd)
+    {
+        npt_voxel_buf   buf;
+        npt_voxel_tess* ts = (npt_voxel_tess*)malloc( sizeof(npt_voxel_tess) );
+        int             it;
+
+        buf.num = 0;
+        buf.max = NPT_VOXEL_HIT;
+        buf.hit = (npt_voxel_hit*)malloc( sizeof(npt_voxel_hit)*buf.max );
+        if( ts == NULL || buf.hit == NULL ) err++;
+
+#pragma omp for schedule(dynamic,1)
+        for( it=0; it<num_tile; it++ ) {
+            int tj = it % ntj, tk = it / ntj;
+            int l, s;
+
+            if( err > 0 ) continue;
+            buf.num = 0;
+            for( l=tile_off[it]; l<tile_off[it+1]; l++ ) {
+                int      itri = tile_tri[l];
+                int      j0 = std::max( range[itri][0], tj*NPT_VOXEL_TILE );
+                int      j1 = std::min( range[itri][1], tj*NPT_VOXEL_TILE + NPT_VOXEL_TILE - 1 );
+                int      k0 = std::max( range[itri][2], tk*NPT_VOXEL_TILE );
+                int      k1 = std::min( range[itri][3], tk*NPT_VOXEL_TILE + NPT_VOXEL_TILE - 1 );
+                NPT_REAL t[3][3], cp[7][3];
+                int      a, b;
+
+                npt_voxel_tessellate( mesh, itri, 1 << depth, t, cp, ts );
+                for( a=0; a<ts->n && err == 0; a++ ) {
+                    for( b=0; b<=a; b++ ) {
+                        int v[3];
+                        v[0] = a*(a+1)/2 + b;
+                        v[1] = (a+1)*(a+2)/2 + b;
+                        v[2] = (a+1)*(a+2)/2 + b + 1;
+                        if( npt_voxel_subTri( t, cp, ts, v, grid, sub, j0, j1, k0, k1, tj, tk, &buf ) != 0 ) { err++; break; }
+                        if( b < a ) {
+                            v[1] = v[2];
+                            v[2] = a*(a+1)/2 + b + 1;
+                            if( npt_voxel_subTri( t, cp, ts, v, grid, sub, j0, j1, k0, k1, tj, tk, &buf ) != 0 ) { err++; break; }
+                        }
+                    }
+                }
+            }
+            if( err > 0 ) continue;
+            s = proc( &buf, grid, sub, tj, tk, ctx );
+            if( s < 0 ) err++;
+            else        odd += s;
+        }
+        if( ts      ) free( ts );
+        if( buf.hit ) free( buf.hit );
+    }
+
+    free( range );
+    free( tile_off );
+    free( tile_tri );
+    if( err > 0 ) return 1;
+    return ( odd > 0 ) ? 2 : 0;
+}
+
+
+// 座標の範囲を走査線が通るセルの行の範囲（空の場合は r0 > r1）
+//    セルの行 r の走査線は org + (r + o)*pitch（omin <= o <= omax）を通る
+static void
+npt_voxel_rows(
+        NPT_REAL   vmin,       // [in]    座標の最小値
+        NPT_REAL   vmax,       // [in]    座標の最大値
+        NPT_REAL   org,        // [in]    格子の原点
+        NPT_REAL   pitch,      // [in]    セルの大きさ
+        int        size,       // [in]    セル数
+        double     omin,       // [in]    走査線のセル内の位置の最小値
+        double     omax,       // [in]    走査線のセル内の位置の最大値
+        int*       r0,         // [out]   最初の行
+        int*       r1          // [out]   最後の行
+    )
+{
+    // 分割点の丸め誤差の余裕
+    double a = ((double)vmin - org)/pitch - omax - 1.0e-5;
+    double b = ((double)vmax - org)/pitch - omin + 1.0e-5;
+
+    if( b < 0.0 || a > size - 1.0 ) {
+        *r0 = 1; *r1 = 0;
+        return;
+    }
+    *r0 = ( a < 0.0 ) ? 0 : (int)ceil( a );
+    *r1 = ( b > size - 1.0 ) ? size - 1 : (int)floor( b );
+}
+
+
+// パッチの分割点
+//    分割点 (a,b) (0<=b<=a<=n) は (eta,xi) = (a/n, b/n)、番号は a(a+1)/2+b とする。
+//    頂点は三角形の頂点、辺上の点は npt_voxel_edgePnt で求め、辺を共有するパッチで一致させる。
+static void
+npt_voxel_tessellate(
+        NPT_MESH*        mesh,      // [in]    三角形メッシュ
+        int              itri,      // [in]    三角形番号
+        int              n,         // [in]    辺の分割数
+        NPT_REAL         t[3][3],   // [out]   三角形の頂点座標
+        NPT_REAL         cp[7][3],  // [out]   長田パッチパラメータ
+        npt_voxel_tess*  ts         // [out]   パッチの分割
+    )
+{
+    int a, b, m;
+
+    for( a=0; a<3; a++ ) {
+        for( m=0; m<3; m++ ) t[a][m] = mesh->vtx[ mesh->tri[itri][a] ][m];
+    }
+    npt_mesh_param_get( mesh, itri, cp );
+
+    ts->n = n;
+    for( a=0; a<=n; a++ ) {
+        for( b=0; b<=a; b++ ) {
+            int      v = a*(a+1)/2 + b;
+            NPT_REAL d_eta[3], d_xi[3];
+
+            ts->par[v][0] = (NPT_REAL)a/n;
+            ts->par[v][1] = (NPT_REAL)b/n;
+            if( a == 0 ) {
+                for( m=0; m<3; m++ ) ts->pos[v][m] = t[0][m];
+            }
+            else if( a == n && b == 0 ) {
+                for( m=0; m<3; m++ ) ts->pos[v][m] = t[1][m];
+            }
+            else if( a == n && b == n ) {
+                for( m=0; m<3; m++ ) ts->pos[v][m] = t[2][m];
+            }
+            else if( b == 0 ) {
+                npt_voxel_edgePnt( mesh, itri, cp, 0, a, n, ts->pos[v] );
+            }
+            else if( a == n ) {
+                npt_voxel_edgePnt( mesh, itri, cp, 1, b, n, ts->pos[v] );
+            }
+            else if( a == b ) {
+                npt_voxel_edgePnt( mesh, itri, cp, 2, n - a, n, ts->pos[v] );
+            }
+            else {
+                npt_curv_tangent( ts->par[v][0], ts->par[v][1], t, cp, ts->pos[v], d_eta, d_xi );
+            }
+        }
+    }
+}
+
+
+// 辺上の分割点
+//    辺 j（頂点 j -> j+1）の頂点 j から m/n の位置の点を、頂点番号の小さい頂点からの
+//    ３次ベジェ曲線（辺の制御点）として求める
+static void
+npt_voxel_edgePnt(
+        NPT_MESH*   mesh,          // [in]    三角形メッシュ
+        int         itri,          // [in]    三角形番号
+        NPT_REAL    cp[7][3],      // [in]    長田パッチパラメータ
+        int         j,             // [in]    辺番号
+        int         m,             // [in]    分割点の位置
+        int         n,             // [in]    辺の分割数
+        NPT_REAL    pos[3]         // [out]   分割点の座標
+    )
+{
+    int             v0 = mesh->tri[itri][j], v1 = mesh->tri[itri][(j+1)%3];
+    const NPT_REAL* q[4];
+    double          s;
+    int             k;
+
+    if( v0 < v1 ) {
+        q[0] = mesh->vtx[v0]; q[1] = cp[2*j];   q[2] = cp[2*j+1]; q[3] = mesh->vtx[v1];
+    }
+    else {
+        q[0] = mesh->vtx[v1]; q[1] = cp[2*j+1]; q[2] = cp[2*j];   q[3] = mesh->vtx[v0];
+        m = n - m;
+    }
+    s = (double)m/n;
+    for( k=0; k<3; k++ ) {
+        double a0 = q[0][k] + s*(q[1][k] - q[0][k]);
+        double a1 = q[1][k] + s*(q[2][k] - q[1][k]);
+        double a2 = q[2][k] + s*(q[3][k] - q[2][k]);
+        double b0 = a0 + s*(a1 - a0);
+        double b1 = a1 + s*(a2 - a1);
+        pos[k] = (NPT_REAL)( b0 + s*(b1 - b0) );
+    }
+}
+
+
+// yz 平面の辺の関数（点が辺 a->b の左側で正）
+//    辺の向きを座標順に統一して計算し、値が 0 の場合の符号は点を (y+ε, z+ε^2) に摂動して
+//    決める。辺を共有する三角形で値は符号のみ異なる。
+//    符号を返し、投影が点となる辺のみ 0 とする。
+static int
+npt_voxel_edgeFunc(
+        const NPT_REAL  a[3],      // [in]    辺の始点
+        const NPT_REAL  b[3],      // [in]    辺の終点
+        double          py,        // [in]    点の y 座標
+        double          pz,        // [in]    点の z 座標
+        double*         f          // [out]   辺の関数の値
+    )
+{
+    int             sw = ( a[1] > b[1] ) || ( a[1] == b[1] && a[2] > b[2] );
+    const NPT_REAL* p0 = sw ? b : a;
+    const NPT_REAL* p1 = sw ? a : b;
+    double          ey = (double)p1[1] - p0[1];
+    double          ez = (double)p1[2] - p0[2];
+    double          v  = ey*( pz - p0[2] ) - ez*( py - p0[1] );
+    double          d  = v;
+
+    if( d == 0.0 ) {
+        d = -ez;
+        if( d == 0.0 ) d = ey;
+    }
+    *f = sw ? -v : v;
+    if( d == 0.0 ) return 0;
+    return ( ( d > 0.0 ) != ( sw != 0 ) ) ? 1 : -1;
+}
+
+
+// 分割三角形と走査線の交差判定
+//    交差する走査線の交点を buf に追加する
+static int
+npt_voxel_subTri(
+        NPT_REAL               t[3][3],   // [in]    三角形の頂点座標
+        NPT_REAL               cp[7][3],  // [in]    長田パッチパラメータ
+        npt_voxel_tess*        ts,        // [in]    パッチの分割
+        const int              v[3],      // [in]    分割三角形の分割点番号
+        const NPT_VOXEL_GRID*  grid,      // [in]    直交格子
+        const npt_voxel_sub*   sub,       // [in]    セルの行の走査線
+        int                    j0,        // [in]    パッチとタイルの y の行の範囲
+        int                    j1,        // [in]
+        int                    k0,        // [in]    パッチとタイルの z の行の範囲
+        int                    k1,        // [in]
+        int                    tj,        // [in]    タイル番号
+        int                    tk,        // [in]
+        npt_voxel_buf*         buf        // [inout] 交点の配列
+    )
+{
+    const NPT_REAL* p[3] = { ts->pos[v[0]], ts->pos[v[1]], ts->pos[v[2]] };
+    NPT_REAL        vmin[3], vmax[3];
+    int             r[4], j, k, l, m, is;
+
+    for( m=1; m<3; m++ ) {
+        vmin[m] = vmax[m] = p[0][m];
+        for( l=1; l<3; l++ ) {
+            if( p[l][m] < vmin[m] ) vmin[m] = p[l][m];
+            if( p[l][m] > vmax[m] ) vmax[m] = p[l][m];
+        }
+    }
+    npt_voxel_rows( vmin[1], vmax[1], grid->org[1], grid->pitch[1], grid->size[1], sub->omin, sub->omax, &r[0], &r[1] );
+    npt_voxel_rows( vmin[2], vmax[2], grid->org[2], grid->pitch[2], grid->size[2], sub->omin, sub->omax, &r[2], &r[3] );
+    if( r[0] < j0 ) r[0] = j0;
+    if( r[1] > j1 ) r[1] = j1;
+    if( r[2] < k0 ) r[2] = k0;
+    if( r[3] > k1 ) r[3] = k1;
+
+    for( k=r[2]; k<=r[3]; k++ ) {
+        for( j=r[0]; j<=r[1]; j++ ) {
+          int row = ((k - tk*NPT_VOXEL_TILE)*NPT_VOXEL_TILE + (j - tj*NPT_VOXEL_TILE))*sub->num;
+          for( is=0; is<sub->num; is++ ) {
+            double py = grid->org[1] + (j + sub->off[is][0])*grid->pitch[1];
+            double pz = grid->org[2] + (k + sub->off[is][1])*grid->pitch[2];
+            double w[3], sum, x, eta, xi;
+            int    sg[3];
+
+            // 包含箱の外側の走査線は交差しない
+            if( py < vmin[1] || py > vmax[1] || pz < vmin[2] || pz > vmax[2] ) continue;
+
+            sg[0] = npt_voxel_edgeFunc( p[1], p[2], py, pz, &w[0] );
+            sg[1] = npt_voxel_edgeFunc( p[2], p[0], py, pz, &w[1] );
+            sg[2] = npt_voxel_edgeFunc( p[0], p[1], py, pz, &w[2] );
+            if( sg[0] == 0 || sg[0] != sg[1] || sg[0] != sg[2] ) continue;
+
+            sum = w[0] + w[1] + w[2];
+            if( sum == 0.0 ) continue;
+            x = eta = xi = 0.0;
+            for( l=0; l<3; l++ ) {
+                x   += w[l]*p[l][0];
+                eta += w[l]*ts->par[v[l]][0];
+                xi  += w[l]*ts->par[v[l]][1];
+            }
+            x /= sum; eta /= sum; xi /= sum;
+
+            if( buf->num == buf->max ) {
+                npt_voxel_hit* h = (npt_voxel_hit*)realloc( buf->hit, sizeof(npt_voxel_hit)*2*buf->max );
+                if( h == NULL ) return 1;
+                buf->hit = h;
+                buf->max *= 2;
+            }
+            buf->hit[buf->num].row = row + is;
+            buf->hit[buf->num].x   = npt_voxel_refine( t, cp, eta, xi, py, pz, x, ts->n, grid );
+            buf->num++;
+          }
+        }
+    }
+    return 0;
+}
+
+
+// 曲面上の交点
+//    (y,z) が行の点と一致する (eta,xi) を Newton 法で求め、その x 座標を返す。
+//    収束しない場合、パラメータが分割三角形の近傍を外れる場合は平面三角形の交点を返す。
+static NPT_REAL
+npt_voxel_refine(
+        NPT_REAL               t[3][3],   // [in]    三角形の頂点座標
+        NPT_REAL               cp[7][3],  // [in]    長田パッチパラメータ
+        double                 eta,       // [in]    平面三角形の交点の (eta,xi)
+        double                 xi,        // [in]
+        double                 py,        // [in]    行の点
+        double                 pz,        // [in]
+        double                 xflat,     // [in]    平面三角形の交点の x 座標
+        int                    n,         // [in]    辺の分割数
+        const NPT_VOXEL_GRID*  grid       // [in]    直交格子
+    )
+{
+    double   tol = NPT_VOXEL_TOL*std::min( grid->pitch[1], grid->pitch[2] );
+    double   e = eta, s = xi;
+    NPT_REAL pos[3], d_eta[3], d_xi[3];
+    int      it;
+
+    for( it=0; it<NPT_VOXEL_NEWTON; it++ ) {
+        double ry, rz, det, de, ds;
+
+        npt_curv_tangent( (NPT_REAL)e, (NPT_REAL)s, t, cp, pos, d_eta, d_xi );
+        ry = pos[1] - py;
+        rz = pos[2] - pz;
+        if( fabs( ry ) <= tol && fabs( rz ) <= tol ) return pos[0];
+
+        det = (double)d_eta[1]*d_xi[2] - (double)d_eta[2]*d_xi[1];
+        if( det == 0.0 ) break;
+        de = ( ry*d_xi[2] - rz*d_xi[1] )/det;
+        ds = ( d_eta[1]*rz - d_eta[2]*ry )/det;
+        e -= de;
+        s -= ds;
+        if( fabs( e - eta ) > 1.0/n || fabs( s - xi ) > 1.0/n ||
+            s < -0.5/n || e > 1.0 + 0.5/n || s > e + 0.5/n ) break;
+    }
+    return (NPT_REAL)xflat;
+}
+
+
+// タイルの行の塗りつぶし
+//    交点を行、x の順に並べ、奇数番目から偶数番目の交点の間に中心があるセルを内部とする。
+//    交点の数が奇数の行の数を返す。
+static int
+npt_voxel_fill(
+        npt_voxel_buf*         buf,       // [inout] 交点の配列
+        const NPT_VOXEL_GRID*  grid,      // [in]    直交格子
+        const npt_voxel_sub*   sub,       // [in]    セルの行の走査線（セル中心の１本）
+        int                    tj,        // [in]    タイル番号 (y)
+        int                    tk,        // [in]    タイル番号 (z)
+        void*                  ctx        // [inout] セルの内外フラグ
+    )
+{
+    unsigned int* flag = (unsigned int*)ctx;
+    int nx = grid->size[0];
+    int nw = NPT_VOXEL_ROW_WORDS( nx );
+    int odd = 0;
+    int l, e;
+
+    std::sort( buf->hit, buf->hit + buf->num, npt_voxel_hit_less() );
+
+    for( l=0; l<buf->num; l=e ) {
+        int           row = buf->hit[l].row;
+        int           j   = tj*NPT_VOXEL_TILE + (row/sub->num) % NPT_VOXEL_TILE;
+        int           k   = tk*NPT_VOXEL_TILE + (row/sub->num) / NPT_VOXEL_TILE;
+        unsigned int* rw  = flag + ((size_t)k*grid->size[1] + j)*nw;
+        int           m;
+
+        for( e=l; e<buf->num && buf->hit[e].row == row; e++ ) ;
+        if( (e - l) % 2 != 0 ) odd++;
+
+        for( m=l; m+1<e; m+=2 ) {
+            double a = ((double)buf->hit[m  ].x - grid->org[0])/grid->pitch[0] - 0.5;
+            double b = ((double)buf->hit[m+1].x - grid->org[0])/grid->pitch[0] - 0.5;
+            int    i0, i1;
+
+            if( b < 0.0 || a >= nx - 1.0 ) continue;
+            i0 = ( a < 0.0 ) ? 0 : (int)floor( a ) + 1;
+            i1 = ( b > nx ) ? nx - 1 : (int)ceil( b ) - 1;
+            if( i1 > nx - 1 ) i1 = nx - 1;
+            if( i0 <= i1 ) npt_voxel_setBits( rw, i0, i1 );
+        }
+    }
+    return odd;
+}
+
+
+// 行のビット i0-i1 を 1 にする
+static void
+npt_voxel_setBits(
+        unsigned int*  row,        // [inout] 行の語
+        int            i0,         // [in]    最初のセル
+        int            i1          // [in]    最後のセル
+    )
+{
+    int w0 = i0/32, w1 = i1/32;
+    int w;
+
+    if( w0 == w1 ) {
+        row[w0] |= ( 0xFFFFFFFFu >> (31 - (i1 - i0)) ) << (i0 % 32);
+        return;
+    }
+    row[w0] |= 0xFFFFFFFFu << (i0 % 32);
+    for( w=w0+1; w<w1; w++ ) row[w] = 0xFFFFFFFFu;
+    row[w1] |= 0xFFFFFFFFu >> (31 - (i1 % 32));
+}
+
+
+// タイルの切断セル
+//    セルの行ごとに全ての走査線の交点を x の順に並べて走査する。
+//    交点の数が奇数の走査線は最後の交点を除く（以降を流体とする）。
+static int
+npt_voxel_cutTile(
+        npt_voxel_buf*         buf,       // [inout] 交点の配列
+        const NPT_VOXEL_GRID*  grid,      // [in]    直交格子
+        const npt_voxel_sub*   sub,       // [in]    セルの行の走査線
+        int                    tj,        // [in]    タイル番号 (y)
+        int                    tk,        // [in]    タイル番号 (z)
+        void*                  ctx        // [inout] 切断セルの走査の作業領域
+    )
+{
+    npt_voxel_cutCtx* cc  = (npt_voxel_cutCtx*)ctx;
+    npt_voxel_hit*    ev;
+    int               odd = 0;
+    int               l, e;
+
+    if( buf->num == 0 ) return 0;
+    ev = (npt_voxel_hit*)malloc( sizeof(npt_voxel_hit)*buf->num );
+    if( ev == NULL ) return -1;
+
+    std::sort( buf->hit, buf->hit + buf->num, npt_voxel_hit_less() );
+
+    for( l=0; l<buf->num; l=e ) {
+        int cr = buf->hit[l].row / sub->num;
+        int n  = 0;
+        int m, f;
+
+        // セルの行の交点（走査線番号、x）
+        for( e=l; e<buf->num && buf->hit[e].row / sub->num == cr; e=f ) {
+            for( f=e; f<buf->num && buf->hit[f].row == buf->hit[e].row; f++ ) ;
+            if( (f - e) % 2 != 0 ) odd++;
+            for( m=e; m<e+(f-e)/2*2; m++ ) {
+                ev[n].row = buf->hit[m].row % sub->num;
+                ev[n].x   = buf->hit[m].x;
+                n++;
+            }
+        }
+        std::sort( ev, ev + n, npt_voxel_hit_less_x() );
+
+        if( npt_voxel_cutSweep( ev, n, grid, cc->nsub,
+                                tj*NPT_VOXEL_TILE + cr % NPT_VOXEL_TILE,
+                                tk*NPT_VOXEL_TILE + cr / NPT_VOXEL_TILE, &cc->tile[tk*cc->ntj + tj] ) != 0 ) {
+            free( ev );
+            return -1;
+        }
+    }
+    free( ev );
+    return odd;
+}
+
+
+// セルの行の切断セル
+//    走査線ごとの固体（曲面の内部）の長さをグループ単位に積分し、セルの体積率、
+//    y, z の下側の面の開口率を求める。x の下側の面はセル内部の走査線の状態から求める。
+//    全ての走査線の状態が同じで交点のないセルは出力しない。
+static int
+npt_voxel_cutSweep(
+        const npt_voxel_hit*   ev,        // [in]    交点（走査線番号、x の順）
+        int                    num_ev,    // [in]    交点の数
+        const NPT_VOXEL_GRID*  grid,      // [in]    直交格子
+        int                    nsub,      // [in]    セルの辺あたりの分割数
+        int                    j,         // [in]    セルの行
+        int                    k,         // [in]
+        npt_voxel_cutBuf*      out        // [inout] 切断セル
+    )
+{
+    char   solid[NPT_VOXEL_MAX_SUB*NPT_VOXEL_MAX_SUB + 2*NPT_VOXEL_MAX_SUB];
+    int    full[NPT_VOXEL_NUM_GROUP] = { nsub*nsub, nsub, nsub };
+    int    cnt[NPT_VOXEL_NUM_GROUP]  = { 0, 0, 0 };
+    int    num = nsub*nsub + 2*nsub;
+    int    nx  = grid->size[0];
+    double org = grid->org[0], h = grid->pitch[0];
+    int    tot = 0;
+    int    e = 0, i = 0, g;
+
+    memset( solid, 0, sizeof(char)*num );
+
+    // 格子の前の交点
+    while( e < num_ev && (double)ev[e].x <= org ) {
+        tot += npt_voxel_cutToggle( solid, cnt, nsub, ev[e].row );
+        e++;
+    }
+
+    while( i < nx ) {
+        double   x0 = org + i*h, x1 = org + (i+1)*h, xp = x0;
+        double   acc[NPT_VOXEL_NUM_GROUP] = { 0.0, 0.0, 0.0 };
+        int      xf = cnt[0];
+        int      hit = 0;
+        NPT_REAL area[3];
+
+        // 交点まで状態が一様なセルを飛ばす
+        if( tot == 0 || tot == num ) {
+            int ie;
+            if( e >= num_ev ) break;
+            ie = (int)floor( ((double)ev[e].x - org)/h ) - 1;
+            if( ie > i ) {
+                i = ( ie < nx ) ? ie : nx;
+                continue;
+            }
+        }
+
+        for( ; e<num_ev && (double)ev[e].x < x1; e++ ) {
+            double x = ev[e].x;
+            for( g=0; g<NPT_VOXEL_NUM_GROUP; g++ ) acc[g] += cnt[g]*( x - xp );
+            xp = x;
+            tot += npt_voxel_cutToggle( solid, cnt, nsub, ev[e].row );
+            hit = 1;
+        }
+        for( g=0; g<NPT_VOXEL_NUM_GROUP; g++ ) acc[g] += cnt[g]*( x1 - xp );
+
+        // 交点のないセルは走査線の状態が一様でない場合のみ（x の下側の面を含む）
+        if( hit || ( tot != 0 && tot != num ) ) {
+            area[0] = (NPT_REAL)( 1.0 - (double)xf/full[0] );
+            area[1] = (NPT_REAL)( 1.0 - acc[1]/( full[1]*h ) );
+            area[2] = (NPT_REAL)( 1.0 - acc[2]/( full[2]*h ) );
+            if( npt_voxel_cutAdd( out, i, j, k, (NPT_REAL)( 1.0 - acc[0]/( full[0]*h ) ), area ) != 0 ) return 1;
+        }
+        i++;
+    }
+    return 0;
+}
+
+
+// 走査線の状態（固体、流体）の反転
+//    グループの固体の走査線数を更新し、固体の走査線数の増分を返す
+static int
+npt_voxel_cutToggle(
+        char*  solid,                      // [inout] 走査線の状態（1:固体）
+        int    cnt[NPT_VOXEL_NUM_GROUP],   // [inout] グループの固体の走査線数
+        int    nsub,                       // [in]    セルの辺あたりの分割数
+        int    s                           // [in]    走査線番号
+    )
+{
+    int g = ( s < nsub*nsub ) ? 0 : ( s < nsub*nsub + nsub ) ? 1 : 2;
+    int d = solid[s] ? -1 : 1;
+
+    solid[s] = (char)!solid[s];
+    cnt[g]  += d;
+    return d;
+}
+
+
+// 切断セルの追加
+static int
+npt_voxel_cutAdd(
+        npt_voxel_cutBuf*  out,        // [inout] 切断セル
+        int                i,          // [in]    セル番号
+        int                j,          // [in]
+        int                k,          // [in]
+        NPT_REAL           vol,        // [in]    体積率
+        NPT_REAL           area[3]     // [in]    x, y, z の下側の面の開口率
+    )
+{
+    if( out->num == out->max ) {
+        int       max = ( out->max > 0 ) ? 2*out->max : 256;
+        int     (*idx)[3]  = (int(*)[3])realloc( out->idx, sizeof(int)*3*max );
+        NPT_REAL* v        = NULL;
+        NPT_REAL(*a)[3]    = NULL;
+
+        if( idx == NULL ) return 1;
+        out->idx = idx;
+        v = (NPT_REAL*)realloc( out->vol, sizeof(NPT_REAL)*max );
+        if( v == NULL ) return 1;
+        out->vol = v;
+        a = (NPT_REAL(*)[3])realloc( out->area, sizeof(NPT_REAL)*3*max );
+        if( a == NULL ) return 1;
+        out->area = a;
+        out->max  = max;
+    }
+    out->idx[out->num][0] = i;
+    out->idx[out->num][1] = j;
+    out->idx[out->num][2] = k;
+    out->vol[out->num]    = vol;
+    out->area[out->num][0] = area[0];
+    out->area[out->num][1] = area[1];
+    out->area[out->num][2] = area[2];
+    out->num++;
+    return 0;
+}
+
@@ -0,0 +1,552 @@
+/*
+ * Npatch - Nagata Patch Library
+ *
+ * Copyright (c) 2015-2016 Advanced Institute for Computational Science, RIKEN.
+ * All rights reserved.
+ *
+ */
+
+////////////////////////////////////////////////////////////////////////////
+///
+/// 長田パッチ 一般化巻き数による点の内外判定 関数
+///
+////////////////////////////////////////////////////////////////////////////
+
+
+#include "Npt_Wind.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+// 検索時の節点スタックの大きさ（中央値分割のため深さは log2(パッチ数) 程度）
+#define NPT_WIND_STACK   128
+
+// 近傍のパッチを求積する距離（包含箱の対角長との比）
+#define NPT_WIND_NEAR    0.5
+
+// 求積点数
+#define NPT_WIND_NUM_PNT   7
+
+// 求積公式（Dunavant 次数5、重心座標 (w,u,v) と重み（合計1））
+//    N = x_eta × x_xi は (eta,xi) の４次式のため、双極子 ∫N dA は厳密となる
+static const double npt_wind_pnt[NPT_WIND_NUM_PNT][4] = {
+    { 0.333333333333333, 0.333333333333333, 0.333333333333333, 0.225000000000000 },
+    { 0.059715871789770, 0.470142064105115, 0.470142064105115, 0.132394152788506 },
+    { 0.470142064105115, 0.059715871789770, 0.470142064105115, 0.132394152788506 },
+    { 0.470142064105115, 0.470142064105115, 0.059715871789770, 0.132394152788506 },
+    { 0.797426985353087, 0.101286507323456, 0.101286507323456, 0.125939180544827 },
+    { 0.101286507323456, 0.797426985353087, 0.101286507323456, 0.125939180544827 },
+    { 0.101286507323456, 0.101286507323456, 0.797426985353087, 0.125939180544827 },
+};
+
+//------------------------------------------------------------------
+//  プロトタイプ宣言
+//------------------------------------------------------------------
+static int    npt_wind_run( int num, NPT_REAL (*tri)[3][3], NPT_REAL (*npatch)[7][3], NPT_MESH* mesh,
+                            NPT_WIND* wind );
+static void   npt_wind_patchMoment( NPT_REAL tri[3][3], NPT_REAL cp[7][3], NPT_WIND_MOMENT* mo );
+static void   npt_wind_merge( const NPT_WIND_MOMENT* a, const NPT_WIND_MOMENT* b, NPT_WIND_MOMENT* mo );
+static double npt_wind_point( const NPT_WIND* wind, const double q[3], double beta );
+static double npt_wind_far( const NPT_WIND_MOMENT* mo, const double q[3] );
+static double npt_wind_near( NPT_REAL tri[3][3], NPT_REAL cp[7][3], const double q[3], int level );
+static void   npt_wind_patchPnt( NPT_REAL tri[3][3], NPT_REAL cp[7][3], const double bc[3], double x[3], double n[3] );
+static double npt_wind_quad( NPT_REAL tri[3][3], NPT_REAL cp[7][3], const double q[3] );
+static double npt_wind_solid( NPT_REAL tri[3][3], const double q[3] );
+
+
+// #################################################################
+//    公開関数
+// #################################################################
+
+/// 一般化巻き数の評価用データの作成（複数パッチ）
+///
+/// @param [in]    num          三角形数
+/// @param [in]    tri          三角形の頂点座標 [num]
+/// @param [in]    npatch       長田パッチパラメータ [num]
+/// @param [out]   wind         評価用データ
+/// @return リターンコード   =0 正常  !=0 異常（メモリ確保失敗）
+int
+npt_wind_crt_n(
+        int          num,
+        NPT_REAL     tri   [][3][3],
+        NPT_REAL     npatch[][7][3],
+        NPT_WIND*    wind
+    )
+{
+    return npt_wind_run( num, tri, npatch, NULL, wind );
+}
+
+
+/// 一般化巻き数の評価用データの作成（三角形メッシュ）
+///
+/// @param [in]    mesh         三角形メッシュ（vtx_norm 設定済み）
+/// @param [out]   wind         評価用データ
+/// @return リターンコード   =0 正常  !=0 異常（メモリ確保失敗）
+int
+npt_wind_crt(
+        NPT_MESH*    mesh,
+        NPT_WIND*    wind
+    )
+{
+    return npt_wind_run( mesh->num_tri, NULL, NULL, mesh, wind );
+}
+
+
+/// 一般化巻き数の評価用データの領域解放
+///
+/// @param [inout] wind         評価用データ
+/// @return なし
+void
+npt_wind_free(
+        NPT_WIND*    wind
+    )
+{
+    free( wind->tri );
+    free( wind->cp );
+    free( wind->patch );
+    free( wind->node );
+    npt_bvh_free( &wind->bvh );
+    wind->tri   = NULL;
+    wind->cp    = NULL;
+    wind->patch = NULL;
+    wind->node  = NULL;
+    wind->num   = 0;
+}
+
+
+/// 一般化巻き数（複数点）
+///
+/// @param [in]    wind         評価用データ
+/// @param [in]    num          点数
+/// @param [in]    pos          点の座標 [num]
+/// @param [in]    beta         遠方の展開を使う距離（展開の半径との比）
+/// @param [out]   wn           一般化巻き数 [num]
+/// @return リターンコード   =0 正常  !=0 異常（beta 不正）
+int
+npt_wind_eval_n(
+        const NPT_WIND*  wind,
+        int              num,
+        NPT_REAL         pos[][3],
+        NPT_REAL         beta,
+        NPT_REAL*        wn
+    )
+{
+    int i;
+
+    if( !( beta > 0.0 ) ) return 1;
+
+#pragma omp parallel for schedule(dynamic,64)
+    for( i=0; i<num; i++ ) {
+        double q[3] = { pos[i][0], pos[i][1], pos[i][2] };
+        wn[i] = (NPT_REAL)npt_wind_point( wind, q, beta );
+    }
+    return 0;
+}
+
+
+/// 点の内外判定（複数点）
+///
+/// @param [in]    wind         評価用データ
+/// @param [in]    num          点数
+/// @param [in]    pos          点の座標 [num]
+/// @param [in]    beta         遠方の展開を使う距離（展開の半径との比）
+/// @param [out]   inside       内外フラグ（1:内部 0:外部） [num]
+/// @return リターンコード   =0 正常  !=0 異常（beta 不正）
+int
+npt_wind_inside_n(
+        const NPT_WIND*  wind,
+        int              num,
+        NPT_REAL         pos[][3],
+        NPT_REAL         beta,
+        unsigned char*   inside
+    )
+{
+    int i;
+
+    if( !( beta > 0.0 ) ) return 1;
+
+#pragma omp parallel for schedule(dynamic,64)
+    for( i=0; i<num; i++ ) {
+        double q[3] = { pos[i][0], pos[i][1], pos[i][2] };
+        inside[i] = ( npt_wind_point( wind, q, beta ) > 0.5 ) ? 1 : 0;
+    }
+    return 0;
+}
+
+
+// #################################################################
+//    非公開（プライベート）関数
+// #################################################################
+
+// 評価用データの作成
+//    mesh != NULL の場合はメッシュ、それ以外は tri, npatch の配列を対象とする
+static int
+npt_wind_run(
+        int          num,          // [in]    三角形数
+        NPT_REAL   (*tri)[3][3],   // [in]    三角形の頂点座標 [num]
+        NPT_REAL   (*npatch)[7][3],// [in]    長田パッチパラメータ [num]
+        NPT_MESH*    mesh,         // [in]    三角形メッシュ
+        NPT_WIND*    wind          // [out]   評価用データ
+    )
+{
+    int n1 = ( num > 0 ) ? num : 1;
+    int i, nd;
+
+    memset( wind, 0, sizeof(NPT_WIND) );
+    wind->num   = num;
+    wind->tri   = (NPT_REAL(*)[3][3])malloc( n1*sizeof(NPT_REAL[3][3]) );
+    wind->cp    = (NPT_REAL(*)[7][3])malloc( n1*sizeof(NPT_REAL[7][3]) );
+    wind->patch = (NPT_WIND_MOMENT*)malloc( n1*sizeof(NPT_WIND_MOMENT) );
+    NPT_REAL (*box)[2][3] = (NPT_REAL(*)[2][3])malloc( n1*sizeof(NPT_REAL[2][3]) );
+    if( wind->tri == NULL || wind->cp == NULL || wind->patch == NULL || box == NULL ) {
+        free( box );
+        npt_wind_free( wind );
+        return 1;
+    }
+
+    // パッチの展開、包含箱（頂点と制御点の包含箱）
+#pragma omp parallel for schedule(static)
+    for( i=0; i<num; i++ ) {
+        int j, k;
+        for( j=0; j<3; j++ ) {
+            for( k=0; k<3; k++ ) {
+                wind->tri[i][j][k] = ( mesh != NULL ) ? mesh->vtx[ mesh->tri[i][j] ][k] : tri[i][j][k];
+            }
+        }
+        if( mesh != NULL ) {
+            npt_mesh_param_get( mesh, i, wind->cp[i] );
+        }
+        else {
+            memcpy( wind->cp[i], npatch[i], sizeof(NPT_REAL[7][3]) );
+        }
+        npt_wind_patchMoment( wind->tri[i], wind->cp[i], &wind->patch[i] );
+
+        for( k=0; k<3; k++ ) {
+            box[i][0][k] = box[i][1][k] = wind->tri[i][0][k];
+        }
+        for( j=0; j<10; j++ ) {
+            NPT_REAL* p = ( j < 3 ) ? wind->tri[i][j] : wind->cp[i][j-3];
+            for( k=0; k<3; k++ ) {
+                if( p[k] < box[i][0][k] ) box[i][0][k] = p[k];
+                if( p[k] > box[i][1][k] ) box[i][1][k] = p[k];
+            }
+        }
+    }
+
+    if( npt_bvh_crt( num, box, &wind->bvh ) != 0 ) {
+        free( box );
+        npt_wind_free( wind );
+        return 1;
+    }
+    free( box );
+
+    wind->node = (NPT_WIND_MOMENT*)malloc( ( wind->bvh.num_node > 0 ? wind->bvh.num_node : 1 )*sizeof(NPT_WIND_MOMENT) );
+    if( wind->node == NULL ) {
+        npt_wind_free( wind );
+        return 1;
+    }
+
+    // 節点の展開（子節点の番号は親節点より大きいため、番号の逆順に作成する）
+    for( nd=wind->bvh.num_node-1; nd>=0; nd-- ) {
+        const NPT_BVH* bvh = &wind->bvh;
+        if( bvh->child[nd][0] < 0 ) {
+            wind->node[nd] = wind->patch[ bvh->idx[ bvh->range[nd][0] ] ];
+            for( i=1; i<bvh->range[nd][1]; i++ ) {
+                NPT_WIND_MOMENT mo = wind->node[nd];
+                npt_wind_merge( &mo, &wind->patch[ bvh->idx[ bvh->range[nd][0] + i ] ], &wind->node[nd] );
+            }
+        }
+        else {
+            npt_wind_merge( &wind->node[ bvh->child[nd][0] ], &wind->node[ bvh->child[nd][1] ], &wind->node[nd] );
+        }
+    }
+    return 0;
+}
+
+
+// パッチの展開
+//    求積点の x, N = x_eta × x_xi から表面積、面積重心、双極子、２次の展開を求め、
+//    展開の半径は面積重心から頂点、制御点までの最大距離とする（凸包性により曲面を含む）
+static void
+npt_wind_patchMoment(
+        NPT_REAL          tri[3][3], // [in]    三角形の頂点座標
+        NPT_REAL          cp[7][3],  // [in]    長田パッチパラメータ
+        NPT_WIND_MOMENT*  mo         // [out]   展開
+    )
+{
+    double x[NPT_WIND_NUM_PNT][3], n[NPT_WIND_NUM_PNT][3], a[NPT_WIND_NUM_PNT];
+    int    q, j, k;
+
+    memset( mo, 0, sizeof(NPT_WIND_MOMENT) );
+    for( q=0; q<NPT_WIND_NUM_PNT; q++ ) {
+        double w = 0.5*npt_wind_pnt[q][3];
+
+        npt_wind_patchPnt( tri, cp, npt_wind_pnt[q], x[q], n[q] );
+        for( k=0; k<3; k++ ) n[q][k] *= w;
+        a[q] = sqrt( n[q][0]*n[q][0] + n[q][1]*n[q][1] + n[q][2]*n[q][2] );
+        for( k=0; k<3; k++ ) {
+            mo->cen[k] += a[q]*x[q][k];
+            mo->dip[k] += n[q][k];
+        }
+        mo->area += a[q];
+    }
+    for( k=0; k<3; k++ ) {
+        mo->cen[k] = ( mo->area > 0.0 ) ? mo->cen[k]/mo->area : ( (double)tri[0][k] + tri[1][k] + tri[2][k] )/3.0;
+    }
+    for( q=0; q<NPT_WIND_NUM_PNT; q++ ) {
+        for( j=0; j<3; j++ ) {
+            for( k=0; k<3; k++ ) mo->quad[j][k] += ( x[q][j] - mo->cen[j] )*n[q][k];
+        }
+    }
+    for( j=0; j<10; j++ ) {
+        NPT_REAL* p = ( j < 3 ) ? tri[j] : cp[j-3];
+        double    d[3] = { p[0] - mo->cen[0], p[1] - mo->cen[1], p[2] - mo->cen[2] };
+        double    r = sqrt( d[0]*d[0] + d[1]*d[1] + d[2]*d[2] );
+        if( r > mo->rad ) mo->rad = r;
+    }
+}
+
+
+// 展開の和（展開中心を面積重心に移す）
+static void
+npt_wind_merge(
+        const NPT_WIND_MOMENT*  a,   // [in]    展開
+        const NPT_WIND_MOMENT*  b,   // [in]    展開
+        NPT_WIND_MOMENT*        mo   // [out]   展開の和（a, b と異なる領域）
+    )
+{
+    const NPT_WIND_MOMENT* ab[2] = { a, b };
+    int m, j, k;
+
+    mo->area = a->area + b->area;
+    for( k=0; k<3; k++ ) {
+        mo->cen[k] = ( mo->area > 0.0 ) ? ( a->area*a->cen[k] + b->area*b->cen[k] )/mo->area
+                                        : 0.5*( a->cen[k] + b->cen[k] );
+        mo->dip[k] = a->dip[k] + b->dip[k];
+    }
+    mo->rad = 0.0;
+    for( j=0; j<3; j++ ) {
+        for( k=0; k<3; k++ ) mo->quad[j][k] = 0.0;
+    }
+    for( m=0; m<2; m++ ) {
+        double d[3] = { ab[m]->cen[0] - mo->cen[0], ab[m]->cen[1] - mo->cen[1], ab[m]->cen[2] - mo->cen[2] };
+        double r = sqrt( d[0]*d[0] + d[1]*d[1] + d[2]*d[2] ) + ab[m]->rad;
+        if( r > mo->rad ) mo->rad = r;
+        // ∫(x-c)N^T = ∫(x-c_m)N^T + (c_m-c) D_m^T
+        for( j=0; j<3; j++ ) {
+            for( k=0; k<3; k++ ) mo->quad[j][k] += ab[m]->quad[j][k] + d[j]*ab[m]->dip[k];
+        }
+    }
+}
+
+
+// １点の一般化巻き数
+static double
+npt_wind_point(
+        const NPT_WIND*  wind,     // [in]    評価用データ
+        const double     q[3],     // [in]    点の座標
+        double           beta      // [in]    遠方の展開を使う距離（展開の半径との比）
+    )
+{
+    const NPT_BVH* bvh = &wind->bvh;
+    int    stack[NPT_WIND_STACK];
+    int    sp = 0;
+    double w  = 0.0;
+    int    i;
+
+    if( bvh->num_node == 0 ) return 0.0;
+
+    stack[sp++] = 0;
+    while( sp > 0 ) {
+        int                    nd = stack[--sp];
+        const NPT_WIND_MOMENT* mo = &wind->node[nd];
+        double d[3] = { mo->cen[0] - q[0], mo->cen[1] - q[1], mo->cen[2] - q[2] };
+
+        if( d[0]*d[0] + d[1]*d[1] + d[2]*d[2] > beta*beta*mo->rad*mo->rad ) {
+            w += npt_wind_far( mo, q );
+        }
+        else if( bvh->child[nd][0] < 0 ) {
+            for( i=0; i<bvh->range[nd][1]; i++ ) {
+                int                    ip = bvh->idx[ bvh->range[nd][0] + i ];
+                const NPT_WIND_MOMENT* mp = &wind->patch[ip];
+                double e[3] = { mp->cen[0] - q[0], mp->cen[1] - q[1], mp->cen[2] - q[2] };
+
+                if( e[0]*e[0] + e[1]*e[1] + e[2]*e[2] > beta*beta*mp->rad*mp->rad ) {
+                    w += npt_wind_far( mp, q );
+                }
+                else {
+                    w += npt_wind_near( wind->tri[ip], wind->cp[ip], q, 0 );
+                }
+            }
+        }
+        else {
+            stack[sp++] = bvh->child[nd][1];
+            stack[sp++] = bvh->child[nd][0];
+        }
+    }
+    return w/( 4.0*PAI );
+}
+
+
+// 展開による立体角（遠方）
+//    f(x) = (x-q).N/|x-q|^3 を展開中心 c で Taylor 展開し、r = c - q として
+//    D.r/|r|^3 + Σ C_ij ( δ_ij/|r|^3 - 3 r_i r_j/|r|^5 )
+static double
+npt_wind_far(
+        const NPT_WIND_MOMENT*  mo,  // [in]    展開
+        const double            q[3] // [in]    点の座標
+    )
+{
+    double r[3] = { mo->cen[0] - q[0], mo->cen[1] - q[1], mo->cen[2] - q[2] };
+    double r2   = r[0]*r[0] + r[1]*r[1] + r[2]*r[2];
+    double ir   = 1.0/sqrt( r2 );
+    double ir3  = ir*ir*ir;
+    double rcr  = 0.0;
+    int    j, k;
+
+    for( j=0; j<3; j++ ) {
+        for( k=0; k<3; k++ ) rcr += r[j]*mo->quad[j][k]*r[k];
+    }
+    return ( mo->dip[0]*r[0] + mo->dip[1]*r[1] + mo->dip[2]*r[2] )*ir3
+         + ( mo->quad[0][0] + mo->quad[1][1] + mo->quad[2][2] )*ir3 - 3.0*rcr*ir3*ir*ir;
+}
+
+
+// パッチの立体角（近傍、再帰）
+//    点と包含箱の距離が対角長の NPT_WIND_NEAR 倍を超えれば求積し、それ以外は４分割する。
+//    分割の深さが NPT_WIND_MAX_DEPTH の子パッチは頂点の平面三角形とする
+static double
+npt_wind_near(
+        NPT_REAL      tri[3][3],   // [in]    三角形の頂点座標
+        NPT_REAL      cp[7][3],    // [in]    長田パッチパラメータ
+        const double  q[3],        // [in]    点の座標
+        int           level        // [in]    分割の深さ
+    )
+{
+    double box[2][3], dist2 = 0.0, diag2 = 0.0;
+    int    j, k;
+
+    for( k=0; k<3; k++ ) {
+        box[0][k] = box[1][k] = tri[0][k];
+    }
+    for( j=1; j<10; j++ ) {
+        NPT_REAL* p = ( j < 3 ) ? tri[j] : cp[j-3];
+        for( k=0; k<3; k++ ) {
+            if( p[k] < box[0][k] ) box[0][k] = p[k];
+            if( p[k] > box[1][k] ) box[1][k] = p[k];
+        }
+    }
+    for( k=0; k<3; k++ ) {
+        double e = ( q[k] < box[0][k] ) ? box[0][k] - q[k] : ( q[k] > box[1][k] ) ? q[k] - box[1][k] : 0.0;
+        dist2 += e*e;
+        diag2 += ( box[1][k] - box[0][k] )*( box[1][k] - box[0][k] );
+    }
+
+    if( dist2 > NPT_WIND_NEAR*NPT_WIND_NEAR*diag2 ) {
+        return npt_wind_quad( tri, cp, q );
+    }
+    if( level >= NPT_WIND_MAX_DEPTH ) {
+        return npt_wind_solid( tri, q );
+    }
+
+    NPT_REAL sub_tri[4][3][3], sub_cp[4][7][3];
+    double   w = 0.0;
+    int      c;
+
+    npt_subdiv( tri, cp, sub_tri, sub_cp );
+    for( c=0; c<4; c++ ) {
+        w += npt_wind_near( sub_tri[c], sub_cp[c], q, level + 1 );
+    }
+    return w;
+}
+
+
+// 曲面上の点と N = x_eta × x_xi
+//    重心座標 (w,u,v)（w は頂点1、u は頂点2、v は頂点3 の重み）の３次 Bernstein 基底による。
+//    x(u,v,w) の偏微分 x_u, x_v, x_w から x_eta = x_u - x_w, x_xi = x_v - x_u
+static void
+npt_wind_patchPnt(
+        NPT_REAL      tri[3][3],   // [in]    三角形の頂点座標
+        NPT_REAL      cp[7][3],    // [in]    長田パッチパラメータ
+        const double  bc[3],       // [in]    重心座標 (w,u,v)
+        double        x[3],        // [out]   曲面上の点
+        double        n[3]         // [out]   N = x_eta × x_xi
+    )
+{
+    double w = bc[0], u = bc[1], v = bc[2];
+    //                      P1      c11      c12      P2     c21      c22      P3     c31      c32      cc
+    double bs[10] = { w*w*w, 3*u*w*w, 3*u*u*w, u*u*u, 3*u*u*v, 3*u*v*v, v*v*v, 3*v*v*w, 3*v*w*w, 6*u*v*w };
+    double du[10] = { 0,     3*w*w,   6*u*w,   3*u*u, 6*u*v,   3*v*v,   0,     0,       0,       6*v*w   };
+    double dv[10] = { 0,     0,       0,       0,     3*u*u,   6*u*v,   3*v*v, 6*v*w,   3*w*w,   6*u*w   };
+    double dw[10] = { 3*w*w, 6*u*w,   3*u*u,   0,     0,       0,       0,     3*v*v,   6*v*w,   6*u*v   };
+    const NPT_REAL* p[10] = { tri[0], cp[0], cp[1], tri[1], cp[2], cp[3], tri[2], cp[4], cp[5], cp[6] };
+    double xe[3] = { 0.0, 0.0, 0.0 }, xx[3] = { 0.0, 0.0, 0.0 };
+    int    j, k;
+
+    x[0] = x[1] = x[2] = 0.0;
+    for( j=0; j<10; j++ ) {
+        double de = du[j] - dw[j], dx = dv[j] - du[j];
+        for( k=0; k<3; k++ ) {
+            x[k]  += bs[j]*p[j][k];
+            xe[k] += de*p[j][k];
+            xx[k] += dx*p[j][k];
+        }
+    }
+    n[0] = xe[1]*xx[2] - xe[2]*xx[1];
+    n[1] = xe[2]*xx[0] - xe[0]*xx[2];
+    n[2] = xe[0]*xx[1] - xe[1]*xx[0];
+}
+
+
+// パッチの立体角（求積）
+static double
+npt_wind_quad(
+        NPT_REAL      tri[3][3],   // [in]    三角形の頂点座標
+        NPT_REAL      cp[7][3],    // [in]    長田パッチパラメータ
+        const double  q[3]         // [in]    点の座標
+    )
+{
+    double w = 0.0;
+    int    p;
+
+    for( p=0; p<NPT_WIND_NUM_PNT; p++ ) {
+        double x[3], n[3], r2;
+
+        npt_wind_patchPnt( tri, cp, npt_wind_pnt[p], x, n );
+        x[0] -= q[0];
+        x[1] -= q[1];
+        x[2] -= q[2];
+        r2    = x[0]*x[0] + x[1]*x[1] + x[2]*x[2];
+        w    += 0.5*npt_wind_pnt[p][3]*( x[0]*n[0] + x[1]*n[1] + x[2]*n[2] )/( r2*sqrt( r2 ) );
+    }
+    return w;
+}
+
+
+// 平面三角形の立体角（Van Oosterom-Strackee の式）
+//    a, b, c を頂点から点への相対位置として
+//    Ω = 2 atan2( a.(b×c), |a||b||c| + (a.b)|c| + (b.c)|a| + (c.a)|b| )
+static double
+npt_wind_solid(
+        NPT_REAL      tri[3][3],   // [in]    三角形の頂点座標
+        const double  q[3]         // [in]    点の座標
+    )
+{
+    double a[3], b[3], c[3];
+    int    k;
+
+    for( k=0; k<3; k++ ) {
+        a[k] = tri[0][k] - q[k];
+        b[k] = tri[1][k] - q[k];
+        c[k] = tri[2][k] - q[k];
+    }
+    double la  = sqrt( a[0]*a[0] + a[1]*a[1] + a[2]*a[2] );
+    double lb  = sqrt( b[0]*b[0] + b[1]*b[1] + b[2]*b[2] );
+    double lc  = sqrt( c[0]*c[0] + c[1]*c[1] + c[2]*c[2] );
+    double det = a[0]*( b[1]*c[2] - b[2]*c[1] ) + a[1]*( b[2]*c[0] - b[0]*c[2] ) + a[2]*( b[0]*c[1] - b[1]*c[0] );
+    double den = la*lb*lc + ( a[0]*b[0] + a[1]*b[1] + a[2]*b[2] )*lc
+                          + ( b[0]*c[0] + b[1]*c[1] + b[2]*c[2] )*la
+                          + ( c[0]*a[0] + c[1]*a[1] + c[2]*a[2] )*lb;
+
+    return 2.0*atan2( det, den );
+}